@@ -0,0 +1,78 @@
+#include "colmap/estimators/bundle_adjustment.h"
+
+#include "colmap/math/random.h"
+#include "colmap/scene/reconstruction.h"
+#include "colmap/scene/synthetic.h"
+
+#include <benchmark/benchmark.h>
+
+using namespace colmap;
+
+// Backend of the bundle adjuster selected by the last benchmark argument.
+enum class Backend { CERES = 0, SCHUR = 1, SCHUR_MIXED_PRECISION = 2 };
+
+class BM_BundleAdjustment : public benchmark::Fixture {
+ public:
+  void SetUp(::benchmark::State& state) {
+    SetPRNGSeed(0);
+    SyntheticDatasetOptions synthetic_options;
+    synthetic_options.num_cameras = 1;
+    synthetic_options.num_images = state.range(0);
+    synthetic_options.num_points3D = state.range(1);
+    synthetic_options.point2D_stddev = 1;
+    reconstruction = Reconstruction();
+    SynthesizeDataset(synthetic_options, &reconstruction);
+
+    // Perturb the points, such that the solvers need several iterations.
+    for (const auto& point3D : reconstruction.Points3D()) {
+      reconstruction.SetPoint3DXYZ(
+          point3D.first, point3D.second.xyz + 0.05 * Eigen::Vector3d::Random());
+    }
+
+    config = BundleAdjustmentConfig();
+    for (const image_t image_id : reconstruction.RegImageIds()) {
+      config.AddImage(image_id);
+    }
+    config.SetConstantCamPose(reconstruction.RegImageIds()[0]);
+    config.SetConstantCamPositions(reconstruction.RegImageIds()[1], {0});
+
+    const auto backend = static_cast<Backend>(state.range(2));
+    options = BundleAdjustmentOptions();
+    options.print_summary = false;
+    options.use_schur_solver = backend != Backend::CERES;
+    options.use_mixed_precision = backend == Backend::SCHUR_MIXED_PRECISION;
+  }
+
+  Reconstruction reconstruction;
+  BundleAdjustmentConfig config;
+  BundleAdjustmentOptions options;
+};
+
+BENCHMARK_DEFINE_F(BM_BundleAdjustment, Solve)(benchmark::State& state) {
+  double initial_cost = 0;
+  double final_cost = 0;
+  int num_iterations = 0;
+  for (auto _ : state) {
+    state.PauseTiming();
+    Reconstruction reconstruction_copy = reconstruction;
+    BundleAdjuster bundle_adjuster(options, config);
+    state.ResumeTiming();
+    bundle_adjuster.Solve(&reconstruction_copy);
+    const ceres::Solver::Summary& summary = bundle_adjuster.Summary();
+    initial_cost = summary.initial_cost;
+    final_cost = summary.final_cost;
+    num_iterations =
+        summary.num_successful_steps + summary.num_unsuccessful_steps;
+  }
+  state.counters["initial_cost"] = initial_cost;
+  state.counters["final_cost"] = final_cost;
+  state.counters["iterations"] = num_iterations;
+}
+
+// The arguments are the number of images, the number of points, and the
+// backend: Ceres, Schur, and Schur with mixed precision.
+BENCHMARK_REGISTER_F(BM_BundleAdjustment, Solve)
+    ->ArgsProduct({{10, 50}, {1000, 10000}, {0, 1, 2}})
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
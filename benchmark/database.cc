@@ -0,0 +1,113 @@
+#include "colmap/scene/database.h"
+
+#include "colmap/math/random.h"
+
+#include <algorithm>
+
+#include <benchmark/benchmark.h>
+
+using namespace colmap;
+
+constexpr int kNumKeypoints = 8000;
+constexpr int kNumMatches = 2000;
+
+// Keypoints and matches in the typical layout of the matcher output, where
+// the matches are sorted by the first index.
+static FeatureKeypoints CreateKeypoints() {
+  FeatureKeypoints keypoints;
+  keypoints.reserve(kNumKeypoints);
+  for (int i = 0; i < kNumKeypoints; ++i) {
+    keypoints.emplace_back(RandomUniformReal<float>(0, 4000),
+                           RandomUniformReal<float>(0, 3000),
+                           RandomUniformReal<float>(1, 10),
+                           RandomUniformReal<float>(-3.14f, 3.14f));
+  }
+  return keypoints;
+}
+
+static FeatureMatches CreateMatches() {
+  std::vector<point2D_t> point2D_idxs1(kNumKeypoints);
+  for (int i = 0; i < kNumKeypoints; ++i) {
+    point2D_idxs1[i] = i;
+  }
+  Shuffle(kNumMatches, &point2D_idxs1);
+  std::sort(point2D_idxs1.begin(), point2D_idxs1.begin() + kNumMatches);
+  FeatureMatches matches(kNumMatches);
+  for (int i = 0; i < kNumMatches; ++i) {
+    matches[i].point2D_idx1 = point2D_idxs1[i];
+    matches[i].point2D_idx2 = RandomUniformInteger(0, kNumKeypoints - 1);
+  }
+  return matches;
+}
+
+class BM_Database : public benchmark::Fixture {
+ public:
+  void SetUp(::benchmark::State& state) {
+    SetPRNGSeed(0);
+    database = std::make_unique<Database>(Database::kInMemoryDatabasePath);
+    database->SetBlobEncoding(
+        static_cast<Database::BlobEncoding>(state.range(0)));
+    keypoints = CreateKeypoints();
+    matches = CreateMatches();
+    camera_id = database->WriteCamera(
+        Camera::CreateFromModelName(kInvalidCameraId, "PINHOLE", 1, 1, 1));
+    image_id1 = WriteImage();
+    image_id2 = WriteImage();
+    database->WriteKeypoints(image_id1, keypoints);
+    database->WriteMatches(image_id1, image_id2, matches);
+  }
+
+  void TearDown(::benchmark::State& state) { database.reset(); }
+
+  image_t WriteImage() {
+    Image image;
+    image.SetName(std::to_string(database->NumImages()));
+    image.SetCameraId(camera_id);
+    return database->WriteImage(image);
+  }
+
+  std::unique_ptr<Database> database;
+  camera_t camera_id;
+  image_t image_id1;
+  image_t image_id2;
+  FeatureKeypoints keypoints;
+  FeatureMatches matches;
+};
+
+BENCHMARK_DEFINE_F(BM_Database, ReadKeypoints)(benchmark::State& state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(database->ReadKeypoints(image_id1));
+  }
+}
+
+BENCHMARK_DEFINE_F(BM_Database, WriteKeypoints)(benchmark::State& state) {
+  for (auto _ : state) {
+    state.PauseTiming();
+    const image_t image_id = WriteImage();
+    state.ResumeTiming();
+    database->WriteKeypoints(image_id, keypoints);
+  }
+}
+
+BENCHMARK_DEFINE_F(BM_Database, ReadMatches)(benchmark::State& state) {
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(database->ReadMatches(image_id1, image_id2));
+  }
+}
+
+BENCHMARK_DEFINE_F(BM_Database, WriteMatches)(benchmark::State& state) {
+  for (auto _ : state) {
+    state.PauseTiming();
+    const image_t image_id = WriteImage();
+    state.ResumeTiming();
+    database->WriteMatches(image_id1, image_id, matches);
+  }
+}
+
+// The argument is the blob encoding: RAW, PACKED, and PACKED_LZ4.
+BENCHMARK_REGISTER_F(BM_Database, ReadKeypoints)->DenseRange(0, 2);
+BENCHMARK_REGISTER_F(BM_Database, WriteKeypoints)->DenseRange(0, 2);
+BENCHMARK_REGISTER_F(BM_Database, ReadMatches)->DenseRange(0, 2);
+BENCHMARK_REGISTER_F(BM_Database, WriteMatches)->DenseRange(0, 2);
+
+BENCHMARK_MAIN();
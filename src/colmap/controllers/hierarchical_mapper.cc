@@ -35,67 +35,141 @@
 #include "colmap/util/misc.h"
 #include "colmap/util/threading.h"
 
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <mutex>
+
 namespace colmap {
 namespace {
 
+// State of a cluster in the cluster tree. A parent cluster is merged as soon
+// as all its child clusters are reconstructed or merged.
+struct ClusterState {
+  const SceneClustering::Cluster* parent_cluster = nullptr;
+  size_t num_pending_child_clusters = 0;
+  std::shared_ptr<ReconstructionManager> reconstruction_manager;
+};
+
+using ClusterStates =
+    std::unordered_map<const SceneClustering::Cluster*, ClusterState>;
+
+void InitializeClusterStates(const SceneClustering::Cluster& cluster,
+                             const SceneClustering::Cluster* parent_cluster,
+                             ClusterStates* cluster_states) {
+  ClusterState& cluster_state = (*cluster_states)[&cluster];
+  cluster_state.parent_cluster = parent_cluster;
+  cluster_state.num_pending_child_clusters = cluster.child_clusters.size();
+  cluster_state.reconstruction_manager =
+      std::make_shared<ReconstructionManager>();
+  for (const auto& child_cluster : cluster.child_clusters) {
+    InitializeClusterStates(child_cluster, &cluster, cluster_states);
+  }
+}
+
+// Merge the reconstructions of the child clusters, which must all be finished.
+// Only the states of the given cluster and its children are accessed, so that
+// sibling clusters can be merged concurrently.
 void MergeClusters(const SceneClustering::Cluster& cluster,
-                   std::unordered_map<const SceneClustering::Cluster*,
-                                      std::shared_ptr<ReconstructionManager>>*
-                       reconstruction_managers) {
+                   const int num_threads,
+                   ClusterStates* cluster_states) {
+  const double kMaxReprojError = 8.0;
+  const double kMinInlierObservations = 0.3;
+  // The alignment is estimated from a sample of the common images, since
+  // verifying the alignment on all observations of large overlaps dominates
+  // the merging time.
+  const int kMaxNumAlignmentImages = 100;
+
   // Extract all reconstructions from all child clusters.
   std::vector<std::shared_ptr<Reconstruction>> reconstructions;
   for (const auto& child_cluster : cluster.child_clusters) {
-    if (!child_cluster.child_clusters.empty()) {
-      MergeClusters(child_cluster, reconstruction_managers);
-    }
-
-    auto& reconstruction_manager = reconstruction_managers->at(&child_cluster);
+    auto& reconstruction_manager =
+        cluster_states->at(&child_cluster).reconstruction_manager;
     for (size_t i = 0; i < reconstruction_manager->Size(); ++i) {
       reconstructions.push_back(reconstruction_manager->Get(i));
     }
   }
 
-  // Try to merge all child cluster reconstruction.
-  while (reconstructions.size() > 1) {
+  std::sort(reconstructions.begin(),
+            reconstructions.end(),
+            [](const std::shared_ptr<Reconstruction>& reconstruction1,
+               const std::shared_ptr<Reconstruction>& reconstruction2) {
+              return reconstruction1->NumRegImages() >
+                     reconstruction2->NumRegImages();
+            });
+
+  // Merge all reconstructions at once into the largest one. The alignments to
+  // the largest reconstruction are independent and estimated in parallel.
+  // Reconstructions that cannot be aligned are retried after the others are
+  // merged, since they may overlap with the merged images. The remaining
+  // reconstructions are merged in the same way among themselves.
+  std::vector<std::shared_ptr<Reconstruction>> merged_reconstructions;
+  while (!reconstructions.empty()) {
+    std::shared_ptr<Reconstruction> tgt_reconstruction = reconstructions[0];
+    reconstructions.erase(reconstructions.begin());
+
     bool merge_success = false;
-    for (size_t i = 0; i < reconstructions.size(); ++i) {
-      const int num_reg_images_i = reconstructions[i]->NumRegImages();
-      for (size_t j = 0; j < i; ++j) {
-        const double kMaxReprojError = 8.0;
-        const int num_reg_images_j = reconstructions[j]->NumRegImages();
-        if (MergeAndFilterReconstructions(
-                kMaxReprojError, *reconstructions[j], *reconstructions[i])) {
-          LOG(INFO) << StringPrintf(
-              "=> Merged clusters with %d and %d images into %d images",
-              num_reg_images_i,
-              num_reg_images_j,
-              reconstructions[i]->NumRegImages());
-          reconstructions.erase(reconstructions.begin() + j);
-          merge_success = true;
-          break;
+    while (!reconstructions.empty()) {
+      std::vector<Sim3d> tgt_from_srcs(reconstructions.size());
+      std::vector<char> align_success(reconstructions.size(), false);
+      ThreadPool thread_pool(std::min(
+          num_threads, static_cast<int>(reconstructions.size())));
+      for (size_t i = 0; i < reconstructions.size(); ++i) {
+        thread_pool.AddTask([&, i]() {
+          align_success[i] =
+              AlignReconstructionsViaReprojections(*reconstructions[i],
+                                                   *tgt_reconstruction,
+                                                   kMinInlierObservations,
+                                                   kMaxReprojError,
+                                                   &tgt_from_srcs[i],
+                                                   kMaxNumAlignmentImages);
+        });
+      }
+      thread_pool.Wait();
+
+      std::vector<std::shared_ptr<Reconstruction>> unaligned_reconstructions;
+      for (size_t i = 0; i < reconstructions.size(); ++i) {
+        if (!align_success[i]) {
+          unaligned_reconstructions.push_back(reconstructions[i]);
+          continue;
         }
+        const int num_reg_images_src = reconstructions[i]->NumRegImages();
+        const int num_reg_images_tgt = tgt_reconstruction->NumRegImages();
+        MergeAlignedReconstructions(
+            tgt_from_srcs[i], *reconstructions[i], *tgt_reconstruction);
+        LOG(INFO) << StringPrintf(
+            "=> Merged clusters with %d and %d images into %d images",
+            num_reg_images_src,
+            num_reg_images_tgt,
+            tgt_reconstruction->NumRegImages());
+        merge_success = true;
       }
 
-      if (merge_success) {
+      if (unaligned_reconstructions.size() == reconstructions.size()) {
         break;
       }
+      reconstructions = std::move(unaligned_reconstructions);
     }
 
-    if (!merge_success) {
-      break;
+    // Filter the merged points once after all merges.
+    if (merge_success) {
+      ObservationManager(*tgt_reconstruction)
+          .FilterAllPoints3D(kMaxReprojError, /*min_tri_angle=*/0);
     }
+
+    merged_reconstructions.push_back(std::move(tgt_reconstruction));
   }
 
-  // Insert a new reconstruction manager for merged cluster.
-  auto& reconstruction_manager = (*reconstruction_managers)[&cluster];
-  reconstruction_manager = std::make_shared<ReconstructionManager>();
-  for (const auto& reconstruction : reconstructions) {
+  // Collect the merged reconstructions in the cluster's manager.
+  auto& reconstruction_manager =
+      cluster_states->at(&cluster).reconstruction_manager;
+  for (const auto& reconstruction : merged_reconstructions) {
     reconstruction_manager->Get(reconstruction_manager->Add()) = reconstruction;
   }
 
-  // Delete all merged child cluster reconstruction managers.
+  // Release all merged child cluster reconstruction managers.
   for (const auto& child_cluster : cluster.child_clusters) {
-    reconstruction_managers->erase(&child_cluster);
+    cluster_states->at(&child_cluster).reconstruction_manager.reset();
   }
 }
 
@@ -156,7 +230,7 @@ void HierarchicalMapperController::Run() {
   // Reconstruct clusters
   //////////////////////////////////////////////////////////////////////////////
 
-  PrintHeading1("Reconstructing clusters");
+  PrintHeading1("Reconstructing and merging clusters");
 
   // Determine the number of workers and threads per worker.
   const int kMaxNumThreads = -1;
@@ -170,37 +244,104 @@ void HierarchicalMapperController::Run() {
   const int num_threads_per_worker =
       std::max(1, num_eff_threads / num_eff_workers);
 
+  // Once fewer clusters than workers remain, the threads of the idle workers
+  // are lent to the clusters that are still being reconstructed.
+  std::atomic<int> num_unfinished_leaf_clusters(
+      static_cast<int>(leaf_clusters.size()));
+  auto GetNumThreadsPerCluster = [&]() {
+    const int num_busy_workers = std::max(
+        1, std::min(num_eff_workers, num_unfinished_leaf_clusters.load()));
+    return std::max(num_threads_per_worker, num_eff_threads / num_busy_workers);
+  };
+
+  // The cluster tree is merged bottom-up in the same thread pool. Sibling
+  // clusters are merged as soon as both are finished rather than after all
+  // leaf clusters are reconstructed. All states are created upfront, so that
+  // the map is not modified while the workers access it.
+  ClusterStates cluster_states;
+  InitializeClusterStates(
+      *scene_clustering.GetRootCluster(), nullptr, &cluster_states);
+
+  ThreadPool thread_pool(num_eff_workers);
+  std::mutex cluster_mutex;
+
+  std::function<void(const SceneClustering::Cluster*)> FinishCluster;
+  auto MergeCluster = [&](const SceneClustering::Cluster* cluster) {
+    MergeClusters(*cluster, GetNumThreadsPerCluster(), &cluster_states);
+    FinishCluster(cluster);
+  };
+  FinishCluster = [&](const SceneClustering::Cluster* cluster) {
+    const SceneClustering::Cluster* parent_cluster =
+        cluster_states.at(cluster).parent_cluster;
+    if (parent_cluster == nullptr) {
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(cluster_mutex);
+      if (--cluster_states.at(parent_cluster).num_pending_child_clusters > 0) {
+        return;
+      }
+    }
+    thread_pool.AddTask(MergeCluster, parent_cluster);
+  };
+
   // Function to reconstruct one cluster using incremental mapping.
-  std::mutex c_mutex;
-  auto ReconstructCluster =
-      [&, this](const SceneClustering::Cluster& cluster,
-                std::shared_ptr<ReconstructionManager> reconstruction_manager) {
-        if (cluster.image_ids.empty()) {
-          return;
-        }
+  std::mutex mappers_mutex;
+  std::atomic<size_t> next_cluster_idx(0);
+  auto ReconstructCluster = [&, this](
+                                const SceneClustering::Cluster* cluster) {
+    if (!cluster->image_ids.empty()) {
+      auto incremental_options = std::make_shared<IncrementalMapperOptions>(
+          options_.incremental_options);
+      incremental_options->max_model_overlap = 3;
+      incremental_options->init_num_trials = options_.init_num_trials;
+      const bool lend_threads = incremental_options->num_threads < 0;
+      if (lend_threads) {
+        incremental_options->num_threads = GetNumThreadsPerCluster();
+      }
 
-        auto incremental_options = std::make_shared<IncrementalMapperOptions>(
-            options_.incremental_options);
-        incremental_options->max_model_overlap = 3;
-        incremental_options->init_num_trials = options_.init_num_trials;
-        if (incremental_options->num_threads < 0) {
-          incremental_options->num_threads = num_threads_per_worker;
-        }
+      for (const auto image_id : cluster->image_ids) {
+        incremental_options->image_names.insert(image_id_to_name.at(image_id));
+      }
 
-        for (const auto image_id : cluster.image_ids) {
-          incremental_options->image_names.insert(
-              image_id_to_name.at(image_id));
-        }
+      // Clusters are reconstructed concurrently and need separate files.
+      if (!incremental_options->correspondence_graph_path.empty()) {
+        incremental_options->correspondence_graph_path +=
+            ".cluster" + std::to_string(next_cluster_idx++);
+      }
+
+      auto mapper = std::make_shared<IncrementalMapperController>(
+          incremental_options,
+          options_.image_path,
+          options_.database_path,
+          cluster_states.at(cluster).reconstruction_manager);
+
+      // The bundle adjustment options are created from the mapper options
+      // on demand, so updating the number of threads in the callbacks of the
+      // mapper's own thread takes effect at the next bundle adjustment.
+      if (lend_threads) {
+        IncrementalMapperOptions* options = incremental_options.get();
+        const auto UpdateNumThreads = [&, options]() {
+          options->num_threads = GetNumThreadsPerCluster();
+        };
+        mapper->AddCallback(
+            IncrementalMapperController::INITIAL_IMAGE_PAIR_REG_CALLBACK,
+            UpdateNumThreads);
+        mapper->AddCallback(
+            IncrementalMapperController::NEXT_IMAGE_REG_CALLBACK,
+            UpdateNumThreads);
+      }
 
-        auto mapper = std::make_shared<IncrementalMapperController>(std::move(incremental_options),
-                                           options_.image_path,
-                                           options_.database_path,
-                                           std::move(reconstruction_manager));
-        c_mutex.try_lock();
+      {
+        std::lock_guard<std::mutex> lock(mappers_mutex);
         mappers.emplace_back(mapper);
-        c_mutex.unlock();
-        mapper->Run();
-      };
+      }
+      mapper->Run();
+    }
+
+    num_unfinished_leaf_clusters -= 1;
+    FinishCluster(cluster);
+  };
 
   // Start reconstructing the bigger clusters first for better resource usage.
   std::sort(leaf_clusters.begin(),
@@ -211,35 +352,18 @@ void HierarchicalMapperController::Run() {
             });
 
   // Start the reconstruction workers. Use a separate reconstruction manager per
-  // thread to avoid race conditions.
-  std::unordered_map<const SceneClustering::Cluster*,
-                     std::shared_ptr<ReconstructionManager>>
-      reconstruction_managers;
-  reconstruction_managers.reserve(leaf_clusters.size());
-
-  ThreadPool thread_pool(num_eff_workers);
+  // cluster to avoid race conditions. The merges of the clusters are added to
+  // the thread pool by the workers once the child clusters are finished.
   for (const auto& cluster : leaf_clusters) {
-    reconstruction_managers[cluster] =
-        std::make_shared<ReconstructionManager>();
-    thread_pool.AddTask(
-        ReconstructCluster, *cluster, reconstruction_managers[cluster]);
+    thread_pool.AddTask(ReconstructCluster, cluster);
   }
   thread_pool.Wait();
 
-  //////////////////////////////////////////////////////////////////////////////
-  // Merge clusters
-  //////////////////////////////////////////////////////////////////////////////
-
-  if (leaf_clusters.size() > 1) {
-    PrintHeading1("Merging clusters");
-
-    MergeClusters(*scene_clustering.GetRootCluster(), &reconstruction_managers);
-  }
-
-  THROW_CHECK_EQ(reconstruction_managers.size(), 1);
-  THROW_CHECK_GT(
-      reconstruction_managers.begin()->second->Get(0)->NumRegImages(), 0);
-  *reconstruction_manager_ = *reconstruction_managers.begin()->second;
+  const auto& root_reconstruction_manager =
+      cluster_states.at(scene_clustering.GetRootCluster())
+          .reconstruction_manager;
+  THROW_CHECK_GT(root_reconstruction_manager->Get(0)->NumRegImages(), 0);
+  *reconstruction_manager_ = *root_reconstruction_manager;
 
   run_timer.PrintMinutes();
 }
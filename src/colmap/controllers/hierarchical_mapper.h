@@ -55,7 +55,9 @@ class HierarchicalMapperController : public BaseController {
     // The maximum number of trials to initialize a cluster.
     int init_num_trials = 10;
 
-    // The number of workers used to reconstruct clusters in parallel.
+    // The number of workers used to reconstruct and merge clusters in
+    // parallel. Unless the number of threads is set in the incremental
+    // options, the threads of idle workers are lent to the running clusters.
     int num_workers = -1;
 
     // Options for clustering the scene graph.
@@ -92,6 +92,36 @@ TEST(HierarchicalMapperController, WithoutNoise) {
                              /*num_obs_tolerance=*/0);
 }
 
+TEST(HierarchicalMapperController, SingleWorker) {
+  const std::string database_path = CreateTestDir() + "/database.db";
+
+  Database database(database_path);
+  Reconstruction gt_reconstruction;
+  SyntheticDatasetOptions synthetic_dataset_options;
+  synthetic_dataset_options.num_cameras = 2;
+  synthetic_dataset_options.num_images = 20;
+  synthetic_dataset_options.num_points3D = 50;
+  synthetic_dataset_options.point2D_stddev = 0;
+  SynthesizeDataset(synthetic_dataset_options, &gt_reconstruction, &database);
+
+  // The merges are scheduled in the same thread pool as the clusters.
+  auto reconstruction_manager = std::make_shared<ReconstructionManager>();
+  HierarchicalMapperController::Options mapper_options;
+  mapper_options.database_path = database_path;
+  mapper_options.num_workers = 1;
+  mapper_options.clustering_options.leaf_max_num_images = 5;
+  mapper_options.clustering_options.image_overlap = 3;
+  HierarchicalMapperController mapper(mapper_options, reconstruction_manager);
+  mapper.Run();
+
+  ASSERT_EQ(reconstruction_manager->Size(), 1);
+  ExpectEqualReconstructions(gt_reconstruction,
+                             *reconstruction_manager->Get(0),
+                             /*max_rotation_error_deg=*/1e-2,
+                             /*max_proj_center_error=*/1e-4,
+                             /*num_obs_tolerance=*/0);
+}
+
 TEST(HierarchicalMapperController, MultiReconstruction) {
   const std::string database_path = CreateTestDir() + "/database.db";
 
@@ -29,9 +29,17 @@
 
 #include "colmap/controllers/incremental_mapper.h"
 
+#include "colmap/util/endian.h"
 #include "colmap/util/misc.h"
+#include "colmap/util/threading.h"
 #include "colmap/util/timer.h"
 
+#include <fstream>
+#include <future>
+#include <memory>
+
+#include <boost/filesystem.hpp>
+
 namespace colmap {
 namespace {
 
@@ -45,6 +53,15 @@ void IterativeGlobalRefinement(const IncrementalMapperOptions& options,
                                    options.GlobalBundleAdjustment(),
                                    options.Triangulation());
   mapper.FilterImages(mapper_options);
+
+  const auto& filter_times = mapper.ObservationManager().FilterTimes();
+  LOG(INFO) << StringPrintf(
+      "=> Accumulated filter time: %.3fs reprojection error, %.3fs "
+      "triangulation angle, %.3fs negative depth, %.3fs images",
+      filter_times.large_reproj_error,
+      filter_times.small_tri_angle,
+      filter_times.negative_depth,
+      filter_times.images);
 }
 
 void ExtractColors(const std::string& image_path,
@@ -57,21 +74,69 @@ void ExtractColors(const std::string& image_path,
   }
 }
 
-void WriteSnapshot(const Reconstruction& reconstruction,
-                   const std::string& snapshot_path) {
-  LOG(INFO) << "Creating snapshot";
-  // Get the current timestamp in milliseconds.
-  const size_t timestamp =
-      std::chrono::duration_cast<std::chrono::milliseconds>(
-          std::chrono::high_resolution_clock::now().time_since_epoch())
-          .count();
-  // Write reconstruction to unique path with current timestamp.
-  const std::string path =
-      JoinPaths(snapshot_path, StringPrintf("%010d", timestamp));
-  CreateDirIfNotExists(path);
-  VLOG(1) << "=> Writing to " << path;
-  reconstruction.Write(path);
-}
+// Writes reconstruction snapshots to unique paths with the timestamp at which
+// the snapshot was taken. In asynchronous mode, the snapshot is a deep copy of
+// the reconstruction that is written on a background thread. The copy is made
+// on the mapper thread and is linear in the number of 3D points, their tracks,
+// and the image points of registered images. Only unregistered images share
+// their image points with the copy.
+class SnapshotWriter {
+ public:
+  SnapshotWriter(std::string snapshot_path, bool async)
+      : snapshot_path_(std::move(snapshot_path)) {
+    if (async) {
+      thread_pool_ = std::make_unique<ThreadPool>(1);
+    }
+  }
+
+  ~SnapshotWriter() {
+    if (pending_write_.valid()) {
+      pending_write_.wait();
+    }
+  }
+
+  void Write(const Reconstruction& reconstruction) {
+    LOG(INFO) << "Creating snapshot";
+    // Get the current timestamp in milliseconds.
+    const size_t timestamp =
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::high_resolution_clock::now().time_since_epoch())
+            .count();
+    const std::string path =
+        JoinPaths(snapshot_path_, StringPrintf("%010d", timestamp));
+    if (thread_pool_ == nullptr) {
+      WriteToPath(reconstruction, path);
+      return;
+    }
+
+    // Bound the memory of pending snapshots by waiting for the previous one.
+    Wait();
+    auto snapshot = std::make_shared<const Reconstruction>(reconstruction);
+    pending_write_ = thread_pool_->AddTask(
+        [snapshot = std::move(snapshot), path]() {
+          WriteToPath(*snapshot, path);
+        });
+  }
+
+  // Wait for the pending snapshot to be written.
+  void Wait() {
+    if (pending_write_.valid()) {
+      pending_write_.get();
+    }
+  }
+
+ private:
+  static void WriteToPath(const Reconstruction& reconstruction,
+                          const std::string& path) {
+    CreateDirIfNotExists(path);
+    VLOG(1) << "=> Writing to " << path;
+    reconstruction.Write(path);
+  }
+
+  const std::string snapshot_path_;
+  std::unique_ptr<ThreadPool> thread_pool_;
+  std::future<void> pending_write_;
+};
 
 }  // namespace
 
@@ -84,6 +149,11 @@ IncrementalMapper::Options IncrementalMapperOptions::Mapper() const {
   options.max_extra_param = max_extra_param;
   options.num_threads = num_threads;
   options.local_ba_num_images = ba_local_num_images;
+  options.global_ba_partition_min_num_images =
+      ba_global_partition_min_num_images;
+  options.global_ba_partition.max_num_images_per_submap =
+      ba_global_partition_max_num_images;
+  options.global_ba_partition.num_threads = num_threads;
   options.fix_existing_images = fix_existing_images;
   return options;
 }
@@ -91,6 +161,7 @@ IncrementalMapper::Options IncrementalMapperOptions::Mapper() const {
 IncrementalTriangulator::Options IncrementalMapperOptions::Triangulation()
     const {
   IncrementalTriangulator::Options options = triangulation;
+  options.num_threads = num_threads;
   options.min_focal_length_ratio = min_focal_length_ratio;
   options.max_focal_length_ratio = max_focal_length_ratio;
   options.max_extra_param = max_extra_param;
@@ -116,6 +187,8 @@ BundleAdjustmentOptions IncrementalMapperOptions::LocalBundleAdjustment()
   options.refine_extra_params = ba_refine_extra_params;
   options.min_num_residuals_for_multi_threading =
       ba_min_num_residuals_for_multi_threading;
+  options.use_schur_solver = ba_use_schur_solver;
+  options.use_mixed_precision = ba_use_mixed_precision;
   options.loss_function_scale = 1.0;
   options.loss_function_type =
       BundleAdjustmentOptions::LossFunctionType::SOFT_L1;
@@ -143,6 +216,8 @@ BundleAdjustmentOptions IncrementalMapperOptions::GlobalBundleAdjustment()
   options.refine_extra_params = ba_refine_extra_params;
   options.min_num_residuals_for_multi_threading =
       ba_min_num_residuals_for_multi_threading;
+  options.use_schur_solver = ba_use_schur_solver;
+  options.use_mixed_precision = ba_use_mixed_precision;
   options.loss_function_type =
       BundleAdjustmentOptions::LossFunctionType::TRIVIAL;
   return options;
@@ -164,11 +239,20 @@ bool IncrementalMapperOptions::Check() const {
   CHECK_OPTION_GT(ba_global_images_freq, 0);
   CHECK_OPTION_GT(ba_global_points_freq, 0);
   CHECK_OPTION_GT(ba_global_max_num_iterations, 0);
+  CHECK_OPTION_GE(ba_global_partition_min_num_images, 0);
+  CHECK_OPTION_GT(ba_global_partition_max_num_images, 0);
   CHECK_OPTION_GT(ba_local_max_refinements, 0);
   CHECK_OPTION_GE(ba_local_max_refinement_change, 0);
   CHECK_OPTION_GT(ba_global_max_refinements, 0);
   CHECK_OPTION_GE(ba_global_max_refinement_change, 0);
+  CHECK_OPTION(!ba_use_mixed_precision || ba_use_schur_solver);
+  CHECK_OPTION(ba_global_partition_min_num_images == 0 ||
+               !ba_use_schur_solver);
   CHECK_OPTION_GE(snapshot_images_freq, 0);
+  CHECK_OPTION_GE(checkpoint_images_freq, 0);
+  if (checkpoint_images_freq > 0 || resume_from_checkpoint) {
+    CHECK_OPTION(!checkpoint_path.empty());
+  }
   CHECK_OPTION(Mapper().Check());
   CHECK_OPTION(Triangulation().Check());
   return true;
@@ -196,25 +280,38 @@ void IncrementalMapperController::Run() {
     return;
   }
 
-  IncrementalMapper::Options init_mapper_options = options_->Mapper();
-  Reconstruct(init_mapper_options);
+  loop_state_ = CheckpointState();
+  resume_state_.reset();
+  if (options_->resume_from_checkpoint && ReadCheckpoint()) {
+    LOG(INFO) << "Resuming reconstruction from checkpoint";
+  }
 
+  // Alternately relax the minimum number of inliers and the minimum
+  // triangulation angle of the initialization, until a reconstruction
+  // succeeds. When resuming, the relaxations are replayed up to the step of
+  // the checkpoint.
   const size_t kNumInitRelaxations = 2;
-  for (size_t i = 0; i < kNumInitRelaxations; ++i) {
-    if (reconstruction_manager_->Size() > 0 || CheckIfStopped()) {
-      break;
+  const size_t resume_step =
+      resume_state_ ? resume_state_->init_relaxation_step : 0;
+  IncrementalMapper::Options init_mapper_options = options_->Mapper();
+  for (size_t step = 0; step <= 2 * kNumInitRelaxations; ++step) {
+    if (step > 0) {
+      if (step > resume_step) {
+        if (reconstruction_manager_->Size() > 0 || CheckIfStopped()) {
+          break;
+        }
+        LOG(INFO) << "=> Relaxing the initialization constraints.";
+      }
+      if (step % 2 == 1) {
+        init_mapper_options.init_min_num_inliers /= 2;
+      } else {
+        init_mapper_options.init_min_tri_angle /= 2;
+      }
     }
-
-    LOG(INFO) << "=> Relaxing the initialization constraints.";
-    init_mapper_options.init_min_num_inliers /= 2;
-    Reconstruct(init_mapper_options);
-
-    if (reconstruction_manager_->Size() > 0 || CheckIfStopped()) {
-      break;
+    if (step < resume_step) {
+      continue;
     }
-
-    LOG(INFO) << "=> Relaxing the initialization constraints.";
-    init_mapper_options.init_min_tri_angle /= 2;
+    loop_state_.init_relaxation_step = step;
     Reconstruct(init_mapper_options);
   }
 
@@ -239,8 +336,13 @@ bool IncrementalMapperController::LoadDatabase() {
   Timer timer;
   timer.Start();
   const size_t min_num_matches = static_cast<size_t>(options_->min_num_matches);
-  database_cache_ = DatabaseCache::Create(
-      database, min_num_matches, options_->ignore_watermarks, image_names);
+  database_cache_ =
+      DatabaseCache::Create(database,
+                            min_num_matches,
+                            options_->ignore_watermarks,
+                            image_names,
+                            options_->compact_correspondence_graph,
+                            options_->correspondence_graph_path);
   timer.PrintMinutes();
 
   if (database_cache_->NumImages() == 0) {
@@ -328,6 +430,9 @@ IncrementalMapperController::ReconstructSubModel(
     const IncrementalMapper::Options& mapper_options,
     const std::shared_ptr<Reconstruction>& reconstruction) {
   mapper.BeginReconstruction(reconstruction);
+  if (resume_state_) {
+    mapper.ReadState(JoinPaths(resume_checkpoint_path_, "mapper.bin"));
+  }
 
   ////////////////////////////////////////////////////////////////////////////
   // Register initial pair
@@ -347,9 +452,20 @@ IncrementalMapperController::ReconstructSubModel(
   // Incremental mapping
   ////////////////////////////////////////////////////////////////////////////
 
+  SnapshotWriter snapshot_writer(options_->snapshot_path,
+                                 options_->snapshot_async);
   size_t snapshot_prev_num_reg_images = reconstruction->NumRegImages();
+  size_t checkpoint_prev_num_reg_images = reconstruction->NumRegImages();
   size_t ba_prev_num_reg_images = reconstruction->NumRegImages();
   size_t ba_prev_num_points = reconstruction->NumPoints3D();
+  if (resume_state_) {
+    snapshot_prev_num_reg_images = resume_state_->snapshot_prev_num_reg_images;
+    checkpoint_prev_num_reg_images =
+        resume_state_->checkpoint_prev_num_reg_images;
+    ba_prev_num_reg_images = resume_state_->ba_prev_num_reg_images;
+    ba_prev_num_points = resume_state_->ba_prev_num_points;
+    resume_state_.reset();
+  }
 
   bool reg_next_success = true;
   bool prev_reg_next_success = true;
@@ -361,16 +477,19 @@ IncrementalMapperController::ReconstructSubModel(
     prev_reg_next_success = reg_next_success;
     reg_next_success = false;
 
-    const std::vector<image_t> next_images =
-        mapper.FindNextImages(mapper_options);
+    const std::set<IncrementalMapper::NextImageCandidate>& next_images =
+        mapper.RankNextImages(mapper_options);
 
     if (next_images.empty()) {
       break;
     }
 
     image_t next_image_id;
-    for (size_t reg_trial = 0; reg_trial < next_images.size(); ++reg_trial) {
-      next_image_id = next_images[reg_trial];
+    size_t reg_trial = 0;
+    for (auto next_image_it = next_images.begin();
+         next_image_it != next_images.end();
+         ++next_image_it, ++reg_trial) {
+      next_image_id = next_image_it->image_id;
 
       LOG(INFO) << StringPrintf("Registering image #%d (%d)",
                                 next_image_id,
@@ -423,7 +542,7 @@ IncrementalMapperController::ReconstructSubModel(
           reconstruction->NumRegImages() >=
               options_->snapshot_images_freq + snapshot_prev_num_reg_images) {
         snapshot_prev_num_reg_images = reconstruction->NumRegImages();
-        WriteSnapshot(*reconstruction, options_->snapshot_path);
+        snapshot_writer.Write(*reconstruction);
       }
 
       Callback(NEXT_IMAGE_REG_CALLBACK);
@@ -442,8 +561,24 @@ IncrementalMapperController::ReconstructSubModel(
       IterativeGlobalRefinement(*options_, mapper_options, mapper);
     }
     progress_ = float(reconstruction->NumRegImages())/ reconstruction->NumImages();
+
+    // Checkpoint after a successful registration, which is where the loop
+    // continues when resuming from the checkpoint.
+    if (reg_next_success && options_->checkpoint_images_freq > 0 &&
+        reconstruction->NumRegImages() >=
+            options_->checkpoint_images_freq + checkpoint_prev_num_reg_images) {
+      checkpoint_prev_num_reg_images = reconstruction->NumRegImages();
+      CheckpointState state = loop_state_;
+      state.snapshot_prev_num_reg_images = snapshot_prev_num_reg_images;
+      state.checkpoint_prev_num_reg_images = checkpoint_prev_num_reg_images;
+      state.ba_prev_num_reg_images = ba_prev_num_reg_images;
+      state.ba_prev_num_points = ba_prev_num_points;
+      WriteCheckpoint(mapper, state);
+    }
   } while (reg_next_success || prev_reg_next_success);
 
+  snapshot_writer.Wait();
+
   if (CheckIfStopped()) {
     return Status::INTERRUPTED;
   }
@@ -463,23 +598,34 @@ void IncrementalMapperController::Reconstruct(
 
   // Is there a sub-model before we start the reconstruction? I.e. the user
   // has imported an existing reconstruction.
-  const bool initial_reconstruction_given = reconstruction_manager_->Size() > 0;
-  THROW_CHECK_LE(reconstruction_manager_->Size(), 1)
-      << "Can only resume from a "
-         "single reconstruction, but "
-         "multiple are given.";
+  bool initial_reconstruction_given = reconstruction_manager_->Size() > 0;
+  int init_num_trials = 0;
+  if (resume_state_) {
+    initial_reconstruction_given = resume_state_->initial_reconstruction_given;
+    init_num_trials = resume_state_->num_init_trials;
+  } else {
+    THROW_CHECK_LE(reconstruction_manager_->Size(), 1)
+        << "Can only resume from a "
+           "single reconstruction, but "
+           "multiple are given.";
+  }
+  loop_state_.initial_reconstruction_given = initial_reconstruction_given;
 
-  for (int num_trials = 0; num_trials < options_->init_num_trials;
+  for (int num_trials = init_num_trials; num_trials < options_->init_num_trials;
        ++num_trials) {
     if (CheckIfStopped()) {
       break;
     }
     size_t reconstruction_idx;
-    if (!initial_reconstruction_given || num_trials > 0) {
+    if (resume_state_) {
+      // The sub-model in progress is the last one in the checkpoint.
+      reconstruction_idx = reconstruction_manager_->Size() - 1;
+    } else if (!initial_reconstruction_given || num_trials > 0) {
       reconstruction_idx = reconstruction_manager_->Add();
     } else {
       reconstruction_idx = 0;
     }
+    loop_state_.num_init_trials = num_trials;
     std::shared_ptr<Reconstruction> reconstruction =
         reconstruction_manager_->Get(reconstruction_idx);
 
@@ -538,6 +684,98 @@ void IncrementalMapperController::Reconstruct(
   }
 }
 
+void IncrementalMapperController::WriteCheckpoint(
+    const IncrementalMapper& mapper, const CheckpointState& state) const {
+  LOG(INFO) << "Writing checkpoint";
+  Timer timer;
+  timer.Start();
+
+  // Write into a temporary folder that replaces the previous checkpoint once
+  // it is complete, so that a failure while writing keeps the previous one.
+  // The controller state is written last and marks a complete checkpoint.
+  const std::string path =
+      JoinPaths(options_->checkpoint_path, "checkpoint");
+  const std::string tmp_path =
+      JoinPaths(options_->checkpoint_path, "checkpoint.tmp");
+  boost::filesystem::remove_all(tmp_path);
+  CreateDirIfNotExists(tmp_path, /*recursive=*/true);
+
+  // Keep the order of the reconstructions, in which the sub-model in progress
+  // is the last one.
+  const std::string models_path = JoinPaths(tmp_path, "models");
+  CreateDirIfNotExists(models_path);
+  for (size_t i = 0; i < reconstruction_manager_->Size(); ++i) {
+    const std::string model_path = JoinPaths(models_path, std::to_string(i));
+    CreateDirIfNotExists(model_path);
+    reconstruction_manager_->Get(i)->Write(model_path);
+  }
+  mapper.WriteState(JoinPaths(tmp_path, "mapper.bin"));
+
+  const std::string state_path = JoinPaths(tmp_path, "controller.bin");
+  std::ofstream file(state_path, std::ios::trunc | std::ios::binary);
+  THROW_CHECK_FILE_OPEN(file, state_path);
+  WriteBinaryLittleEndian<uint64_t>(&file, reconstruction_manager_->Size());
+  WriteBinaryLittleEndian<uint64_t>(&file, state.init_relaxation_step);
+  WriteBinaryLittleEndian<int32_t>(&file, state.num_init_trials);
+  WriteBinaryLittleEndian<uint8_t>(&file, state.initial_reconstruction_given);
+  WriteBinaryLittleEndian<uint64_t>(&file,
+                                    state.snapshot_prev_num_reg_images);
+  WriteBinaryLittleEndian<uint64_t>(&file,
+                                    state.checkpoint_prev_num_reg_images);
+  WriteBinaryLittleEndian<uint64_t>(&file, state.ba_prev_num_reg_images);
+  WriteBinaryLittleEndian<uint64_t>(&file, state.ba_prev_num_points);
+  file.close();
+  THROW_CHECK(!file.fail()) << "Failed to write " << state_path;
+
+  boost::filesystem::remove_all(path);
+  boost::filesystem::rename(tmp_path, path);
+  VLOG(1) << "=> Wrote checkpoint to " << path << " in "
+          << timer.ElapsedSeconds() << "s";
+}
+
+bool IncrementalMapperController::ReadCheckpoint() {
+  // Fall back to the temporary checkpoint, if writing was interrupted after
+  // removing the previous checkpoint. The temporary checkpoint is complete
+  // and promoted before use, since the next checkpoint overwrites it.
+  const std::string path = JoinPaths(options_->checkpoint_path, "checkpoint");
+  if (!ExistsFile(JoinPaths(path, "controller.bin"))) {
+    const std::string tmp_path =
+        JoinPaths(options_->checkpoint_path, "checkpoint.tmp");
+    if (!ExistsFile(JoinPaths(tmp_path, "controller.bin"))) {
+      LOG(INFO) << "No checkpoint found in " << options_->checkpoint_path;
+      return false;
+    }
+    LOG(INFO) << "Promoting interrupted checkpoint " << tmp_path;
+    boost::filesystem::remove_all(path);
+    boost::filesystem::rename(tmp_path, path);
+  }
+
+  const std::string state_path = JoinPaths(path, "controller.bin");
+  std::ifstream file(state_path, std::ios::binary);
+  THROW_CHECK_FILE_OPEN(file, state_path);
+  const uint64_t num_reconstructions = ReadBinaryLittleEndian<uint64_t>(&file);
+  CheckpointState state;
+  state.init_relaxation_step = ReadBinaryLittleEndian<uint64_t>(&file);
+  state.num_init_trials = ReadBinaryLittleEndian<int32_t>(&file);
+  state.initial_reconstruction_given = ReadBinaryLittleEndian<uint8_t>(&file);
+  state.snapshot_prev_num_reg_images = ReadBinaryLittleEndian<uint64_t>(&file);
+  state.checkpoint_prev_num_reg_images =
+      ReadBinaryLittleEndian<uint64_t>(&file);
+  state.ba_prev_num_reg_images = ReadBinaryLittleEndian<uint64_t>(&file);
+  state.ba_prev_num_points = ReadBinaryLittleEndian<uint64_t>(&file);
+  THROW_CHECK(file.good()) << "Truncated checkpoint state: " << state_path;
+  THROW_CHECK_GT(num_reconstructions, 0);
+
+  reconstruction_manager_->Clear();
+  for (uint64_t i = 0; i < num_reconstructions; ++i) {
+    reconstruction_manager_->Read(JoinPaths(path, "models", std::to_string(i)));
+  }
+
+  resume_state_ = state;
+  resume_checkpoint_path_ = path;
+  return true;
+}
+
 void IncrementalMapperController::TriangulateReconstruction(
     const std::shared_ptr<Reconstruction>& reconstruction) {
   THROW_CHECK(LoadDatabase());
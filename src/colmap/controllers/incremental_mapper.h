@@ -33,6 +33,8 @@
 #include "colmap/sfm/incremental_mapper.h"
 #include "colmap/util/base_controller.h"
 
+#include <optional>
+
 namespace colmap {
 
 struct IncrementalMapperOptions {
@@ -42,6 +44,14 @@ struct IncrementalMapperOptions {
   // Whether to ignore the inlier matches of watermark image pairs.
   bool ignore_watermarks = false;
 
+  // Whether to store the correspondence graph in a compact layout, which
+  // roughly halves its memory at a slightly higher lookup cost.
+  bool compact_correspondence_graph = false;
+
+  // If not empty, the correspondence graph is stored out of core in files at
+  // this path, for datasets whose graph exceeds the available memory.
+  std::string correspondence_graph_path = "";
+
   // Whether to reconstruct multiple sub-models.
   bool multiple_models = true;
 
@@ -87,6 +97,15 @@ struct IncrementalMapperOptions {
   // enable multi-threading solving of the problems.
   int ba_min_num_residuals_for_multi_threading = 50000;
 
+  // Whether to use the specialized Schur complement solver instead of
+  // Ceres-Solver for local and global bundle adjustment. Cannot be combined
+  // with the partitioned global bundle adjustment.
+  bool ba_use_schur_solver = false;
+
+  // Whether the Schur complement solver stores the Jacobians and the reduced
+  // camera system in single precision. Requires ba_use_schur_solver.
+  bool ba_use_mixed_precision = false;
+
   // The number of images to optimize in local bundle adjustment.
   int ba_local_num_images = 6;
 
@@ -108,6 +127,13 @@ struct IncrementalMapperOptions {
   // The maximum number of global bundle adjustment iterations.
   int ba_global_max_num_iterations = 50;
 
+  // The minimum number of registered images to partition global bundle
+  // adjustment into submaps of at most the given number of images, which are
+  // solved in parallel. Partitioning is disabled if zero. Partitioning does
+  // not reduce the memory of the bundle adjustment.
+  int ba_global_partition_min_num_images = 0;
+  int ba_global_partition_max_num_images = 500;
+
   // The thresholds for iterative bundle adjustment refinements.
   int ba_local_max_refinements = 2;
   double ba_local_max_refinement_change = 0.001;
@@ -120,6 +146,30 @@ struct IncrementalMapperOptions {
   std::string snapshot_path = "";
   int snapshot_images_freq = 0;
 
+  // Whether to write snapshots on a background thread from a copy of the
+  // reconstruction, so that mapping continues while a snapshot is written.
+  // At most one snapshot is written at a time. Note that the mapping still
+  // stalls for a deep copy of the 3D points, tracks, and image points of the
+  // registered images, and the copy doubles their memory until it is written.
+  bool snapshot_async = false;
+
+  // Path to a folder with the checkpoint of the incremental reconstruction.
+  // The checkpoint is updated according to the specified frequency of
+  // registered images and contains all reconstructions and the state of the
+  // mapper, so that an interrupted reconstruction can be resumed from it.
+  std::string checkpoint_path = "";
+  int checkpoint_images_freq = 0;
+
+  // Whether to resume the reconstruction from the checkpoint in
+  // `checkpoint_path`. Starts a new reconstruction if no checkpoint exists.
+  // The resumed reconstruction may deviate from an uninterrupted one, since
+  // the checkpoint does not contain the following state, which is reset:
+  // the random number generators, the incrementally updated problem of the
+  // local bundle adjustment, and the number of retriangulation trials per
+  // image pair. The tried track merges of the triangulator are only cached
+  // within a single call and thus not affected.
+  bool resume_from_checkpoint = false;
+
   // Which images to reconstruct. If no images are specified, all images will
   // be reconstructed by default.
   std::unordered_set<std::string> image_names;
@@ -199,6 +249,30 @@ class IncrementalMapperController : public BaseController {
   float GetProgress() {return progress_;}
   float progress_;
  private:
+  // The position in the reconstruction loops, which is written to checkpoints
+  // together with the counters of the current sub-model.
+  struct CheckpointState {
+    size_t init_relaxation_step = 0;
+    int num_init_trials = 0;
+    bool initial_reconstruction_given = false;
+    size_t snapshot_prev_num_reg_images = 0;
+    size_t checkpoint_prev_num_reg_images = 0;
+    size_t ba_prev_num_reg_images = 0;
+    size_t ba_prev_num_points = 0;
+  };
+
+  // Write the reconstructions, the mapper state, and the given state to the
+  // checkpoint, replacing the previous checkpoint only once it is complete.
+  void WriteCheckpoint(const IncrementalMapper& mapper,
+                       const CheckpointState& state) const;
+
+  // Read the reconstructions and the state from the checkpoint, if it exists.
+  bool ReadCheckpoint();
+
+  CheckpointState loop_state_;
+  std::optional<CheckpointState> resume_state_;
+  std::string resume_checkpoint_path_;
+
   const std::shared_ptr<const IncrementalMapperOptions> options_;
   const std::string image_path_;
   const std::string database_path_;
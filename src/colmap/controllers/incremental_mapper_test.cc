@@ -31,8 +31,10 @@
 
 #include "colmap/estimators/alignment.h"
 #include "colmap/scene/synthetic.h"
+#include "colmap/util/misc.h"
 #include "colmap/util/testing.h"
 
+#include <boost/filesystem.hpp>
 #include <gtest/gtest.h>
 
 namespace colmap {
@@ -120,6 +122,231 @@ TEST(IncrementalMapperController, WithNoise) {
                              /*num_obs_tolerance=*/0.02);
 }
 
+TEST(IncrementalMapperController, AsyncSnapshots) {
+  const std::string test_dir = CreateTestDir();
+  const std::string database_path = test_dir + "/database.db";
+  const std::string snapshot_path = test_dir + "/snapshots";
+  CreateDirIfNotExists(snapshot_path);
+
+  Database database(database_path);
+  Reconstruction gt_reconstruction;
+  SyntheticDatasetOptions synthetic_dataset_options;
+  synthetic_dataset_options.num_cameras = 2;
+  synthetic_dataset_options.num_images = 7;
+  synthetic_dataset_options.num_points3D = 50;
+  synthetic_dataset_options.point2D_stddev = 0;
+  SynthesizeDataset(synthetic_dataset_options, &gt_reconstruction, &database);
+
+  auto mapper_options = std::make_shared<IncrementalMapperOptions>();
+  mapper_options->snapshot_path = snapshot_path;
+  mapper_options->snapshot_images_freq = 1;
+  mapper_options->snapshot_async = true;
+  auto reconstruction_manager = std::make_shared<ReconstructionManager>();
+  IncrementalMapperController mapper(mapper_options,
+                                     /*image_path=*/"",
+                                     database_path,
+                                     reconstruction_manager);
+  mapper.Run();
+
+  ASSERT_EQ(reconstruction_manager->Size(), 1);
+  const std::vector<std::string> snapshot_dirs = GetDirList(snapshot_path);
+  ASSERT_FALSE(snapshot_dirs.empty());
+  for (const auto& snapshot_dir : snapshot_dirs) {
+    Reconstruction snapshot;
+    snapshot.Read(snapshot_dir);
+    EXPECT_GT(snapshot.NumRegImages(), 2);
+    EXPECT_LE(snapshot.NumRegImages(),
+              reconstruction_manager->Get(0)->NumRegImages());
+  }
+}
+
+TEST(IncrementalMapperController, ResumeFromCheckpoint) {
+  const std::string test_dir = CreateTestDir();
+  const std::string database_path = test_dir + "/database.db";
+  const std::string checkpoint_path = test_dir + "/checkpoint";
+  CreateDirIfNotExists(checkpoint_path);
+
+  Database database(database_path);
+  Reconstruction gt_reconstruction;
+  SyntheticDatasetOptions synthetic_dataset_options;
+  synthetic_dataset_options.num_cameras = 2;
+  synthetic_dataset_options.num_images = 7;
+  synthetic_dataset_options.num_points3D = 50;
+  synthetic_dataset_options.point2D_stddev = 0;
+  SynthesizeDataset(synthetic_dataset_options, &gt_reconstruction, &database);
+
+  auto mapper_options = std::make_shared<IncrementalMapperOptions>();
+  mapper_options->checkpoint_path = checkpoint_path;
+  mapper_options->checkpoint_images_freq = 1;
+  mapper_options->resume_from_checkpoint = true;
+
+  // Interrupt the reconstruction after a few registered images.
+  const size_t kNumInterruptRegImages = 4;
+  auto interrupted_reconstruction_manager =
+      std::make_shared<ReconstructionManager>();
+  IncrementalMapperController interrupted_mapper(
+      mapper_options,
+      /*image_path=*/"",
+      database_path,
+      interrupted_reconstruction_manager);
+  interrupted_mapper.SetCheckIfStoppedFunc([&]() {
+    return interrupted_reconstruction_manager->Size() > 0 &&
+           interrupted_reconstruction_manager->Get(0)->NumRegImages() >=
+               kNumInterruptRegImages;
+  });
+  interrupted_mapper.Run();
+  ASSERT_EQ(interrupted_reconstruction_manager->Size(), 1);
+  ASSERT_EQ(interrupted_reconstruction_manager->Get(0)->NumRegImages(),
+            kNumInterruptRegImages);
+  ASSERT_TRUE(ExistsDir(checkpoint_path + "/checkpoint"));
+
+  // Resume the reconstruction from the checkpoint.
+  auto reconstruction_manager = std::make_shared<ReconstructionManager>();
+  IncrementalMapperController mapper(mapper_options,
+                                     /*image_path=*/"",
+                                     database_path,
+                                     reconstruction_manager);
+  mapper.Run();
+
+  ASSERT_EQ(reconstruction_manager->Size(), 1);
+  ExpectEqualReconstructions(gt_reconstruction,
+                             *reconstruction_manager->Get(0),
+                             /*max_rotation_error_deg=*/1e-2,
+                             /*max_proj_center_error=*/1e-4,
+                             /*num_obs_tolerance=*/0);
+}
+
+TEST(IncrementalMapperController, ResumeFromInterruptedCheckpoint) {
+  const std::string test_dir = CreateTestDir();
+  const std::string database_path = test_dir + "/database.db";
+  const std::string checkpoint_path = test_dir + "/checkpoint";
+  CreateDirIfNotExists(checkpoint_path);
+
+  Database database(database_path);
+  Reconstruction gt_reconstruction;
+  SyntheticDatasetOptions synthetic_dataset_options;
+  synthetic_dataset_options.num_cameras = 2;
+  synthetic_dataset_options.num_images = 7;
+  synthetic_dataset_options.num_points3D = 50;
+  synthetic_dataset_options.point2D_stddev = 0;
+  SynthesizeDataset(synthetic_dataset_options, &gt_reconstruction, &database);
+
+  auto mapper_options = std::make_shared<IncrementalMapperOptions>();
+  mapper_options->checkpoint_path = checkpoint_path;
+  mapper_options->checkpoint_images_freq = 1;
+  mapper_options->resume_from_checkpoint = true;
+
+  auto interrupted_reconstruction_manager =
+      std::make_shared<ReconstructionManager>();
+  IncrementalMapperController interrupted_mapper(
+      mapper_options,
+      /*image_path=*/"",
+      database_path,
+      interrupted_reconstruction_manager);
+  interrupted_mapper.SetCheckIfStoppedFunc([&]() {
+    return interrupted_reconstruction_manager->Size() > 0 &&
+           interrupted_reconstruction_manager->Get(0)->NumRegImages() >= 4;
+  });
+  interrupted_mapper.Run();
+
+  // Simulate an interruption after removing the previous checkpoint and
+  // before renaming the complete temporary checkpoint.
+  const std::string final_path = checkpoint_path + "/checkpoint";
+  const std::string tmp_path = checkpoint_path + "/checkpoint.tmp";
+  ASSERT_TRUE(ExistsDir(final_path));
+  boost::filesystem::rename(final_path, tmp_path);
+
+  auto reconstruction_manager = std::make_shared<ReconstructionManager>();
+  IncrementalMapperController mapper(mapper_options,
+                                     /*image_path=*/"",
+                                     database_path,
+                                     reconstruction_manager);
+  mapper.Run();
+
+  // The temporary checkpoint was promoted and then replaced by the later
+  // checkpoints of the resumed reconstruction.
+  EXPECT_TRUE(ExistsFile(final_path + "/controller.bin"));
+  EXPECT_FALSE(ExistsDir(tmp_path));
+
+  ASSERT_EQ(reconstruction_manager->Size(), 1);
+  ExpectEqualReconstructions(gt_reconstruction,
+                             *reconstruction_manager->Get(0),
+                             /*max_rotation_error_deg=*/1e-2,
+                             /*max_proj_center_error=*/1e-4,
+                             /*num_obs_tolerance=*/0);
+}
+
+TEST(IncrementalMapperController, ResumeMultiReconstructionFromCheckpoint) {
+  const std::string test_dir = CreateTestDir();
+  const std::string database_path = test_dir + "/database.db";
+  const std::string checkpoint_path = test_dir + "/checkpoint";
+  CreateDirIfNotExists(checkpoint_path);
+
+  Database database(database_path);
+  Reconstruction gt_reconstruction1;
+  Reconstruction gt_reconstruction2;
+  SyntheticDatasetOptions synthetic_dataset_options;
+  synthetic_dataset_options.num_cameras = 1;
+  synthetic_dataset_options.num_images = 5;
+  synthetic_dataset_options.num_points3D = 50;
+  synthetic_dataset_options.point2D_stddev = 0;
+  SynthesizeDataset(synthetic_dataset_options, &gt_reconstruction1, &database);
+  synthetic_dataset_options.num_images = 4;
+  SynthesizeDataset(synthetic_dataset_options, &gt_reconstruction2, &database);
+
+  auto mapper_options = std::make_shared<IncrementalMapperOptions>();
+  mapper_options->min_model_size = 4;
+  mapper_options->checkpoint_path = checkpoint_path;
+  mapper_options->checkpoint_images_freq = 1;
+  mapper_options->resume_from_checkpoint = true;
+
+  // Interrupt the reconstruction of the second model, such that the resumed
+  // reconstruction continues the last model and keeps the finished one.
+  auto interrupted_reconstruction_manager =
+      std::make_shared<ReconstructionManager>();
+  IncrementalMapperController interrupted_mapper(
+      mapper_options,
+      /*image_path=*/"",
+      database_path,
+      interrupted_reconstruction_manager);
+  interrupted_mapper.SetCheckIfStoppedFunc([&]() {
+    return interrupted_reconstruction_manager->Size() == 2 &&
+           interrupted_reconstruction_manager->Get(1)->NumRegImages() >= 3;
+  });
+  interrupted_mapper.Run();
+  ASSERT_EQ(interrupted_reconstruction_manager->Size(), 2);
+  ASSERT_TRUE(ExistsDir(checkpoint_path + "/checkpoint/models/0"));
+  ASSERT_TRUE(ExistsDir(checkpoint_path + "/checkpoint/models/1"));
+
+  auto reconstruction_manager = std::make_shared<ReconstructionManager>();
+  IncrementalMapperController mapper(mapper_options,
+                                     /*image_path=*/"",
+                                     database_path,
+                                     reconstruction_manager);
+  mapper.Run();
+
+  ASSERT_EQ(reconstruction_manager->Size(), 2);
+  Reconstruction* computed_reconstruction1 = nullptr;
+  Reconstruction* computed_reconstruction2 = nullptr;
+  if (reconstruction_manager->Get(0)->NumRegImages() == 5) {
+    computed_reconstruction1 = reconstruction_manager->Get(0).get();
+    computed_reconstruction2 = reconstruction_manager->Get(1).get();
+  } else {
+    computed_reconstruction1 = reconstruction_manager->Get(1).get();
+    computed_reconstruction2 = reconstruction_manager->Get(0).get();
+  }
+  ExpectEqualReconstructions(gt_reconstruction1,
+                             *computed_reconstruction1,
+                             /*max_rotation_error_deg=*/1e-2,
+                             /*max_proj_center_error=*/1e-4,
+                             /*num_obs_tolerance=*/0);
+  ExpectEqualReconstructions(gt_reconstruction2,
+                             *computed_reconstruction2,
+                             /*max_rotation_error_deg=*/1e-2,
+                             /*max_proj_center_error=*/1e-4,
+                             /*num_obs_tolerance=*/0);
+}
+
 TEST(IncrementalMapperController, MultiReconstruction) {
   const std::string database_path = CreateTestDir() + "/database.db";
 
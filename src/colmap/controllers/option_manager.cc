@@ -339,6 +339,10 @@ void OptionManager::AddExhaustiveMatchingOptions() {
 
   AddAndRegisterDefaultOption("ExhaustiveMatching.block_size",
                               &exhaustive_matching->block_size);
+  AddAndRegisterDefaultOption("ExhaustiveMatching.shard_index",
+                              &exhaustive_matching->shard_index);
+  AddAndRegisterDefaultOption("ExhaustiveMatching.num_shards",
+                              &exhaustive_matching->num_shards);
 }
 
 void OptionManager::AddSequentialMatchingOptions() {
@@ -397,6 +401,10 @@ void OptionManager::AddVocabTreeMatchingOptions() {
                               &vocab_tree_matching->vocab_tree_path);
   AddAndRegisterDefaultOption("VocabTreeMatching.match_list_path",
                               &vocab_tree_matching->match_list_path);
+  AddAndRegisterDefaultOption("VocabTreeMatching.shard_index",
+                              &vocab_tree_matching->shard_index);
+  AddAndRegisterDefaultOption("VocabTreeMatching.num_shards",
+                              &vocab_tree_matching->num_shards);
 }
 
 void OptionManager::AddSpatialMatchingOptions() {
@@ -470,6 +478,10 @@ void OptionManager::AddBundleAdjustmentOptions() {
                               &bundle_adjustment->refine_extra_params);
   AddAndRegisterDefaultOption("BundleAdjustment.refine_extrinsics",
                               &bundle_adjustment->refine_extrinsics);
+  AddAndRegisterDefaultOption("BundleAdjustment.use_schur_solver",
+                              &bundle_adjustment->use_schur_solver);
+  AddAndRegisterDefaultOption("BundleAdjustment.use_mixed_precision",
+                              &bundle_adjustment->use_mixed_precision);
 }
 
 void OptionManager::AddMapperOptions() {
@@ -482,6 +494,10 @@ void OptionManager::AddMapperOptions() {
                               &mapper->min_num_matches);
   AddAndRegisterDefaultOption("Mapper.ignore_watermarks",
                               &mapper->ignore_watermarks);
+  AddAndRegisterDefaultOption("Mapper.compact_correspondence_graph",
+                              &mapper->compact_correspondence_graph);
+  AddAndRegisterDefaultOption("Mapper.correspondence_graph_path",
+                              &mapper->correspondence_graph_path);
   AddAndRegisterDefaultOption("Mapper.multiple_models",
                               &mapper->multiple_models);
   AddAndRegisterDefaultOption("Mapper.max_num_models", &mapper->max_num_models);
@@ -509,6 +525,10 @@ void OptionManager::AddMapperOptions() {
   AddAndRegisterDefaultOption(
       "Mapper.ba_min_num_residuals_for_multi_threading",
       &mapper->ba_min_num_residuals_for_multi_threading);
+  AddAndRegisterDefaultOption("Mapper.ba_use_schur_solver",
+                              &mapper->ba_use_schur_solver);
+  AddAndRegisterDefaultOption("Mapper.ba_use_mixed_precision",
+                              &mapper->ba_use_mixed_precision);
   AddAndRegisterDefaultOption("Mapper.ba_local_num_images",
                               &mapper->ba_local_num_images);
   AddAndRegisterDefaultOption("Mapper.ba_local_function_tolerance",
@@ -527,6 +547,10 @@ void OptionManager::AddMapperOptions() {
                               &mapper->ba_global_function_tolerance);
   AddAndRegisterDefaultOption("Mapper.ba_global_max_num_iterations",
                               &mapper->ba_global_max_num_iterations);
+  AddAndRegisterDefaultOption("Mapper.ba_global_partition_min_num_images",
+                              &mapper->ba_global_partition_min_num_images);
+  AddAndRegisterDefaultOption("Mapper.ba_global_partition_max_num_images",
+                              &mapper->ba_global_partition_max_num_images);
   AddAndRegisterDefaultOption("Mapper.ba_global_max_refinements",
                               &mapper->ba_global_max_refinements);
   AddAndRegisterDefaultOption("Mapper.ba_global_max_refinement_change",
@@ -538,6 +562,14 @@ void OptionManager::AddMapperOptions() {
   AddAndRegisterDefaultOption("Mapper.snapshot_path", &mapper->snapshot_path);
   AddAndRegisterDefaultOption("Mapper.snapshot_images_freq",
                               &mapper->snapshot_images_freq);
+  AddAndRegisterDefaultOption("Mapper.snapshot_async",
+                              &mapper->snapshot_async);
+  AddAndRegisterDefaultOption("Mapper.checkpoint_path",
+                              &mapper->checkpoint_path);
+  AddAndRegisterDefaultOption("Mapper.checkpoint_images_freq",
+                              &mapper->checkpoint_images_freq);
+  AddAndRegisterDefaultOption("Mapper.resume_from_checkpoint",
+                              &mapper->resume_from_checkpoint);
   AddAndRegisterDefaultOption("Mapper.fix_existing_images",
                               &mapper->fix_existing_images);
 
@@ -31,10 +31,12 @@
 
 #include "colmap/estimators/similarity_transform.h"
 #include "colmap/geometry/pose.h"
+#include "colmap/math/random.h"
 #include "colmap/optim/loransac.h"
 #include "colmap/scene/projection.h"
 #include "colmap/util/logging.h"
 
+#include <algorithm>
 #include <unordered_map>
 
 namespace colmap {
@@ -248,7 +250,8 @@ bool AlignReconstructionsViaReprojections(
     const Reconstruction& tgt_reconstruction,
     const double min_inlier_observations,
     const double max_reproj_error,
-    Sim3d* tgt_from_src) {
+    Sim3d* tgt_from_src,
+    const int max_num_common_images) {
   THROW_CHECK_GE(min_inlier_observations, 0.0);
   THROW_CHECK_LE(min_inlier_observations, 1.0);
 
@@ -264,13 +267,20 @@ bool AlignReconstructionsViaReprojections(
   ransac.local_estimator.SetReconstructions(&src_reconstruction,
                                             &tgt_reconstruction);
 
-  const std::vector<std::pair<image_t, image_t>> common_image_ids =
+  std::vector<std::pair<image_t, image_t>> common_image_ids =
       src_reconstruction.FindCommonRegImageIds(tgt_reconstruction);
 
   if (common_image_ids.size() < 3) {
     return false;
   }
 
+  const size_t num_sampled_common_images = std::max(3, max_num_common_images);
+  if (max_num_common_images > 0 &&
+      common_image_ids.size() > num_sampled_common_images) {
+    Shuffle(num_sampled_common_images, &common_image_ids);
+    common_image_ids.resize(num_sampled_common_images);
+  }
+
   std::vector<const Image*> src_images(common_image_ids.size());
   std::vector<const Image*> tgt_images(common_image_ids.size());
   for (size_t i = 0; i < common_image_ids.size(); ++i) {
@@ -420,6 +430,14 @@ bool MergeReconstructions(const double max_reproj_error,
     return false;
   }
 
+  MergeAlignedReconstructions(
+      tgt_from_src, src_reconstruction, tgt_reconstruction);
+  return true;
+}
+
+void MergeAlignedReconstructions(const Sim3d& tgt_from_src,
+                                 const Reconstruction& src_reconstruction,
+                                 Reconstruction& tgt_reconstruction) {
   // Find common and missing images in the two reconstructions.
   std::unordered_set<image_t> common_image_ids;
   common_image_ids.reserve(src_reconstruction.NumRegImages());
@@ -489,7 +507,6 @@ bool MergeReconstructions(const double max_reproj_error,
       }
     }
   }
-  return true;
 }
 
 }  // namespace colmap
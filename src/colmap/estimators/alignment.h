@@ -48,13 +48,16 @@ bool AlignReconstructionToLocations(
 // robustly inside RANSAC from corresponding projection centers. An alignment
 // is verified by reprojecting common 3D point observations.
 // The min_inlier_observations threshold determines how many observations
-// in a common image must reproject within the given threshold.
+// in a common image must reproject within the given threshold. If positive,
+// the alignment is estimated from a random sample of at most
+// max_num_common_images common images.
 bool AlignReconstructionsViaReprojections(
     const Reconstruction& src_reconstruction,
     const Reconstruction& tgt_reconstruction,
     double min_inlier_observations,
     double max_reproj_error,
-    Sim3d* tgt_from_src);
+    Sim3d* tgt_from_src,
+    int max_num_common_images = -1);
 
 // Robustly compute alignment between reconstructions by finding images that
 // are registered in both reconstructions. The alignment is then estimated
@@ -93,4 +96,10 @@ bool MergeReconstructions(double max_reproj_error,
                           const Reconstruction& src_reconstruction,
                           Reconstruction& tgt_reconstruction);
 
+// Merges cameras, images, points3D of the source into the target
+// reconstruction using the given, previously estimated alignment.
+void MergeAlignedReconstructions(const Sim3d& tgt_from_src,
+                                 const Reconstruction& src_reconstruction,
+                                 Reconstruction& tgt_reconstruction);
+
 }  // namespace colmap
@@ -84,6 +84,46 @@ TEST(Alignment, AlignReconstructionsViaReprojections) {
   ExpectEqualSim3d(gt_tgt_from_src, tgt_from_src);
 }
 
+TEST(Alignment, AlignReconstructionsViaReprojectionsSampled) {
+  Reconstruction src_reconstruction = GenerateReconstructionForAlignment();
+  Reconstruction tgt_reconstruction = src_reconstruction;
+
+  Sim3d gt_tgt_from_src = TestSim3d();
+  tgt_reconstruction.Transform(gt_tgt_from_src);
+
+  Sim3d tgt_from_src;
+  THROW_CHECK(
+      AlignReconstructionsViaReprojections(src_reconstruction,
+                                           tgt_reconstruction,
+                                           /*min_inlier_observations=*/0.9,
+                                           /*max_reproj_error=*/2,
+                                           &tgt_from_src,
+                                           /*max_num_common_images=*/5));
+  ExpectEqualSim3d(gt_tgt_from_src, tgt_from_src);
+}
+
+TEST(Alignment, MergeAlignedReconstructions) {
+  const Reconstruction src_reconstruction =
+      GenerateReconstructionForAlignment();
+  Reconstruction tgt_reconstruction;
+  const Sim3d tgt_from_src = TestSim3d();
+
+  MergeAlignedReconstructions(
+      tgt_from_src, src_reconstruction, tgt_reconstruction);
+  EXPECT_EQ(tgt_reconstruction.NumCameras(), src_reconstruction.NumCameras());
+  EXPECT_EQ(tgt_reconstruction.NumRegImages(),
+            src_reconstruction.NumRegImages());
+  EXPECT_EQ(tgt_reconstruction.NumPoints3D(),
+            src_reconstruction.NumPoints3D());
+  for (const image_t image_id : src_reconstruction.RegImageIds()) {
+    EXPECT_LT((tgt_reconstruction.Image(image_id).ProjectionCenter() -
+               tgt_from_src *
+                   src_reconstruction.Image(image_id).ProjectionCenter())
+                  .norm(),
+              1e-6);
+  }
+}
+
 TEST(Alignment, AlignReconstructionsViaProjCenters) {
   Reconstruction src_reconstruction = GenerateReconstructionForAlignment();
   Reconstruction tgt_reconstruction = src_reconstruction;
@@ -31,6 +31,7 @@
 
 #include "colmap/estimators/cost_functions.h"
 #include "colmap/estimators/manifold.h"
+#include "colmap/estimators/schur_bundle_adjustment.h"
 #include "colmap/scene/projection.h"
 #include "colmap/sensor/models.h"
 #include "colmap/util/misc.h"
@@ -41,6 +42,63 @@
 
 namespace colmap {
 
+namespace {
+
+ceres::Solver::Options CreateSolverOptions(
+    const BundleAdjustmentOptions& options,
+    const ceres::Solver::Options& input_solver_options,
+    const ceres::Problem& problem,
+    const size_t num_images) {
+  ceres::Solver::Options solver_options = input_solver_options;
+  const bool has_sparse =
+      solver_options.sparse_linear_algebra_library_type != ceres::NO_SPARSE;
+
+  // Empirical choice.
+  const size_t kMaxNumImagesDirectDenseSolver = 50;
+  const size_t kMaxNumImagesDirectSparseSolver = 1000;
+  if (num_images <= kMaxNumImagesDirectDenseSolver) {
+    solver_options.linear_solver_type = ceres::DENSE_SCHUR;
+  } else if (num_images <= kMaxNumImagesDirectSparseSolver && has_sparse) {
+    solver_options.linear_solver_type = ceres::SPARSE_SCHUR;
+  } else {  // Indirect sparse (preconditioned CG) solver.
+    solver_options.linear_solver_type = ceres::ITERATIVE_SCHUR;
+    solver_options.preconditioner_type = ceres::SCHUR_JACOBI;
+  }
+
+  if (problem.NumResiduals() < options.min_num_residuals_for_multi_threading) {
+    solver_options.num_threads = 1;
+#if CERES_VERSION_MAJOR < 2
+    solver_options.num_linear_solver_threads = 1;
+#endif  // CERES_VERSION_MAJOR
+  } else {
+    solver_options.num_threads =
+        GetEffectiveNumThreads(solver_options.num_threads);
+#if CERES_VERSION_MAJOR < 2
+    solver_options.num_linear_solver_threads =
+        GetEffectiveNumThreads(solver_options.num_linear_solver_threads);
+#endif  // CERES_VERSION_MAJOR
+  }
+
+  std::string solver_error;
+  THROW_CHECK(solver_options.IsValid(&solver_error)) << solver_error;
+  return solver_options;
+}
+
+// Re-index the 3D points of the problem, whose positions the solver modified
+// in place, if the reconstruction maintains a spatial index.
+void UpdatePoints3DSpatialIndex(
+    const std::unordered_map<point3D_t, size_t>& point3D_num_observations,
+    Reconstruction* reconstruction) {
+  if (!reconstruction->HasPoints3DSpatialIndex()) {
+    return;
+  }
+  for (const auto& elem : point3D_num_observations) {
+    reconstruction->UpdatePoint3DSpatialIndex(elem.first);
+  }
+}
+
+}  // namespace
+
 ////////////////////////////////////////////////////////////////////////////////
 // BundleAdjustmentOptions
 ////////////////////////////////////////////////////////////////////////////////
@@ -64,6 +122,7 @@ ceres::LossFunction* BundleAdjustmentOptions::CreateLossFunction() const {
 
 bool BundleAdjustmentOptions::Check() const {
   CHECK_OPTION_GE(loss_function_scale, 0);
+  CHECK_OPTION(!use_mixed_precision || use_schur_solver);
   return true;
 }
 
@@ -267,6 +326,13 @@ BundleAdjuster::BundleAdjuster(const BundleAdjustmentOptions& options,
 }
 
 bool BundleAdjuster::Solve(Reconstruction* reconstruction) {
+  if (options_.use_schur_solver) {
+    SchurBundleAdjuster schur_bundle_adjuster(options_, config_);
+    const bool success = schur_bundle_adjuster.Solve(reconstruction);
+    summary_ = schur_bundle_adjuster.Summary();
+    return success;
+  }
+
   loss_function_ =
       std::unique_ptr<ceres::LossFunction>(options_.CreateLossFunction());
   SetUpProblem(reconstruction, loss_function_.get());
@@ -279,6 +345,7 @@ bool BundleAdjuster::Solve(Reconstruction* reconstruction) {
       SetUpSolverOptions(*problem_, options_.solver_options);
 
   ceres::Solve(solver_options, problem_.get(), &summary_);
+  UpdatePoints3DSpatialIndex(point3D_num_observations_, reconstruction);
 
   if (options_.print_summary || VLOG_IS_ON(1)) {
     PrintSolverSummary(summary_, "Bundle adjustment report");
@@ -328,40 +395,8 @@ void BundleAdjuster::SetUpProblem(Reconstruction* reconstruction,
 ceres::Solver::Options BundleAdjuster::SetUpSolverOptions(
     const ceres::Problem& problem,
     const ceres::Solver::Options& input_solver_options) const {
-  ceres::Solver::Options solver_options = input_solver_options;
-  const bool has_sparse =
-      solver_options.sparse_linear_algebra_library_type != ceres::NO_SPARSE;
-
-  // Empirical choice.
-  const size_t kMaxNumImagesDirectDenseSolver = 50;
-  const size_t kMaxNumImagesDirectSparseSolver = 1000;
-  const size_t num_images = config_.NumImages();
-  if (num_images <= kMaxNumImagesDirectDenseSolver) {
-    solver_options.linear_solver_type = ceres::DENSE_SCHUR;
-  } else if (num_images <= kMaxNumImagesDirectSparseSolver && has_sparse) {
-    solver_options.linear_solver_type = ceres::SPARSE_SCHUR;
-  } else {  // Indirect sparse (preconditioned CG) solver.
-    solver_options.linear_solver_type = ceres::ITERATIVE_SCHUR;
-    solver_options.preconditioner_type = ceres::SCHUR_JACOBI;
-  }
-
-  if (problem.NumResiduals() < options_.min_num_residuals_for_multi_threading) {
-    solver_options.num_threads = 1;
-#if CERES_VERSION_MAJOR < 2
-    solver_options.num_linear_solver_threads = 1;
-#endif  // CERES_VERSION_MAJOR
-  } else {
-    solver_options.num_threads =
-        GetEffectiveNumThreads(solver_options.num_threads);
-#if CERES_VERSION_MAJOR < 2
-    solver_options.num_linear_solver_threads =
-        GetEffectiveNumThreads(solver_options.num_linear_solver_threads);
-#endif  // CERES_VERSION_MAJOR
-  }
-
-  std::string solver_error;
-  THROW_CHECK(solver_options.IsValid(&solver_error)) << solver_error;
-  return solver_options;
+  return CreateSolverOptions(
+      options_, input_solver_options, problem, config_.NumImages());
 }
 
 void BundleAdjuster::AddImageToProblem(const image_t image_id,
@@ -526,6 +561,459 @@ void BundleAdjuster::ParameterizePoints(Reconstruction* reconstruction) {
   }
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// IncrementalBundleAdjuster
+////////////////////////////////////////////////////////////////////////////////
+
+IncrementalBundleAdjuster::IncrementalBundleAdjuster(
+    const BundleAdjustmentOptions& options)
+    : options_(options),
+      reconstruction_(nullptr),
+      generation_(0),
+      num_added_residual_blocks_(0),
+      num_removed_residual_blocks_(0) {
+  THROW_CHECK(options_.Check());
+}
+
+void IncrementalBundleAdjuster::Reset() {
+  problem_.reset();
+  loss_function_.reset();
+  reconstruction_ = nullptr;
+  residual_blocks_.clear();
+  point_blocks_.clear();
+  cam_position_params_.clear();
+  parameterized_cam_rotations_.clear();
+  constant_cam_poses_.clear();
+  parameterized_cameras_.clear();
+}
+
+void IncrementalBundleAdjuster::SetOptions(
+    const BundleAdjustmentOptions& options) {
+  THROW_CHECK(options.Check());
+  if (options.loss_function_type != options_.loss_function_type ||
+      options.loss_function_scale != options_.loss_function_scale ||
+      options.refine_focal_length != options_.refine_focal_length ||
+      options.refine_principal_point != options_.refine_principal_point ||
+      options.refine_extra_params != options_.refine_extra_params) {
+    Reset();
+  }
+  options_ = options;
+}
+
+bool IncrementalBundleAdjuster::Solve(const BundleAdjustmentConfig& config,
+                                      Reconstruction* reconstruction) {
+  THROW_CHECK_NOTNULL(reconstruction);
+
+  if (options_.use_schur_solver) {
+    // The specialized solver sets up its problem from scratch, which is cheap
+    // compared to setting up a Ceres problem.
+    Reset();
+    SchurBundleAdjuster schur_bundle_adjuster(options_, config);
+    const bool success = schur_bundle_adjuster.Solve(reconstruction);
+    summary_ = schur_bundle_adjuster.Summary();
+    return success;
+  }
+
+  if (reconstruction != reconstruction_) {
+    Reset();
+    reconstruction_ = reconstruction;
+  }
+
+  if (problem_ == nullptr) {
+    loss_function_ =
+        std::unique_ptr<ceres::LossFunction>(options_.CreateLossFunction());
+    ceres::Problem::Options problem_options;
+    problem_options.loss_function_ownership = ceres::DO_NOT_TAKE_OWNERSHIP;
+    problem_options.enable_fast_removal = true;
+    problem_ = std::make_shared<ceres::Problem>(problem_options);
+  }
+
+  generation_ += 1;
+  num_added_residual_blocks_ = 0;
+  num_removed_residual_blocks_ = 0;
+  camera_ids_.clear();
+  point3D_num_observations_.clear();
+
+  RemoveDeletedPoints();
+  RemoveOutdatedConstantPoseBlocks();
+
+  // Mark the residual blocks of the current configuration as used and add
+  // the missing ones, in the same way as BundleAdjuster sets up its problem.
+  BundleAdjustmentConfig problem_config = config;
+  for (const image_t image_id : config.Images()) {
+    Image& image = reconstruction_->Image(image_id);
+
+    // CostFunction assumes unit quaternions.
+    image.CamFromWorld().rotation.normalize();
+
+    const bool constant_cam_pose =
+        !options_.refine_extrinsics || config.HasConstantCamPose(image_id);
+    if (!constant_cam_pose) {
+      UpdateCamPoseParameterization(image_id, config);
+    }
+
+    size_t num_observations = 0;
+    for (point2D_t point2D_idx = 0; point2D_idx < image.NumPoints2D();
+         ++point2D_idx) {
+      const Point2D& point2D = image.Point2D(point2D_idx);
+      if (!point2D.HasPoint3D()) {
+        continue;
+      }
+      num_observations += 1;
+      point3D_num_observations_[point2D.point3D_id] += 1;
+      UpdateResidualBlock(
+          image_id, point2D_idx, point2D.point3D_id, constant_cam_pose);
+    }
+
+    if (num_observations > 0) {
+      camera_ids_.insert(image.CameraId());
+
+      if (!constant_cam_pose) {
+        double* cam_from_world_rotation =
+            image.CamFromWorld().rotation.coeffs().data();
+        if (parameterized_cam_rotations_.insert(image_id).second) {
+          SetQuaternionManifold(problem_.get(), cam_from_world_rotation);
+        }
+        if (cam_position_params_.count(image_id) == 0) {
+          std::vector<int> constant_position_idxs;
+          if (config.HasConstantCamPositions(image_id)) {
+            constant_position_idxs = config.ConstantCamPositions(image_id);
+            SetSubsetManifold(3,
+                              constant_position_idxs,
+                              problem_.get(),
+                              image.CamFromWorld().translation.data());
+          }
+          cam_position_params_.emplace(image_id,
+                                       std::move(constant_position_idxs));
+        }
+      }
+    }
+  }
+
+  std::vector<point3D_t> point3D_ids;
+  point3D_ids.reserve(config.NumPoints());
+  point3D_ids.insert(point3D_ids.end(),
+                     config.VariablePoints().begin(),
+                     config.VariablePoints().end());
+  point3D_ids.insert(point3D_ids.end(),
+                     config.ConstantPoints().begin(),
+                     config.ConstantPoints().end());
+  for (const point3D_t point3D_id : point3D_ids) {
+    const Point3D& point3D = reconstruction_->Point3D(point3D_id);
+    if (point3D_num_observations_[point3D_id] == point3D.track.Length()) {
+      continue;
+    }
+
+    for (const auto& track_el : point3D.track.Elements()) {
+      if (config.HasImage(track_el.image_id)) {
+        continue;
+      }
+
+      point3D_num_observations_[point3D_id] += 1;
+
+      Image& image = reconstruction_->Image(track_el.image_id);
+      image.CamFromWorld().rotation.normalize();
+
+      if (camera_ids_.count(image.CameraId()) == 0) {
+        camera_ids_.insert(image.CameraId());
+        problem_config.SetConstantCamIntrinsics(image.CameraId());
+      }
+
+      UpdateResidualBlock(track_el.image_id,
+                          track_el.point2D_idx,
+                          point3D_id,
+                          /*constant_cam_pose=*/true);
+    }
+  }
+
+  RemoveUnusedResidualBlocks();
+  ParameterizeCameras(problem_config);
+  ParameterizePoints(problem_config);
+
+  VLOG(2) << "Incremental bundle adjustment added "
+          << num_added_residual_blocks_ << " and removed "
+          << num_removed_residual_blocks_ << " residual blocks";
+
+  if (problem_->NumResiduals() == 0) {
+    return false;
+  }
+
+  const ceres::Solver::Options solver_options =
+      CreateSolverOptions(options_,
+                          options_.solver_options,
+                          *problem_,
+                          problem_config.NumImages());
+
+  ceres::Solve(solver_options, problem_.get(), &summary_);
+  UpdatePoints3DSpatialIndex(point3D_num_observations_, reconstruction_);
+
+  if (options_.print_summary || VLOG_IS_ON(1)) {
+    PrintSolverSummary(summary_, "Bundle adjustment report");
+  }
+
+  return true;
+}
+
+void IncrementalBundleAdjuster::RemoveDeletedPoints() {
+  std::unordered_set<point3D_t> deleted_point3D_ids;
+  for (auto it = point_blocks_.begin(); it != point_blocks_.end();) {
+    if (reconstruction_->ExistsPoint3D(it->first)) {
+      ++it;
+      continue;
+    }
+    // Removes all residual blocks depending on the point. The memory of the
+    // point is not accessed, it only serves as the key of the block.
+    problem_->RemoveParameterBlock(it->second.xyz);
+    num_removed_residual_blocks_ += it->second.num_residual_blocks;
+    deleted_point3D_ids.insert(it->first);
+    it = point_blocks_.erase(it);
+  }
+
+  if (deleted_point3D_ids.empty()) {
+    return;
+  }
+
+  for (auto& image_residual_blocks : residual_blocks_) {
+    auto& blocks = image_residual_blocks.second;
+    for (auto it = blocks.begin(); it != blocks.end();) {
+      if (deleted_point3D_ids.count(it->second.point3D_id) > 0) {
+        it = blocks.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+}
+
+void IncrementalBundleAdjuster::RemoveOutdatedConstantPoseBlocks() {
+  // Images may have been refined since their constant pose residual blocks
+  // were added, e.g., as part of a previous local or global bundle.
+  constexpr double kMaxPoseDiff = 1e-12;
+  for (auto it = constant_cam_poses_.begin();
+       it != constant_cam_poses_.end();) {
+    const Rigid3d& cam_from_world =
+        reconstruction_->Image(it->first).CamFromWorld();
+    if ((cam_from_world.rotation.coeffs() - it->second.rotation.coeffs())
+                .lpNorm<Eigen::Infinity>() <= kMaxPoseDiff &&
+        (cam_from_world.translation - it->second.translation)
+                .lpNorm<Eigen::Infinity>() <= kMaxPoseDiff) {
+      ++it;
+      continue;
+    }
+
+    auto& blocks = residual_blocks_[it->first];
+    for (auto block_it = blocks.begin(); block_it != blocks.end();) {
+      if (block_it->second.constant_cam_pose) {
+        RemoveResidualBlock(block_it);
+        block_it = blocks.erase(block_it);
+      } else {
+        ++block_it;
+      }
+    }
+    it = constant_cam_poses_.erase(it);
+  }
+}
+
+void IncrementalBundleAdjuster::UpdateCamPoseParameterization(
+    const image_t image_id, const BundleAdjustmentConfig& config) {
+  const auto it = cam_position_params_.find(image_id);
+  if (it == cam_position_params_.end()) {
+    return;
+  }
+
+  std::vector<int> constant_position_idxs;
+  if (config.HasConstantCamPositions(image_id)) {
+    constant_position_idxs = config.ConstantCamPositions(image_id);
+  }
+  if (constant_position_idxs == it->second) {
+    return;
+  }
+
+  // The manifold of a parameter block cannot be changed in all versions of
+  // Ceres, so the translation and its residual blocks are added again.
+  Image& image = reconstruction_->Image(image_id);
+  problem_->RemoveParameterBlock(image.CamFromWorld().translation.data());
+  cam_position_params_.erase(it);
+
+  auto& blocks = residual_blocks_[image_id];
+  for (auto block_it = blocks.begin(); block_it != blocks.end();) {
+    if (block_it->second.constant_cam_pose) {
+      ++block_it;
+      continue;
+    }
+    point_blocks_.at(block_it->second.point3D_id).num_residual_blocks -= 1;
+    num_removed_residual_blocks_ += 1;
+    block_it = blocks.erase(block_it);
+  }
+}
+
+void IncrementalBundleAdjuster::UpdateResidualBlock(
+    const image_t image_id,
+    const point2D_t point2D_idx,
+    const point3D_t point3D_id,
+    const bool constant_cam_pose) {
+  auto& blocks = residual_blocks_[image_id];
+  const auto it = blocks.find(point2D_idx);
+  if (it != blocks.end()) {
+    if (it->second.point3D_id == point3D_id &&
+        it->second.constant_cam_pose == constant_cam_pose) {
+      it->second.generation = generation_;
+      return;
+    }
+    RemoveResidualBlock(it);
+    blocks.erase(it);
+  }
+
+  Image& image = reconstruction_->Image(image_id);
+  Camera& camera = reconstruction_->Camera(image.CameraId());
+  Point3D& point3D = reconstruction_->Point3D(point3D_id);
+  const Point2D& point2D = image.Point2D(point2D_idx);
+
+  ResidualBlock block;
+  if (constant_cam_pose) {
+    constant_cam_poses_[image_id] = image.CamFromWorld();
+    block.id = problem_->AddResidualBlock(
+        CameraCostFunction<ReprojErrorConstantPoseCostFunction>(
+            camera.model_id, image.CamFromWorld(), point2D.xy),
+        loss_function_.get(),
+        point3D.xyz.data(),
+        camera.params.data());
+  } else {
+    block.id = problem_->AddResidualBlock(
+        CameraCostFunction<ReprojErrorCostFunction>(camera.model_id,
+                                                    point2D.xy),
+        loss_function_.get(),
+        image.CamFromWorld().rotation.coeffs().data(),
+        image.CamFromWorld().translation.data(),
+        point3D.xyz.data(),
+        camera.params.data());
+  }
+  block.point3D_id = point3D_id;
+  block.constant_cam_pose = constant_cam_pose;
+  block.generation = generation_;
+  blocks.emplace(point2D_idx, block);
+
+  PointBlock& point_block = point_blocks_[point3D_id];
+  point_block.xyz = point3D.xyz.data();
+  point_block.num_residual_blocks += 1;
+  num_added_residual_blocks_ += 1;
+}
+
+void IncrementalBundleAdjuster::RemoveResidualBlock(
+    std::unordered_map<point2D_t, ResidualBlock>::iterator it) {
+  problem_->RemoveResidualBlock(it->second.id);
+  point_blocks_.at(it->second.point3D_id).num_residual_blocks -= 1;
+  num_removed_residual_blocks_ += 1;
+}
+
+void IncrementalBundleAdjuster::RemoveUnusedResidualBlocks() {
+  for (auto image_it = residual_blocks_.begin();
+       image_it != residual_blocks_.end();) {
+    auto& blocks = image_it->second;
+    for (auto it = blocks.begin(); it != blocks.end();) {
+      if (it->second.generation == generation_) {
+        ++it;
+        continue;
+      }
+      RemoveResidualBlock(it);
+      it = blocks.erase(it);
+    }
+    if (blocks.empty()) {
+      image_it = residual_blocks_.erase(image_it);
+    } else {
+      ++image_it;
+    }
+  }
+
+  // Points without residual blocks would otherwise remain in the problem and
+  // might be deleted from the reconstruction before the next call.
+  for (auto it = point_blocks_.begin(); it != point_blocks_.end();) {
+    if (it->second.num_residual_blocks == 0) {
+      problem_->RemoveParameterBlock(it->second.xyz);
+      it = point_blocks_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void IncrementalBundleAdjuster::ParameterizeCameras(
+    const BundleAdjustmentConfig& config) {
+  const bool constant_camera = !options_.refine_focal_length &&
+                               !options_.refine_principal_point &&
+                               !options_.refine_extra_params;
+  for (const camera_t camera_id : camera_ids_) {
+    Camera& camera = reconstruction_->Camera(camera_id);
+
+    if (constant_camera || config.HasConstantCamIntrinsics(camera_id)) {
+      problem_->SetParameterBlockConstant(camera.params.data());
+      continue;
+    }
+
+    problem_->SetParameterBlockVariable(camera.params.data());
+    if (!parameterized_cameras_.insert(camera_id).second) {
+      continue;
+    }
+
+    std::vector<int> const_camera_params;
+    if (!options_.refine_focal_length) {
+      const span<const size_t> params_idxs = camera.FocalLengthIdxs();
+      const_camera_params.insert(
+          const_camera_params.end(), params_idxs.begin(), params_idxs.end());
+    }
+    if (!options_.refine_principal_point) {
+      const span<const size_t> params_idxs = camera.PrincipalPointIdxs();
+      const_camera_params.insert(
+          const_camera_params.end(), params_idxs.begin(), params_idxs.end());
+    }
+    if (!options_.refine_extra_params) {
+      const span<const size_t> params_idxs = camera.ExtraParamsIdxs();
+      const_camera_params.insert(
+          const_camera_params.end(), params_idxs.begin(), params_idxs.end());
+    }
+
+    if (const_camera_params.size() > 0) {
+      SetSubsetManifold(static_cast<int>(camera.params.size()),
+                        const_camera_params,
+                        problem_.get(),
+                        camera.params.data());
+    }
+  }
+}
+
+void IncrementalBundleAdjuster::ParameterizePoints(
+    const BundleAdjustmentConfig& config) {
+  for (const auto& elem : point3D_num_observations_) {
+    Point3D& point3D = reconstruction_->Point3D(elem.first);
+    if (point3D.track.Length() > elem.second ||
+        config.HasConstantPoint(elem.first)) {
+      problem_->SetParameterBlockConstant(point3D.xyz.data());
+    } else {
+      problem_->SetParameterBlockVariable(point3D.xyz.data());
+    }
+  }
+}
+
+const BundleAdjustmentOptions& IncrementalBundleAdjuster::Options() const {
+  return options_;
+}
+
+std::shared_ptr<ceres::Problem> IncrementalBundleAdjuster::Problem() {
+  return problem_;
+}
+
+const ceres::Solver::Summary& IncrementalBundleAdjuster::Summary() const {
+  return summary_;
+}
+
+size_t IncrementalBundleAdjuster::NumAddedResidualBlocks() const {
+  return num_added_residual_blocks_;
+}
+
+size_t IncrementalBundleAdjuster::NumRemovedResidualBlocks() const {
+  return num_removed_residual_blocks_;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // RigBundleAdjuster
 ////////////////////////////////////////////////////////////////////////////////
@@ -549,6 +1037,7 @@ bool RigBundleAdjuster::Solve(Reconstruction* reconstruction,
       SetUpSolverOptions(*problem_, options_.solver_options);
 
   ceres::Solve(solver_options, problem_.get(), &summary_);
+  UpdatePoints3DSpatialIndex(point3D_num_observations_, reconstruction);
 
   if (options_.print_summary || VLOG_IS_ON(1)) {
     PrintSolverSummary(summary_, "Rig Bundle adjustment report");
@@ -34,6 +34,7 @@
 #include "colmap/util/eigen_alignment.h"
 
 #include <memory>
+#include <unordered_map>
 #include <unordered_set>
 
 #include <Eigen/Core>
@@ -69,6 +70,19 @@ struct BundleAdjustmentOptions {
   // due to the overhead of threading.
   int min_num_residuals_for_multi_threading = 50000;
 
+  // Whether to solve the problem with the specialized Schur complement solver
+  // instead of Ceres-Solver. Only applies to BundleAdjuster and is typically
+  // faster for large problems, see SchurBundleAdjuster for details.
+  bool use_schur_solver = false;
+
+  // Whether the Schur complement solver stores the Jacobians and the reduced
+  // camera system in single precision. Residuals, costs, and parameters remain
+  // in double precision and the solution of the reduced camera system is
+  // refined in double precision. Halves the memory and memory bandwidth of
+  // the Jacobians, which dominate for large problems. Requires
+  // use_schur_solver, otherwise the options fail the check.
+  bool use_mixed_precision = false;
+
   // Ceres-Solver options.
   ceres::Solver::Options solver_options;
 
@@ -211,6 +225,97 @@ class BundleAdjuster {
   std::unique_ptr<ceres::LossFunction> loss_function_;
 };
 
+// Bundle adjuster that keeps its Ceres problem alive across calls to Solve and
+// only adds and removes the residuals of the observations that changed since
+// the previous call. This is intended for repeated bundle adjustment of
+// overlapping configurations, e.g. local bundle adjustment during incremental
+// mapping, where most residuals are shared between consecutive problems.
+//
+// The problem references the parameters of the reconstruction, which must
+// therefore stay the same object between calls (a different reconstruction
+// resets the problem). Points deleted from the reconstruction between calls are
+// detected and removed from the problem.
+class IncrementalBundleAdjuster {
+ public:
+  explicit IncrementalBundleAdjuster(const BundleAdjustmentOptions& options);
+
+  // Update the problem to the given configuration and solve it. Returns false
+  // if the configuration has no residuals.
+  bool Solve(const BundleAdjustmentConfig& config,
+             Reconstruction* reconstruction);
+
+  // Clear the problem, such that the next call to Solve starts from scratch.
+  void Reset();
+
+  // Update the options. The problem is reset if the loss function or the
+  // parameterization of the intrinsics change.
+  void SetOptions(const BundleAdjustmentOptions& options);
+
+  // Getter functions below
+  const BundleAdjustmentOptions& Options() const;
+  std::shared_ptr<ceres::Problem> Problem();
+  const ceres::Solver::Summary& Summary() const;
+
+  // The number of residual blocks added to and removed from the problem by the
+  // last call to Solve.
+  size_t NumAddedResidualBlocks() const;
+  size_t NumRemovedResidualBlocks() const;
+
+ private:
+  struct ResidualBlock {
+    ceres::ResidualBlockId id;
+    point3D_t point3D_id;
+    bool constant_cam_pose;
+    // The last call to Solve that used this residual block.
+    size_t generation;
+  };
+
+  struct PointBlock {
+    double* xyz;
+    size_t num_residual_blocks;
+  };
+
+  void RemoveDeletedPoints();
+  void RemoveOutdatedConstantPoseBlocks();
+  void UpdateCamPoseParameterization(image_t image_id,
+                                     const BundleAdjustmentConfig& config);
+  void UpdateResidualBlock(image_t image_id,
+                           point2D_t point2D_idx,
+                           point3D_t point3D_id,
+                           bool constant_cam_pose);
+  void RemoveResidualBlock(
+      std::unordered_map<point2D_t, ResidualBlock>::iterator it);
+  void RemoveUnusedResidualBlocks();
+  void ParameterizeCameras(const BundleAdjustmentConfig& config);
+  void ParameterizePoints(const BundleAdjustmentConfig& config);
+
+  BundleAdjustmentOptions options_;
+  Reconstruction* reconstruction_;
+  std::shared_ptr<ceres::Problem> problem_;
+  std::unique_ptr<ceres::LossFunction> loss_function_;
+  ceres::Solver::Summary summary_;
+  size_t generation_;
+  size_t num_added_residual_blocks_;
+  size_t num_removed_residual_blocks_;
+
+  // Residual blocks in the problem by image and 2D point.
+  std::unordered_map<image_t, std::unordered_map<point2D_t, ResidualBlock>>
+      residual_blocks_;
+  // Points referenced by residual blocks in the problem.
+  std::unordered_map<point3D_t, PointBlock> point_blocks_;
+  // Constant position indices with which the translation of variable poses
+  // was parameterized and the images with a parameterized rotation.
+  std::unordered_map<image_t, std::vector<int>> cam_position_params_;
+  std::unordered_set<image_t> parameterized_cam_rotations_;
+  std::unordered_set<camera_t> parameterized_cameras_;
+  // Poses baked into the constant pose residual blocks of each image.
+  std::unordered_map<image_t, Rigid3d> constant_cam_poses_;
+
+  // Cameras and number of observations of points in the current problem.
+  std::unordered_set<camera_t> camera_ids_;
+  std::unordered_map<point3D_t, size_t> point3D_num_observations_;
+};
+
 class RigBundleAdjuster : public BundleAdjuster {
  public:
   struct Options {
@@ -643,6 +643,258 @@ TEST(BundleAdjustment, ConstantExtraParam) {
   }
 }
 
+TEST(BundleAdjustment, IncrementalTwoView) {
+  Reconstruction reconstruction;
+  GenerateReconstruction(2, 100, &reconstruction);
+  const auto orig_reconstruction = reconstruction;
+
+  BundleAdjustmentConfig config;
+  config.AddImage(0);
+  config.AddImage(1);
+  config.SetConstantCamPose(0);
+  config.SetConstantCamPositions(1, {0});
+
+  BundleAdjustmentOptions options;
+  IncrementalBundleAdjuster bundle_adjuster(options);
+  ASSERT_TRUE(bundle_adjuster.Solve(config, &reconstruction));
+  EXPECT_EQ(bundle_adjuster.NumAddedResidualBlocks(), 200);
+  EXPECT_EQ(bundle_adjuster.NumRemovedResidualBlocks(), 0);
+
+  // Same as in the TwoView test.
+  EXPECT_EQ(bundle_adjuster.Summary().num_residuals_reduced, 400);
+  EXPECT_EQ(bundle_adjuster.Summary().num_effective_parameters_reduced, 309);
+
+  CheckVariableCamera(reconstruction.Camera(0), orig_reconstruction.Camera(0));
+  CheckConstantImage(reconstruction.Image(0), orig_reconstruction.Image(0));
+
+  CheckVariableCamera(reconstruction.Camera(1), orig_reconstruction.Camera(1));
+  CheckConstantXImage(reconstruction.Image(1), orig_reconstruction.Image(1));
+
+  for (const auto& point3D : reconstruction.Points3D()) {
+    CheckVariablePoint(point3D.second,
+                       orig_reconstruction.Point3D(point3D.first));
+  }
+
+  // Solving the same configuration again reuses the problem.
+  ASSERT_TRUE(bundle_adjuster.Solve(config, &reconstruction));
+  EXPECT_EQ(bundle_adjuster.NumAddedResidualBlocks(), 0);
+  EXPECT_EQ(bundle_adjuster.NumRemovedResidualBlocks(), 0);
+  EXPECT_EQ(bundle_adjuster.Summary().num_residuals_reduced, 400);
+  EXPECT_EQ(bundle_adjuster.Summary().num_effective_parameters_reduced, 309);
+}
+
+TEST(BundleAdjustment, IncrementalUpdate) {
+  Reconstruction reconstruction;
+  GenerateReconstruction(3, 100, &reconstruction);
+
+  BundleAdjustmentConfig config;
+  config.AddImage(0);
+  config.AddImage(1);
+  config.SetConstantCamPose(0);
+  for (const auto& point3D : reconstruction.Points3D()) {
+    config.AddVariablePoint(point3D.first);
+  }
+
+  BundleAdjustmentOptions options;
+  IncrementalBundleAdjuster bundle_adjuster(options);
+
+  // The observations in the third image are added with constant pose.
+  ASSERT_TRUE(bundle_adjuster.Solve(config, &reconstruction));
+  EXPECT_EQ(bundle_adjuster.NumAddedResidualBlocks(), 300);
+  EXPECT_EQ(bundle_adjuster.NumRemovedResidualBlocks(), 0);
+  EXPECT_EQ(bundle_adjuster.Problem()->NumResidualBlocks(), 300);
+
+  // Refining the pose of the third image replaces its residual blocks.
+  config.AddImage(2);
+  ASSERT_TRUE(bundle_adjuster.Solve(config, &reconstruction));
+  EXPECT_EQ(bundle_adjuster.NumAddedResidualBlocks(), 100);
+  EXPECT_EQ(bundle_adjuster.NumRemovedResidualBlocks(), 100);
+  EXPECT_EQ(bundle_adjuster.Problem()->NumResidualBlocks(), 300);
+
+  reconstruction.DeleteObservation(2, 0);
+  ASSERT_TRUE(bundle_adjuster.Solve(config, &reconstruction));
+  EXPECT_EQ(bundle_adjuster.NumAddedResidualBlocks(), 0);
+  EXPECT_EQ(bundle_adjuster.NumRemovedResidualBlocks(), 1);
+  EXPECT_EQ(bundle_adjuster.Problem()->NumResidualBlocks(), 299);
+
+  const point3D_t point3D_id = reconstruction.Image(0).Point2D(1).point3D_id;
+  config.RemoveVariablePoint(point3D_id);
+  reconstruction.DeletePoint3D(point3D_id);
+  ASSERT_TRUE(bundle_adjuster.Solve(config, &reconstruction));
+  EXPECT_EQ(bundle_adjuster.NumAddedResidualBlocks(), 0);
+  EXPECT_EQ(bundle_adjuster.NumRemovedResidualBlocks(), 3);
+  EXPECT_EQ(bundle_adjuster.Problem()->NumResidualBlocks(), 296);
+
+  // The constant pose residual blocks of the first image are kept when it is
+  // only observed through the tracks of the configuration.
+  config.RemoveImage(0);
+  ASSERT_TRUE(bundle_adjuster.Solve(config, &reconstruction));
+  EXPECT_EQ(bundle_adjuster.NumAddedResidualBlocks(), 0);
+  EXPECT_EQ(bundle_adjuster.NumRemovedResidualBlocks(), 0);
+  EXPECT_EQ(bundle_adjuster.Problem()->NumResidualBlocks(), 296);
+
+  bundle_adjuster.Reset();
+  ASSERT_TRUE(bundle_adjuster.Solve(config, &reconstruction));
+  EXPECT_EQ(bundle_adjuster.NumAddedResidualBlocks(), 296);
+  EXPECT_EQ(bundle_adjuster.NumRemovedResidualBlocks(), 0);
+}
+
+TEST(BundleAdjustment, IncrementalMatchesBundleAdjuster) {
+  Reconstruction reconstruction;
+  GenerateReconstruction(4, 100, &reconstruction);
+
+  BundleAdjustmentConfig config;
+  config.AddImage(0);
+  config.AddImage(1);
+  config.SetConstantCamPose(0);
+  config.SetConstantCamIntrinsics(1);
+  config.AddConstantPoint(reconstruction.Image(0).Point2D(0).point3D_id);
+
+  BundleAdjustmentOptions options;
+  IncrementalBundleAdjuster incremental_bundle_adjuster(options);
+  // Prepare the problem for a different configuration first.
+  BundleAdjustmentConfig prev_config;
+  prev_config.AddImage(2);
+  prev_config.AddImage(3);
+  ASSERT_TRUE(incremental_bundle_adjuster.Solve(prev_config, &reconstruction));
+
+  Reconstruction reconstruction_copy = reconstruction;
+  ASSERT_TRUE(incremental_bundle_adjuster.Solve(config, &reconstruction));
+  BundleAdjuster bundle_adjuster(options, config);
+  ASSERT_TRUE(bundle_adjuster.Solve(&reconstruction_copy));
+
+  const ceres::Solver::Summary& summary =
+      incremental_bundle_adjuster.Summary();
+  EXPECT_EQ(summary.num_residuals_reduced,
+            bundle_adjuster.Summary().num_residuals_reduced);
+  EXPECT_EQ(summary.num_effective_parameters_reduced,
+            bundle_adjuster.Summary().num_effective_parameters_reduced);
+  EXPECT_NEAR(summary.final_cost,
+              bundle_adjuster.Summary().final_cost,
+              1e-6 * bundle_adjuster.Summary().final_cost);
+}
+
+// Solves the configuration with the Schur complement solver in double and in
+// mixed precision and checks that both converge to the same solution.
+void CheckMixedPrecision(const Reconstruction& reconstruction,
+                         const BundleAdjustmentConfig& config,
+                         BundleAdjustmentOptions options) {
+  options.print_summary = false;
+  options.use_schur_solver = true;
+
+  Reconstruction double_reconstruction = reconstruction;
+  BundleAdjuster double_bundle_adjuster(options, config);
+  ASSERT_TRUE(double_bundle_adjuster.Solve(&double_reconstruction));
+
+  options.use_mixed_precision = true;
+  Reconstruction mixed_reconstruction = reconstruction;
+  BundleAdjuster mixed_bundle_adjuster(options, config);
+  ASSERT_TRUE(mixed_bundle_adjuster.Solve(&mixed_reconstruction));
+
+  const ceres::Solver::Summary& double_summary =
+      double_bundle_adjuster.Summary();
+  const ceres::Solver::Summary& mixed_summary = mixed_bundle_adjuster.Summary();
+  EXPECT_NE(mixed_summary.termination_type, ceres::FAILURE);
+  EXPECT_EQ(mixed_summary.num_effective_parameters_reduced,
+            double_summary.num_effective_parameters_reduced);
+  // The cost is always evaluated in double precision.
+  EXPECT_EQ(mixed_summary.initial_cost, double_summary.initial_cost);
+  EXPECT_LT(mixed_summary.final_cost, mixed_summary.initial_cost);
+  EXPECT_EQ(mixed_summary.linear_solver_type_used,
+            double_summary.linear_solver_type_used);
+  // The scenes converge slowly along weakly constrained directions, such as
+  // the focal length and the depth of the points, so only the cost is compared
+  // after the maximum number of iterations.
+  EXPECT_NEAR(mixed_summary.final_cost,
+              double_summary.final_cost,
+              1e-6 * double_summary.final_cost);
+}
+
+TEST(BundleAdjustment, MixedPrecisionRequiresSchurSolver) {
+  BundleAdjustmentOptions options;
+  options.use_mixed_precision = true;
+  EXPECT_FALSE(options.Check());
+  options.use_schur_solver = true;
+  EXPECT_TRUE(options.Check());
+}
+
+TEST(BundleAdjustment, MixedPrecisionTwoView) {
+  Reconstruction reconstruction;
+  GenerateReconstruction(2, 100, &reconstruction);
+
+  BundleAdjustmentConfig config;
+  config.AddImage(0);
+  config.AddImage(1);
+  config.SetConstantCamPose(0);
+  config.SetConstantCamPositions(1, {0});
+
+  CheckMixedPrecision(reconstruction, config, BundleAdjustmentOptions());
+}
+
+TEST(BundleAdjustment, MixedPrecisionPartiallyContainedTracks) {
+  Reconstruction reconstruction;
+  GenerateReconstruction(3, 100, &reconstruction);
+  reconstruction.DeleteObservation(2, 0);
+
+  BundleAdjustmentConfig config;
+  config.AddImage(0);
+  config.AddImage(1);
+  config.SetConstantCamPose(0);
+  config.SetConstantCamPose(1);
+
+  CheckMixedPrecision(reconstruction, config, BundleAdjustmentOptions());
+}
+
+TEST(BundleAdjustment, MixedPrecisionVariablePrincipalPoint) {
+  Reconstruction reconstruction;
+  GenerateReconstruction(3, 100, &reconstruction);
+
+  BundleAdjustmentConfig config;
+  config.AddImage(0);
+  config.AddImage(1);
+  config.AddImage(2);
+  config.SetConstantCamPose(0);
+  config.SetConstantCamPositions(1, {0});
+
+  BundleAdjustmentOptions options;
+  options.refine_principal_point = true;
+  CheckMixedPrecision(reconstruction, config, options);
+}
+
+TEST(BundleAdjustment, MixedPrecisionRobustLoss) {
+  Reconstruction reconstruction;
+  GenerateReconstruction(10, 100, &reconstruction);
+
+  BundleAdjustmentConfig config;
+  for (image_t image_id = 0; image_id < 10; ++image_id) {
+    config.AddImage(image_id);
+  }
+  config.SetConstantCamPose(0);
+  config.SetConstantCamPositions(1, {0});
+
+  BundleAdjustmentOptions options;
+  options.loss_function_type =
+      BundleAdjustmentOptions::LossFunctionType::CAUCHY;
+  CheckMixedPrecision(reconstruction, config, options);
+}
+
+TEST(BundleAdjustment, MixedPrecisionIterative) {
+  // Large enough for the reduced camera system to be solved iteratively.
+  Reconstruction reconstruction;
+  GenerateReconstruction(120, 100, &reconstruction);
+
+  BundleAdjustmentConfig config;
+  for (image_t image_id = 0; image_id < 120; ++image_id) {
+    config.AddImage(image_id);
+  }
+  config.SetConstantCamPose(0);
+  config.SetConstantCamPositions(1, {0});
+
+  BundleAdjustmentOptions options;
+  options.solver_options.max_num_iterations = 30;
+  CheckMixedPrecision(reconstruction, config, options);
+}
+
 TEST(BundleAdjustment, RigTwoView) {
   Reconstruction reconstruction;
   GenerateReconstruction(2, 100, &reconstruction);
@@ -31,9 +31,31 @@
 
 #include "colmap/estimators/manifold.h"
 
+#include <algorithm>
+
 #include <ceres/crs_matrix.h>
 
 namespace colmap {
+namespace {
+
+// Find the index of the entry (row, col) of a symmetric matrix stored as its
+// compressed lower triangle, or -1 if it is not part of the sparsity pattern.
+int FindLowerTriangularEntry(const Eigen::SparseMatrix<double>& matrix,
+                             int row,
+                             int col) {
+  if (row < col) {
+    std::swap(row, col);
+  }
+  const int* begin = matrix.innerIndexPtr() + matrix.outerIndexPtr()[col];
+  const int* end = matrix.innerIndexPtr() + matrix.outerIndexPtr()[col + 1];
+  const int* it = std::lower_bound(begin, end, row);
+  if (it == end || *it != row) {
+    return -1;
+  }
+  return it - matrix.innerIndexPtr();
+}
+
+}  // namespace
 
 BundleAdjustmentCovarianceEstimatorBase::
     BundleAdjustmentCovarianceEstimatorBase(ceres::Problem* problem,
@@ -485,9 +507,12 @@ bool BundleAdjustmentCovarianceEstimator::HasValidPoseFactorization() const {
 
 double BundleAdjustmentCovarianceEstimator::GetPoseCovarianceByIndex(
     int row, int col) const {
-  THROW_CHECK(HasValidPoseCovariance() || HasValidPoseFactorization());
+  THROW_CHECK(HasValidPoseCovariance() || HasValidSelectedCovariance() ||
+              HasValidPoseFactorization());
   if (HasValidPoseCovariance())
     return cov_poses_(row, col);
+  else if (HasValidSelectedCovariance())
+    return GetSelectedCovarianceByIndex(row, col);
   else
     return L_matrix_poses_inv_.col(row).dot(L_matrix_poses_inv_.col(col));
 }
@@ -498,13 +523,23 @@ BundleAdjustmentCovarianceEstimator::GetPoseCovarianceBlockOperation(
     int col_start,
     int row_block_size,
     int col_block_size) const {
-  THROW_CHECK(HasValidPoseCovariance() || HasValidPoseFactorization());
+  THROW_CHECK(HasValidPoseCovariance() || HasValidSelectedCovariance() ||
+              HasValidPoseFactorization());
   if (HasValidPoseCovariance()) {
     return cov_poses_.block(
         row_start, col_start, row_block_size, col_block_size);
   }
-  // HasValidPoseRefactorization() == true
   Eigen::MatrixXd output(row_block_size, col_block_size);
+  if (HasValidSelectedCovariance()) {
+    for (int row = 0; row < row_block_size; ++row) {
+      for (int col = 0; col < col_block_size; ++col) {
+        output(row, col) =
+            GetSelectedCovarianceByIndex(row_start + row, col_start + col);
+      }
+    }
+    return output;
+  }
+  // HasValidPoseRefactorization() == true
   for (int row = 0; row < row_block_size; ++row) {
     for (int col = 0; col < col_block_size; ++col) {
       output(row, col) = L_matrix_poses_inv_.col(row_start + row)
@@ -520,9 +555,12 @@ bool BundleAdjustmentCovarianceEstimator::HasValidFullFactorization() const {
 
 double BundleAdjustmentCovarianceEstimator::GetCovarianceByIndex(
     int row, int col) const {
-  THROW_CHECK(HasValidFullCovariance() || HasValidFullFactorization());
+  THROW_CHECK(HasValidFullCovariance() || HasValidSelectedCovariance() ||
+              HasValidFullFactorization());
   if (HasValidFullCovariance())
     return cov_variables_(row, col);
+  else if (HasValidSelectedCovariance())
+    return GetSelectedCovarianceByIndex(row, col);
   else
     return L_matrix_variables_inv_.col(row).dot(
         L_matrix_variables_inv_.col(col));
@@ -534,13 +572,23 @@ BundleAdjustmentCovarianceEstimator::GetCovarianceBlockOperation(
     int col_start,
     int row_block_size,
     int col_block_size) const {
-  THROW_CHECK(HasValidFullCovariance() || HasValidFullFactorization());
+  THROW_CHECK(HasValidFullCovariance() || HasValidSelectedCovariance() ||
+              HasValidFullFactorization());
   if (HasValidFullCovariance()) {
     return cov_variables_.block(
         row_start, col_start, row_block_size, col_block_size);
   }
-  // HasValidRefactorization() == true
   Eigen::MatrixXd output(row_block_size, col_block_size);
+  if (HasValidSelectedCovariance()) {
+    for (int row = 0; row < row_block_size; ++row) {
+      for (int col = 0; col < col_block_size; ++col) {
+        output(row, col) =
+            GetSelectedCovarianceByIndex(row_start + row, col_start + col);
+      }
+    }
+    return output;
+  }
+  // HasValidRefactorization() == true
   for (int row = 0; row < row_block_size; ++row) {
     for (int col = 0; col < col_block_size; ++col) {
       output(row, col) = L_matrix_variables_inv_.col(row_start + row)
@@ -623,6 +671,135 @@ bool BundleAdjustmentCovarianceEstimator::ComputeFull() {
   return true;
 }
 
+bool BundleAdjustmentCovarianceEstimator::HasValidSelectedCovariance() const {
+  return cov_selected_.size() != 0;
+}
+
+double BundleAdjustmentCovarianceEstimator::GetSelectedCovarianceByIndex(
+    int row, int col) const {
+  THROW_CHECK(HasValidSelectedCovariance());
+  const int index = FindLowerTriangularEntry(
+      cov_selected_, cov_selected_perm_(row), cov_selected_perm_(col));
+  THROW_CHECK_GE(index, 0)
+      << StringPrintf("Covariance entry (%d, %d) is not part of the sparsity "
+                      "pattern of the selected inverse.",
+                      row,
+                      col);
+  return cov_selected_.valuePtr()[index];
+}
+
+bool BundleAdjustmentCovarianceEstimator::ComputeSelected(
+    const std::vector<std::pair<const double*, const double*>>& block_pairs) {
+  if (!HasValidSchurComplement()) {
+    ComputeSchurComplement();
+  }
+  const int num_params = num_params_poses_ + num_params_other_variables_;
+
+  // Damp the other variables and add explicit zeros for the requested cross
+  // covariances, so that they become part of the sparsity pattern of the
+  // Cholesky factor and thus of the selected inverse.
+  std::vector<Eigen::Triplet<double>> triplets;
+  triplets.reserve(S_matrix_.nonZeros() + num_params_other_variables_);
+  for (int col = 0; col < S_matrix_.outerSize(); ++col) {
+    for (Eigen::SparseMatrix<double>::InnerIterator it(S_matrix_, col); it;
+         ++it) {
+      triplets.emplace_back(it.row(), it.col(), it.value());
+    }
+  }
+  for (int i = num_params_poses_; i < num_params; ++i) {
+    triplets.emplace_back(i, i, lambda_);
+  }
+  for (const auto& block_pair : block_pairs) {
+    const int index1 = GetBlockIndex(block_pair.first);
+    const int num_params_block1 = GetBlockTangentSize(block_pair.first);
+    const int index2 = GetBlockIndex(block_pair.second);
+    const int num_params_block2 = GetBlockTangentSize(block_pair.second);
+    for (int i = 0; i < num_params_block1; ++i) {
+      for (int j = 0; j < num_params_block2; ++j) {
+        triplets.emplace_back(index1 + i, index2 + j, 0.0);
+        triplets.emplace_back(index2 + j, index1 + i, 0.0);
+      }
+    }
+  }
+  Eigen::SparseMatrix<double> S(num_params, num_params);
+  S.setFromTriplets(triplets.begin(), triplets.end());
+
+  LOG(INFO) << StringPrintf("Start sparse Cholesky decomposition (n = %d)",
+                            num_params);
+  Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>> ldltOfS(S);
+  const Eigen::VectorXd& D = ldltOfS.vectorD();
+  int rank = 0;
+  for (int i = 0; i < num_params; ++i) {
+    if (D(i) != 0.0) rank++;
+  }
+  if (rank < num_params) {
+    LOG(INFO) << StringPrintf(
+        "Unable to compute covariance. The Schur complement on all variables "
+        "(except for 3D points) is rank deficient. Number of columns: %d, "
+        "rank: %d.",
+        num_params,
+        rank);
+    return false;
+  }
+  LOG(INFO) << "Finish sparse Cholesky decomposition.";
+
+  // The strictly lower triangular part of the unit lower triangular factor.
+  const Eigen::SparseMatrix<double>& L = ldltOfS.matrixL().nestedExpression();
+
+  std::vector<Eigen::Triplet<double>> pattern;
+  pattern.reserve(L.nonZeros() + num_params);
+  for (int col = 0; col < num_params; ++col) {
+    pattern.emplace_back(col, col, 0.0);
+    for (Eigen::SparseMatrix<double>::InnerIterator it(L, col); it; ++it) {
+      if (it.row() > col) {
+        pattern.emplace_back(it.row(), col, 0.0);
+      }
+    }
+  }
+  Eigen::SparseMatrix<double> Z(num_params, num_params);
+  Z.setFromTriplets(pattern.begin(), pattern.end());
+  const auto Z_entry = [&Z](const int row, const int col) -> double& {
+    const int index = FindLowerTriangularEntry(Z, row, col);
+    THROW_CHECK_GE(index, 0);
+    return Z.valuePtr()[index];
+  };
+
+  // Takahashi recurrence Z = D^-1 L^-1 + (I - L^T) Z evaluated backwards. The
+  // rows of each column of L form a clique in the filled graph, so all
+  // required entries of Z are in the pattern and already computed.
+  LOG(INFO) << "Start selected inversion.";
+  std::vector<int> col_rows;
+  std::vector<double> col_values;
+  for (int col = num_params - 1; col >= 0; --col) {
+    col_rows.clear();
+    col_values.clear();
+    for (Eigen::SparseMatrix<double>::InnerIterator it(L, col); it; ++it) {
+      if (it.row() > col) {
+        col_rows.push_back(it.row());
+        col_values.push_back(it.value());
+      }
+    }
+    for (const int row : col_rows) {
+      double sum = 0.0;
+      for (size_t k = 0; k < col_rows.size(); ++k) {
+        sum += Z_entry(row, col_rows[k]) * col_values[k];
+      }
+      Z_entry(row, col) = -sum;
+    }
+    double diag = 1.0 / D(col);
+    for (size_t k = 0; k < col_rows.size(); ++k) {
+      diag -= col_values[k] * Z_entry(col_rows[k], col);
+    }
+    Z_entry(col, col) = diag;
+  }
+  LOG(INFO) << StringPrintf("Finish selected inversion (%d entries).",
+                            static_cast<int>(Z.nonZeros()));
+
+  cov_selected_ = std::move(Z);
+  cov_selected_perm_ = ldltOfS.permutationP().indices();
+  return true;
+}
+
 bool BundleAdjustmentCovarianceEstimator::Factorize() {
   if (!HasValidSchurComplement()) {
     ComputeSchurComplement();
@@ -759,7 +936,7 @@ bool EstimatePoseCovariance(
     double lambda) {
   BundleAdjustmentCovarianceEstimator estimator(
       problem, reconstruction, lambda);
-  if (!estimator.Factorize()) return false;
+  if (!estimator.ComputeSelected()) return false;
   image_id_to_covar.clear();
   for (const auto& image : reconstruction->Images()) {
     image_t image_id = image.first;
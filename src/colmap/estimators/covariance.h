@@ -189,6 +189,20 @@ class BundleAdjustmentCovarianceEstimator
   bool ComputeFull() override;
   bool Compute() override;
 
+  // Compute the covariance for all parameters (except for 3D points) by
+  // selected inversion of the Schur complement with the Takahashi recurrence.
+  // Instead of a dense inverse, only the entries in the sparsity pattern of
+  // the sparse Cholesky factor are computed. The pattern includes the diagonal
+  // blocks of all parameter blocks (and thus the covariance of every pose) and
+  // the cross covariances of jointly observed parameter blocks. The cross
+  // covariances of further pairs of parameter blocks can be requested through
+  // block_pairs. Querying covariance entries outside of the pattern fails.
+  // Similar to ``Compute()``, the other variables are damped by lambda.
+  bool ComputeSelected(
+      const std::vector<std::pair<const double*, const double*>>& block_pairs =
+          {});
+  bool HasValidSelectedCovariance() const;
+
   // factorization
   bool FactorizeFull();
   bool Factorize();
@@ -225,6 +239,13 @@ class BundleAdjustmentCovarianceEstimator
   // The inverse of L matrix after Cholesky factorization
   Eigen::MatrixXd L_matrix_variables_inv_;
   Eigen::MatrixXd L_matrix_poses_inv_;
+
+  // The selected inverse of the permuted Schur complement as the lower
+  // triangle in the sparsity pattern of its Cholesky factor, and the
+  // permutation from parameter indices to the rows of the selected inverse.
+  Eigen::SparseMatrix<double> cov_selected_;
+  Eigen::VectorXi cov_selected_perm_;
+  double GetSelectedCovarianceByIndex(int row, int col) const;
 };
 
 // The covariance for each image is in the order [R, t] with both of them
@@ -186,6 +186,54 @@ TEST(Covariance, ComputeFull) {
   ExpectNearEigenMatrixXd(covar, covar_ceres, 1e-6);
 }
 
+TEST(Covariance, ComputeSelected) {
+  Reconstruction reconstruction;
+  GenerateReconstruction(&reconstruction);
+  std::shared_ptr<BundleAdjuster> bundle_adjuster =
+      BuildBundleAdjuster(&reconstruction);
+  bundle_adjuster->Solve(&reconstruction);
+  std::shared_ptr<ceres::Problem> problem = bundle_adjuster->Problem();
+
+  BundleAdjustmentCovarianceEstimator estimator_full(problem.get(),
+                                                     &reconstruction);
+  ASSERT_TRUE(estimator_full.ComputeFull());
+
+  std::vector<image_t> image_ids;
+  for (const auto& image : reconstruction.Images()) {
+    if (!estimator_full.HasPose(image.first)) continue;
+    image_ids.push_back(image.first);
+  }
+  ASSERT_GE(image_ids.size(), 2);
+  double* tvec1 = reconstruction.Image(image_ids.front())
+                      .CamFromWorld()
+                      .translation.data();
+  double* tvec2 =
+      reconstruction.Image(image_ids.back()).CamFromWorld().translation.data();
+
+  BundleAdjustmentCovarianceEstimator estimator(problem.get(), &reconstruction);
+  ASSERT_TRUE(estimator.ComputeSelected({{tvec1, tvec2}}));
+
+  // covariance for each image
+  for (const image_t image_id : image_ids) {
+    ExpectNearEigenMatrixXd(estimator.GetPoseCovariance(image_id),
+                            estimator_full.GetPoseCovariance(image_id),
+                            1e-6);
+  }
+
+  // explicitly requested cross covariance
+  ExpectNearEigenMatrixXd(estimator.GetPoseCovariance(tvec1, tvec2),
+                          estimator_full.GetPoseCovariance(tvec1, tvec2),
+                          1e-6);
+
+  // covariance for each camera
+  for (const auto& camera : reconstruction.Cameras()) {
+    double* ptr = const_cast<double*>(camera.second.params.data());
+    if (!estimator.HasBlock(ptr)) continue;
+    ExpectNearEigenMatrixXd(
+        estimator.GetCovariance(ptr), estimator_full.GetCovariance(ptr), 1e-6);
+  }
+}
+
 TEST(Covariance, RankDeficientPoints) {
   Reconstruction reconstruction;
   GenerateReconstruction(&reconstruction);
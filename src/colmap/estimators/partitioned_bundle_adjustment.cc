@@ -0,0 +1,783 @@
+// Copyright (c) 2023, ETH Zurich and UNC Chapel Hill.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of ETH Zurich and UNC Chapel Hill nor the names of
+//       its contributors may be used to endorse or promote products derived
+//       from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "colmap/estimators/partitioned_bundle_adjustment.h"
+
+#include "colmap/estimators/cost_functions.h"
+#include "colmap/estimators/manifold.h"
+#include "colmap/scene/database.h"
+#include "colmap/scene/scene_clustering.h"
+#include "colmap/sensor/models.h"
+#include "colmap/util/logging.h"
+#include "colmap/util/misc.h"
+#include "colmap/util/threading.h"
+#include "colmap/util/timer.h"
+
+#include <algorithm>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace colmap {
+namespace {
+
+// Curvatures below this fraction of the largest curvature of a parameter block
+// are clamped to keep the consensus penalty positive definite, e.g., for
+// parameters that are not constrained by the observations of a submap.
+constexpr double kMinRelativeCurvature = 1e-6;
+
+// The penalty is adapted when the primal and dual residuals differ by more
+// than this factor, see Boyd et al., "Distributed Optimization and Statistical
+// Learning via the Alternating Direction Method of Multipliers", 2011.
+constexpr double kResidualBalanceRatio = 10.0;
+constexpr double kPenaltyUpdateFactor = 2.0;
+
+// Quadratic penalty `sqrt_weights .* (x - target)` of a submap parameter block
+// towards the consensus. The target and the weights are updated in place
+// between the consensus iterations.
+class ConsensusCostFunction : public ceres::CostFunction {
+ public:
+  ConsensusCostFunction(const Eigen::VectorXd* target,
+                        const Eigen::VectorXd* sqrt_weights)
+      : target_(target), sqrt_weights_(sqrt_weights) {
+    set_num_residuals(static_cast<int>(target->size()));
+    mutable_parameter_block_sizes()->push_back(
+        static_cast<int>(target->size()));
+  }
+
+  bool Evaluate(double const* const* parameters,
+                double* residuals,
+                double** jacobians) const override {
+    const int size = static_cast<int>(target_->size());
+    for (int i = 0; i < size; ++i) {
+      residuals[i] = (*sqrt_weights_)(i) * (parameters[0][i] - (*target_)(i));
+    }
+    if (jacobians != nullptr && jacobians[0] != nullptr) {
+      Eigen::Map<Eigen::Matrix<double,
+                                Eigen::Dynamic,
+                                Eigen::Dynamic,
+                                Eigen::RowMajor>>
+          jacobian(jacobians[0], size, size);
+      jacobian.setZero();
+      jacobian.diagonal() = *sqrt_weights_;
+    }
+    return true;
+  }
+
+ private:
+  const Eigen::VectorXd* target_;
+  const Eigen::VectorXd* sqrt_weights_;
+};
+
+// Copy of a parameter block of the reconstruction in a submap.
+struct SubmapParameterBlock {
+  double* global_values = nullptr;
+  Eigen::VectorXd values;
+  // Diagonal of the Gauss-Newton approximation of the Hessian of the
+  // reprojection error of the submap with respect to the block.
+  Eigen::VectorXd curvature;
+  bool constant = false;
+  bool is_quaternion = false;
+  std::vector<int> constant_idxs;
+  // Consensus terms, only used for blocks shared with other submaps.
+  bool shared = false;
+  Eigen::VectorXd dual;
+  Eigen::VectorXd target;
+  Eigen::VectorXd sqrt_weights;
+};
+
+struct Submap {
+  std::vector<image_t> image_ids;
+  std::vector<SubmapParameterBlock> blocks;
+  // Loss functions of observations in images shared with other submaps by the
+  // number of submaps containing the image.
+  std::unordered_map<int, std::unique_ptr<ceres::LossFunction>>
+      scaled_loss_functions;
+  std::unique_ptr<ceres::Problem> problem;
+  ceres::Solver::Options solver_options;
+  ceres::Solver::Summary summary;
+};
+
+// Parameter block of the reconstruction that is copied to several submaps.
+struct SharedParameterBlock {
+  double* values = nullptr;
+  bool is_quaternion = false;
+  std::vector<int> constant_idxs;
+  // Submap and block indices of the copies.
+  std::vector<std::pair<size_t, size_t>> copies;
+};
+
+std::vector<int> ConstantCameraParams(const BundleAdjustmentOptions& options,
+                                      const Camera& camera) {
+  std::vector<int> const_camera_params;
+  const auto AddParams = [&const_camera_params](span<const size_t> idxs) {
+    const_camera_params.insert(
+        const_camera_params.end(), idxs.begin(), idxs.end());
+  };
+  if (!options.refine_focal_length) {
+    AddParams(camera.FocalLengthIdxs());
+  }
+  if (!options.refine_principal_point) {
+    AddParams(camera.PrincipalPointIdxs());
+  }
+  if (!options.refine_extra_params) {
+    AddParams(camera.ExtraParamsIdxs());
+  }
+  return const_camera_params;
+}
+
+bool IsConstantPoint(const BundleAdjustmentConfig& config,
+                     const Point3D& point3D,
+                     const point3D_t point3D_id) {
+  if (config.HasConstantPoint(point3D_id)) {
+    return true;
+  }
+  for (const auto& track_el : point3D.track.Elements()) {
+    if (!config.HasImage(track_el.image_id)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Adds the weighted squared columns of the Jacobian of the cost function to
+// the curvatures of the parameter blocks.
+void AccumulateCurvature(const ceres::CostFunction& cost_function,
+                         const std::vector<double*>& parameters,
+                         const double weight,
+                         const std::vector<SubmapParameterBlock*>& blocks) {
+  const int num_residuals = cost_function.num_residuals();
+  std::vector<double> residuals(num_residuals);
+  std::vector<std::vector<double>> jacobians(parameters.size());
+  std::vector<double*> jacobian_ptrs(parameters.size());
+  for (size_t i = 0; i < parameters.size(); ++i) {
+    jacobians[i].resize(num_residuals * blocks[i]->values.size());
+    jacobian_ptrs[i] = jacobians[i].data();
+  }
+  if (!cost_function.Evaluate(
+          parameters.data(), residuals.data(), jacobian_ptrs.data())) {
+    return;
+  }
+  for (size_t i = 0; i < parameters.size(); ++i) {
+    const Eigen::Map<const Eigen::Matrix<double,
+                                         Eigen::Dynamic,
+                                         Eigen::Dynamic,
+                                         Eigen::RowMajor>>
+        jacobian(jacobians[i].data(), num_residuals, blocks[i]->values.size());
+    if (jacobian.allFinite()) {
+      blocks[i]->curvature +=
+          weight * jacobian.colwise().squaredNorm().transpose();
+    }
+  }
+}
+
+// Sets up the problem of the submap with a copy of all parameters observed by
+// its images. The observations of images contained in several submaps are
+// down-weighted by the number of submaps, such that the objectives of the
+// submaps sum up to the objective of the complete problem. The reconstruction
+// is only read.
+void SetUpSubmap(const BundleAdjustmentOptions& options,
+                 const BundleAdjustmentConfig& config,
+                 const std::unordered_map<image_t, int>& num_image_submaps,
+                 Reconstruction* reconstruction,
+                 ceres::LossFunction* loss_function,
+                 Submap* submap) {
+  const bool constant_camera = !options.refine_focal_length &&
+                               !options.refine_principal_point &&
+                               !options.refine_extra_params;
+
+  // Collect the parameter blocks before setting up the problem, such that the
+  // copies of the parameters do not move anymore.
+  std::unordered_map<const double*, size_t> block_idxs;
+  const auto AddBlock = [&block_idxs, submap](double* global_values,
+                                              const int size) {
+    const auto it = block_idxs.emplace(global_values, submap->blocks.size());
+    if (it.second) {
+      SubmapParameterBlock block;
+      block.global_values = global_values;
+      block.values = Eigen::Map<const Eigen::VectorXd>(global_values, size);
+      block.curvature = Eigen::VectorXd::Zero(size);
+      submap->blocks.push_back(std::move(block));
+    }
+    return it.first->second;
+  };
+
+  for (const image_t image_id : submap->image_ids) {
+    Image& image = reconstruction->Image(image_id);
+    Camera& camera = reconstruction->Camera(image.CameraId());
+    const bool constant_cam_pose =
+        !options.refine_extrinsics || config.HasConstantCamPose(image_id);
+    for (const Point2D& point2D : image.Points2D()) {
+      if (!point2D.HasPoint3D()) {
+        continue;
+      }
+      if (!constant_cam_pose) {
+        SubmapParameterBlock& rotation = submap->blocks[AddBlock(
+            image.CamFromWorld().rotation.coeffs().data(), 4)];
+        rotation.is_quaternion = true;
+        SubmapParameterBlock& translation = submap->blocks[AddBlock(
+            image.CamFromWorld().translation.data(), 3)];
+        if (config.HasConstantCamPositions(image_id)) {
+          translation.constant_idxs = config.ConstantCamPositions(image_id);
+        }
+      }
+      Point3D& point3D = reconstruction->Point3D(point2D.point3D_id);
+      submap->blocks[AddBlock(point3D.xyz.data(), 3)].constant =
+          IsConstantPoint(config, point3D, point2D.point3D_id);
+      SubmapParameterBlock& camera_params = submap->blocks[AddBlock(
+          camera.params.data(), static_cast<int>(camera.params.size()))];
+      if (constant_camera ||
+          config.HasConstantCamIntrinsics(image.CameraId())) {
+        camera_params.constant = true;
+      } else {
+        camera_params.constant_idxs = ConstantCameraParams(options, camera);
+      }
+    }
+  }
+
+  ceres::Problem::Options problem_options;
+  problem_options.loss_function_ownership = ceres::DO_NOT_TAKE_OWNERSHIP;
+  submap->problem = std::make_unique<ceres::Problem>(problem_options);
+
+  for (const image_t image_id : submap->image_ids) {
+    const Image& image = reconstruction->Image(image_id);
+    const Camera& camera = reconstruction->Camera(image.CameraId());
+    const bool constant_cam_pose =
+        !options.refine_extrinsics || config.HasConstantCamPose(image_id);
+
+    const int num_submaps = num_image_submaps.at(image_id);
+    ceres::LossFunction* image_loss_function = loss_function;
+    if (num_submaps > 1) {
+      auto& scaled_loss_function = submap->scaled_loss_functions[num_submaps];
+      if (!scaled_loss_function) {
+        scaled_loss_function = std::make_unique<ceres::ScaledLoss>(
+            loss_function, 1.0 / num_submaps, ceres::DO_NOT_TAKE_OWNERSHIP);
+      }
+      image_loss_function = scaled_loss_function.get();
+    }
+
+    for (const Point2D& point2D : image.Points2D()) {
+      if (!point2D.HasPoint3D()) {
+        continue;
+      }
+
+      std::vector<SubmapParameterBlock*> blocks;
+      ceres::CostFunction* cost_function = nullptr;
+      if (constant_cam_pose) {
+        cost_function =
+            CameraCostFunction<ReprojErrorConstantPoseCostFunction>(
+                camera.model_id, image.CamFromWorld(), point2D.xy);
+      } else {
+        cost_function = CameraCostFunction<ReprojErrorCostFunction>(
+            camera.model_id, point2D.xy);
+        blocks.push_back(&submap->blocks.at(
+            block_idxs.at(image.CamFromWorld().rotation.coeffs().data())));
+        blocks.push_back(&submap->blocks.at(
+            block_idxs.at(image.CamFromWorld().translation.data())));
+      }
+      blocks.push_back(&submap->blocks.at(block_idxs.at(
+          reconstruction->Point3D(point2D.point3D_id).xyz.data())));
+      blocks.push_back(
+          &submap->blocks.at(block_idxs.at(camera.params.data())));
+
+      std::vector<double*> parameters(blocks.size());
+      for (size_t i = 0; i < blocks.size(); ++i) {
+        parameters[i] = blocks[i]->values.data();
+      }
+      AccumulateCurvature(
+          *cost_function, parameters, 1.0 / num_submaps, blocks);
+      submap->problem->AddResidualBlock(
+          cost_function, image_loss_function, parameters);
+    }
+  }
+
+  for (SubmapParameterBlock& block : submap->blocks) {
+    if (block.constant) {
+      submap->problem->SetParameterBlockConstant(block.values.data());
+      continue;
+    }
+    if (block.is_quaternion) {
+      SetQuaternionManifold(submap->problem.get(), block.values.data());
+    } else if (!block.constant_idxs.empty()) {
+      SetSubsetManifold(static_cast<int>(block.values.size()),
+                        block.constant_idxs,
+                        submap->problem.get(),
+                        block.values.data());
+    }
+    const double max_curvature = block.curvature.maxCoeff();
+    block.curvature = block.curvature.cwiseMax(
+        max_curvature > 0 ? kMinRelativeCurvature * max_curvature : 1.0);
+  }
+}
+
+// Computes the cost of the complete problem from the parameters in the
+// reconstruction, such that it can be compared to the cost of BundleAdjuster.
+double ComputeCost(const BundleAdjustmentConfig& config,
+                   const Reconstruction& reconstruction,
+                   const ceres::LossFunction& loss_function,
+                   size_t* num_residuals) {
+  double cost = 0;
+  *num_residuals = 0;
+  for (const image_t image_id : config.Images()) {
+    const Image& image = reconstruction.Image(image_id);
+    const Camera& camera = reconstruction.Camera(image.CameraId());
+    for (const Point2D& point2D : image.Points2D()) {
+      if (!point2D.HasPoint3D()) {
+        continue;
+      }
+      const Eigen::Vector3d point3D_in_cam =
+          image.CamFromWorld() *
+          reconstruction.Point3D(point2D.point3D_id).xyz;
+      const double squared_error =
+          (camera.ImgFromCam(point3D_in_cam.hnormalized()) - point2D.xy)
+              .squaredNorm();
+      double rho[3];
+      loss_function.Evaluate(squared_error, rho);
+      cost += 0.5 * rho[0];
+      *num_residuals += 2;
+    }
+  }
+  return cost;
+}
+
+}  // namespace
+
+bool PartitionedBundleAdjuster::Options::Check() const {
+  CHECK_OPTION_GT(max_num_images_per_submap, 0);
+  CHECK_OPTION_GE(image_overlap, 0);
+  CHECK_OPTION_GT(max_num_iterations, 0);
+  CHECK_OPTION_GT(max_num_submap_iterations, 0);
+  CHECK_OPTION_GT(penalty, 0);
+  CHECK_OPTION_GE(consensus_tolerance, 0);
+  return true;
+}
+
+PartitionedBundleAdjuster::PartitionedBundleAdjuster(
+    const Options& options,
+    const BundleAdjustmentOptions& ba_options,
+    const BundleAdjustmentConfig& config)
+    : options_(options), ba_options_(ba_options), config_(config) {
+  THROW_CHECK(options_.Check());
+  THROW_CHECK(ba_options_.Check());
+  THROW_CHECK(!ba_options_.use_schur_solver)
+      << "The Schur complement solver is not supported for submaps";
+}
+
+std::vector<std::vector<image_t>> PartitionedBundleAdjuster::PartitionImages(
+    const Options& options,
+    const BundleAdjustmentConfig& config,
+    const Reconstruction& reconstruction) {
+  std::vector<image_t> image_ids(config.Images().begin(),
+                                 config.Images().end());
+  std::sort(image_ids.begin(), image_ids.end());
+  if (image_ids.size() <=
+      static_cast<size_t>(options.max_num_images_per_submap)) {
+    return {image_ids};
+  }
+
+  // Weigh the covisibility graph by the number of commonly observed points.
+  std::unordered_set<point3D_t> point3D_ids;
+  for (const image_t image_id : image_ids) {
+    for (const Point2D& point2D : reconstruction.Image(image_id).Points2D()) {
+      if (point2D.HasPoint3D()) {
+        point3D_ids.insert(point2D.point3D_id);
+      }
+    }
+  }
+
+  std::unordered_map<image_pair_t, int> num_covisible_points;
+  std::vector<image_t> track_image_ids;
+  for (const point3D_t point3D_id : point3D_ids) {
+    track_image_ids.clear();
+    for (const auto& track_el :
+         reconstruction.Point3D(point3D_id).track.Elements()) {
+      if (config.HasImage(track_el.image_id)) {
+        track_image_ids.push_back(track_el.image_id);
+      }
+    }
+    std::sort(track_image_ids.begin(), track_image_ids.end());
+    track_image_ids.erase(
+        std::unique(track_image_ids.begin(), track_image_ids.end()),
+        track_image_ids.end());
+    for (size_t i = 0; i < track_image_ids.size(); ++i) {
+      for (size_t j = i + 1; j < track_image_ids.size(); ++j) {
+        num_covisible_points[Database::ImagePairToPairId(
+            track_image_ids[i], track_image_ids[j])] += 1;
+      }
+    }
+  }
+
+  std::vector<std::pair<image_t, image_t>> image_pairs;
+  std::vector<int> num_inliers;
+  image_pairs.reserve(num_covisible_points.size());
+  num_inliers.reserve(num_covisible_points.size());
+  for (const auto& pair : num_covisible_points) {
+    image_pairs.push_back(Database::PairIdToImagePair(pair.first));
+    num_inliers.push_back(pair.second);
+  }
+
+  SceneClustering::Options clustering_options;
+  clustering_options.is_hierarchical = true;
+  clustering_options.branching = 2;
+  clustering_options.image_overlap = options.image_overlap;
+  clustering_options.leaf_max_num_images = options.max_num_images_per_submap;
+  SceneClustering scene_clustering(clustering_options);
+  scene_clustering.Partition(image_pairs, num_inliers);
+
+  std::vector<std::vector<image_t>> submaps;
+  std::unordered_set<image_t> clustered_image_ids;
+  for (const auto* cluster : scene_clustering.GetLeafClusters()) {
+    std::vector<image_t> submap = cluster->image_ids;
+    std::sort(submap.begin(), submap.end());
+    submap.erase(std::unique(submap.begin(), submap.end()), submap.end());
+    clustered_image_ids.insert(submap.begin(), submap.end());
+    submaps.push_back(std::move(submap));
+  }
+  std::sort(submaps.begin(), submaps.end());
+
+  for (const image_t image_id : image_ids) {
+    if (clustered_image_ids.count(image_id) == 0) {
+      submaps.front().push_back(image_id);
+    }
+  }
+
+  return submaps;
+}
+
+bool PartitionedBundleAdjuster::Solve(Reconstruction* reconstruction) {
+  THROW_CHECK_NOTNULL(reconstruction);
+
+  Timer timer;
+  timer.Start();
+
+  summary_ = ceres::Solver::Summary();
+  report_ = ConsensusReport();
+
+  const std::vector<std::vector<image_t>> submap_image_ids =
+      PartitionImages(options_, config_, *reconstruction);
+  if (submap_image_ids.size() == 1) {
+    BundleAdjuster bundle_adjuster(ba_options_, config_);
+    const bool success = bundle_adjuster.Solve(reconstruction);
+    summary_ = bundle_adjuster.Summary();
+    report_.num_submaps = 1;
+    report_.converged = success;
+    return success;
+  }
+
+  // CostFunction assumes unit quaternions.
+  for (const image_t image_id : config_.Images()) {
+    reconstruction->Image(image_id).CamFromWorld().rotation.normalize();
+  }
+
+  std::unique_ptr<ceres::LossFunction> loss_function(
+      ba_options_.CreateLossFunction());
+
+  size_t num_residuals = 0;
+  summary_.initial_cost =
+      ComputeCost(config_, *reconstruction, *loss_function, &num_residuals);
+  if (num_residuals == 0) {
+    return false;
+  }
+
+  std::vector<Submap> submaps(submap_image_ids.size());
+  std::unordered_map<image_t, int> num_image_submaps;
+  for (size_t i = 0; i < submaps.size(); ++i) {
+    submaps[i].image_ids = submap_image_ids[i];
+    for (const image_t image_id : submaps[i].image_ids) {
+      num_image_submaps[image_id] += 1;
+    }
+  }
+
+  const int num_threads = std::min(GetEffectiveNumThreads(options_.num_threads),
+                                   static_cast<int>(submaps.size()));
+  ThreadPool thread_pool(num_threads);
+
+  for (Submap& submap : submaps) {
+    thread_pool.AddTask([&]() {
+      SetUpSubmap(ba_options_,
+                  config_,
+                  num_image_submaps,
+                  reconstruction,
+                  loss_function.get(),
+                  &submap);
+    });
+  }
+  thread_pool.Wait();
+
+  // Collect the variable parameter blocks copied to several submaps.
+  std::unordered_map<const double*, SharedParameterBlock> parameter_blocks;
+  std::vector<SharedParameterBlock*> shared_blocks;
+  for (size_t submap_idx = 0; submap_idx < submaps.size(); ++submap_idx) {
+    const Submap& submap = submaps[submap_idx];
+    for (size_t block_idx = 0; block_idx < submap.blocks.size(); ++block_idx) {
+      const SubmapParameterBlock& block = submap.blocks[block_idx];
+      if (block.constant) {
+        continue;
+      }
+      SharedParameterBlock& parameter_block =
+          parameter_blocks[block.global_values];
+      if (parameter_block.copies.size() == 1) {
+        shared_blocks.push_back(&parameter_block);
+      }
+      parameter_block.values = block.global_values;
+      parameter_block.is_quaternion = block.is_quaternion;
+      parameter_block.constant_idxs = block.constant_idxs;
+      parameter_block.copies.emplace_back(submap_idx, block_idx);
+    }
+  }
+
+  double penalty = options_.penalty;
+  for (SharedParameterBlock* parameter_block : shared_blocks) {
+    for (const auto& copy : parameter_block->copies) {
+      Submap& submap = submaps[copy.first];
+      SubmapParameterBlock& block = submap.blocks[copy.second];
+      block.shared = true;
+      block.dual = Eigen::VectorXd::Zero(block.values.size());
+      block.target = block.values;
+      block.sqrt_weights = (penalty * block.curvature).cwiseSqrt();
+      submap.problem->AddResidualBlock(
+          new ConsensusCostFunction(&block.target, &block.sqrt_weights),
+          nullptr,
+          block.values.data());
+    }
+  }
+
+  for (Submap& submap : submaps) {
+    BundleAdjustmentConfig submap_config;
+    for (const image_t image_id : submap.image_ids) {
+      submap_config.AddImage(image_id);
+    }
+    BundleAdjuster bundle_adjuster(ba_options_, submap_config);
+    submap.solver_options = bundle_adjuster.SetUpSolverOptions(
+        *submap.problem, ba_options_.solver_options);
+    submap.solver_options.max_num_iterations =
+        std::min(submap.solver_options.max_num_iterations,
+                 options_.max_num_submap_iterations);
+    submap.solver_options.num_threads =
+        std::max(1, submap.solver_options.num_threads / num_threads);
+#if CERES_VERSION_MAJOR < 2
+    submap.solver_options.num_linear_solver_threads = std::max(
+        1, submap.solver_options.num_linear_solver_threads / num_threads);
+#endif  // CERES_VERSION_MAJOR
+  }
+
+  report_.num_submaps = submaps.size();
+  report_.num_shared_parameter_blocks = shared_blocks.size();
+
+  bool success = true;
+  for (int iteration = 0; iteration < options_.max_num_iterations;
+       ++iteration) {
+    // Solve the submaps with the penalty towards the current consensus.
+    for (Submap& submap : submaps) {
+      for (SubmapParameterBlock& block : submap.blocks) {
+        if (block.shared) {
+          block.target = Eigen::Map<const Eigen::VectorXd>(
+                             block.global_values, block.values.size()) -
+                         block.dual;
+        }
+      }
+      thread_pool.AddTask([&submap]() {
+        ceres::Solve(
+            submap.solver_options, submap.problem.get(), &submap.summary);
+      });
+    }
+    thread_pool.Wait();
+
+    for (const Submap& submap : submaps) {
+      if (!submap.summary.IsSolutionUsable()) {
+        LOG(WARNING) << "Failed to solve submap: "
+                     << submap.summary.BriefReport();
+        success = false;
+      }
+    }
+    if (!success) {
+      break;
+    }
+
+    report_.num_iterations += 1;
+
+    // Average the copies into the new consensus and update the dual
+    // variables. Every copy is weighted by its penalty.
+    double primal_residual_sum = 0;
+    double dual_residual_sum = 0;
+    size_t num_shared_params = 0;
+    for (SharedParameterBlock* parameter_block : shared_blocks) {
+      const auto& first_copy = parameter_block->copies.front();
+      const Eigen::Index size =
+          submaps[first_copy.first].blocks[first_copy.second].values.size();
+      Eigen::Map<Eigen::VectorXd> consensus(parameter_block->values, size);
+      const Eigen::VectorXd prev_consensus = consensus;
+
+      Eigen::VectorXd weighted_sum = Eigen::VectorXd::Zero(size);
+      Eigen::VectorXd weight_sum = Eigen::VectorXd::Zero(size);
+      for (const auto& copy : parameter_block->copies) {
+        const SubmapParameterBlock& block =
+            submaps[copy.first].blocks[copy.second];
+        weighted_sum +=
+            block.curvature.cwiseProduct(block.values + block.dual);
+        weight_sum += block.curvature;
+      }
+      consensus = weighted_sum.cwiseQuotient(weight_sum);
+      for (const int idx : parameter_block->constant_idxs) {
+        consensus(idx) = prev_consensus(idx);
+      }
+      if (parameter_block->is_quaternion) {
+        consensus.normalize();
+      }
+
+      for (const auto& copy : parameter_block->copies) {
+        SubmapParameterBlock& block = submaps[copy.first].blocks[copy.second];
+        const Eigen::VectorXd disagreement = block.values - consensus;
+        block.dual += disagreement;
+        primal_residual_sum +=
+            block.curvature.dot(disagreement.cwiseAbs2());
+        dual_residual_sum +=
+            block.curvature.dot((consensus - prev_consensus).cwiseAbs2());
+        num_shared_params += size;
+      }
+    }
+
+    report_.primal_residual =
+        std::sqrt(primal_residual_sum / num_shared_params);
+    report_.dual_residual =
+        penalty * std::sqrt(dual_residual_sum / num_shared_params);
+    report_.penalty = penalty;
+
+    VLOG(1) << StringPrintf(
+        "Consensus iteration %d: primal residual %e, dual residual %e, "
+        "penalty %e",
+        iteration + 1,
+        report_.primal_residual,
+        report_.dual_residual,
+        penalty);
+
+    if (report_.primal_residual <= options_.consensus_tolerance &&
+        report_.dual_residual <= options_.consensus_tolerance) {
+      report_.converged = true;
+      break;
+    }
+
+    // Balance the primal and dual residuals. The scaled dual variables are
+    // inversely proportional to the penalty.
+    double penalty_scale = 1.0;
+    if (report_.primal_residual >
+        kResidualBalanceRatio * report_.dual_residual) {
+      penalty_scale = kPenaltyUpdateFactor;
+    } else if (report_.dual_residual >
+               kResidualBalanceRatio * report_.primal_residual) {
+      penalty_scale = 1.0 / kPenaltyUpdateFactor;
+    }
+    if (penalty_scale != 1.0) {
+      penalty *= penalty_scale;
+      for (Submap& submap : submaps) {
+        for (SubmapParameterBlock& block : submap.blocks) {
+          if (block.shared) {
+            block.dual /= penalty_scale;
+            block.sqrt_weights = (penalty * block.curvature).cwiseSqrt();
+          }
+        }
+      }
+    }
+  }
+
+  // The shared parameters already hold the consensus, the remaining variable
+  // parameters are only contained in a single submap.
+  for (const Submap& submap : submaps) {
+    for (const SubmapParameterBlock& block : submap.blocks) {
+      if (!block.constant && !block.shared) {
+        Eigen::Map<Eigen::VectorXd>(block.global_values, block.values.size()) =
+            block.values;
+      }
+    }
+  }
+
+  // Re-index the points, whose positions were updated in place.
+  if (reconstruction->HasPoints3DSpatialIndex()) {
+    for (const image_t image_id : config_.Images()) {
+      for (const Point2D& point2D :
+           reconstruction->Image(image_id).Points2D()) {
+        if (point2D.HasPoint3D()) {
+          reconstruction->UpdatePoint3DSpatialIndex(point2D.point3D_id);
+        }
+      }
+    }
+  }
+
+  size_t num_effective_parameters = 0;
+  for (const auto& parameter_block : parameter_blocks) {
+    const auto& copy = parameter_block.second.copies.front();
+    num_effective_parameters +=
+        submaps[copy.first].blocks[copy.second].values.size() -
+        parameter_block.second.constant_idxs.size() -
+        (parameter_block.second.is_quaternion ? 1 : 0);
+  }
+
+  summary_.final_cost =
+      ComputeCost(config_, *reconstruction, *loss_function, &num_residuals);
+  summary_.num_residuals = num_residuals;
+  summary_.num_residuals_reduced = num_residuals;
+  summary_.num_residual_blocks = num_residuals / 2;
+  summary_.num_residual_blocks_reduced = num_residuals / 2;
+  summary_.num_parameter_blocks = parameter_blocks.size();
+  summary_.num_parameter_blocks_reduced = parameter_blocks.size();
+  summary_.num_effective_parameters = num_effective_parameters;
+  summary_.num_effective_parameters_reduced = num_effective_parameters;
+  summary_.num_successful_steps = report_.num_iterations;
+  summary_.num_unsuccessful_steps = 0;
+  summary_.num_threads_given = options_.num_threads;
+  summary_.num_threads_used = num_threads;
+  if (!success) {
+    summary_.termination_type = ceres::FAILURE;
+  } else if (report_.converged) {
+    summary_.termination_type = ceres::CONVERGENCE;
+  } else {
+    summary_.termination_type = ceres::NO_CONVERGENCE;
+  }
+  summary_.total_time_in_seconds = timer.ElapsedSeconds();
+
+  if (ba_options_.print_summary || VLOG_IS_ON(1)) {
+    PrintSolverSummary(
+        summary_,
+        StringPrintf("Partitioned bundle adjustment report (%d submaps)",
+                     static_cast<int>(report_.num_submaps)));
+  }
+
+  return success;
+}
+
+const ceres::Solver::Summary& PartitionedBundleAdjuster::Summary() const {
+  return summary_;
+}
+
+const PartitionedBundleAdjuster::ConsensusReport&
+PartitionedBundleAdjuster::Report() const {
+  return report_;
+}
+
+}  // namespace colmap
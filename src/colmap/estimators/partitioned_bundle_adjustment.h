@@ -0,0 +1,143 @@
+// Copyright (c) 2023, ETH Zurich and UNC Chapel Hill.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of ETH Zurich and UNC Chapel Hill nor the names of
+//       its contributors may be used to endorse or promote products derived
+//       from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include "colmap/estimators/bundle_adjustment.h"
+#include "colmap/scene/reconstruction.h"
+
+#include <vector>
+
+#include <ceres/ceres.h>
+
+namespace colmap {
+
+// Bundle adjuster for problems too large to be solved as a whole. The images
+// are partitioned into overlapping submaps by clustering the covisibility graph
+// with SceneClustering. Every submap owns a copy of the parameters of its
+// images, cameras, and points and is solved independently in parallel.
+// Agreement on the parameters shared by several submaps, i.e., the poses and
+// cameras of overlapping images and the points observed in several submaps, is
+// enforced by the consensus form of the alternating direction method of
+// multipliers (ADMM). The observations of the shared images are split evenly
+// between their submaps, such that the submap objectives sum up to the
+// objective of the complete problem. Each iteration solves the submaps with an
+// additional quadratic penalty towards the current consensus, averages the
+// shared parameters into the new consensus, and updates the dual variables.
+// The penalty of each parameter is scaled by the curvature of the reprojection
+// error in the submap, so that its weight does not depend on the units of the
+// parameter.
+//
+// The adjuster accepts the same options and configurations as BundleAdjuster,
+// except for the Schur complement solver, which fails the check, since the
+// submaps are solved by Ceres. Points are added through the observations of
+// the configured images and, as in BundleAdjuster, points with observations in
+// other images or configured as constant are kept constant. Problems that fit
+// into a single submap are solved by BundleAdjuster.
+//
+// Note that partitioning speeds up the solution of large problems through
+// smaller linear systems that are solved in parallel, but does not reduce the
+// memory. The problems, parameter copies, and consensus terms of all submaps
+// are kept during the whole solve, such that the memory exceeds that of
+// BundleAdjuster by the copies of the shared parameters.
+class PartitionedBundleAdjuster {
+ public:
+  struct Options {
+    // Maximum number of images of a submap, excluding the images it shares
+    // with neighboring submaps.
+    int max_num_images_per_submap = 500;
+
+    // Number of images shared between neighboring submaps.
+    int image_overlap = 50;
+
+    // Maximum number of consensus iterations.
+    int max_num_iterations = 50;
+
+    // Maximum number of solver iterations of each submap per consensus
+    // iteration. The submaps are warm-started from the previous iteration.
+    int max_num_submap_iterations = 10;
+
+    // Initial weight of the consensus penalty relative to the curvature of the
+    // reprojection error. The weight is adapted during the iterations to
+    // balance the primal and dual residuals.
+    double penalty = 0.1;
+
+    // Convergence threshold for the root mean square of the primal and dual
+    // residuals, which measure the disagreement between the submaps and the
+    // change of the consensus in units of the reprojection error.
+    double consensus_tolerance = 2e-3;
+
+    // Number of submaps solved in parallel.
+    int num_threads = -1;
+
+    bool Check() const;
+  };
+
+  struct ConsensusReport {
+    size_t num_submaps = 0;
+    size_t num_shared_parameter_blocks = 0;
+    size_t num_iterations = 0;
+    double primal_residual = 0;
+    double dual_residual = 0;
+    double penalty = 0;
+    bool converged = false;
+  };
+
+  PartitionedBundleAdjuster(const Options& options,
+                            const BundleAdjustmentOptions& ba_options,
+                            const BundleAdjustmentConfig& config);
+
+  bool Solve(Reconstruction* reconstruction);
+
+  // Partition the configured images into overlapping submaps. Images without
+  // covisible configured images are added to the first submap.
+  static std::vector<std::vector<image_t>> PartitionImages(
+      const Options& options,
+      const BundleAdjustmentConfig& config,
+      const Reconstruction& reconstruction);
+
+  // Get the solver summary after the last call to `Solve`. The costs are the
+  // costs of the complete problem and can be compared to the summary of
+  // BundleAdjuster. The number of successful steps is the number of consensus
+  // iterations.
+  const ceres::Solver::Summary& Summary() const;
+
+  // Get the statistics of the consensus iterations of the last call to
+  // `Solve`.
+  const ConsensusReport& Report() const;
+
+ private:
+  const Options options_;
+  const BundleAdjustmentOptions ba_options_;
+  const BundleAdjustmentConfig config_;
+  ceres::Solver::Summary summary_;
+  ConsensusReport report_;
+};
+
+}  // namespace colmap
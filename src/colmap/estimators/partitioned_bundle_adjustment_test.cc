@@ -0,0 +1,306 @@
+// Copyright (c) 2023, ETH Zurich and UNC Chapel Hill.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of ETH Zurich and UNC Chapel Hill nor the names of
+//       its contributors may be used to endorse or promote products derived
+//       from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "colmap/estimators/partitioned_bundle_adjustment.h"
+
+#include "colmap/math/random.h"
+#include "colmap/sensor/models.h"
+
+#include <set>
+
+#include <gtest/gtest.h>
+
+namespace colmap {
+namespace {
+
+// Generates images along a line with a shared camera, such that each point is
+// only observed by the nearby images. The viewpoints are slightly jittered to
+// avoid degenerate configurations. The points and the image positions are
+// perturbed from the observed ground truth.
+void GenerateStripReconstruction(const size_t num_images,
+                                 const size_t num_points_per_image,
+                                 Reconstruction* reconstruction) {
+  SetPRNGSeed(0);
+
+  const double kFocalLengthFactor = 1.2;
+  const size_t kImageSize = 1000;
+  const double kMaxObservationDistance = 3.0;
+
+  const Camera camera =
+      Camera::CreateFromModelId(0,
+                                SimpleRadialCameraModel::model_id,
+                                kFocalLengthFactor * kImageSize,
+                                kImageSize,
+                                kImageSize);
+  reconstruction->AddCamera(camera);
+
+  std::vector<Eigen::Vector3d> points3D;
+  for (size_t i = 0; i < num_images * num_points_per_image; ++i) {
+    points3D.emplace_back(
+        RandomUniformReal(-0.5, num_images - 0.5),
+        RandomUniformReal(-1.0, 1.0),
+        RandomUniformReal(3.0, 8.0));
+  }
+
+  std::vector<point3D_t> point3D_ids;
+  for (const Eigen::Vector3d& xyz : points3D) {
+    point3D_ids.push_back(reconstruction->AddPoint3D(
+        xyz + Eigen::Vector3d(RandomUniformReal(-0.02, 0.02),
+                              RandomUniformReal(-0.02, 0.02),
+                              RandomUniformReal(-0.02, 0.02)),
+        Track()));
+  }
+
+  for (size_t i = 0; i < num_images; ++i) {
+    const image_t image_id = static_cast<image_t>(i);
+    const Eigen::Quaterniond cam_from_world_rotation(
+        Eigen::AngleAxisd(RandomUniformReal(-0.1, 0.1),
+                          Eigen::Vector3d(RandomUniformReal(-1.0, 1.0),
+                                          RandomUniformReal(-1.0, 1.0),
+                                          1.0)
+                              .normalized()));
+    const Eigen::Vector3d proj_center(static_cast<double>(i),
+                                      RandomUniformReal(-0.5, 0.5),
+                                      RandomUniformReal(-0.5, 0.5));
+    const Rigid3d cam_from_world(cam_from_world_rotation,
+                                 -(cam_from_world_rotation * proj_center));
+
+    std::vector<Eigen::Vector2d> points2D;
+    std::vector<point3D_t> observed_point3D_ids;
+    for (size_t j = 0; j < points3D.size(); ++j) {
+      if (std::abs(points3D[j].x() - i) > kMaxObservationDistance) {
+        continue;
+      }
+      points2D.push_back(
+          camera.ImgFromCam((cam_from_world * points3D[j]).hnormalized()) +
+          Eigen::Vector2d(RandomUniformReal(-1.0, 1.0),
+                          RandomUniformReal(-1.0, 1.0)));
+      observed_point3D_ids.push_back(point3D_ids[j]);
+    }
+
+    Image image;
+    image.SetImageId(image_id);
+    image.SetCameraId(camera.camera_id);
+    image.SetName(std::to_string(i));
+    image.CamFromWorld() = cam_from_world;
+    if (i > 1) {
+      image.CamFromWorld().translation +=
+          Eigen::Vector3d(RandomUniformReal(-0.02, 0.02),
+                          RandomUniformReal(-0.02, 0.02),
+                          RandomUniformReal(-0.02, 0.02));
+    }
+    image.SetPoints2D(points2D);
+    image.SetRegistered(true);
+    reconstruction->AddImage(image);
+
+    for (size_t j = 0; j < observed_point3D_ids.size(); ++j) {
+      reconstruction->AddObservation(observed_point3D_ids[j],
+                                     TrackElement(image_id, j));
+    }
+  }
+}
+
+BundleAdjustmentConfig CreateConfig(const size_t num_images) {
+  BundleAdjustmentConfig config;
+  for (size_t i = 0; i < num_images; ++i) {
+    config.AddImage(static_cast<image_t>(i));
+  }
+  config.SetConstantCamPose(0);
+  config.SetConstantCamPositions(1, {0});
+  return config;
+}
+
+PartitionedBundleAdjuster::Options CreateOptions() {
+  PartitionedBundleAdjuster::Options options;
+  options.max_num_images_per_submap = 8;
+  options.image_overlap = 2;
+  options.max_num_iterations = 100;
+  return options;
+}
+
+TEST(PartitionedBundleAdjustment, PartitionImages) {
+  Reconstruction reconstruction;
+  GenerateStripReconstruction(24, 10, &reconstruction);
+
+  const std::vector<std::vector<image_t>> submaps =
+      PartitionedBundleAdjuster::PartitionImages(
+          CreateOptions(), CreateConfig(24), reconstruction);
+  EXPECT_GT(submaps.size(), 1);
+
+  std::set<image_t> image_ids;
+  size_t num_images = 0;
+  for (const auto& submap : submaps) {
+    EXPECT_FALSE(submap.empty());
+    image_ids.insert(submap.begin(), submap.end());
+    num_images += submap.size();
+  }
+  EXPECT_EQ(image_ids.size(), 24);
+  EXPECT_GT(num_images, 24);
+}
+
+TEST(PartitionedBundleAdjustment, SingleSubmap) {
+  Reconstruction reconstruction;
+  GenerateStripReconstruction(6, 10, &reconstruction);
+  Reconstruction ceres_reconstruction = reconstruction;
+
+  BundleAdjustmentOptions ba_options;
+  ba_options.print_summary = false;
+  const BundleAdjustmentConfig config = CreateConfig(6);
+  PartitionedBundleAdjuster bundle_adjuster(
+      CreateOptions(), ba_options, config);
+  ASSERT_TRUE(bundle_adjuster.Solve(&reconstruction));
+  BundleAdjuster ceres_bundle_adjuster(ba_options, config);
+  ASSERT_TRUE(ceres_bundle_adjuster.Solve(&ceres_reconstruction));
+
+  EXPECT_EQ(bundle_adjuster.Report().num_submaps, 1);
+  EXPECT_NEAR(bundle_adjuster.Summary().final_cost,
+              ceres_bundle_adjuster.Summary().final_cost,
+              1e-6 * ceres_bundle_adjuster.Summary().final_cost);
+}
+
+struct SolverTestParams {
+  size_t num_images;
+  BundleAdjustmentOptions::LossFunctionType loss_function_type;
+};
+
+class ParameterizedPartitionedBundleAdjustmentTests
+    : public ::testing::TestWithParam<SolverTestParams> {};
+
+TEST_P(ParameterizedPartitionedBundleAdjustmentTests, MatchesBundleAdjuster) {
+  const SolverTestParams params = GetParam();
+
+  Reconstruction reconstruction;
+  GenerateStripReconstruction(params.num_images, 10, &reconstruction);
+  const Reconstruction orig_reconstruction = reconstruction;
+  Reconstruction ceres_reconstruction = reconstruction;
+
+  BundleAdjustmentOptions ba_options;
+  ba_options.print_summary = false;
+  ba_options.loss_function_type = params.loss_function_type;
+
+  const BundleAdjustmentConfig config = CreateConfig(params.num_images);
+  const PartitionedBundleAdjuster::Options options = CreateOptions();
+  PartitionedBundleAdjuster bundle_adjuster(options, ba_options, config);
+  ASSERT_TRUE(bundle_adjuster.Solve(&reconstruction));
+  BundleAdjuster ceres_bundle_adjuster(ba_options, config);
+  ASSERT_TRUE(ceres_bundle_adjuster.Solve(&ceres_reconstruction));
+
+  const auto& report = bundle_adjuster.Report();
+  EXPECT_GT(report.num_submaps, 1);
+  EXPECT_GT(report.num_shared_parameter_blocks, 0);
+  EXPECT_LT(report.primal_residual, 10 * options.consensus_tolerance);
+
+  const auto& summary = bundle_adjuster.Summary();
+  const auto& ceres_summary = ceres_bundle_adjuster.Summary();
+  EXPECT_NE(summary.termination_type, ceres::FAILURE);
+  EXPECT_EQ(summary.num_residuals_reduced,
+            ceres_summary.num_residuals_reduced);
+  EXPECT_EQ(summary.num_effective_parameters_reduced,
+            ceres_summary.num_effective_parameters_reduced);
+  EXPECT_NEAR(summary.initial_cost,
+              ceres_summary.initial_cost,
+              1e-8 * ceres_summary.initial_cost);
+  EXPECT_LT(summary.final_cost, summary.initial_cost);
+  // The consensus converges only up to the tolerance, so that the solution
+  // is close to but not exactly the same as for the complete problem.
+  EXPECT_GE(summary.final_cost, (1 - 1e-3) * ceres_summary.final_cost);
+  EXPECT_LE(summary.final_cost, 1.02 * ceres_summary.final_cost);
+
+  // The gauge is fixed in the same way as for the complete problem.
+  EXPECT_EQ(reconstruction.Image(0).CamFromWorld().rotation.coeffs(),
+            orig_reconstruction.Image(0).CamFromWorld().rotation.coeffs());
+  EXPECT_EQ(reconstruction.Image(0).CamFromWorld().translation,
+            orig_reconstruction.Image(0).CamFromWorld().translation);
+  EXPECT_EQ(reconstruction.Image(1).CamFromWorld().translation.x(),
+            orig_reconstruction.Image(1).CamFromWorld().translation.x());
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    PartitionedBundleAdjustment,
+    ParameterizedPartitionedBundleAdjustmentTests,
+    ::testing::Values(
+        SolverTestParams{24,
+                         BundleAdjustmentOptions::LossFunctionType::TRIVIAL},
+        SolverTestParams{24, BundleAdjustmentOptions::LossFunctionType::CAUCHY},
+        SolverTestParams{40,
+                         BundleAdjustmentOptions::LossFunctionType::TRIVIAL}));
+
+TEST(PartitionedBundleAdjustment, ConstantPointsAndIntrinsics) {
+  Reconstruction reconstruction;
+  GenerateStripReconstruction(24, 10, &reconstruction);
+  const Reconstruction orig_reconstruction = reconstruction;
+
+  BundleAdjustmentConfig config = CreateConfig(24);
+  config.SetConstantCamIntrinsics(0);
+  const point3D_t constant_point3D_id =
+      reconstruction.Image(12).Point2D(0).point3D_id;
+  config.AddConstantPoint(constant_point3D_id);
+  // Points observed by images outside of the configuration are constant.
+  config.RemoveImage(23);
+  const point3D_t partial_point3D_id =
+      reconstruction.Image(23).Point2D(0).point3D_id;
+
+  BundleAdjustmentOptions ba_options;
+  ba_options.print_summary = false;
+  PartitionedBundleAdjuster bundle_adjuster(
+      CreateOptions(), ba_options, config);
+  ASSERT_TRUE(bundle_adjuster.Solve(&reconstruction));
+  EXPECT_GT(bundle_adjuster.Report().num_submaps, 1);
+  EXPECT_LT(bundle_adjuster.Summary().final_cost,
+            bundle_adjuster.Summary().initial_cost);
+
+  EXPECT_EQ(reconstruction.Camera(0).params,
+            orig_reconstruction.Camera(0).params);
+  EXPECT_EQ(reconstruction.Point3D(constant_point3D_id).xyz,
+            orig_reconstruction.Point3D(constant_point3D_id).xyz);
+  EXPECT_EQ(reconstruction.Point3D(partial_point3D_id).xyz,
+            orig_reconstruction.Point3D(partial_point3D_id).xyz);
+  EXPECT_EQ(reconstruction.Image(23).CamFromWorld().translation,
+            orig_reconstruction.Image(23).CamFromWorld().translation);
+  EXPECT_NE(reconstruction.Image(12).CamFromWorld().translation,
+            orig_reconstruction.Image(12).CamFromWorld().translation);
+}
+
+TEST(PartitionedBundleAdjustment, EmptyConfig) {
+  Reconstruction reconstruction;
+  GenerateStripReconstruction(24, 10, &reconstruction);
+  PartitionedBundleAdjuster bundle_adjuster(
+      CreateOptions(), BundleAdjustmentOptions(), BundleAdjustmentConfig());
+  EXPECT_FALSE(bundle_adjuster.Solve(&reconstruction));
+}
+
+TEST(PartitionedBundleAdjustment, RejectsSchurSolver) {
+  BundleAdjustmentOptions ba_options;
+  ba_options.use_schur_solver = true;
+  EXPECT_ANY_THROW(PartitionedBundleAdjuster(
+      CreateOptions(), ba_options, CreateConfig(24)));
+}
+
+}  // namespace
+}  // namespace colmap
@@ -0,0 +1,1755 @@
+// Copyright (c) 2023, ETH Zurich and UNC Chapel Hill.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of ETH Zurich and UNC Chapel Hill nor the names of
+//       its contributors may be used to endorse or promote products derived
+//       from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "colmap/estimators/schur_bundle_adjustment.h"
+
+#include "colmap/sensor/models.h"
+#include "colmap/util/logging.h"
+#include "colmap/util/threading.h"
+#include "colmap/util/timer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <future>
+#include <limits>
+#include <numeric>
+#include <type_traits>
+
+#include <Eigen/Cholesky>
+#include <Eigen/Geometry>
+
+namespace colmap {
+namespace {
+
+// Maximum number of intrinsic parameters of a camera model.
+constexpr int kMaxNumCameraParams = 16;
+
+// Maximum number of reduced camera parameters for which the Schur complement
+// is formed and factorized explicitly.
+constexpr int kMaxNumDenseSchurParams = 600;
+
+// Maximum number of refinement steps of the single precision solution of the
+// reduced camera system and the relative residual at which they stop.
+constexpr int kMaxNumMixedPrecisionRefinements = 5;
+constexpr double kMixedPrecisionRefinementTolerance = 1e-10;
+
+// Product of the transposed camera-side Jacobian of a pose or camera with the
+// point Jacobian of an observation.
+template <typename T>
+using CameraPointBlock =
+    Eigen::Matrix<T, Eigen::Dynamic, 3, 0, kMaxNumCameraParams, 3>;
+
+// Projects a point in camera coordinates to the image and optionally computes
+// the Jacobians of the projection w.r.t. the point and the camera parameters,
+// stored in column-major order with two rows.
+using ProjectFunc = void (*)(const double* params,
+                             const Eigen::Vector3d& point_in_cam,
+                             Eigen::Vector2d* xy,
+                             double* jacobian_point,
+                             double* jacobian_params);
+
+template <typename CameraModel>
+void ProjectPoint(const double* params,
+                  const Eigen::Vector3d& point_in_cam,
+                  Eigen::Vector2d* xy,
+                  double* jacobian_point,
+                  double* jacobian_params) {
+  if (jacobian_point == nullptr) {
+    CameraModel::ImgFromCam(params,
+                            point_in_cam.x(),
+                            point_in_cam.y(),
+                            point_in_cam.z(),
+                            &xy->x(),
+                            &xy->y());
+    return;
+  }
+
+  constexpr int kNumParams = static_cast<int>(CameraModel::num_params);
+  using JetT = ceres::Jet<double, 3 + kNumParams>;
+  JetT params_jet[kNumParams];
+  for (int i = 0; i < kNumParams; ++i) {
+    params_jet[i] = JetT(params[i], 3 + i);
+  }
+  const JetT u(point_in_cam.x(), 0);
+  const JetT v(point_in_cam.y(), 1);
+  const JetT w(point_in_cam.z(), 2);
+  JetT x;
+  JetT y;
+  CameraModel::ImgFromCam(params_jet, u, v, w, &x, &y);
+
+  xy->x() = x.a;
+  xy->y() = y.a;
+  for (int i = 0; i < 3; ++i) {
+    jacobian_point[2 * i] = x.v[i];
+    jacobian_point[2 * i + 1] = y.v[i];
+  }
+  for (int i = 0; i < kNumParams; ++i) {
+    jacobian_params[2 * i] = x.v[3 + i];
+    jacobian_params[2 * i + 1] = y.v[3 + i];
+  }
+}
+
+ProjectFunc GetProjectFunc(const CameraModelId model_id) {
+  switch (model_id) {
+#define CAMERA_MODEL_CASE(CameraModel) \
+  case CameraModel::model_id:          \
+    return &ProjectPoint<CameraModel>;
+
+    CAMERA_MODEL_SWITCH_CASES
+
+#undef CAMERA_MODEL_CASE
+  }
+  return nullptr;
+}
+
+// Calls func(begin, end, thread_idx) for contiguous ranges of [0, num_items),
+// one range per thread of the pool or a single range without a pool.
+template <typename Func>
+void ParallelFor(ThreadPool* thread_pool, const size_t num_items, Func func) {
+  const size_t num_threads =
+      thread_pool == nullptr ? 1 : thread_pool->NumThreads();
+  if (num_threads == 1 || num_items < num_threads) {
+    func(0, num_items, 0);
+    return;
+  }
+
+  std::vector<std::future<void>> futures;
+  futures.reserve(num_threads);
+  for (size_t thread_idx = 0; thread_idx < num_threads; ++thread_idx) {
+    const size_t begin = num_items * thread_idx / num_threads;
+    const size_t end = num_items * (thread_idx + 1) / num_threads;
+    futures.push_back(thread_pool->AddTask(
+        [&func, begin, end, thread_idx]() { func(begin, end, thread_idx); }));
+  }
+  for (auto& future : futures) {
+    future.get();
+  }
+}
+
+// Sums the per-thread accumulators into the first one.
+template <typename Vector>
+void ReduceAccumulators(std::vector<Vector>* accumulators) {
+  for (size_t i = 1; i < accumulators->size(); ++i) {
+    (*accumulators)[0] += (*accumulators)[i];
+  }
+}
+
+// Computes y += J x in double precision, where the 2 x size Jacobian J is
+// stored in column-major order.
+template <typename T>
+void AddJacobianProduct(const T* jacobian,
+                        const int size,
+                        const double* x,
+                        Eigen::Vector2d* y) {
+  for (int i = 0; i < size; ++i) {
+    y->x() += static_cast<double>(jacobian[2 * i]) * x[i];
+    y->y() += static_cast<double>(jacobian[2 * i + 1]) * x[i];
+  }
+}
+
+// Computes y += J^T v in double precision.
+template <typename T>
+void AddJacobianTransposeProduct(const T* jacobian,
+                                 const int size,
+                                 const Eigen::Vector2d& v,
+                                 double* y) {
+  for (int i = 0; i < size; ++i) {
+    y[i] += static_cast<double>(jacobian[2 * i]) * v.x() +
+            static_cast<double>(jacobian[2 * i + 1]) * v.y();
+  }
+}
+
+Eigen::Matrix3d CrossProductMatrix(const Eigen::Vector3d& vector) {
+  Eigen::Matrix3d matrix;
+  matrix << 0, -vector(2), vector(1), vector(2), 0, -vector(0), -vector(1),
+      vector(0), 0;
+  return matrix;
+}
+
+// The bundle adjustment problem in structure-of-arrays layout. The camera-side
+// parameters (image poses and camera intrinsics) that are refined form the
+// reduced camera system, in which every variable pose or camera occupies a
+// contiguous block of its active (not held constant) parameters. Pose updates
+// are parameterized by a left-multiplied rotation vector and a translation.
+//
+// The Jacobians and the reduced camera system are stored with scalar type T.
+// Residuals, costs, parameters, gradients, and all products with the Jacobians
+// are computed in double precision, such that single precision storage only
+// perturbs the linearization and not the evaluated cost.
+template <typename T>
+class SchurProblem {
+ public:
+  SchurProblem(const BundleAdjustmentOptions& options,
+               BundleAdjustmentConfig config,
+               Reconstruction* reconstruction,
+               ThreadPool* thread_pool);
+
+  size_t NumObservations() const { return obs_image_idxs_.size(); }
+  size_t NumReducedObservations() const;
+  size_t NumParameterBlocks() const;
+  size_t NumParameters() const;
+  size_t NumCameraParams() const { return num_camera_params_; }
+  size_t NumVariablePoints() const { return variable_point_idxs_.size(); }
+
+  // Evaluate the total cost of the problem and optionally the residuals and
+  // Jacobians scaled by the robust loss function together with the gradient
+  // and the block diagonal of the normal equations. Returns false if the
+  // cost is not finite.
+  bool Evaluate(bool jacobians, double* cost);
+
+  // Maximum absolute entry of the gradient.
+  double GradientMaxNorm() const;
+
+  // Norm of all parameters.
+  double ParameterNorm() const;
+
+  // Solve the damped normal equations for the Gauss-Newton step and compute
+  // the decrease of the linearized cost under the step. Returns false if the
+  // linear system could not be solved.
+  bool SolveStep(double mu,
+                 Eigen::VectorXd* camera_step,
+                 Eigen::VectorXd* point_step,
+                 double* model_cost_change,
+                 ceres::LinearSolverType* linear_solver_type);
+
+  void Backup();
+  void Restore();
+  void Plus(const Eigen::VectorXd& camera_step,
+            const Eigen::VectorXd& point_step);
+
+  void WriteToReconstruction() const;
+
+ private:
+  using MatrixXT = Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>;
+  using VectorXT = Eigen::Matrix<T, Eigen::Dynamic, 1>;
+  using JacobianMap = Eigen::Map<const Eigen::Matrix<T, 2, Eigen::Dynamic>>;
+
+  void AddImage(image_t image_id);
+  void AddPoint(point3D_t point3D_id);
+  int AddCamera(camera_t camera_id);
+  void AddObservation(int image_idx, int point_idx, const Eigen::Vector2d& xy);
+  void ParameterizeCameras();
+  void ParameterizeImages();
+  void FinalizeObservations();
+
+  void EvaluateObservation(size_t obs_idx, bool jacobians, double* cost);
+  void AccumulateNormalTerms();
+
+  Eigen::Vector2d MultiplyCameraJacobian(size_t obs_idx,
+                                         const double* x) const;
+  void AddCameraJacobianTransposeProduct(size_t obs_idx,
+                                         const Eigen::Vector2d& v,
+                                         double* y) const;
+
+  void ComputePointBlocks(double mu);
+  void ComputeReducedRhs(Eigen::VectorXd* rhs) const;
+  void RefineSolution(double mu,
+                      const Eigen::LLT<MatrixXT>& llt,
+                      const Eigen::VectorXd& rhs,
+                      Eigen::VectorXd* camera_step) const;
+  bool SolveDense(double mu, Eigen::VectorXd* camera_step) const;
+  bool SolveIterative(double mu, Eigen::VectorXd* camera_step) const;
+  void MultiplySchurComplement(double mu,
+                               const Eigen::VectorXd& x,
+                               Eigen::VectorXd* y,
+                               std::vector<Eigen::VectorXd>* accumulators,
+                               std::vector<double>* obs_products) const;
+  void BackSubstitute(const Eigen::VectorXd& camera_step,
+                      Eigen::VectorXd* point_step) const;
+  double ModelCostChange(const Eigen::VectorXd& camera_step,
+                         const Eigen::VectorXd& point_step) const;
+
+  int PoseSize(int image_idx) const { return pose_sizes_[image_idx]; }
+  int IntrinsicsSize(int image_idx) const {
+    return intrinsics_sizes_[image_camera_idxs_[image_idx]];
+  }
+
+  const BundleAdjustmentOptions& options_;
+  BundleAdjustmentConfig config_;
+  Reconstruction* reconstruction_;
+  ThreadPool* thread_pool_;
+  std::unique_ptr<ceres::LossFunction> loss_function_;
+
+  // Images with their poses stored as quaternion coefficients and translation.
+  std::vector<image_t> image_ids_;
+  std::unordered_map<image_t, int> image_idxs_;
+  std::vector<double> rotations_;
+  std::vector<double> translations_;
+  std::vector<Eigen::Matrix3d> rotation_matrices_;
+  std::vector<int> image_camera_idxs_;
+  // Offset and size of the pose block in the reduced camera system and the
+  // active pose dimensions (0-2 rotation, 3-5 translation).
+  std::vector<int> pose_offsets_;
+  std::vector<int> pose_sizes_;
+  std::vector<std::array<int, 6>> pose_dims_;
+
+  // Cameras with their parameters stored contiguously.
+  std::vector<camera_t> camera_ids_;
+  std::unordered_map<camera_t, int> camera_idxs_;
+  std::vector<double> params_;
+  std::vector<int> params_offsets_;
+  std::vector<int> num_params_;
+  std::vector<ProjectFunc> project_funcs_;
+  // Offset and size of the intrinsics block in the reduced camera system and
+  // the indices of the active parameters.
+  std::vector<int> intrinsics_offsets_;
+  std::vector<int> intrinsics_sizes_;
+  std::vector<int> intrinsics_dims_;
+
+  // Points with the index of the variable point or -1 if constant.
+  std::vector<point3D_t> point3D_ids_;
+  std::unordered_map<point3D_t, int> point_idxs_;
+  std::vector<double> points_;
+  std::vector<int> point_variable_idxs_;
+  std::vector<int> variable_point_idxs_;
+
+  // Observations sorted by point, where the observations of point i are in
+  // [point_obs_begin_[i], point_obs_begin_[i + 1]).
+  std::vector<int> obs_image_idxs_;
+  std::vector<int> obs_point_idxs_;
+  std::vector<Eigen::Vector2d> obs_xys_;
+  std::vector<size_t> point_obs_begin_;
+
+  // Evaluated residuals and Jacobians. The camera Jacobian of an observation
+  // holds the active pose columns followed by the active intrinsic columns.
+  std::vector<Eigen::Vector2d> residuals_;
+  std::vector<Eigen::Matrix<T, 2, 3>> point_jacobians_;
+  std::vector<T> camera_jacobians_;
+  std::vector<size_t> camera_jacobian_offsets_;
+
+  // Reduced camera system blocks, i.e. the variable poses and intrinsics.
+  std::vector<int> block_offsets_;
+  std::vector<int> block_sizes_;
+  std::vector<int> pose_blocks_;
+  std::vector<int> intrinsics_blocks_;
+  int num_camera_params_ = 0;
+
+  // Gradient and diagonal of the normal equations for the camera parameters
+  // and the gradient and 3x3 diagonal blocks for the variable points.
+  Eigen::VectorXd camera_gradient_;
+  Eigen::VectorXd camera_diagonal_;
+  Eigen::VectorXd point_gradient_;
+  std::vector<Eigen::Matrix3d> point_blocks_;
+  std::vector<Eigen::Matrix3d> point_block_inverses_;
+
+  // Parameter values before the last step for rejected steps.
+  std::vector<double> rotations_backup_;
+  std::vector<double> translations_backup_;
+  std::vector<double> params_backup_;
+  std::vector<double> points_backup_;
+};
+
+template <typename T>
+SchurProblem<T>::SchurProblem(const BundleAdjustmentOptions& options,
+                              BundleAdjustmentConfig config,
+                              Reconstruction* reconstruction,
+                              ThreadPool* thread_pool)
+    : options_(options),
+      config_(std::move(config)),
+      reconstruction_(reconstruction),
+      thread_pool_(thread_pool),
+      loss_function_(options.CreateLossFunction()) {
+  // Same order as in BundleAdjuster, so that the cameras of images outside of
+  // the configuration are only held constant if not observed otherwise.
+  for (const image_t image_id : config_.Images()) {
+    AddImage(image_id);
+  }
+  for (const point3D_t point3D_id : config_.VariablePoints()) {
+    AddPoint(point3D_id);
+  }
+  for (const point3D_t point3D_id : config_.ConstantPoints()) {
+    AddPoint(point3D_id);
+  }
+
+  ParameterizeCameras();
+  ParameterizeImages();
+  FinalizeObservations();
+}
+
+template <typename T>
+int SchurProblem<T>::AddCamera(const camera_t camera_id) {
+  const auto it = camera_idxs_.find(camera_id);
+  if (it != camera_idxs_.end()) {
+    return it->second;
+  }
+
+  const Camera& camera = reconstruction_->Camera(camera_id);
+  THROW_CHECK_LE(camera.params.size(), kMaxNumCameraParams);
+  const int camera_idx = static_cast<int>(camera_ids_.size());
+  camera_idxs_.emplace(camera_id, camera_idx);
+  camera_ids_.push_back(camera_id);
+  params_offsets_.push_back(static_cast<int>(params_.size()));
+  num_params_.push_back(static_cast<int>(camera.params.size()));
+  params_.insert(params_.end(), camera.params.begin(), camera.params.end());
+  project_funcs_.push_back(GetProjectFunc(camera.model_id));
+  return camera_idx;
+}
+
+template <typename T>
+void SchurProblem<T>::AddImage(const image_t image_id) {
+  Image& image = reconstruction_->Image(image_id);
+
+  // The pose update assumes unit quaternions.
+  image.CamFromWorld().rotation.normalize();
+
+  const int image_idx = static_cast<int>(image_ids_.size());
+  bool has_observation = false;
+  for (const Point2D& point2D : image.Points2D()) {
+    if (!point2D.HasPoint3D()) {
+      continue;
+    }
+
+    has_observation = true;
+
+    int point_idx;
+    const auto it = point_idxs_.find(point2D.point3D_id);
+    if (it == point_idxs_.end()) {
+      point_idx = static_cast<int>(point3D_ids_.size());
+      point_idxs_.emplace(point2D.point3D_id, point_idx);
+      point3D_ids_.push_back(point2D.point3D_id);
+      const Eigen::Vector3d& xyz =
+          reconstruction_->Point3D(point2D.point3D_id).xyz;
+      points_.insert(points_.end(), xyz.data(), xyz.data() + 3);
+    } else {
+      point_idx = it->second;
+    }
+
+    AddObservation(image_idx, point_idx, point2D.xy);
+  }
+
+  if (!has_observation) {
+    return;
+  }
+
+  image_idxs_.emplace(image_id, image_idx);
+  image_ids_.push_back(image_id);
+  const Rigid3d& cam_from_world = image.CamFromWorld();
+  rotations_.insert(rotations_.end(),
+                    cam_from_world.rotation.coeffs().data(),
+                    cam_from_world.rotation.coeffs().data() + 4);
+  translations_.insert(translations_.end(),
+                       cam_from_world.translation.data(),
+                       cam_from_world.translation.data() + 3);
+  image_camera_idxs_.push_back(AddCamera(image.CameraId()));
+}
+
+template <typename T>
+void SchurProblem<T>::AddPoint(const point3D_t point3D_id) {
+  const Point3D& point3D = reconstruction_->Point3D(point3D_id);
+
+  int point_idx;
+  const auto it = point_idxs_.find(point3D_id);
+  if (it == point_idxs_.end()) {
+    point_idx = static_cast<int>(point3D_ids_.size());
+    point_idxs_.emplace(point3D_id, point_idx);
+    point3D_ids_.push_back(point3D_id);
+    points_.insert(points_.end(), point3D.xyz.data(), point3D.xyz.data() + 3);
+  } else {
+    point_idx = it->second;
+  }
+
+  for (const auto& track_el : point3D.track.Elements()) {
+    // Skip observations that were already added by the images.
+    if (config_.HasImage(track_el.image_id)) {
+      continue;
+    }
+
+    Image& image = reconstruction_->Image(track_el.image_id);
+    image.CamFromWorld().rotation.normalize();
+
+    // Images outside of the configuration have a constant pose and the
+    // intrinsics of their camera are only refined if the camera is also used
+    // by images of the configuration.
+    int image_idx;
+    const auto image_it = image_idxs_.find(track_el.image_id);
+    if (image_it == image_idxs_.end()) {
+      image_idx = static_cast<int>(image_ids_.size());
+      image_idxs_.emplace(track_el.image_id, image_idx);
+      image_ids_.push_back(track_el.image_id);
+      const Rigid3d& cam_from_world = image.CamFromWorld();
+      rotations_.insert(rotations_.end(),
+                        cam_from_world.rotation.coeffs().data(),
+                        cam_from_world.rotation.coeffs().data() + 4);
+      translations_.insert(translations_.end(),
+                           cam_from_world.translation.data(),
+                           cam_from_world.translation.data() + 3);
+      if (camera_idxs_.count(image.CameraId()) == 0) {
+        config_.SetConstantCamIntrinsics(image.CameraId());
+      }
+      image_camera_idxs_.push_back(AddCamera(image.CameraId()));
+    } else {
+      image_idx = image_it->second;
+    }
+
+    AddObservation(
+        image_idx, point_idx, image.Point2D(track_el.point2D_idx).xy);
+  }
+}
+
+template <typename T>
+void SchurProblem<T>::AddObservation(const int image_idx,
+                                     const int point_idx,
+                                     const Eigen::Vector2d& xy) {
+  obs_image_idxs_.push_back(image_idx);
+  obs_point_idxs_.push_back(point_idx);
+  obs_xys_.push_back(xy);
+}
+
+template <typename T>
+void SchurProblem<T>::ParameterizeCameras() {
+  std::vector<bool> refine_param;
+  for (size_t camera_idx = 0; camera_idx < camera_ids_.size(); ++camera_idx) {
+    const Camera& camera = reconstruction_->Camera(camera_ids_[camera_idx]);
+    refine_param.assign(camera.params.size(),
+                        !config_.HasConstantCamIntrinsics(camera.camera_id));
+    const auto set_constant = [&refine_param](span<const size_t> idxs) {
+      for (const size_t idx : idxs) {
+        refine_param[idx] = false;
+      }
+    };
+    if (!options_.refine_focal_length) {
+      set_constant(camera.FocalLengthIdxs());
+    }
+    if (!options_.refine_principal_point) {
+      set_constant(camera.PrincipalPointIdxs());
+    }
+    if (!options_.refine_extra_params) {
+      set_constant(camera.ExtraParamsIdxs());
+    }
+
+    int size = 0;
+    for (size_t idx = 0; idx < refine_param.size(); ++idx) {
+      if (refine_param[idx]) {
+        intrinsics_dims_.push_back(static_cast<int>(idx));
+        size += 1;
+      }
+    }
+    // Pad the active indices to the maximum to keep a fixed stride.
+    intrinsics_dims_.resize(intrinsics_dims_.size() + kMaxNumCameraParams -
+                            size);
+
+    if (size > 0) {
+      intrinsics_blocks_.push_back(static_cast<int>(block_sizes_.size()));
+      intrinsics_offsets_.push_back(num_camera_params_);
+      block_offsets_.push_back(num_camera_params_);
+      block_sizes_.push_back(size);
+      num_camera_params_ += size;
+    } else {
+      intrinsics_blocks_.push_back(-1);
+      intrinsics_offsets_.push_back(-1);
+    }
+    intrinsics_sizes_.push_back(size);
+  }
+}
+
+template <typename T>
+void SchurProblem<T>::ParameterizeImages() {
+  for (size_t image_idx = 0; image_idx < image_ids_.size(); ++image_idx) {
+    const image_t image_id = image_ids_[image_idx];
+    std::array<int, 6> dims;
+    int size = 0;
+    if (options_.refine_extrinsics && config_.HasImage(image_id) &&
+        !config_.HasConstantCamPose(image_id)) {
+      std::array<bool, 6> refine_dim;
+      refine_dim.fill(true);
+      if (config_.HasConstantCamPositions(image_id)) {
+        for (const int idx : config_.ConstantCamPositions(image_id)) {
+          refine_dim[3 + idx] = false;
+        }
+      }
+      for (int dim = 0; dim < 6; ++dim) {
+        if (refine_dim[dim]) {
+          dims[size++] = dim;
+        }
+      }
+    }
+
+    pose_dims_.push_back(dims);
+    pose_sizes_.push_back(size);
+    if (size > 0) {
+      pose_blocks_.push_back(static_cast<int>(block_sizes_.size()));
+      pose_offsets_.push_back(num_camera_params_);
+      block_offsets_.push_back(num_camera_params_);
+      block_sizes_.push_back(size);
+      num_camera_params_ += size;
+    } else {
+      pose_blocks_.push_back(-1);
+      pose_offsets_.push_back(-1);
+    }
+  }
+}
+
+template <typename T>
+void SchurProblem<T>::FinalizeObservations() {
+  const size_t num_points = point3D_ids_.size();
+  const size_t num_observations = obs_image_idxs_.size();
+
+  // A point is only refined if its entire track is part of the problem.
+  point_obs_begin_.assign(num_points + 1, 0);
+  for (const int point_idx : obs_point_idxs_) {
+    point_obs_begin_[point_idx + 1] += 1;
+  }
+  point_variable_idxs_.resize(num_points, -1);
+  for (size_t point_idx = 0; point_idx < num_points; ++point_idx) {
+    const point3D_t point3D_id = point3D_ids_[point_idx];
+    const size_t num_point_observations = point_obs_begin_[point_idx + 1];
+    if (!config_.HasConstantPoint(point3D_id) &&
+        reconstruction_->Point3D(point3D_id).track.Length() ==
+            num_point_observations) {
+      point_variable_idxs_[point_idx] =
+          static_cast<int>(variable_point_idxs_.size());
+      variable_point_idxs_.push_back(static_cast<int>(point_idx));
+    }
+    point_obs_begin_[point_idx + 1] += point_obs_begin_[point_idx];
+  }
+
+  // Counting sort of the observations by point.
+  std::vector<size_t> obs_order(num_observations);
+  std::vector<size_t> next_obs_idxs(point_obs_begin_.begin(),
+                                    point_obs_begin_.end() - 1);
+  for (size_t obs_idx = 0; obs_idx < num_observations; ++obs_idx) {
+    obs_order[next_obs_idxs[obs_point_idxs_[obs_idx]]++] = obs_idx;
+  }
+  std::vector<int> obs_image_idxs(num_observations);
+  std::vector<int> obs_point_idxs(num_observations);
+  std::vector<Eigen::Vector2d> obs_xys(num_observations);
+  for (size_t i = 0; i < num_observations; ++i) {
+    obs_image_idxs[i] = obs_image_idxs_[obs_order[i]];
+    obs_point_idxs[i] = obs_point_idxs_[obs_order[i]];
+    obs_xys[i] = obs_xys_[obs_order[i]];
+  }
+  obs_image_idxs_ = std::move(obs_image_idxs);
+  obs_point_idxs_ = std::move(obs_point_idxs);
+  obs_xys_ = std::move(obs_xys);
+
+  camera_jacobian_offsets_.resize(num_observations + 1);
+  camera_jacobian_offsets_[0] = 0;
+  for (size_t obs_idx = 0; obs_idx < num_observations; ++obs_idx) {
+    const int image_idx = obs_image_idxs_[obs_idx];
+    camera_jacobian_offsets_[obs_idx + 1] =
+        camera_jacobian_offsets_[obs_idx] +
+        2 * (PoseSize(image_idx) + IntrinsicsSize(image_idx));
+  }
+
+  residuals_.resize(num_observations);
+  point_jacobians_.resize(num_observations);
+  camera_jacobians_.resize(camera_jacobian_offsets_.back());
+  rotation_matrices_.resize(image_ids_.size());
+  point_blocks_.resize(variable_point_idxs_.size());
+  point_block_inverses_.resize(variable_point_idxs_.size());
+}
+
+template <typename T>
+size_t SchurProblem<T>::NumReducedObservations() const {
+  size_t num_observations = 0;
+  for (size_t obs_idx = 0; obs_idx < obs_image_idxs_.size(); ++obs_idx) {
+    if (point_variable_idxs_[obs_point_idxs_[obs_idx]] >= 0 ||
+        camera_jacobian_offsets_[obs_idx + 1] >
+            camera_jacobian_offsets_[obs_idx]) {
+      num_observations += 1;
+    }
+  }
+  return num_observations;
+}
+
+template <typename T>
+size_t SchurProblem<T>::NumParameterBlocks() const {
+  return 2 * image_ids_.size() + camera_ids_.size() + point3D_ids_.size();
+}
+
+template <typename T>
+size_t SchurProblem<T>::NumParameters() const {
+  return rotations_.size() + translations_.size() + params_.size() +
+         points_.size();
+}
+
+template <typename T>
+void SchurProblem<T>::EvaluateObservation(const size_t obs_idx,
+                                          const bool jacobians,
+                                          double* cost) {
+  const int image_idx = obs_image_idxs_[obs_idx];
+  const int camera_idx = image_camera_idxs_[image_idx];
+  const Eigen::Matrix3d& rotation = rotation_matrices_[image_idx];
+  const Eigen::Vector3d rotated_point =
+      rotation * Eigen::Map<const Eigen::Vector3d>(
+                     &points_[3 * obs_point_idxs_[obs_idx]]);
+  const Eigen::Vector3d point_in_cam =
+      rotated_point +
+      Eigen::Map<const Eigen::Vector3d>(&translations_[3 * image_idx]);
+
+  Eigen::Vector2d xy;
+  Eigen::Matrix<double, 2, 3> jacobian_point_in_cam;
+  Eigen::Matrix<double, 2, kMaxNumCameraParams> jacobian_params;
+  project_funcs_[camera_idx](&params_[params_offsets_[camera_idx]],
+                             point_in_cam,
+                             &xy,
+                             jacobians ? jacobian_point_in_cam.data() : nullptr,
+                             jacobians ? jacobian_params.data() : nullptr);
+  const Eigen::Vector2d residual = xy - obs_xys_[obs_idx];
+
+  // Robustify the residual and Jacobians as done by Ceres, such that the
+  // Gauss-Newton model matches the second-order expansion of the loss.
+  const double sq_norm = residual.squaredNorm();
+  double rho[3];
+  loss_function_->Evaluate(sq_norm, rho);
+  *cost += 0.5 * rho[0];
+  if (!jacobians) {
+    return;
+  }
+
+  const double sqrt_rho1 = std::sqrt(rho[1]);
+  double residual_scaling = sqrt_rho1;
+  double alpha_sq_norm = 0;
+  if (sq_norm > 0 && rho[2] > 0) {
+    const double alpha = 1 - std::sqrt(1 + 2 * sq_norm * rho[2] / rho[1]);
+    residual_scaling = sqrt_rho1 / (1 - alpha);
+    alpha_sq_norm = alpha / sq_norm;
+  }
+  const Eigen::Matrix2d correction =
+      sqrt_rho1 * (Eigen::Matrix2d::Identity() -
+                   alpha_sq_norm * residual * residual.transpose());
+
+  residuals_[obs_idx] = residual_scaling * residual;
+  jacobian_point_in_cam = correction * jacobian_point_in_cam;
+  point_jacobians_[obs_idx] =
+      (jacobian_point_in_cam * rotation).template cast<T>();
+
+  T* camera_jacobian =
+      camera_jacobians_.data() + camera_jacobian_offsets_[obs_idx];
+  const int pose_size = pose_sizes_[image_idx];
+  if (pose_size > 0) {
+    Eigen::Matrix<double, 2, 6> jacobian_pose;
+    jacobian_pose.leftCols<3>() =
+        -jacobian_point_in_cam * CrossProductMatrix(rotated_point);
+    jacobian_pose.rightCols<3>() = jacobian_point_in_cam;
+    const std::array<int, 6>& dims = pose_dims_[image_idx];
+    for (int i = 0; i < pose_size; ++i) {
+      camera_jacobian[2 * i] = static_cast<T>(jacobian_pose(0, dims[i]));
+      camera_jacobian[2 * i + 1] = static_cast<T>(jacobian_pose(1, dims[i]));
+    }
+    camera_jacobian += 2 * pose_size;
+  }
+
+  const int intrinsics_size = intrinsics_sizes_[camera_idx];
+  if (intrinsics_size > 0) {
+    const int num_params = num_params_[camera_idx];
+    jacobian_params.leftCols(num_params) =
+        correction * jacobian_params.leftCols(num_params);
+    const int* dims = &intrinsics_dims_[kMaxNumCameraParams * camera_idx];
+    for (int i = 0; i < intrinsics_size; ++i) {
+      camera_jacobian[2 * i] = static_cast<T>(jacobian_params(0, dims[i]));
+      camera_jacobian[2 * i + 1] = static_cast<T>(jacobian_params(1, dims[i]));
+    }
+  }
+}
+
+template <typename T>
+bool SchurProblem<T>::Evaluate(const bool jacobians, double* cost) {
+  for (size_t image_idx = 0; image_idx < image_ids_.size(); ++image_idx) {
+    rotation_matrices_[image_idx] =
+        Eigen::Map<const Eigen::Quaterniond>(&rotations_[4 * image_idx])
+            .toRotationMatrix();
+  }
+
+  const size_t num_threads =
+      thread_pool_ == nullptr ? 1 : thread_pool_->NumThreads();
+  std::vector<double> costs(num_threads, 0);
+  ParallelFor(thread_pool_,
+              NumObservations(),
+              [&](const size_t begin, const size_t end, const size_t thread) {
+                double thread_cost = 0;
+                for (size_t obs_idx = begin; obs_idx < end; ++obs_idx) {
+                  EvaluateObservation(obs_idx, jacobians, &thread_cost);
+                }
+                costs[thread] = thread_cost;
+              });
+  *cost = std::accumulate(costs.begin(), costs.end(), 0.0);
+  if (!std::isfinite(*cost)) {
+    return false;
+  }
+
+  if (jacobians) {
+    AccumulateNormalTerms();
+  }
+
+  return true;
+}
+
+template <typename T>
+void SchurProblem<T>::AccumulateNormalTerms() {
+  const size_t num_threads =
+      thread_pool_ == nullptr ? 1 : thread_pool_->NumThreads();
+  std::vector<Eigen::VectorXd> gradients(
+      num_threads, Eigen::VectorXd::Zero(num_camera_params_));
+  std::vector<Eigen::VectorXd> diagonals(
+      num_threads, Eigen::VectorXd::Zero(num_camera_params_));
+  point_gradient_.resize(3 * variable_point_idxs_.size());
+
+  ParallelFor(
+      thread_pool_,
+      point3D_ids_.size(),
+      [&](const size_t begin, const size_t end, const size_t thread) {
+        Eigen::VectorXd& gradient = gradients[thread];
+        Eigen::VectorXd& diagonal = diagonals[thread];
+        for (size_t point_idx = begin; point_idx < end; ++point_idx) {
+          Eigen::Vector3d point_gradient = Eigen::Vector3d::Zero();
+          Eigen::Matrix3d point_block = Eigen::Matrix3d::Zero();
+          for (size_t obs_idx = point_obs_begin_[point_idx];
+               obs_idx < point_obs_begin_[point_idx + 1];
+               ++obs_idx) {
+            const Eigen::Vector2d& residual = residuals_[obs_idx];
+            const Eigen::Matrix<double, 2, 3> point_jacobian =
+                point_jacobians_[obs_idx].template cast<double>();
+            point_gradient += point_jacobian.transpose() * residual;
+            point_block += point_jacobian.transpose() * point_jacobian;
+
+            AddCameraJacobianTransposeProduct(
+                obs_idx, residual, gradient.data());
+            const int image_idx = obs_image_idxs_[obs_idx];
+            const T* camera_jacobian =
+                camera_jacobians_.data() + camera_jacobian_offsets_[obs_idx];
+            const int pose_size = PoseSize(image_idx);
+            const int pose_offset = pose_offsets_[image_idx];
+            for (int i = 0; i < pose_size; ++i) {
+              diagonal[pose_offset + i] +=
+                  Eigen::Map<const Eigen::Matrix<T, 2, 1>>(camera_jacobian +
+                                                           2 * i)
+                      .template cast<double>()
+                      .squaredNorm();
+            }
+            camera_jacobian += 2 * pose_size;
+            const int intrinsics_size = IntrinsicsSize(image_idx);
+            const int intrinsics_offset =
+                intrinsics_offsets_[image_camera_idxs_[image_idx]];
+            for (int i = 0; i < intrinsics_size; ++i) {
+              diagonal[intrinsics_offset + i] +=
+                  Eigen::Map<const Eigen::Matrix<T, 2, 1>>(camera_jacobian +
+                                                           2 * i)
+                      .template cast<double>()
+                      .squaredNorm();
+            }
+          }
+
+          const int variable_idx = point_variable_idxs_[point_idx];
+          if (variable_idx >= 0) {
+            point_gradient_.segment<3>(3 * variable_idx) = point_gradient;
+            point_blocks_[variable_idx] = point_block;
+          }
+        }
+      });
+
+  ReduceAccumulators(&gradients);
+  ReduceAccumulators(&diagonals);
+  camera_gradient_ = std::move(gradients[0]);
+  camera_diagonal_ = std::move(diagonals[0]);
+}
+
+template <typename T>
+double SchurProblem<T>::GradientMaxNorm() const {
+  double max_norm = 0;
+  if (camera_gradient_.size() > 0) {
+    max_norm = camera_gradient_.lpNorm<Eigen::Infinity>();
+  }
+  if (point_gradient_.size() > 0) {
+    max_norm = std::max(max_norm, point_gradient_.lpNorm<Eigen::Infinity>());
+  }
+  return max_norm;
+}
+
+template <typename T>
+double SchurProblem<T>::ParameterNorm() const {
+  double sq_norm = 0;
+  for (const std::vector<double>* values :
+       {&rotations_, &translations_, &params_, &points_}) {
+    for (const double value : *values) {
+      sq_norm += value * value;
+    }
+  }
+  return std::sqrt(sq_norm);
+}
+
+template <typename T>
+Eigen::Vector2d SchurProblem<T>::MultiplyCameraJacobian(
+    const size_t obs_idx, const double* x) const {
+  const int image_idx = obs_image_idxs_[obs_idx];
+  const T* camera_jacobian =
+      camera_jacobians_.data() + camera_jacobian_offsets_[obs_idx];
+  Eigen::Vector2d y = Eigen::Vector2d::Zero();
+  const int pose_size = PoseSize(image_idx);
+  if (pose_size > 0) {
+    AddJacobianProduct(
+        camera_jacobian, pose_size, x + pose_offsets_[image_idx], &y);
+    camera_jacobian += 2 * pose_size;
+  }
+  const int intrinsics_size = IntrinsicsSize(image_idx);
+  if (intrinsics_size > 0) {
+    AddJacobianProduct(camera_jacobian,
+                       intrinsics_size,
+                       x + intrinsics_offsets_[image_camera_idxs_[image_idx]],
+                       &y);
+  }
+  return y;
+}
+
+template <typename T>
+void SchurProblem<T>::AddCameraJacobianTransposeProduct(
+    const size_t obs_idx, const Eigen::Vector2d& v, double* y) const {
+  const int image_idx = obs_image_idxs_[obs_idx];
+  const T* camera_jacobian =
+      camera_jacobians_.data() + camera_jacobian_offsets_[obs_idx];
+  const int pose_size = PoseSize(image_idx);
+  if (pose_size > 0) {
+    AddJacobianTransposeProduct(
+        camera_jacobian, pose_size, v, y + pose_offsets_[image_idx]);
+    camera_jacobian += 2 * pose_size;
+  }
+  const int intrinsics_size = IntrinsicsSize(image_idx);
+  if (intrinsics_size > 0) {
+    AddJacobianTransposeProduct(
+        camera_jacobian,
+        intrinsics_size,
+        v,
+        y + intrinsics_offsets_[image_camera_idxs_[image_idx]]);
+  }
+}
+
+// Inverts the damped 3x3 diagonal blocks of the variable points.
+template <typename T>
+void SchurProblem<T>::ComputePointBlocks(const double mu) {
+  ParallelFor(
+      thread_pool_,
+      variable_point_idxs_.size(),
+      [&](const size_t begin, const size_t end, const size_t) {
+        for (size_t i = begin; i < end; ++i) {
+          Eigen::Matrix3d damped_block = point_blocks_[i];
+          for (int k = 0; k < 3; ++k) {
+            damped_block(k, k) +=
+                std::clamp(point_blocks_[i](k, k),
+                           options_.solver_options.min_lm_diagonal,
+                           options_.solver_options.max_lm_diagonal) /
+                mu;
+          }
+          point_block_inverses_[i] = damped_block.inverse();
+        }
+      });
+}
+
+// Computes the right-hand side of the reduced camera system, i.e.
+// -g_c + sum_i W_i V_i^-1 g_i over the variable points.
+template <typename T>
+void SchurProblem<T>::ComputeReducedRhs(Eigen::VectorXd* rhs) const {
+  const size_t num_threads =
+      thread_pool_ == nullptr ? 1 : thread_pool_->NumThreads();
+  std::vector<Eigen::VectorXd> accumulators(
+      num_threads, Eigen::VectorXd::Zero(num_camera_params_));
+  ParallelFor(
+      thread_pool_,
+      variable_point_idxs_.size(),
+      [&](const size_t begin, const size_t end, const size_t thread) {
+        for (size_t i = begin; i < end; ++i) {
+          const int point_idx = variable_point_idxs_[i];
+          const Eigen::Vector3d z =
+              point_block_inverses_[i] * point_gradient_.segment<3>(3 * i);
+          for (size_t obs_idx = point_obs_begin_[point_idx];
+               obs_idx < point_obs_begin_[point_idx + 1];
+               ++obs_idx) {
+            AddCameraJacobianTransposeProduct(
+                obs_idx,
+                point_jacobians_[obs_idx].template cast<double>() * z,
+                accumulators[thread].data());
+          }
+        }
+      });
+  ReduceAccumulators(&accumulators);
+  *rhs = accumulators[0] - camera_gradient_;
+}
+
+// Explicitly forms and factorizes the damped Schur complement
+// S = U + D_c / mu - sum_i W_i V_i^-1 W_i^T.
+template <typename T>
+bool SchurProblem<T>::SolveDense(const double mu,
+                                 Eigen::VectorXd* camera_step) const {
+  const size_t num_threads =
+      thread_pool_ == nullptr ? 1 : thread_pool_->NumThreads();
+  std::vector<MatrixXT> accumulators(
+      num_threads, MatrixXT::Zero(num_camera_params_, num_camera_params_));
+
+  // Each observation contributes a pose and an intrinsics part to the
+  // camera-side Jacobian, given by their column offset and size.
+  struct JacobianPart {
+    int offset;
+    int size;
+    const T* jacobian;
+    CameraPointBlock<T> w;
+  };
+
+  ParallelFor(
+      thread_pool_,
+      point3D_ids_.size(),
+      [&](const size_t begin, const size_t end, const size_t thread) {
+        MatrixXT& schur = accumulators[thread];
+        std::vector<JacobianPart> parts;
+        for (size_t point_idx = begin; point_idx < end; ++point_idx) {
+          parts.clear();
+          for (size_t obs_idx = point_obs_begin_[point_idx];
+               obs_idx < point_obs_begin_[point_idx + 1];
+               ++obs_idx) {
+            const int image_idx = obs_image_idxs_[obs_idx];
+            const T* camera_jacobian =
+                camera_jacobians_.data() + camera_jacobian_offsets_[obs_idx];
+            const size_t first_part = parts.size();
+            const int pose_size = PoseSize(image_idx);
+            if (pose_size > 0) {
+              parts.push_back(JacobianPart{
+                  pose_offsets_[image_idx], pose_size, camera_jacobian, {}});
+              camera_jacobian += 2 * pose_size;
+            }
+            const int intrinsics_size = IntrinsicsSize(image_idx);
+            if (intrinsics_size > 0) {
+              parts.push_back(JacobianPart{
+                  intrinsics_offsets_[image_camera_idxs_[image_idx]],
+                  intrinsics_size,
+                  camera_jacobian,
+                  {}});
+            }
+
+            for (size_t a = first_part; a < parts.size(); ++a) {
+              const JacobianMap jacobian_a(parts[a].jacobian, 2, parts[a].size);
+              parts[a].w =
+                  jacobian_a.transpose() * point_jacobians_[obs_idx];
+              for (size_t b = first_part; b < parts.size(); ++b) {
+                const JacobianMap jacobian_b(
+                    parts[b].jacobian, 2, parts[b].size);
+                schur.block(parts[a].offset,
+                            parts[b].offset,
+                            parts[a].size,
+                            parts[b].size) +=
+                    jacobian_a.transpose() * jacobian_b;
+              }
+            }
+          }
+
+          const int variable_idx = point_variable_idxs_[point_idx];
+          if (variable_idx < 0) {
+            continue;
+          }
+          const Eigen::Matrix<T, 3, 3> point_block_inverse =
+              point_block_inverses_[variable_idx].template cast<T>();
+          for (const JacobianPart& part_a : parts) {
+            const CameraPointBlock<T> w_v = part_a.w * point_block_inverse;
+            for (const JacobianPart& part_b : parts) {
+              schur.block(
+                  part_a.offset, part_b.offset, part_a.size, part_b.size) -=
+                  w_v * part_b.w.transpose();
+            }
+          }
+        }
+      });
+
+  for (size_t i = 1; i < num_threads; ++i) {
+    accumulators[0] += accumulators[i];
+  }
+  MatrixXT& schur = accumulators[0];
+  for (int i = 0; i < num_camera_params_; ++i) {
+    schur(i, i) += static_cast<T>(
+        std::clamp(camera_diagonal_(i),
+                   options_.solver_options.min_lm_diagonal,
+                   options_.solver_options.max_lm_diagonal) /
+        mu);
+  }
+
+  Eigen::VectorXd rhs;
+  ComputeReducedRhs(&rhs);
+  const Eigen::LLT<MatrixXT> llt(schur);
+  if (llt.info() != Eigen::Success) {
+    return false;
+  }
+  *camera_step = llt.solve(rhs.template cast<T>()).template cast<double>();
+  if (!std::is_same<T, double>::value) {
+    RefineSolution(mu, llt, rhs, camera_step);
+  }
+  return camera_step->allFinite();
+}
+
+// Iteratively refines the solution of the reduced camera system computed with
+// the single precision factorization, using the residual of the system
+// evaluated in double precision: x += S_T^-1 (b - S x). Stops early if the
+// refinement does not reduce the residual, i.e., if the system is too badly
+// conditioned for the single precision factorization.
+template <typename T>
+void SchurProblem<T>::RefineSolution(const double mu,
+                                     const Eigen::LLT<MatrixXT>& llt,
+                                     const Eigen::VectorXd& rhs,
+                                     Eigen::VectorXd* camera_step) const {
+  const size_t num_threads =
+      thread_pool_ == nullptr ? 1 : thread_pool_->NumThreads();
+  std::vector<Eigen::VectorXd> accumulators(
+      num_threads, Eigen::VectorXd(num_camera_params_));
+  std::vector<double> obs_products(2 * NumObservations());
+  const double rhs_norm = rhs.norm();
+  double prev_residual_norm = std::numeric_limits<double>::infinity();
+  Eigen::VectorXd prev_camera_step;
+  Eigen::VectorXd schur_step;
+  for (int iteration = 0; iteration < kMaxNumMixedPrecisionRefinements;
+       ++iteration) {
+    MultiplySchurComplement(
+        mu, *camera_step, &schur_step, &accumulators, &obs_products);
+    const Eigen::VectorXd residual = rhs - schur_step;
+    const double residual_norm = residual.norm();
+    if (!(residual_norm < prev_residual_norm)) {
+      if (prev_camera_step.size() > 0) {
+        *camera_step = prev_camera_step;
+      }
+      break;
+    }
+    if (residual_norm <= kMixedPrecisionRefinementTolerance * rhs_norm) {
+      break;
+    }
+    prev_residual_norm = residual_norm;
+    prev_camera_step = *camera_step;
+    *camera_step +=
+        llt.solve(residual.template cast<T>()).template cast<double>();
+  }
+}
+
+// Computes y = S x for the damped Schur complement without forming it, by
+// eliminating the points one at a time: S x = U x + D_c x / mu -
+// sum_i W_i V_i^-1 W_i^T x.
+template <typename T>
+void SchurProblem<T>::MultiplySchurComplement(
+    const double mu,
+    const Eigen::VectorXd& x,
+    Eigen::VectorXd* y,
+    std::vector<Eigen::VectorXd>* accumulators,
+    std::vector<double>* obs_products) const {
+  for (Eigen::VectorXd& accumulator : *accumulators) {
+    accumulator.setZero();
+  }
+  ParallelFor(
+      thread_pool_,
+      point3D_ids_.size(),
+      [&](const size_t begin, const size_t end, const size_t thread) {
+        double* accumulator = (*accumulators)[thread].data();
+        for (size_t point_idx = begin; point_idx < end; ++point_idx) {
+          const size_t obs_begin = point_obs_begin_[point_idx];
+          const size_t obs_end = point_obs_begin_[point_idx + 1];
+          Eigen::Map<Eigen::Matrix<double, 2, Eigen::Dynamic>> products(
+              obs_products->data() + 2 * obs_begin, 2, obs_end - obs_begin);
+          for (size_t obs_idx = obs_begin; obs_idx < obs_end; ++obs_idx) {
+            products.col(obs_idx - obs_begin) =
+                MultiplyCameraJacobian(obs_idx, x.data());
+          }
+
+          const int variable_idx = point_variable_idxs_[point_idx];
+          if (variable_idx >= 0) {
+            Eigen::Vector3d w_x = Eigen::Vector3d::Zero();
+            for (size_t obs_idx = obs_begin; obs_idx < obs_end; ++obs_idx) {
+              w_x += point_jacobians_[obs_idx]
+                         .template cast<double>()
+                         .transpose() *
+                     products.col(obs_idx - obs_begin);
+            }
+            const Eigen::Vector3d z = point_block_inverses_[variable_idx] * w_x;
+            for (size_t obs_idx = obs_begin; obs_idx < obs_end; ++obs_idx) {
+              products.col(obs_idx - obs_begin) -=
+                  point_jacobians_[obs_idx].template cast<double>() * z;
+            }
+          }
+
+          for (size_t obs_idx = obs_begin; obs_idx < obs_end; ++obs_idx) {
+            AddCameraJacobianTransposeProduct(
+                obs_idx, products.col(obs_idx - obs_begin), accumulator);
+          }
+        }
+      });
+  ReduceAccumulators(accumulators);
+
+  *y = (*accumulators)[0];
+  for (int i = 0; i < num_camera_params_; ++i) {
+    (*y)(i) += std::clamp(camera_diagonal_(i),
+                          options_.solver_options.min_lm_diagonal,
+                          options_.solver_options.max_lm_diagonal) /
+               mu * x(i);
+  }
+}
+
+// Solves the reduced camera system by preconditioned conjugate gradients on
+// the implicit Schur complement. The preconditioner is the inverse of the
+// block diagonal of the Schur complement, i.e. one block per pose and camera,
+// which is formed and inverted with scalar type T.
+template <typename T>
+bool SchurProblem<T>::SolveIterative(const double mu,
+                                     Eigen::VectorXd* camera_step) const {
+  const size_t num_threads =
+      thread_pool_ == nullptr ? 1 : thread_pool_->NumThreads();
+  const size_t num_blocks = block_sizes_.size();
+
+  std::vector<size_t> block_data_offsets(num_blocks + 1, 0);
+  for (size_t block = 0; block < num_blocks; ++block) {
+    block_data_offsets[block + 1] =
+        block_data_offsets[block] + block_sizes_[block] * block_sizes_[block];
+  }
+
+  struct JacobianPart {
+    int block;
+    const T* jacobian;
+    CameraPointBlock<T> w;
+  };
+
+  std::vector<VectorXT> accumulators(
+      num_threads, VectorXT::Zero(block_data_offsets.back()));
+  ParallelFor(
+      thread_pool_,
+      point3D_ids_.size(),
+      [&](const size_t begin, const size_t end, const size_t thread) {
+        T* accumulator = accumulators[thread].data();
+        std::vector<JacobianPart> parts;
+        for (size_t point_idx = begin; point_idx < end; ++point_idx) {
+          parts.clear();
+          for (size_t obs_idx = point_obs_begin_[point_idx];
+               obs_idx < point_obs_begin_[point_idx + 1];
+               ++obs_idx) {
+            const int image_idx = obs_image_idxs_[obs_idx];
+            const T* camera_jacobian =
+                camera_jacobians_.data() + camera_jacobian_offsets_[obs_idx];
+            const size_t first_part = parts.size();
+            if (pose_blocks_[image_idx] >= 0) {
+              parts.push_back(
+                  JacobianPart{pose_blocks_[image_idx], camera_jacobian, {}});
+              camera_jacobian += 2 * PoseSize(image_idx);
+            }
+            const int intrinsics_block =
+                intrinsics_blocks_[image_camera_idxs_[image_idx]];
+            if (intrinsics_block >= 0) {
+              parts.push_back(
+                  JacobianPart{intrinsics_block, camera_jacobian, {}});
+            }
+
+            for (size_t a = first_part; a < parts.size(); ++a) {
+              const int size = block_sizes_[parts[a].block];
+              const JacobianMap jacobian(parts[a].jacobian, 2, size);
+              parts[a].w = jacobian.transpose() * point_jacobians_[obs_idx];
+              Eigen::Map<MatrixXT>(
+                  accumulator + block_data_offsets[parts[a].block],
+                  size,
+                  size) += jacobian.transpose() * jacobian;
+            }
+          }
+
+          const int variable_idx = point_variable_idxs_[point_idx];
+          if (variable_idx < 0) {
+            continue;
+          }
+          const Eigen::Matrix<T, 3, 3> point_block_inverse =
+              point_block_inverses_[variable_idx].template cast<T>();
+          for (const JacobianPart& part_a : parts) {
+            const int size = block_sizes_[part_a.block];
+            Eigen::Map<MatrixXT> block(
+                accumulator + block_data_offsets[part_a.block], size, size);
+            const CameraPointBlock<T> w_v = part_a.w * point_block_inverse;
+            for (const JacobianPart& part_b : parts) {
+              if (part_b.block == part_a.block) {
+                block -= w_v * part_b.w.transpose();
+              }
+            }
+          }
+        }
+      });
+  ReduceAccumulators(&accumulators);
+
+  std::vector<MatrixXT> preconditioner(num_blocks);
+  for (size_t block = 0; block < num_blocks; ++block) {
+    const int size = block_sizes_[block];
+    const int offset = block_offsets_[block];
+    MatrixXT damped_block = Eigen::Map<const MatrixXT>(
+        accumulators[0].data() + block_data_offsets[block], size, size);
+    for (int i = 0; i < size; ++i) {
+      damped_block(i, i) += static_cast<T>(
+          std::clamp(camera_diagonal_(offset + i),
+                     options_.solver_options.min_lm_diagonal,
+                     options_.solver_options.max_lm_diagonal) /
+          mu);
+    }
+    const Eigen::LLT<MatrixXT> llt(damped_block);
+    if (llt.info() == Eigen::Success) {
+      preconditioner[block] = llt.solve(MatrixXT::Identity(size, size));
+    } else {
+      preconditioner[block] =
+          damped_block.diagonal().cwiseInverse().asDiagonal();
+    }
+  }
+  const auto precondition = [&](const Eigen::VectorXd& r, Eigen::VectorXd* z) {
+    z->resize(r.size());
+    for (size_t block = 0; block < num_blocks; ++block) {
+      const int size = block_sizes_[block];
+      const int offset = block_offsets_[block];
+      z->segment(offset, size) =
+          (preconditioner[block] *
+           r.segment(offset, size).template cast<T>())
+              .template cast<double>();
+    }
+  };
+
+  Eigen::VectorXd rhs;
+  ComputeReducedRhs(&rhs);
+  camera_step->setZero(num_camera_params_);
+  if (rhs.squaredNorm() == 0) {
+    return true;
+  }
+
+  std::vector<Eigen::VectorXd> matvec_accumulators(
+      num_threads, Eigen::VectorXd(num_camera_params_));
+  std::vector<double> obs_products(2 * NumObservations());
+  Eigen::VectorXd r = rhs;
+  Eigen::VectorXd z;
+  precondition(r, &z);
+  Eigen::VectorXd p = z;
+  Eigen::VectorXd q;
+  double r_dot_z = r.dot(z);
+  // Terminate once the relative decrease of the quadratic model
+  // Q(x) = x^T S x / 2 - x^T b per iteration falls below eta, as in Ceres.
+  double q0 = 0;
+  for (int iteration = 1;
+       iteration <= options_.solver_options.max_linear_solver_iterations;
+       ++iteration) {
+    MultiplySchurComplement(
+        mu, p, &q, &matvec_accumulators, &obs_products);
+    const double p_dot_q = p.dot(q);
+    if (!(p_dot_q > 0)) {
+      break;
+    }
+    const double alpha = r_dot_z / p_dot_q;
+    *camera_step += alpha * p;
+    r -= alpha * q;
+    const double q1 = -0.5 * camera_step->dot(rhs + r);
+    if (iteration * (q1 - q0) / q1 < options_.solver_options.eta) {
+      break;
+    }
+    q0 = q1;
+    precondition(r, &z);
+    const double new_r_dot_z = r.dot(z);
+    p = z + (new_r_dot_z / r_dot_z) * p;
+    r_dot_z = new_r_dot_z;
+  }
+
+  return camera_step->allFinite();
+}
+
+// Recovers the point updates given the camera updates:
+// dp_i = -V_i^-1 (g_i + W_i^T dc).
+template <typename T>
+void SchurProblem<T>::BackSubstitute(const Eigen::VectorXd& camera_step,
+                                     Eigen::VectorXd* point_step) const {
+  point_step->resize(3 * variable_point_idxs_.size());
+  ParallelFor(thread_pool_,
+              variable_point_idxs_.size(),
+              [&](const size_t begin, const size_t end, const size_t) {
+                for (size_t i = begin; i < end; ++i) {
+                  const int point_idx = variable_point_idxs_[i];
+                  Eigen::Vector3d rhs = point_gradient_.segment<3>(3 * i);
+                  for (size_t obs_idx = point_obs_begin_[point_idx];
+                       obs_idx < point_obs_begin_[point_idx + 1];
+                       ++obs_idx) {
+                    rhs += point_jacobians_[obs_idx]
+                               .template cast<double>()
+                               .transpose() *
+                           MultiplyCameraJacobian(obs_idx, camera_step.data());
+                  }
+                  point_step->segment<3>(3 * i) =
+                      -point_block_inverses_[i] * rhs;
+                }
+              });
+}
+
+// Computes the decrease of the Gauss-Newton model -(g^T d + |J d|^2 / 2).
+template <typename T>
+double SchurProblem<T>::ModelCostChange(
+    const Eigen::VectorXd& camera_step,
+    const Eigen::VectorXd& point_step) const {
+  const size_t num_threads =
+      thread_pool_ == nullptr ? 1 : thread_pool_->NumThreads();
+  std::vector<double> sq_norms(num_threads, 0);
+  ParallelFor(
+      thread_pool_,
+      point3D_ids_.size(),
+      [&](const size_t begin, const size_t end, const size_t thread) {
+        double sq_norm = 0;
+        for (size_t point_idx = begin; point_idx < end; ++point_idx) {
+          const int variable_idx = point_variable_idxs_[point_idx];
+          for (size_t obs_idx = point_obs_begin_[point_idx];
+               obs_idx < point_obs_begin_[point_idx + 1];
+               ++obs_idx) {
+            Eigen::Vector2d jacobian_step =
+                MultiplyCameraJacobian(obs_idx, camera_step.data());
+            if (variable_idx >= 0) {
+              jacobian_step +=
+                  point_jacobians_[obs_idx].template cast<double>() *
+                  point_step.template segment<3>(3 * variable_idx);
+            }
+            sq_norm += jacobian_step.squaredNorm();
+          }
+        }
+        sq_norms[thread] = sq_norm;
+      });
+  const double jacobian_step_sq_norm =
+      std::accumulate(sq_norms.begin(), sq_norms.end(), 0.0);
+  return -(camera_gradient_.dot(camera_step) + point_gradient_.dot(point_step) +
+           0.5 * jacobian_step_sq_norm);
+}
+
+template <typename T>
+bool SchurProblem<T>::SolveStep(const double mu,
+                                Eigen::VectorXd* camera_step,
+                                Eigen::VectorXd* point_step,
+                                double* model_cost_change,
+                                ceres::LinearSolverType* linear_solver_type) {
+  ComputePointBlocks(mu);
+
+  bool success;
+  if (num_camera_params_ == 0) {
+    camera_step->resize(0);
+    success = true;
+  } else if (num_camera_params_ <= kMaxNumDenseSchurParams) {
+    *linear_solver_type = ceres::DENSE_SCHUR;
+    success = SolveDense(mu, camera_step);
+  } else {
+    *linear_solver_type = ceres::ITERATIVE_SCHUR;
+    success = SolveIterative(mu, camera_step);
+  }
+  if (!success) {
+    return false;
+  }
+
+  BackSubstitute(*camera_step, point_step);
+  *model_cost_change = ModelCostChange(*camera_step, *point_step);
+  return std::isfinite(*model_cost_change);
+}
+
+template <typename T>
+void SchurProblem<T>::Backup() {
+  rotations_backup_ = rotations_;
+  translations_backup_ = translations_;
+  params_backup_ = params_;
+  points_backup_ = points_;
+}
+
+template <typename T>
+void SchurProblem<T>::Restore() {
+  rotations_.swap(rotations_backup_);
+  translations_.swap(translations_backup_);
+  params_.swap(params_backup_);
+  points_.swap(points_backup_);
+}
+
+template <typename T>
+void SchurProblem<T>::Plus(const Eigen::VectorXd& camera_step,
+                           const Eigen::VectorXd& point_step) {
+  for (size_t image_idx = 0; image_idx < image_ids_.size(); ++image_idx) {
+    const int pose_size = pose_sizes_[image_idx];
+    if (pose_size == 0) {
+      continue;
+    }
+    Eigen::Matrix<double, 6, 1> pose_step = Eigen::Matrix<double, 6, 1>::Zero();
+    for (int i = 0; i < pose_size; ++i) {
+      pose_step(pose_dims_[image_idx][i]) =
+          camera_step(pose_offsets_[image_idx] + i);
+    }
+    Eigen::Map<Eigen::Quaterniond> rotation(&rotations_[4 * image_idx]);
+    const Eigen::Vector3d rotation_step = pose_step.head<3>();
+    const double angle = rotation_step.norm();
+    if (angle > 0) {
+      rotation = (Eigen::Quaterniond(
+                      Eigen::AngleAxisd(angle, rotation_step / angle)) *
+                  rotation)
+                     .normalized();
+    }
+    Eigen::Map<Eigen::Vector3d>(&translations_[3 * image_idx]) +=
+        pose_step.tail<3>();
+  }
+
+  for (size_t camera_idx = 0; camera_idx < camera_ids_.size(); ++camera_idx) {
+    const int* dims = &intrinsics_dims_[kMaxNumCameraParams * camera_idx];
+    for (int i = 0; i < intrinsics_sizes_[camera_idx]; ++i) {
+      params_[params_offsets_[camera_idx] + dims[i]] +=
+          camera_step(intrinsics_offsets_[camera_idx] + i);
+    }
+  }
+
+  for (size_t i = 0; i < variable_point_idxs_.size(); ++i) {
+    Eigen::Map<Eigen::Vector3d>(&points_[3 * variable_point_idxs_[i]]) +=
+        point_step.segment<3>(3 * i);
+  }
+}
+
+template <typename T>
+void SchurProblem<T>::WriteToReconstruction() const {
+  for (size_t image_idx = 0; image_idx < image_ids_.size(); ++image_idx) {
+    if (pose_sizes_[image_idx] == 0) {
+      continue;
+    }
+    Rigid3d& cam_from_world =
+        reconstruction_->Image(image_ids_[image_idx]).CamFromWorld();
+    cam_from_world.rotation.coeffs() =
+        Eigen::Map<const Eigen::Vector4d>(&rotations_[4 * image_idx]);
+    cam_from_world.translation =
+        Eigen::Map<const Eigen::Vector3d>(&translations_[3 * image_idx]);
+  }
+
+  for (size_t camera_idx = 0; camera_idx < camera_ids_.size(); ++camera_idx) {
+    if (intrinsics_sizes_[camera_idx] == 0) {
+      continue;
+    }
+    std::vector<double>& params =
+        reconstruction_->Camera(camera_ids_[camera_idx]).params;
+    std::copy_n(&params_[params_offsets_[camera_idx]],
+                num_params_[camera_idx],
+                params.begin());
+  }
+
+  for (const int point_idx : variable_point_idxs_) {
+    reconstruction_->SetPoint3DXYZ(
+        point3D_ids_[point_idx],
+        Eigen::Map<const Eigen::Vector3d>(&points_[3 * point_idx]));
+  }
+}
+
+// Runs the Levenberg-Marquardt iterations on the problem. Returns false if the
+// problem has no observations.
+template <typename T>
+bool SolveSchurProblem(const BundleAdjustmentOptions& options,
+                       const BundleAdjustmentConfig& config,
+                       Reconstruction* reconstruction,
+                       ThreadPool* thread_pool,
+                       const Timer& timer,
+                       ceres::Solver::Summary* summary) {
+  const ceres::Solver::Options& solver_options = options.solver_options;
+
+  SchurProblem<T> problem(options, config, reconstruction, thread_pool);
+  if (problem.NumObservations() == 0) {
+    return false;
+  }
+
+  summary->num_residual_blocks = static_cast<int>(problem.NumObservations());
+  summary->num_residuals = 2 * summary->num_residual_blocks;
+  summary->num_residual_blocks_reduced =
+      static_cast<int>(problem.NumReducedObservations());
+  summary->num_residuals_reduced = 2 * summary->num_residual_blocks_reduced;
+  summary->num_parameter_blocks =
+      static_cast<int>(problem.NumParameterBlocks());
+  summary->num_parameters = static_cast<int>(problem.NumParameters());
+  summary->num_effective_parameters_reduced = static_cast<int>(
+      problem.NumCameraParams() + 3 * problem.NumVariablePoints());
+  summary->linear_solver_type_given = solver_options.linear_solver_type;
+  summary->linear_solver_type_used = ceres::DENSE_SCHUR;
+  summary->num_successful_steps = 0;
+  summary->num_unsuccessful_steps = 0;
+  summary->preprocessor_time_in_seconds = timer.ElapsedSeconds();
+
+  double cost = 0;
+  if (!problem.Evaluate(/*jacobians=*/true, &cost)) {
+    summary->termination_type = ceres::FAILURE;
+    summary->message = "Initial cost is not finite.";
+    return true;
+  }
+  summary->initial_cost = cost;
+
+  double mu = solver_options.initial_trust_region_radius;
+  double nu = 2;
+  int num_consecutive_invalid_steps = 0;
+  Eigen::VectorXd camera_step;
+  Eigen::VectorXd point_step;
+  summary->termination_type = ceres::NO_CONVERGENCE;
+  summary->message = "Maximum number of iterations reached.";
+  for (int iteration = 0; iteration < solver_options.max_num_iterations;
+       ++iteration) {
+    if (timer.ElapsedSeconds() > solver_options.max_solver_time_in_seconds) {
+      summary->message = "Maximum solver time reached.";
+      break;
+    }
+
+    if (problem.GradientMaxNorm() <= solver_options.gradient_tolerance) {
+      summary->termination_type = ceres::CONVERGENCE;
+      summary->message = "Gradient tolerance reached.";
+      break;
+    }
+
+    double model_cost_change = 0;
+    const bool valid_step =
+        problem.SolveStep(mu,
+                          &camera_step,
+                          &point_step,
+                          &model_cost_change,
+                          &summary->linear_solver_type_used);
+
+    // A step that cannot decrease the linearized cost by more than the
+    // numerical precision of the cost means that the solver converged.
+    if (valid_step && model_cost_change <=
+                          std::numeric_limits<double>::epsilon() * cost) {
+      summary->termination_type = ceres::CONVERGENCE;
+      summary->message = "Linearized cost cannot be decreased further.";
+      break;
+    }
+
+    if (!valid_step) {
+      summary->num_unsuccessful_steps += 1;
+      if (++num_consecutive_invalid_steps >
+          solver_options.max_num_consecutive_invalid_steps) {
+        summary->termination_type = ceres::FAILURE;
+        summary->message = "Too many consecutive invalid steps.";
+        break;
+      }
+      mu /= nu;
+      nu *= 2;
+      continue;
+    }
+    num_consecutive_invalid_steps = 0;
+
+    if (solver_options.parameter_tolerance > 0) {
+      const double step_norm = std::sqrt(camera_step.squaredNorm() +
+                                         point_step.squaredNorm());
+      if (step_norm <=
+          solver_options.parameter_tolerance *
+              (problem.ParameterNorm() + solver_options.parameter_tolerance)) {
+        summary->termination_type = ceres::CONVERGENCE;
+        summary->message = "Parameter tolerance reached.";
+        break;
+      }
+    }
+
+    problem.Backup();
+    problem.Plus(camera_step, point_step);
+    double new_cost = 0;
+    const bool valid_cost = problem.Evaluate(/*jacobians=*/false, &new_cost);
+    const double cost_change = cost - new_cost;
+    const double relative_decrease =
+        valid_cost ? cost_change / model_cost_change
+                   : -std::numeric_limits<double>::infinity();
+
+    if (valid_cost && std::abs(cost_change) <=
+                          solver_options.function_tolerance * cost) {
+      if (cost_change < 0) {
+        problem.Restore();
+      } else {
+        cost = new_cost;
+        summary->num_successful_steps += 1;
+      }
+      summary->termination_type = ceres::CONVERGENCE;
+      summary->message = "Function tolerance reached.";
+      break;
+    }
+
+    if (relative_decrease > solver_options.min_relative_decrease) {
+      summary->num_successful_steps += 1;
+      cost = new_cost;
+      mu = std::min(solver_options.max_trust_region_radius,
+                    mu / std::max(1.0 / 3.0,
+                                  1.0 - std::pow(2 * relative_decrease - 1,
+                                                 3)));
+      nu = 2;
+      problem.Evaluate(/*jacobians=*/true, &cost);
+    } else {
+      summary->num_unsuccessful_steps += 1;
+      problem.Restore();
+      mu /= nu;
+      nu *= 2;
+      if (mu < solver_options.min_trust_region_radius) {
+        summary->termination_type = ceres::CONVERGENCE;
+        summary->message = "Trust region radius too small.";
+        break;
+      }
+    }
+  }
+
+  summary->final_cost = cost;
+  problem.WriteToReconstruction();
+
+  return true;
+}
+
+}  // namespace
+
+SchurBundleAdjuster::SchurBundleAdjuster(const BundleAdjustmentOptions& options,
+                                         const BundleAdjustmentConfig& config)
+    : options_(options), config_(config) {
+  THROW_CHECK(options_.Check());
+}
+
+bool SchurBundleAdjuster::Solve(Reconstruction* reconstruction) {
+  THROW_CHECK_NOTNULL(reconstruction);
+
+  Timer timer;
+  timer.Start();
+
+  summary_ = ceres::Solver::Summary();
+
+  const ceres::Solver::Options& solver_options = options_.solver_options;
+  const size_t num_residuals = config_.NumResiduals(*reconstruction);
+  if (num_residuals == 0) {
+    return false;
+  }
+
+  int num_threads = 1;
+  if (num_residuals >=
+      static_cast<size_t>(options_.min_num_residuals_for_multi_threading)) {
+    num_threads = GetEffectiveNumThreads(solver_options.num_threads);
+  }
+  std::unique_ptr<ThreadPool> thread_pool;
+  if (num_threads > 1) {
+    thread_pool = std::make_unique<ThreadPool>(num_threads);
+  }
+
+  summary_.num_threads_given = solver_options.num_threads;
+  summary_.num_threads_used = num_threads;
+
+  bool success;
+  if (options_.use_mixed_precision) {
+    success = SolveSchurProblem<float>(
+        options_, config_, reconstruction, thread_pool.get(), timer, &summary_);
+  } else {
+    success = SolveSchurProblem<double>(
+        options_, config_, reconstruction, thread_pool.get(), timer, &summary_);
+  }
+  if (!success) {
+    return false;
+  }
+
+  summary_.total_time_in_seconds = timer.ElapsedSeconds();
+
+  if (options_.print_summary || VLOG_IS_ON(1)) {
+    PrintSolverSummary(summary_, "Bundle adjustment report");
+  }
+
+  return true;
+}
+
+const ceres::Solver::Summary& SchurBundleAdjuster::Summary() const {
+  return summary_;
+}
+
+}  // namespace colmap
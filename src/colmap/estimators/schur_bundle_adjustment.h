@@ -0,0 +1,71 @@
+// Copyright (c) 2023, ETH Zurich and UNC Chapel Hill.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of ETH Zurich and UNC Chapel Hill nor the names of
+//       its contributors may be used to endorse or promote products derived
+//       from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include "colmap/estimators/bundle_adjustment.h"
+#include "colmap/scene/reconstruction.h"
+
+#include <ceres/ceres.h>
+
+namespace colmap {
+
+// Bundle adjuster specialized to the camera-point structure of bundle
+// adjustment problems. Instead of setting up a generic Ceres problem, the
+// parameters and observations are stored in flat arrays, the residuals and
+// Jacobians are evaluated in parallel, and a Levenberg-Marquardt loop is run on
+// the reduced camera system obtained by eliminating the points through the
+// Schur complement. Small reduced systems are factorized densely, while larger
+// ones are solved by conjugate gradients on the implicit Schur complement with
+// a block-Jacobi preconditioner. With the mixed precision option, the
+// Jacobians and the reduced camera system are stored in single precision and
+// the solution is refined in double precision.
+//
+// The adjuster accepts the same options and configurations as BundleAdjuster
+// and produces the same parameterization. Of the Ceres solver options, only
+// the iteration limits, tolerances, trust region settings, and the number of
+// threads are used.
+class SchurBundleAdjuster {
+ public:
+  SchurBundleAdjuster(const BundleAdjustmentOptions& options,
+                      const BundleAdjustmentConfig& config);
+
+  bool Solve(Reconstruction* reconstruction);
+
+  // Get the solver summary after the last call to `Solve`. Only the problem
+  // sizes, costs, step counts, timings, and termination type are filled.
+  const ceres::Solver::Summary& Summary() const;
+
+ private:
+  const BundleAdjustmentOptions options_;
+  const BundleAdjustmentConfig config_;
+  ceres::Solver::Summary summary_;
+};
+
+}  // namespace colmap
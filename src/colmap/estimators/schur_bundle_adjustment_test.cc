@@ -0,0 +1,345 @@
+// Copyright (c) 2023, ETH Zurich and UNC Chapel Hill.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of ETH Zurich and UNC Chapel Hill nor the names of
+//       its contributors may be used to endorse or promote products derived
+//       from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "colmap/estimators/schur_bundle_adjustment.h"
+
+#include "colmap/math/random.h"
+#include "colmap/scene/projection.h"
+#include "colmap/sensor/models.h"
+
+#include <gtest/gtest.h>
+
+namespace colmap {
+namespace {
+
+void GenerateReconstruction(const size_t num_images,
+                            const size_t num_points,
+                            Reconstruction* reconstruction) {
+  SetPRNGSeed(0);
+
+  for (size_t i = 0; i < num_points; ++i) {
+    const Eigen::Vector3d xyz(RandomUniformReal(-1.0, 1.0),
+                              RandomUniformReal(-1.0, 1.0),
+                              RandomUniformReal(-1.0, 1.0));
+    reconstruction->AddPoint3D(xyz, Track());
+  }
+
+  const double kFocalLengthFactor = 1.2;
+  const size_t kImageSize = 1000;
+
+  for (size_t i = 0; i < num_images; ++i) {
+    const camera_t camera_id = static_cast<camera_t>(i);
+    const image_t image_id = static_cast<image_t>(i);
+
+    const Camera camera =
+        Camera::CreateFromModelId(camera_id,
+                                  SimpleRadialCameraModel::model_id,
+                                  kFocalLengthFactor * kImageSize,
+                                  kImageSize,
+                                  kImageSize);
+    reconstruction->AddCamera(camera);
+
+    Image image;
+    image.SetImageId(image_id);
+    image.SetCameraId(camera_id);
+    image.SetName(std::to_string(i));
+    image.CamFromWorld() = Rigid3d(
+        Eigen::Quaterniond::Identity(),
+        Eigen::Vector3d(
+            RandomUniformReal(-1.0, 1.0), RandomUniformReal(-1.0, 1.0), 10));
+    image.SetRegistered(true);
+    reconstruction->AddImage(image);
+
+    std::vector<Eigen::Vector2d> points2D;
+    for (const auto& point3D : reconstruction->Points3D()) {
+      // Get exact projection of 3D point.
+      Eigen::Vector2d point2D = camera.ImgFromCam(
+          (image.CamFromWorld() * point3D.second.xyz).hnormalized());
+      // Add some uniform noise.
+      point2D += Eigen::Vector2d(RandomUniformReal(-2.0, 2.0),
+                                 RandomUniformReal(-2.0, 2.0));
+      points2D.push_back(point2D);
+    }
+
+    reconstruction->Image(image_id).SetPoints2D(points2D);
+  }
+
+  for (size_t i = 0; i < num_images; ++i) {
+    const image_t image_id = static_cast<image_t>(i);
+    TrackElement track_el;
+    track_el.image_id = image_id;
+    track_el.point2D_idx = 0;
+    for (const auto& point3D : reconstruction->Points3D()) {
+      reconstruction->AddObservation(point3D.first, track_el);
+      track_el.point2D_idx += 1;
+    }
+  }
+}
+
+BundleAdjustmentConfig CreateConfig(const size_t num_images) {
+  BundleAdjustmentConfig config;
+  for (size_t i = 0; i < num_images; ++i) {
+    config.AddImage(static_cast<image_t>(i));
+  }
+  config.SetConstantCamPose(0);
+  config.SetConstantCamPositions(1, {0});
+  return config;
+}
+
+TEST(SchurBundleAdjustment, TwoView) {
+  Reconstruction reconstruction;
+  GenerateReconstruction(2, 100, &reconstruction);
+  const auto orig_reconstruction = reconstruction;
+
+  BundleAdjustmentOptions options;
+  SchurBundleAdjuster bundle_adjuster(options, CreateConfig(2));
+  ASSERT_TRUE(bundle_adjuster.Solve(&reconstruction));
+
+  const auto summary = bundle_adjuster.Summary();
+  EXPECT_NE(summary.termination_type, ceres::FAILURE);
+  EXPECT_EQ(summary.linear_solver_type_used, ceres::DENSE_SCHUR);
+  EXPECT_LT(summary.final_cost, summary.initial_cost);
+
+  // 100 points, 2 images, 2 residuals per point per image
+  EXPECT_EQ(summary.num_residuals_reduced, 400);
+  // 100 x 3 point parameters
+  // + 5 image parameters (pose of second image)
+  // + 2 x 2 camera parameters
+  EXPECT_EQ(summary.num_effective_parameters_reduced, 309);
+
+  EXPECT_EQ(reconstruction.Image(0).CamFromWorld().rotation.coeffs(),
+            orig_reconstruction.Image(0).CamFromWorld().rotation.coeffs());
+  EXPECT_EQ(reconstruction.Image(0).CamFromWorld().translation,
+            orig_reconstruction.Image(0).CamFromWorld().translation);
+  EXPECT_NE(reconstruction.Image(1).CamFromWorld().rotation.coeffs(),
+            orig_reconstruction.Image(1).CamFromWorld().rotation.coeffs());
+  EXPECT_EQ(reconstruction.Image(1).CamFromWorld().translation.x(),
+            orig_reconstruction.Image(1).CamFromWorld().translation.x());
+  EXPECT_NE(reconstruction.Image(1).CamFromWorld().translation.y(),
+            orig_reconstruction.Image(1).CamFromWorld().translation.y());
+
+  const size_t focal_length_idx = SimpleRadialCameraModel::focal_length_idxs[0];
+  const size_t principal_point_idx =
+      SimpleRadialCameraModel::principal_point_idxs[0];
+  for (const camera_t camera_id : {0, 1}) {
+    EXPECT_NE(reconstruction.Camera(camera_id).params[focal_length_idx],
+              orig_reconstruction.Camera(camera_id).params[focal_length_idx]);
+    EXPECT_EQ(
+        reconstruction.Camera(camera_id).params[principal_point_idx],
+        orig_reconstruction.Camera(camera_id).params[principal_point_idx]);
+  }
+
+  for (const auto& point3D : reconstruction.Points3D()) {
+    EXPECT_NE(point3D.second.xyz,
+              orig_reconstruction.Point3D(point3D.first).xyz);
+  }
+}
+
+TEST(SchurBundleAdjustment, PartiallyContainedTracks) {
+  Reconstruction reconstruction;
+  GenerateReconstruction(3, 100, &reconstruction);
+  const auto variable_point3D_id =
+      reconstruction.Image(2).Point2D(0).point3D_id;
+  reconstruction.DeleteObservation(2, 0);
+  const auto orig_reconstruction = reconstruction;
+
+  BundleAdjustmentConfig config;
+  config.AddImage(0);
+  config.AddImage(1);
+  config.SetConstantCamPose(0);
+  config.SetConstantCamPose(1);
+
+  BundleAdjustmentOptions options;
+  SchurBundleAdjuster bundle_adjuster(options, config);
+  ASSERT_TRUE(bundle_adjuster.Solve(&reconstruction));
+
+  const auto summary = bundle_adjuster.Summary();
+
+  // 100 points, 2 images, 2 residuals per point per image
+  EXPECT_EQ(summary.num_residuals_reduced, 400);
+  // 1 x 3 point parameters
+  // 2 x 2 camera parameters
+  EXPECT_EQ(summary.num_effective_parameters_reduced, 7);
+
+  EXPECT_EQ(reconstruction.Camera(2).params,
+            orig_reconstruction.Camera(2).params);
+  EXPECT_EQ(reconstruction.Image(2).CamFromWorld().translation,
+            orig_reconstruction.Image(2).CamFromWorld().translation);
+  for (const auto& point3D : reconstruction.Points3D()) {
+    if (point3D.first == variable_point3D_id) {
+      EXPECT_NE(point3D.second.xyz,
+                orig_reconstruction.Point3D(point3D.first).xyz);
+    } else {
+      EXPECT_EQ(point3D.second.xyz,
+                orig_reconstruction.Point3D(point3D.first).xyz);
+    }
+  }
+}
+
+TEST(SchurBundleAdjustment, ConstantPointsAndIntrinsics) {
+  Reconstruction reconstruction;
+  GenerateReconstruction(2, 100, &reconstruction);
+  const auto orig_reconstruction = reconstruction;
+
+  BundleAdjustmentConfig config = CreateConfig(2);
+  config.SetConstantCamIntrinsics(0);
+  config.AddConstantPoint(1);
+  config.AddConstantPoint(2);
+
+  BundleAdjustmentOptions options;
+  options.refine_extra_params = false;
+  SchurBundleAdjuster bundle_adjuster(options, config);
+  ASSERT_TRUE(bundle_adjuster.Solve(&reconstruction));
+
+  const auto summary = bundle_adjuster.Summary();
+
+  // 98 x 3 point parameters
+  // + 5 image parameters (pose of second image)
+  // + 1 camera parameter (focal length of second camera)
+  EXPECT_EQ(summary.num_effective_parameters_reduced, 300);
+
+  const size_t focal_length_idx = SimpleRadialCameraModel::focal_length_idxs[0];
+  const size_t extra_param_idx = SimpleRadialCameraModel::extra_params_idxs[0];
+  EXPECT_EQ(reconstruction.Camera(0).params,
+            orig_reconstruction.Camera(0).params);
+  EXPECT_NE(reconstruction.Camera(1).params[focal_length_idx],
+            orig_reconstruction.Camera(1).params[focal_length_idx]);
+  EXPECT_EQ(reconstruction.Camera(1).params[extra_param_idx],
+            orig_reconstruction.Camera(1).params[extra_param_idx]);
+  EXPECT_EQ(reconstruction.Point3D(1).xyz,
+            orig_reconstruction.Point3D(1).xyz);
+  EXPECT_EQ(reconstruction.Point3D(2).xyz,
+            orig_reconstruction.Point3D(2).xyz);
+  EXPECT_NE(reconstruction.Point3D(3).xyz,
+            orig_reconstruction.Point3D(3).xyz);
+}
+
+TEST(SchurBundleAdjustment, EmptyConfig) {
+  Reconstruction reconstruction;
+  GenerateReconstruction(2, 100, &reconstruction);
+
+  BundleAdjustmentOptions options;
+  SchurBundleAdjuster bundle_adjuster(options, BundleAdjustmentConfig());
+  EXPECT_FALSE(bundle_adjuster.Solve(&reconstruction));
+}
+
+TEST(SchurBundleAdjustment, Multithreaded) {
+  Reconstruction reconstruction;
+  GenerateReconstruction(4, 200, &reconstruction);
+  Reconstruction reconstruction_multithreaded = reconstruction;
+
+  BundleAdjustmentOptions options;
+  options.print_summary = false;
+  options.min_num_residuals_for_multi_threading = 0;
+  options.solver_options.num_threads = 1;
+  SchurBundleAdjuster bundle_adjuster(options, CreateConfig(4));
+  ASSERT_TRUE(bundle_adjuster.Solve(&reconstruction));
+
+  options.solver_options.num_threads = 4;
+  SchurBundleAdjuster bundle_adjuster_multithreaded(options, CreateConfig(4));
+  ASSERT_TRUE(bundle_adjuster_multithreaded.Solve(
+      &reconstruction_multithreaded));
+
+  EXPECT_EQ(bundle_adjuster_multithreaded.Summary().num_threads_used, 4);
+  EXPECT_NEAR(bundle_adjuster.Summary().final_cost,
+              bundle_adjuster_multithreaded.Summary().final_cost,
+              1e-6 * bundle_adjuster.Summary().final_cost);
+}
+
+struct SolverTestParams {
+  size_t num_images;
+  BundleAdjustmentOptions::LossFunctionType loss_function_type;
+};
+
+class ParameterizedSchurBundleAdjustmentTests
+    : public ::testing::TestWithParam<SolverTestParams> {};
+
+TEST_P(ParameterizedSchurBundleAdjustmentTests, MatchesCeres) {
+  const SolverTestParams params = GetParam();
+
+  Reconstruction reconstruction;
+  GenerateReconstruction(params.num_images, 100, &reconstruction);
+  Reconstruction ceres_reconstruction = reconstruction;
+
+  BundleAdjustmentOptions options;
+  options.print_summary = false;
+  options.loss_function_type = params.loss_function_type;
+  options.solver_options.max_num_iterations = 30;
+
+  const BundleAdjustmentConfig config = CreateConfig(params.num_images);
+  SchurBundleAdjuster bundle_adjuster(options, config);
+  ASSERT_TRUE(bundle_adjuster.Solve(&reconstruction));
+  BundleAdjuster ceres_bundle_adjuster(options, config);
+  ASSERT_TRUE(ceres_bundle_adjuster.Solve(&ceres_reconstruction));
+
+  const auto& summary = bundle_adjuster.Summary();
+  const auto& ceres_summary = ceres_bundle_adjuster.Summary();
+  EXPECT_NE(summary.termination_type, ceres::FAILURE);
+  EXPECT_EQ(summary.linear_solver_type_used,
+            params.num_images <= 50 ? ceres::DENSE_SCHUR
+                                    : ceres::ITERATIVE_SCHUR);
+  EXPECT_EQ(summary.num_residuals_reduced,
+            ceres_summary.num_residuals_reduced);
+  EXPECT_EQ(summary.num_effective_parameters_reduced,
+            ceres_summary.num_effective_parameters_reduced);
+  EXPECT_NEAR(summary.initial_cost,
+              ceres_summary.initial_cost,
+              1e-8 * ceres_summary.initial_cost);
+  EXPECT_NEAR(summary.final_cost,
+              ceres_summary.final_cost,
+              1e-3 * ceres_summary.final_cost);
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    SchurBundleAdjustment,
+    ParameterizedSchurBundleAdjustmentTests,
+    ::testing::Values(
+        SolverTestParams{3, BundleAdjustmentOptions::LossFunctionType::TRIVIAL},
+        SolverTestParams{10,
+                         BundleAdjustmentOptions::LossFunctionType::CAUCHY},
+        SolverTestParams{120,
+                         BundleAdjustmentOptions::LossFunctionType::TRIVIAL},
+        SolverTestParams{120,
+                         BundleAdjustmentOptions::LossFunctionType::SOFT_L1}));
+
+TEST(SchurBundleAdjustment, BundleAdjusterOption) {
+  Reconstruction reconstruction;
+  GenerateReconstruction(2, 100, &reconstruction);
+
+  BundleAdjustmentOptions options;
+  options.use_schur_solver = true;
+  BundleAdjuster bundle_adjuster(options, CreateConfig(2));
+  ASSERT_TRUE(bundle_adjuster.Solve(&reconstruction));
+  EXPECT_EQ(bundle_adjuster.Problem(), nullptr);
+  EXPECT_EQ(bundle_adjuster.Summary().num_residuals_reduced, 400);
+  EXPECT_EQ(bundle_adjuster.Summary().num_effective_parameters_reduced, 309);
+}
+
+}  // namespace
+}  // namespace colmap
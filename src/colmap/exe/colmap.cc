@@ -101,6 +101,8 @@ int main(int argc, char** argv) {
   commands.emplace_back("database_cleaner", &colmap::RunDatabaseCleaner);
   commands.emplace_back("database_creator", &colmap::RunDatabaseCreator);
   commands.emplace_back("database_merger", &colmap::RunDatabaseMerger);
+  commands.emplace_back("database_shard_merger",
+                        &colmap::RunDatabaseShardMerger);
   commands.emplace_back("delaunay_mesher", &colmap::RunDelaunayMesher);
   commands.emplace_back("exhaustive_matcher", &colmap::RunExhaustiveMatcher);
   commands.emplace_back("feature_extractor", &colmap::RunFeatureExtractor);
@@ -32,6 +32,7 @@
 #include "colmap/controllers/option_manager.h"
 #include "colmap/scene/database.h"
 #include "colmap/util/misc.h"
+#include "colmap/util/timer.h"
 
 namespace colmap {
 
@@ -76,11 +77,26 @@ int RunDatabaseCleaner(int argc, char** argv) {
 }
 
 int RunDatabaseCreator(int argc, char** argv) {
+  std::string blob_encoding = "raw";
+
   OptionManager options;
   options.AddDatabaseOptions();
+  options.AddDefaultOption(
+      "blob_encoding", &blob_encoding, "{raw, packed, packed_lz4}");
   options.Parse(argc, argv);
 
+  StringToLower(&blob_encoding);
   Database database(*options.database_path);
+  if (blob_encoding == "raw") {
+    database.SetBlobEncoding(Database::BlobEncoding::RAW);
+  } else if (blob_encoding == "packed") {
+    database.SetBlobEncoding(Database::BlobEncoding::PACKED);
+  } else if (blob_encoding == "packed_lz4") {
+    database.SetBlobEncoding(Database::BlobEncoding::PACKED_LZ4);
+  } else {
+    LOG(ERROR) << "Invalid blob encoding";
+    return EXIT_FAILURE;
+  }
 
   return EXIT_SUCCESS;
 }
@@ -109,4 +125,29 @@ int RunDatabaseMerger(int argc, char** argv) {
   return EXIT_SUCCESS;
 }
 
+int RunDatabaseShardMerger(int argc, char** argv) {
+  std::string shard_database_paths;
+
+  OptionManager options;
+  options.AddDatabaseOptions();
+  options.AddRequiredOption(
+      "shard_database_paths", &shard_database_paths, "comma-separated list");
+  options.Parse(argc, argv);
+
+  Database database(*options.database_path);
+  for (const auto& shard_database_path :
+       CSVToVector<std::string>(shard_database_paths)) {
+    PrintHeading2("Merging shard " + shard_database_path);
+    Timer timer;
+    timer.Start();
+    database.MergeShard(shard_database_path);
+    LOG(INFO) << StringPrintf(" in %.3fs", timer.ElapsedSeconds());
+  }
+
+  LOG(INFO) << "Matched image pairs: " << database.NumMatchedImagePairs();
+  LOG(INFO) << "Verified image pairs: " << database.NumVerifiedImagePairs();
+
+  return EXIT_SUCCESS;
+}
+
 }  // namespace colmap
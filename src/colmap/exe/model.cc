@@ -591,9 +591,10 @@ int RunModelConverter(int argc, char** argv) {
   OptionManager options;
   options.AddRequiredOption("input_path", &input_path);
   options.AddRequiredOption("output_path", &output_path);
-  options.AddRequiredOption("output_type",
-                            &output_type,
-                            "{BIN, TXT, NVM, Bundler, VRML, PLY, R3D, CAM}");
+  options.AddRequiredOption(
+      "output_type",
+      &output_type,
+      "{BIN, TXT, CHUNKED, NVM, Bundler, VRML, PLY, R3D, CAM}");
   options.AddDefaultOption("skip_distortion", &skip_distortion);
   options.Parse(argc, argv);
 
@@ -605,6 +606,8 @@ int RunModelConverter(int argc, char** argv) {
     reconstruction.WriteBinary(output_path);
   } else if (output_type == "txt") {
     reconstruction.WriteText(output_path);
+  } else if (output_type == "chunked") {
+    reconstruction.WriteChunked(output_path);
   } else if (output_type == "nvm") {
     ExportNVM(reconstruction, output_path, skip_distortion);
   } else if (output_type == "bundler") {
@@ -970,6 +973,16 @@ int RunModelSplitter(int argc, char** argv) {
 
   const bool use_tile_keys = split_type == "tiles";
 
+  // Index the points once, so that each crop only visits the points near its
+  // part instead of all points of the model.
+  double voxel_size = std::numeric_limits<double>::max();
+  for (const auto& bbox : bounds) {
+    voxel_size = std::min(voxel_size, (bbox.second - bbox.first).maxCoeff());
+  }
+  if (num_parts > 1 && voxel_size > 0 && std::isfinite(voxel_size)) {
+    reconstruction.EnablePoints3DSpatialIndex(voxel_size / 2);
+  }
+
   auto SplitReconstruction = [&](const int idx) {
     Reconstruction tile_recon = reconstruction.Crop(bounds[idx]);
     // calculate area covered by model as proportion of box area
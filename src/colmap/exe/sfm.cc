@@ -247,15 +247,16 @@ int RunMapper(int argc, char** argv) {
     mapper.AddCallback(
         IncrementalMapperController::LAST_IMAGE_REG_CALLBACK, [&]() {
           // If the number of reconstructions has not changed, the last model
-          // was discarded for some reason.
-          if (reconstruction_manager->Size() > prev_num_reconstructions) {
+          // was discarded for some reason. When resuming from a checkpoint,
+          // the models finished before the checkpoint are written again.
+          while (reconstruction_manager->Size() > prev_num_reconstructions) {
             const std::string reconstruction_path = JoinPaths(
                 output_path, std::to_string(prev_num_reconstructions));
             CreateDirIfNotExists(reconstruction_path);
             reconstruction_manager->Get(prev_num_reconstructions)
                 ->Write(reconstruction_path);
             options.Write(JoinPaths(reconstruction_path, "project.ini"));
-            prev_num_reconstructions = reconstruction_manager->Size();
+            prev_num_reconstructions += 1;
           }
         });
   }
@@ -95,6 +95,9 @@ std::vector<std::pair<image_t, image_t>> ReadImagePairsText(
 
 bool ExhaustiveMatchingOptions::Check() const {
   CHECK_OPTION_GT(block_size, 1);
+  CHECK_OPTION_GT(num_shards, 0);
+  CHECK_OPTION_GE(shard_index, 0);
+  CHECK_OPTION_LT(shard_index, num_shards);
   return true;
 }
 
@@ -102,6 +105,9 @@ bool VocabTreeMatchingOptions::Check() const {
   CHECK_OPTION_GT(num_images, 0);
   CHECK_OPTION_GT(num_nearest_neighbors, 0);
   CHECK_OPTION_GT(num_checks, 0);
+  CHECK_OPTION_GT(num_shards, 0);
+  CHECK_OPTION_GE(shard_index, 0);
+  CHECK_OPTION_LT(shard_index, num_shards);
   return true;
 }
 
@@ -145,6 +151,19 @@ bool ImagePairsMatchingOptions::Check() const {
 
 bool FeaturePairsMatchingOptions::Check() const { return true; }
 
+int ImagePairShard(const image_t image_id1,
+                   const image_t image_id2,
+                   const int num_shards) {
+  THROW_CHECK_GT(num_shards, 0);
+  // Mix the bits of the pair identifier (splitmix64 finalizer), such that
+  // consecutive pairs are evenly distributed over the shards.
+  uint64_t hash = Database::ImagePairToPairId(image_id1, image_id2);
+  hash = (hash ^ (hash >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  hash = (hash ^ (hash >> 27)) * 0x94d049bb133111ebULL;
+  hash = hash ^ (hash >> 31);
+  return static_cast<int>(hash % static_cast<uint64_t>(num_shards));
+}
+
 std::vector<std::pair<image_t, image_t>> PairGenerator::AllPairs() {
   std::vector<std::pair<image_t, image_t>> image_pairs;
   while (!this->HasFinished()) {
@@ -211,6 +230,12 @@ std::vector<std::pair<image_t, image_t>> ExhaustivePairGenerator::Next() {
       const size_t block_id2 = idx2 % block_size_;
       if ((idx1 > idx2 && block_id1 <= block_id2) ||
           (idx1 < idx2 && block_id1 < block_id2)) {  // Avoid duplicate pairs
+        if (options_.num_shards > 1 &&
+            ImagePairShard(image_ids_[idx1],
+                           image_ids_[idx2],
+                           options_.num_shards) != options_.shard_index) {
+          continue;
+        }
         image_pairs_.emplace_back(image_ids_[idx1], image_ids_[idx2]);
       }
     }
@@ -270,6 +295,12 @@ VocabTreePairGenerator::VocabTreePairGenerator(
     }
   }
 
+  if (options_.num_shards > 1) {
+    LOG(INFO) << StringPrintf("Matching the image pairs of shard %d/%d",
+                              options_.shard_index + 1,
+                              options_.num_shards);
+  }
+
   IndexImages(all_image_ids);
 
   query_options_.max_num_images = options_.num_images;
@@ -331,9 +362,16 @@ std::vector<std::pair<image_t, image_t>> VocabTreePairGenerator::Next() {
   const auto& image_id = retrieval.Data().image_id;
   const auto& image_scores = retrieval.Data().image_scores;
 
-  // Compose the image pairs from the scores.
+  // Compose the image pairs from the scores. When sharding, every image is
+  // queried and the pairs are assigned to shards by their unordered
+  // identifier, such that (A, B) and (B, A) fall into the same shard.
   image_pairs_.reserve(image_scores.size());
   for (const auto image_score : image_scores) {
+    if (options_.num_shards > 1 &&
+        ImagePairShard(image_id, image_score.image_id, options_.num_shards) !=
+            options_.shard_index) {
+      continue;
+    }
     image_pairs_.emplace_back(image_id, image_score.image_id);
   }
   ++result_idx_;
@@ -41,6 +41,12 @@ struct ExhaustiveMatchingOptions {
   // Block size, i.e. number of images to simultaneously load into memory.
   int block_size = 50;
 
+  // Only match the image pairs of the given shard out of `num_shards`, e.g.,
+  // to distribute matching over multiple nodes. Image pairs are assigned to
+  // shards deterministically using `ImagePairShard`.
+  int shard_index = 0;
+  int num_shards = 1;
+
   bool Check() const;
 };
 
@@ -71,6 +77,13 @@ struct VocabTreeMatchingOptions {
   // Number of threads for indexing and retrieval.
   int num_threads = -1;
 
+  // Only match the image pairs of the given shard out of `num_shards`, e.g.,
+  // to distribute matching over multiple nodes. All query images are
+  // retrieved in every shard and the retrieved image pairs are assigned to
+  // shards deterministically using `ImagePairShard`.
+  int shard_index = 0;
+  int num_shards = 1;
+
   bool Check() const;
 };
 
@@ -160,6 +173,11 @@ struct FeaturePairsMatchingOptions {
   bool Check() const;
 };
 
+// Deterministically assign an unordered image pair to one of `num_shards`
+// shards. The assignment only depends on the image identifiers and is thus
+// consistent across processes.
+int ImagePairShard(image_t image_id1, image_t image_id2, int num_shards);
+
 class PairGenerator {
  public:
   virtual ~PairGenerator() = default;
@@ -30,12 +30,123 @@
 #include "colmap/scene/correspondence_graph.h"
 
 #include "colmap/geometry/pose.h"
+#include "colmap/util/misc.h"
 #include "colmap/util/string.h"
 
-#include <map>
-#include <set>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <queue>
 
 namespace colmap {
+namespace {
+
+// Buffered sequential reader of the records in a binary file.
+template <typename T>
+class BinaryRecordReader {
+ public:
+  explicit BinaryRecordReader(const std::string& path,
+                              const size_t buffer_size = 1 << 16)
+      : file_(path, std::ios::binary), buffer_(buffer_size) {
+    THROW_CHECK_FILE_OPEN(file_, path);
+  }
+
+  // Read the next record and return false at the end of the file.
+  bool Next(T* record) {
+    if (pos_ == size_) {
+      file_.read(reinterpret_cast<char*>(buffer_.data()),
+                 buffer_.size() * sizeof(T));
+      size_ = file_.gcount() / sizeof(T);
+      pos_ = 0;
+      if (size_ == 0) {
+        return false;
+      }
+    }
+    *record = buffer_[pos_++];
+    return true;
+  }
+
+ private:
+  std::ifstream file_;
+  std::vector<T> buffer_;
+  size_t pos_ = 0;
+  size_t size_ = 0;
+};
+
+// Set of image observations that is used to find duplicates when collecting
+// transitive correspondences. The set is implemented as an open addressing
+// hash table whose slots are stamped with the generation in which they were
+// filled, such that clearing the set only increments the generation and the
+// memory can be reused across queries without reallocation.
+class ObservationSet {
+ public:
+  void Clear() {
+    size_ = 0;
+    generation_ += 1;
+    if (generation_ == 0) {
+      // Reset the slots after the generation wrapped around.
+      std::fill(slots_.begin(), slots_.end(), Slot());
+      generation_ = 1;
+    }
+  }
+
+  // Insert the observation and return whether it was not contained before.
+  bool Insert(const image_t image_id, const point2D_t point2D_idx) {
+    if (2 * (size_ + 1) > slots_.size()) {
+      Grow();
+    }
+    const uint64_t key = (static_cast<uint64_t>(image_id) << 32) |
+                         static_cast<uint64_t>(point2D_idx);
+    return InsertKey(key);
+  }
+
+ private:
+  struct Slot {
+    uint64_t key = 0;
+    uint32_t generation = 0;
+  };
+
+  bool InsertKey(const uint64_t key) {
+    // Fibonacci hashing of the key to the number of slots.
+    const size_t mask = slots_.size() - 1;
+    size_t idx = (key * 0x9E3779B97F4A7C15ull) >> (64 - num_slots_bits_);
+    while (slots_[idx].generation == generation_) {
+      if (slots_[idx].key == key) {
+        return false;
+      }
+      idx = (idx + 1) & mask;
+    }
+    slots_[idx].key = key;
+    slots_[idx].generation = generation_;
+    size_ += 1;
+    return true;
+  }
+
+  void Grow() {
+    std::vector<Slot> prev_slots(std::max<size_t>(64, 2 * slots_.size()));
+    prev_slots.swap(slots_);
+    num_slots_bits_ = 0;
+    while ((size_t(1) << num_slots_bits_) < slots_.size()) {
+      num_slots_bits_ += 1;
+    }
+    size_ = 0;
+    const uint32_t prev_generation = generation_;
+    generation_ = 1;
+    for (const Slot& slot : prev_slots) {
+      if (slot.generation == prev_generation) {
+        InsertKey(slot.key);
+      }
+    }
+  }
+
+  std::vector<Slot> slots_;
+  int num_slots_bits_ = 0;
+  size_t size_ = 0;
+  uint32_t generation_ = 1;
+};
+
+}  // namespace
 
 std::unordered_map<image_pair_t, point2D_t>
 CorrespondenceGraph::NumCorrespondencesBetweenImages() const {
@@ -48,10 +159,36 @@ CorrespondenceGraph::NumCorrespondencesBetweenImages() const {
   return num_corrs_between_images;
 }
 
-void CorrespondenceGraph::Finalize() {
+CorrespondenceGraph::OutOfCoreStorage::~OutOfCoreStorage() {
+  node_corr_begs_file.reset();
+  corr_nodes_file.reset();
+  for (const auto& run_path : run_paths) {
+    std::remove(run_path.c_str());
+  }
+  std::remove(path.c_str());
+  std::remove((path + ".idx").c_str());
+}
+
+void CorrespondenceGraph::SetOutOfCore(const std::string& path,
+                                       const size_t max_num_buffered_corrs) {
+  THROW_CHECK(!finalized_);
+  THROW_CHECK(images_.empty());
+  THROW_CHECK(!path.empty());
+  THROW_CHECK_GT(max_num_buffered_corrs, 0);
+  out_of_core_ = std::make_shared<OutOfCoreStorage>();
+  out_of_core_->path = path;
+  out_of_core_->max_num_buffered_corrs = max_num_buffered_corrs;
+}
+
+void CorrespondenceGraph::Finalize(const bool compact_layout) {
   THROW_CHECK(!finalized_);
   finalized_ = true;
 
+  if (out_of_core_) {
+    FinalizeOutOfCore();
+    return;
+  }
+
   // Flatten all correspondences, remove images without observations.
   for (auto it = images_.begin(); it != images_.end();) {
     // Count number of correspondences and observations.
@@ -91,12 +228,247 @@ void CorrespondenceGraph::Finalize() {
 
     ++it;
   }
+
+  if (compact_layout) {
+    MakeCompactLayout();
+  }
+}
+
+size_t CorrespondenceGraph::NumImagePoints() const {
+  size_t num_nodes = 0;
+  for (const auto& image : images_) {
+    num_nodes += image.second.num_points2D;
+  }
+  return num_nodes;
+}
+
+void CorrespondenceGraph::MakeCompactImageLayout() {
+  CompactLayout& layout = compact_layout_;
+
+  layout.image_ids.reserve(images_.size());
+  image_t max_image_id = 0;
+  for (const auto& image : images_) {
+    layout.image_ids.push_back(image.first);
+    max_image_id = std::max(max_image_id, image.first);
+  }
+  std::sort(layout.image_ids.begin(), layout.image_ids.end());
+
+  const size_t num_images = layout.image_ids.size();
+  layout.image_idxs.resize(max_image_id + 1, kInvalidImageIdx);
+  layout.image_node_begs.resize(num_images + 1);
+  layout.image_corr_begs.resize(num_images + 1);
+  layout.image_node_begs[0] = 0;
+  layout.image_corr_begs[0] = 0;
+  for (size_t image_idx = 0; image_idx < num_images; ++image_idx) {
+    const image_t image_id = layout.image_ids[image_idx];
+    const Image& image = images_.at(image_id);
+    layout.image_idxs[image_id] = image_idx;
+    layout.image_node_begs[image_idx + 1] =
+        layout.image_node_begs[image_idx] + image.num_points2D;
+    layout.image_corr_begs[image_idx + 1] =
+        layout.image_corr_begs[image_idx] + image.num_correspondences;
+  }
+
+  layout.node_image_idxs.resize(layout.image_node_begs.back());
+  for (size_t image_idx = 0; image_idx < num_images; ++image_idx) {
+    const auto node_image_idxs_beg = layout.node_image_idxs.begin();
+    std::fill(node_image_idxs_beg + layout.image_node_begs[image_idx],
+              node_image_idxs_beg + layout.image_node_begs[image_idx + 1],
+              static_cast<uint32_t>(image_idx));
+  }
+}
+
+void CorrespondenceGraph::MakeCompactLayout() {
+  const size_t num_nodes = NumImagePoints();
+  if (num_nodes > std::numeric_limits<uint32_t>::max()) {
+    LOG(WARNING) << "Too many image points (" << num_nodes
+                 << ") for compact correspondence graph layout, "
+                    "falling back to default layout.";
+    return;
+  }
+
+  MakeCompactImageLayout();
+
+  CompactLayout& layout = compact_layout_;
+  const size_t num_images = layout.image_ids.size();
+  const size_t num_corrs = layout.image_corr_begs.back();
+
+  // Translate the correspondences to global indices and deallocate the
+  // per-image data.
+  layout.node_corr_begs.reserve(num_nodes + num_images);
+  layout.corr_nodes.reserve(num_corrs);
+  for (const image_t image_id : layout.image_ids) {
+    Image& image = images_.at(image_id);
+    layout.node_corr_begs.insert(layout.node_corr_begs.end(),
+                                 image.flat_corr_begs.begin(),
+                                 image.flat_corr_begs.end());
+    for (const Correspondence& corr : image.flat_corrs) {
+      layout.corr_nodes.push_back(
+          layout.image_node_begs[layout.image_idxs[corr.image_id]] +
+          corr.point2D_idx);
+    }
+    image.flat_corrs.clear();
+    image.flat_corrs.shrink_to_fit();
+    image.flat_corr_begs.clear();
+    image.flat_corr_begs.shrink_to_fit();
+  }
+
+  THROW_CHECK_EQ(layout.node_corr_begs.size(), num_nodes + num_images);
+  THROW_CHECK_EQ(layout.corr_nodes.size(), num_corrs);
+
+  compact_ = true;
+}
+
+void CorrespondenceGraph::SpillOutOfCoreCorrespondences() {
+  OutOfCoreStorage& storage = *out_of_core_;
+  if (storage.buffered_corrs.empty()) {
+    return;
+  }
+
+  // The sort must be stable to keep the correspondences of each image point
+  // in the order in which they were added.
+  std::stable_sort(storage.buffered_corrs.begin(),
+                   storage.buffered_corrs.end(),
+                   [](const OutOfCoreCorrespondence& corr1,
+                      const OutOfCoreCorrespondence& corr2) {
+                     return std::make_pair(corr1.image_id1,
+                                           corr1.point2D_idx1) <
+                            std::make_pair(corr2.image_id1,
+                                           corr2.point2D_idx1);
+                   });
+
+  const std::string run_path =
+      storage.path + ".run" + std::to_string(storage.run_paths.size());
+  std::ofstream file(run_path, std::ios::binary);
+  THROW_CHECK_FILE_OPEN(file, run_path);
+  storage.run_paths.push_back(run_path);
+  file.write(reinterpret_cast<const char*>(storage.buffered_corrs.data()),
+             storage.buffered_corrs.size() * sizeof(OutOfCoreCorrespondence));
+  THROW_CHECK(file.good()) << "Could not write file: " << run_path;
+
+  storage.buffered_corrs.clear();
+}
+
+void CorrespondenceGraph::FinalizeOutOfCore() {
+  OutOfCoreStorage& storage = *out_of_core_;
+  SpillOutOfCoreCorrespondences();
+  storage.buffered_corrs.shrink_to_fit();
+
+  // Remove images without correspondences, as they are useless for SfM.
+  for (auto it = images_.begin(); it != images_.end();) {
+    if (it->second.num_correspondences == 0) {
+      it = images_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  THROW_CHECK_LE(NumImagePoints(), std::numeric_limits<uint32_t>::max())
+      << "Too many image points for out-of-core correspondence graph";
+
+  MakeCompactImageLayout();
+
+  CompactLayout& layout = compact_layout_;
+
+  // Merge the sorted runs, where ties are resolved in favor of earlier runs
+  // to keep the order in which the correspondences were added.
+  std::vector<BinaryRecordReader<OutOfCoreCorrespondence>> runs;
+  runs.reserve(storage.run_paths.size());
+  for (const auto& run_path : storage.run_paths) {
+    runs.emplace_back(run_path);
+  }
+
+  using RunHead = std::pair<std::pair<image_t, point2D_t>, size_t>;
+  std::priority_queue<RunHead, std::vector<RunHead>, std::greater<RunHead>>
+      run_heads;
+  std::vector<OutOfCoreCorrespondence> run_corrs(runs.size());
+  auto PushRunHead = [&](const size_t run_idx) {
+    if (runs[run_idx].Next(&run_corrs[run_idx])) {
+      const OutOfCoreCorrespondence& corr = run_corrs[run_idx];
+      run_heads.emplace(std::make_pair(corr.image_id1, corr.point2D_idx1),
+                        run_idx);
+    }
+  };
+  for (size_t run_idx = 0; run_idx < runs.size(); ++run_idx) {
+    PushRunHead(run_idx);
+  }
+
+  const std::string node_corr_begs_path = storage.path + ".idx";
+  std::ofstream node_corr_begs_file(node_corr_begs_path, std::ios::binary);
+  THROW_CHECK_FILE_OPEN(node_corr_begs_file, node_corr_begs_path);
+  std::ofstream corr_nodes_file(storage.path, std::ios::binary);
+  THROW_CHECK_FILE_OPEN(corr_nodes_file, storage.path);
+
+  // The merged correspondences are ordered by image and point, such that the
+  // images can be written one after the other.
+  std::vector<point2D_t> node_corr_begs;
+  std::vector<uint32_t> corr_nodes;
+  for (const image_t image_id : layout.image_ids) {
+    Image& image = images_.at(image_id);
+
+    node_corr_begs.assign(image.num_points2D + 1, 0);
+    corr_nodes.clear();
+    corr_nodes.reserve(image.num_correspondences);
+    for (point2D_t i = 0; i < image.num_correspondences; ++i) {
+      THROW_CHECK(!run_heads.empty());
+      const size_t run_idx = run_heads.top().second;
+      run_heads.pop();
+      const OutOfCoreCorrespondence& corr = run_corrs[run_idx];
+      THROW_CHECK_EQ(corr.image_id1, image_id);
+      node_corr_begs[corr.point2D_idx1 + 1] += 1;
+      corr_nodes.push_back(
+          layout.image_node_begs[layout.image_idxs[corr.image_id2]] +
+          corr.point2D_idx2);
+      PushRunHead(run_idx);
+    }
+
+    image.num_observations = 0;
+    for (point2D_t point2D_idx = 0; point2D_idx < image.num_points2D;
+         ++point2D_idx) {
+      if (node_corr_begs[point2D_idx + 1] > 0) {
+        image.num_observations += 1;
+      }
+      node_corr_begs[point2D_idx + 1] += node_corr_begs[point2D_idx];
+    }
+
+    node_corr_begs_file.write(
+        reinterpret_cast<const char*>(node_corr_begs.data()),
+        node_corr_begs.size() * sizeof(point2D_t));
+    corr_nodes_file.write(reinterpret_cast<const char*>(corr_nodes.data()),
+                          corr_nodes.size() * sizeof(uint32_t));
+  }
+
+  THROW_CHECK(run_heads.empty());
+  THROW_CHECK(node_corr_begs_file.good())
+      << "Could not write file: " << node_corr_begs_path;
+  THROW_CHECK(corr_nodes_file.good())
+      << "Could not write file: " << storage.path;
+  node_corr_begs_file.close();
+  corr_nodes_file.close();
+
+  // Remove the merged runs.
+  runs.clear();
+  for (const auto& run_path : storage.run_paths) {
+    std::remove(run_path.c_str());
+  }
+  storage.run_paths.clear();
+
+  storage.node_corr_begs_file = std::make_unique<MappedFile>(
+      node_corr_begs_path, /*sequential=*/false);
+  storage.corr_nodes_file =
+      std::make_unique<MappedFile>(storage.path, /*sequential=*/false);
+
+  compact_ = true;
 }
 
 void CorrespondenceGraph::AddImage(const image_t image_id,
                                    const size_t num_points) {
   THROW_CHECK(!ExistsImage(image_id));
-  images_[image_id].corrs.resize(num_points);
+  struct Image& image = images_[image_id];
+  image.num_points2D = num_points;
+  if (!out_of_core_) {
+    image.corrs.resize(num_points);
+  }
 }
 
 void CorrespondenceGraph::AddCorrespondences(const image_t image_id1,
@@ -112,6 +484,17 @@ void CorrespondenceGraph::AddCorrespondences(const image_t image_id1,
   struct Image& image1 = images_.at(image_id1);
   struct Image& image2 = images_.at(image_id2);
 
+  // The out-of-core graph can only detect duplicates within the given matches,
+  // so each image pair must only be added once.
+  std::vector<bool> has_corrs1;
+  std::vector<bool> has_corrs2;
+  if (out_of_core_) {
+    THROW_CHECK_EQ(NumCorrespondencesBetweenImages(image_id1, image_id2), 0)
+        << "Image pair can only be added once to out-of-core graph";
+    has_corrs1.resize(image1.num_points2D, false);
+    has_corrs2.resize(image2.num_points2D, false);
+  }
+
   // Store number of correspondences for each image to find good initial pair.
   image1.num_correspondences += matches.size();
   image2.num_correspondences += matches.size();
@@ -129,25 +512,31 @@ void CorrespondenceGraph::AddCorrespondences(const image_t image_id1,
   // observation is triangulated.
 
   for (const auto& match : matches) {
-    const bool valid_idx1 = match.point2D_idx1 < image1.corrs.size();
-    const bool valid_idx2 = match.point2D_idx2 < image2.corrs.size();
+    const bool valid_idx1 = match.point2D_idx1 < image1.num_points2D;
+    const bool valid_idx2 = match.point2D_idx2 < image2.num_points2D;
 
     if (valid_idx1 && valid_idx2) {
-      auto& corrs1 = image1.corrs[match.point2D_idx1];
-      auto& corrs2 = image2.corrs[match.point2D_idx2];
-
-      const bool duplicate1 =
-          std::find_if(corrs1.begin(),
-                       corrs1.end(),
-                       [image_id2](const Correspondence& corr) {
-                         return corr.image_id == image_id2;
-                       }) != corrs1.end();
-      const bool duplicate2 =
-          std::find_if(corrs2.begin(),
-                       corrs2.end(),
-                       [image_id1](const Correspondence& corr) {
-                         return corr.image_id == image_id1;
-                       }) != corrs2.end();
+      std::vector<Correspondence>* corrs1 = nullptr;
+      std::vector<Correspondence>* corrs2 = nullptr;
+      bool duplicate1 = false;
+      bool duplicate2 = false;
+      if (out_of_core_) {
+        duplicate1 = has_corrs1[match.point2D_idx1];
+        duplicate2 = has_corrs2[match.point2D_idx2];
+      } else {
+        corrs1 = &image1.corrs[match.point2D_idx1];
+        corrs2 = &image2.corrs[match.point2D_idx2];
+        duplicate1 = std::find_if(corrs1->begin(),
+                                  corrs1->end(),
+                                  [image_id2](const Correspondence& corr) {
+                                    return corr.image_id == image_id2;
+                                  }) != corrs1->end();
+        duplicate2 = std::find_if(corrs2->begin(),
+                                  corrs2->end(),
+                                  [image_id1](const Correspondence& corr) {
+                                    return corr.image_id == image_id1;
+                                  }) != corrs2->end();
+      }
 
       if (duplicate1 || duplicate2) {
         image1.num_correspondences -= 1;
@@ -161,9 +550,20 @@ void CorrespondenceGraph::AddCorrespondences(const image_t image_id1,
             image_id1,
             match.point2D_idx2,
             image_id2);
+      } else if (out_of_core_) {
+        has_corrs1[match.point2D_idx1] = true;
+        has_corrs2[match.point2D_idx2] = true;
+        auto& buffered_corrs = out_of_core_->buffered_corrs;
+        buffered_corrs.push_back(
+            {image_id1, match.point2D_idx1, image_id2, match.point2D_idx2});
+        buffered_corrs.push_back(
+            {image_id2, match.point2D_idx2, image_id1, match.point2D_idx1});
+        if (buffered_corrs.size() >= out_of_core_->max_num_buffered_corrs) {
+          SpillOutOfCoreCorrespondences();
+        }
       } else {
-        corrs1.emplace_back(image_id2, match.point2D_idx2);
-        corrs2.emplace_back(image_id1, match.point2D_idx1);
+        corrs1->emplace_back(image_id2, match.point2D_idx2);
+        corrs2->emplace_back(image_id1, match.point2D_idx1);
       }
     } else {
       image1.num_correspondences -= 1;
@@ -189,13 +589,31 @@ CorrespondenceGraph::CorrespondenceRange
 CorrespondenceGraph::FindCorrespondences(const image_t image_id,
                                          const point2D_t point2D_idx) const {
   THROW_CHECK(finalized_);
+  if (compact_) {
+    const CompactLayout& layout = compact_layout_;
+    THROW_CHECK_LT(image_id, layout.image_idxs.size());
+    const uint32_t image_idx = layout.image_idxs[image_id];
+    THROW_CHECK_NE(image_idx, kInvalidImageIdx);
+    const uint32_t node_beg = layout.image_node_begs[image_idx];
+    THROW_CHECK_LT(point2D_idx,
+                   layout.image_node_begs[image_idx + 1] - node_beg);
+    const point2D_t* corr_begs =
+        NodeCorrBegs() + node_beg + image_idx + point2D_idx;
+    const uint32_t* corr_nodes =
+        CorrNodes() + layout.image_corr_begs[image_idx];
+    return CorrespondenceRange{
+        CorrespondenceIterator(this, corr_nodes + corr_begs[0]),
+        CorrespondenceIterator(this, corr_nodes + corr_begs[1])};
+  }
+
   const point2D_t next_point2D_idx = point2D_idx + 1;
   const Image& image = images_.at(image_id);
   const Correspondence* beg =
       image.flat_corrs.data() + image.flat_corr_begs.at(point2D_idx);
   const Correspondence* end =
       image.flat_corrs.data() + image.flat_corr_begs.at(next_point2D_idx);
-  return CorrespondenceRange{beg, end};
+  return CorrespondenceRange{CorrespondenceIterator(beg),
+                             CorrespondenceIterator(end)};
 }
 
 void CorrespondenceGraph::ExtractCorrespondences(
@@ -205,7 +623,7 @@ void CorrespondenceGraph::ExtractCorrespondences(
   const auto range = FindCorrespondences(image_id, point2D_idx);
   corrs->clear();
   corrs->reserve(range.end - range.beg);
-  for (const Correspondence* corr = range.beg; corr < range.end; ++corr) {
+  for (auto corr = range.beg; corr < range.end; ++corr) {
     corrs->push_back(*corr);
   }
 }
@@ -228,8 +646,11 @@ void CorrespondenceGraph::ExtractTransitiveCorrespondences(
   // Push requested image point on queue to visit. Will be removed later.
   corrs->emplace_back(image_id, point2D_idx);
 
-  std::map<image_t, std::set<point2D_t>> image_corrs;
-  image_corrs[image_id].insert(point2D_idx);
+  // The set of collected observations is reused across calls of the same
+  // thread to avoid memory allocations on this hot path.
+  thread_local ObservationSet image_corrs;
+  image_corrs.Clear();
+  image_corrs.Insert(image_id, point2D_idx);
 
   size_t corr_queue_beg = 0;
   size_t corr_queue_end = 1;
@@ -241,12 +662,10 @@ void CorrespondenceGraph::ExtractTransitiveCorrespondences(
       const Correspondence ref_corr = (*corrs)[i];
       const CorrespondenceRange ref_corr_range =
           FindCorrespondences(ref_corr.image_id, ref_corr.point2D_idx);
-      for (const Correspondence* corr = ref_corr_range.beg;
-           corr < ref_corr_range.end;
+      for (auto corr = ref_corr_range.beg; corr < ref_corr_range.end;
            ++corr) {
         // Check if correspondence already collected, otherwise collect.
-        auto& corr_image_corrs = image_corrs[corr->image_id];
-        if (corr_image_corrs.insert(corr->point2D_idx).second) {
+        if (image_corrs.Insert(corr->image_id, corr->point2D_idx)) {
           corrs->emplace_back(corr->image_id, corr->point2D_idx);
         }
       }
@@ -281,13 +700,19 @@ FeatureMatches CorrespondenceGraph::FindCorrespondencesBetweenImages(
   FeatureMatches corrs;
   corrs.reserve(num_correspondences);
 
-  const point2D_t num_points2D1 =
-      images_.at(image_id1).flat_corr_begs.size() - 1;
+  point2D_t num_points2D1 = 0;
+  if (compact_) {
+    const uint32_t image_idx1 = compact_layout_.image_idxs.at(image_id1);
+    num_points2D1 = compact_layout_.image_node_begs[image_idx1 + 1] -
+                    compact_layout_.image_node_begs[image_idx1];
+  } else {
+    num_points2D1 = images_.at(image_id1).flat_corr_begs.size() - 1;
+  }
   for (point2D_t point2D_idx1 = 0; point2D_idx1 < num_points2D1;
        ++point2D_idx1) {
     const CorrespondenceRange range =
         FindCorrespondences(image_id1, point2D_idx1);
-    for (const Correspondence* corr = range.beg; corr < range.end; ++corr) {
+    for (auto corr = range.beg; corr < range.end; ++corr) {
       if (corr->image_id == image_id2) {
         corrs.emplace_back(point2D_idx1, corr->point2D_idx);
       }
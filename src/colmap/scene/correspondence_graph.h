@@ -30,8 +30,14 @@
 #pragma once
 
 #include "colmap/scene/database.h"
+#include "colmap/util/mapped_file.h"
 #include "colmap/util/types.h"
 
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
@@ -54,10 +60,41 @@ class CorrespondenceGraph {
     point2D_t point2D_idx;
   };
 
+  // Iterator over the correspondences of an image observation. Depending on
+  // the layout of the graph, the correspondences are either read directly or
+  // decoded from the global index of the corresponding image observation.
+  class CorrespondenceIterator {
+   public:
+    CorrespondenceIterator() = default;
+    explicit CorrespondenceIterator(const Correspondence* corr) : corr_(corr) {}
+    CorrespondenceIterator(const CorrespondenceGraph* graph,
+                           const uint32_t* node)
+        : graph_(graph), node_(node) {}
+
+    inline const Correspondence& operator*() const;
+    inline const Correspondence* operator->() const;
+
+    inline CorrespondenceIterator& operator++();
+    inline CorrespondenceIterator operator++(int);
+    inline std::ptrdiff_t operator-(const CorrespondenceIterator& other) const;
+    inline bool operator==(const CorrespondenceIterator& other) const;
+    inline bool operator!=(const CorrespondenceIterator& other) const;
+    inline bool operator<(const CorrespondenceIterator& other) const;
+
+   private:
+    const Correspondence* corr_ = nullptr;
+    const CorrespondenceGraph* graph_ = nullptr;
+    const uint32_t* node_ = nullptr;
+    // The last decoded correspondence, such that repeated member accesses
+    // of the same correspondence are only decoded once.
+    mutable const uint32_t* decoded_node_ = nullptr;
+    mutable Correspondence decoded_corr_;
+  };
+
   // Range of correspondences from [beg, end). Empty if beg == end.
   struct CorrespondenceRange {
-    const Correspondence* beg = nullptr;
-    const Correspondence* end = nullptr;
+    CorrespondenceIterator beg;
+    CorrespondenceIterator end;
   };
 
   CorrespondenceGraph() = default;
@@ -92,7 +129,30 @@ class CorrespondenceGraph {
   //   of image points that have at least one correspondence.
   // - Deletes images without observations, as they are useless for SfM.
   // - Shrinks the correspondence vectors to their size to save memory.
-  void Finalize();
+  //
+  // With the compact layout, the image points of all images are numbered
+  // globally and the correspondences of all image points are stored in a
+  // single array of global 32-bit indices with offsets per image point. This
+  // roughly halves the memory of the graph and avoids hash lookups when
+  // finding correspondences, at the cost of decoding the corresponding image
+  // and point from the global index through a per-point image index. Graphs
+  // with more than 2^32 image points fall back to the default layout.
+  void Finalize(bool compact_layout = false);
+
+  // Whether the graph was finalized with the compact layout.
+  inline bool HasCompactLayout() const;
+
+  // Store the correspondences out of core in memory-mapped files, for graphs
+  // that exceed the available memory. Must be called before adding images.
+  // Added correspondences are buffered and spilled to sorted runs on disk in
+  // chunks of at most max_num_buffered_corrs, which are merged in Finalize()
+  // into the files at path and path + ".idx" in the compact layout. All files
+  // are removed with the graph. Each image pair can only be added once.
+  void SetOutOfCore(const std::string& path,
+                    size_t max_num_buffered_corrs = 1 << 24);
+
+  // Whether the correspondences are stored out of core.
+  inline bool IsOutOfCore() const;
 
   // Add new image to the correspondence graph.
   void AddImage(image_t image_id, size_t num_points2D);
@@ -141,7 +201,35 @@ class CorrespondenceGraph {
   bool IsTwoViewObservation(image_t image_id, point2D_t point2D_idx) const;
 
  private:
+  // Decode the image and point of a global image point index in the compact
+  // layout.
+  inline Correspondence DecodeNode(uint32_t node) const;
+
+  // Total number of image points of all images.
+  size_t NumImagePoints() const;
+
+  // Initialize the per-image arrays of the compact layout.
+  void MakeCompactImageLayout();
+
+  // Convert the finalized per-image layout to the compact layout.
+  void MakeCompactLayout();
+
+  // Write the buffered out-of-core correspondences as a sorted run to disk.
+  void SpillOutOfCoreCorrespondences();
+
+  // Merge the sorted runs of out-of-core correspondences into the compact
+  // layout and map it from disk.
+  void FinalizeOutOfCore();
+
+  // The correspondence arrays of the compact layout, either in memory or
+  // mapped from disk.
+  inline const point2D_t* NodeCorrBegs() const;
+  inline const uint32_t* CorrNodes() const;
+
   struct Image {
+    // Number of 2D points in the image.
+    point2D_t num_points2D = 0;
+
     // Number of 2D points with at least one correspondence to another image.
     point2D_t num_observations = 0;
 
@@ -169,12 +257,118 @@ class CorrespondenceGraph {
   bool finalized_ = false;
   std::unordered_map<image_t, Image> images_;
   std::unordered_map<image_pair_t, ImagePair> image_pairs_;
+
+  // The compact layout, in which the images are ordered by their identifiers.
+  struct CompactLayout {
+    // Index of each image identifier in the ordered images, or
+    // kInvalidImageIdx for identifiers of images that do not exist.
+    std::vector<uint32_t> image_idxs;
+    // The identifier of each ordered image.
+    std::vector<image_t> image_ids;
+    // Global index of the first point of each ordered image. The last element
+    // is the total number of image points.
+    std::vector<uint32_t> image_node_begs;
+    // Index of the ordered image of each global image point, which decodes
+    // the global index in constant time.
+    std::vector<uint32_t> node_image_idxs;
+    // Beginning of the correspondences of each ordered image.
+    std::vector<size_t> image_corr_begs;
+    // For each image point, the beginning of its correspondences relative to
+    // the beginning of its image. The points of image i with first global
+    // index n are stored at [n + i, n + i + num_points2D], where the last
+    // element is the number of correspondences of the image.
+    std::vector<point2D_t> node_corr_begs;
+    // Global indices of the corresponding points.
+    std::vector<uint32_t> corr_nodes;
+  };
+
+  static constexpr uint32_t kInvalidImageIdx =
+      std::numeric_limits<uint32_t>::max();
+
+  bool compact_ = false;
+  CompactLayout compact_layout_;
+
+  // A correspondence of the out-of-core graph before Finalize().
+  struct OutOfCoreCorrespondence {
+    image_t image_id1;
+    point2D_t point2D_idx1;
+    image_t image_id2;
+    point2D_t point2D_idx2;
+  };
+
+  // Files of the out-of-core graph, shared between copies of the graph.
+  struct OutOfCoreStorage {
+    ~OutOfCoreStorage();
+
+    std::string path;
+    size_t max_num_buffered_corrs = 0;
+    std::vector<OutOfCoreCorrespondence> buffered_corrs;
+    std::vector<std::string> run_paths;
+    std::unique_ptr<MappedFile> node_corr_begs_file;
+    std::unique_ptr<MappedFile> corr_nodes_file;
+  };
+
+  std::shared_ptr<OutOfCoreStorage> out_of_core_;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
 // Implementation
 ////////////////////////////////////////////////////////////////////////////////
 
+const CorrespondenceGraph::Correspondence&
+CorrespondenceGraph::CorrespondenceIterator::operator*() const {
+  if (node_ == nullptr) {
+    return *corr_;
+  }
+  if (decoded_node_ != node_) {
+    decoded_corr_ = graph_->DecodeNode(*node_);
+    decoded_node_ = node_;
+  }
+  return decoded_corr_;
+}
+
+const CorrespondenceGraph::Correspondence*
+CorrespondenceGraph::CorrespondenceIterator::operator->() const {
+  return &**this;
+}
+
+CorrespondenceGraph::CorrespondenceIterator&
+CorrespondenceGraph::CorrespondenceIterator::operator++() {
+  if (node_ == nullptr) {
+    ++corr_;
+  } else {
+    ++node_;
+  }
+  return *this;
+}
+
+CorrespondenceGraph::CorrespondenceIterator
+CorrespondenceGraph::CorrespondenceIterator::operator++(int) {
+  CorrespondenceIterator prev = *this;
+  ++(*this);
+  return prev;
+}
+
+std::ptrdiff_t CorrespondenceGraph::CorrespondenceIterator::operator-(
+    const CorrespondenceIterator& other) const {
+  return node_ == nullptr ? corr_ - other.corr_ : node_ - other.node_;
+}
+
+bool CorrespondenceGraph::CorrespondenceIterator::operator==(
+    const CorrespondenceIterator& other) const {
+  return corr_ == other.corr_ && node_ == other.node_;
+}
+
+bool CorrespondenceGraph::CorrespondenceIterator::operator!=(
+    const CorrespondenceIterator& other) const {
+  return !(*this == other);
+}
+
+bool CorrespondenceGraph::CorrespondenceIterator::operator<(
+    const CorrespondenceIterator& other) const {
+  return node_ == nullptr ? corr_ < other.corr_ : node_ < other.node_;
+}
+
 size_t CorrespondenceGraph::NumImages() const { return images_.size(); }
 
 size_t CorrespondenceGraph::NumImagePairs() const {
@@ -207,6 +401,35 @@ point2D_t CorrespondenceGraph::NumCorrespondencesBetweenImages(
   }
 }
 
+bool CorrespondenceGraph::HasCompactLayout() const { return compact_; }
+
+bool CorrespondenceGraph::IsOutOfCore() const {
+  return out_of_core_ != nullptr;
+}
+
+const point2D_t* CorrespondenceGraph::NodeCorrBegs() const {
+  if (out_of_core_) {
+    return reinterpret_cast<const point2D_t*>(
+        out_of_core_->node_corr_begs_file->Data());
+  }
+  return compact_layout_.node_corr_begs.data();
+}
+
+const uint32_t* CorrespondenceGraph::CorrNodes() const {
+  if (out_of_core_) {
+    return reinterpret_cast<const uint32_t*>(
+        out_of_core_->corr_nodes_file->Data());
+  }
+  return compact_layout_.corr_nodes.data();
+}
+
+CorrespondenceGraph::Correspondence CorrespondenceGraph::DecodeNode(
+    const uint32_t node) const {
+  const uint32_t image_idx = compact_layout_.node_image_idxs[node];
+  return Correspondence(compact_layout_.image_ids[image_idx],
+                        node - compact_layout_.image_node_begs[image_idx]);
+}
+
 bool CorrespondenceGraph::HasCorrespondences(
     const image_t image_id, const point2D_t point2D_idx) const {
   const CorrespondenceRange range = FindCorrespondences(image_id, point2D_idx);
@@ -29,6 +29,9 @@
 
 #include "colmap/scene/correspondence_graph.h"
 
+#include "colmap/util/misc.h"
+#include "colmap/util/testing.h"
+
 #include <gtest/gtest.h>
 
 namespace colmap {
@@ -236,6 +239,198 @@ TEST(CorrespondenceGraph, ThreeView) {
             2);
 }
 
+TEST(CorrespondenceGraph, TransitiveChain) {
+  // Chain of images, where the first point of each image corresponds to the
+  // first point of the next image and the second points of all images
+  // correspond to each other.
+  const image_t kNumImages = 100;
+  CorrespondenceGraph correspondence_graph;
+  for (image_t image_id = 0; image_id < kNumImages; ++image_id) {
+    correspondence_graph.AddImage(image_id, 2);
+  }
+  for (image_t image_id1 = 0; image_id1 < kNumImages; ++image_id1) {
+    for (image_t image_id2 = image_id1 + 1; image_id2 < kNumImages;
+         ++image_id2) {
+      FeatureMatches matches;
+      if (image_id2 == image_id1 + 1) {
+        matches.emplace_back(0, 0);
+      }
+      matches.emplace_back(1, 1);
+      correspondence_graph.AddCorrespondences(image_id1, image_id2, matches);
+    }
+  }
+  correspondence_graph.Finalize();
+
+  for (size_t transitivity = 1; transitivity < 2 * kNumImages;
+       transitivity *= 2) {
+    EXPECT_EQ(CountNumTransitiveCorrespondences(
+                  correspondence_graph, 0, 0, transitivity),
+              std::min<size_t>(transitivity, kNumImages - 1));
+    EXPECT_EQ(CountNumTransitiveCorrespondences(
+                  correspondence_graph, kNumImages / 2, 0, transitivity),
+              std::min<size_t>(2 * transitivity, kNumImages - 1));
+    EXPECT_EQ(CountNumTransitiveCorrespondences(
+                  correspondence_graph, 0, 1, transitivity),
+              kNumImages - 1);
+  }
+
+  std::vector<CorrespondenceGraph::Correspondence> corrs;
+  correspondence_graph.ExtractTransitiveCorrespondences(
+      kNumImages - 1, 1, /*transitivity=*/3, &corrs);
+  std::vector<bool> found_images(kNumImages, false);
+  for (const auto& corr : corrs) {
+    EXPECT_EQ(corr.point2D_idx, 1);
+    EXPECT_FALSE(found_images[corr.image_id]);
+    found_images[corr.image_id] = true;
+  }
+  EXPECT_FALSE(found_images[kNumImages - 1]);
+}
+
+void ExpectEqualCorrespondenceGraphs(const CorrespondenceGraph& graph1,
+                                     const CorrespondenceGraph& graph2,
+                                     const std::vector<image_t>& image_ids,
+                                     const point2D_t num_points2D) {
+  EXPECT_EQ(graph1.NumImages(), graph2.NumImages());
+  EXPECT_EQ(graph1.NumImagePairs(), graph2.NumImagePairs());
+  EXPECT_EQ(graph1.NumCorrespondencesBetweenImages(),
+            graph2.NumCorrespondencesBetweenImages());
+  std::vector<CorrespondenceGraph::Correspondence> corrs1;
+  std::vector<CorrespondenceGraph::Correspondence> corrs2;
+  for (const image_t image_id : image_ids) {
+    ASSERT_EQ(graph1.ExistsImage(image_id), graph2.ExistsImage(image_id));
+    if (!graph1.ExistsImage(image_id)) {
+      continue;
+    }
+    EXPECT_EQ(graph1.NumObservationsForImage(image_id),
+              graph2.NumObservationsForImage(image_id));
+    EXPECT_EQ(graph1.NumCorrespondencesForImage(image_id),
+              graph2.NumCorrespondencesForImage(image_id));
+    for (point2D_t point2D_idx = 0; point2D_idx < num_points2D;
+         ++point2D_idx) {
+      EXPECT_EQ(graph1.HasCorrespondences(image_id, point2D_idx),
+                graph2.HasCorrespondences(image_id, point2D_idx));
+      EXPECT_EQ(graph1.IsTwoViewObservation(image_id, point2D_idx),
+                graph2.IsTwoViewObservation(image_id, point2D_idx));
+      for (const size_t transitivity : {1, 2, 3}) {
+        graph1.ExtractTransitiveCorrespondences(
+            image_id, point2D_idx, transitivity, &corrs1);
+        graph2.ExtractTransitiveCorrespondences(
+            image_id, point2D_idx, transitivity, &corrs2);
+        ASSERT_EQ(corrs1.size(), corrs2.size());
+        for (size_t k = 0; k < corrs1.size(); ++k) {
+          EXPECT_EQ(corrs1[k].image_id, corrs2[k].image_id);
+          EXPECT_EQ(corrs1[k].point2D_idx, corrs2[k].point2D_idx);
+        }
+      }
+    }
+    for (const image_t other_image_id : image_ids) {
+      if (!graph1.ExistsImage(other_image_id)) {
+        continue;
+      }
+      const FeatureMatches matches1 =
+          graph1.FindCorrespondencesBetweenImages(image_id, other_image_id);
+      const FeatureMatches matches2 =
+          graph2.FindCorrespondencesBetweenImages(image_id, other_image_id);
+      ASSERT_EQ(matches1.size(), matches2.size());
+      for (size_t k = 0; k < matches1.size(); ++k) {
+        EXPECT_EQ(matches1[k].point2D_idx1, matches2[k].point2D_idx1);
+        EXPECT_EQ(matches1[k].point2D_idx2, matches2[k].point2D_idx2);
+      }
+    }
+  }
+}
+
+// Add correspondences between all but the last image, such that the last image
+// has no observations and is removed during finalization.
+void AddSyntheticCorrespondences(const std::vector<image_t>& image_ids,
+                                 const point2D_t num_points2D,
+                                 CorrespondenceGraph* graph) {
+  for (const image_t image_id : image_ids) {
+    graph->AddImage(image_id, num_points2D);
+  }
+  for (size_t i = 0; i < image_ids.size() - 1; ++i) {
+    for (size_t j = i + 1; j < image_ids.size() - 1; ++j) {
+      FeatureMatches matches;
+      for (point2D_t point2D_idx = 0; point2D_idx < num_points2D;
+           point2D_idx += i + j) {
+        matches.emplace_back(point2D_idx, (point2D_idx + i) % num_points2D);
+      }
+      graph->AddCorrespondences(image_ids[i], image_ids[j], matches);
+    }
+  }
+}
+
+TEST(CorrespondenceGraph, CompactLayout) {
+  // Sparse image identifiers.
+  const std::vector<image_t> image_ids = {3, 1, 7, 12, 5};
+  const point2D_t kNumPoints2D = 20;
+  CorrespondenceGraph default_graph;
+  AddSyntheticCorrespondences(image_ids, kNumPoints2D, &default_graph);
+  default_graph.Finalize();
+  CorrespondenceGraph compact_graph;
+  AddSyntheticCorrespondences(image_ids, kNumPoints2D, &compact_graph);
+  compact_graph.Finalize(/*compact_layout=*/true);
+  EXPECT_FALSE(default_graph.HasCompactLayout());
+  EXPECT_TRUE(compact_graph.HasCompactLayout());
+  EXPECT_EQ(compact_graph.NumImages(), image_ids.size() - 1);
+  EXPECT_FALSE(compact_graph.ExistsImage(image_ids.back()));
+  EXPECT_ANY_THROW(compact_graph.FindCorrespondences(image_ids.back(), 0));
+  EXPECT_ANY_THROW(compact_graph.FindCorrespondences(100, 0));
+  EXPECT_ANY_THROW(
+      compact_graph.FindCorrespondences(image_ids[0], kNumPoints2D));
+  ExpectEqualCorrespondenceGraphs(
+      default_graph, compact_graph, image_ids, kNumPoints2D);
+}
+
+TEST(CorrespondenceGraph, OutOfCore) {
+  const std::vector<image_t> image_ids = {3, 1, 7, 12, 5};
+  const point2D_t kNumPoints2D = 20;
+  CorrespondenceGraph default_graph;
+  AddSyntheticCorrespondences(image_ids, kNumPoints2D, &default_graph);
+  default_graph.Finalize();
+  const std::string path = CreateTestDir() + "/correspondence_graph.bin";
+  for (const size_t max_num_buffered_corrs : {3, 1000}) {
+    {
+      CorrespondenceGraph out_of_core_graph;
+      out_of_core_graph.SetOutOfCore(path, max_num_buffered_corrs);
+      AddSyntheticCorrespondences(image_ids, kNumPoints2D, &out_of_core_graph);
+      EXPECT_TRUE(out_of_core_graph.IsOutOfCore());
+      out_of_core_graph.Finalize();
+      EXPECT_TRUE(out_of_core_graph.HasCompactLayout());
+      EXPECT_TRUE(ExistsFile(path));
+      ExpectEqualCorrespondenceGraphs(
+          default_graph, out_of_core_graph, image_ids, kNumPoints2D);
+      const CorrespondenceGraph copied_graph = out_of_core_graph;
+      ExpectEqualCorrespondenceGraphs(
+          default_graph, copied_graph, image_ids, kNumPoints2D);
+    }
+    EXPECT_FALSE(ExistsFile(path));
+    EXPECT_FALSE(ExistsFile(path + ".idx"));
+    EXPECT_FALSE(ExistsFile(path + ".run0"));
+  }
+}
+
+TEST(CorrespondenceGraph, OutOfCoreDuplicate) {
+  CorrespondenceGraph correspondence_graph;
+  correspondence_graph.SetOutOfCore(CreateTestDir() +
+                                    "/correspondence_graph.bin");
+  correspondence_graph.AddImage(0, 10);
+  correspondence_graph.AddImage(1, 10);
+  correspondence_graph.AddImage(2, 10);
+  const FeatureMatches matches = {{0, 0}, {1, 1}, {1, 1}, {3, 3}, {3, 4}};
+  correspondence_graph.AddCorrespondences(0, 1, matches);
+  EXPECT_EQ(correspondence_graph.NumCorrespondencesForImage(0), 3);
+  EXPECT_EQ(correspondence_graph.NumCorrespondencesForImage(1), 3);
+  EXPECT_EQ(correspondence_graph.NumCorrespondencesBetweenImages(0, 1), 3);
+  EXPECT_ANY_THROW(correspondence_graph.AddCorrespondences(1, 0, matches));
+  correspondence_graph.Finalize();
+  EXPECT_EQ(correspondence_graph.NumImages(), 2);
+  EXPECT_EQ(correspondence_graph.NumObservationsForImage(0), 3);
+  EXPECT_EQ(correspondence_graph.NumObservationsForImage(1), 3);
+  EXPECT_TRUE(correspondence_graph.HasCorrespondences(0, 3));
+  EXPECT_FALSE(correspondence_graph.HasCorrespondences(1, 4));
+}
+
 TEST(CorrespondenceGraph, OutOfBounds) {
   CorrespondenceGraph correspondence_graph;
   correspondence_graph.AddImage(0, 10);
@@ -33,9 +33,12 @@
 #include "colmap/util/string.h"
 #include "colmap/util/version.h"
 
+#include <cstring>
 #include <fstream>
 #include <memory>
 
+#include <lz4.h>
+
 namespace colmap {
 namespace {
 
@@ -103,6 +106,292 @@ FeatureMatches FeatureMatchesFromBlob(const FeatureMatchesBlob& blob) {
   return matches;
 }
 
+// Number of bytes per keypoint in the packed encoding: float32 location and
+// float16 affine shape.
+constexpr size_t kPackedKeypointNumBytes =
+    2 * sizeof(float) + 4 * sizeof(Eigen::half);
+
+uint64_t ZigZagEncode(const int64_t value) {
+  return (static_cast<uint64_t>(value) << 1) ^
+         static_cast<uint64_t>(value >> 63);
+}
+
+int64_t ZigZagDecode(const uint64_t value) {
+  return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+std::string PackKeypoints(const FeatureKeypoints& keypoints) {
+  std::string data(keypoints.size() * kPackedKeypointNumBytes, '\0');
+  char* ptr = data.data();
+  for (const auto& keypoint : keypoints) {
+    const float location[2] = {keypoint.x, keypoint.y};
+    const Eigen::half shape[4] = {Eigen::half(keypoint.a11),
+                                  Eigen::half(keypoint.a12),
+                                  Eigen::half(keypoint.a21),
+                                  Eigen::half(keypoint.a22)};
+    memcpy(ptr, location, sizeof(location));
+    ptr += sizeof(location);
+    memcpy(ptr, shape, sizeof(shape));
+    ptr += sizeof(shape);
+  }
+  return data;
+}
+
+FeatureKeypointsBlob UnpackKeypoints(const size_t num_keypoints,
+                                     const uint8_t* data,
+                                     const size_t num_bytes) {
+  THROW_CHECK_EQ(num_bytes, num_keypoints * kPackedKeypointNumBytes);
+  FeatureKeypointsBlob blob(num_keypoints, 6);
+  for (size_t i = 0; i < num_keypoints; ++i) {
+    float location[2];
+    Eigen::half shape[4];
+    memcpy(location, data, sizeof(location));
+    data += sizeof(location);
+    memcpy(shape, data, sizeof(shape));
+    data += sizeof(shape);
+    blob(i, 0) = location[0];
+    blob(i, 1) = location[1];
+    blob(i, 2) = static_cast<float>(shape[0]);
+    blob(i, 3) = static_cast<float>(shape[1]);
+    blob(i, 4) = static_cast<float>(shape[2]);
+    blob(i, 5) = static_cast<float>(shape[3]);
+  }
+  return blob;
+}
+
+// Number of bits needed to represent the given value.
+int NumBits(uint64_t value) {
+  int num_bits = 0;
+  while (value > 0) {
+    value >>= 1;
+    ++num_bits;
+  }
+  return num_bits;
+}
+
+// Maximum bit width of a packed match index. The zig-zag coded difference of
+// two 32-bit indices needs one more bit than the indices themselves.
+constexpr int kMaxPackedMatchNumBits = 33;
+
+// Number of bytes of the packed matches header with the two bit widths.
+constexpr size_t kPackedMatchesHeaderNumBytes = 2;
+
+size_t NumPackedMatchesBytes(const size_t num_matches, const int num_bits) {
+  return kPackedMatchesHeaderNumBytes + (num_matches * num_bits + 7) / 8;
+}
+
+// Read the given number of bits starting at the given bit offset. Assumes a
+// little-endian host, as the other packed encodings.
+inline uint64_t ReadBits(const uint8_t* data,
+                         const size_t num_bytes,
+                         const size_t bit,
+                         const int num_bits) {
+  const size_t offset = bit / 8;
+  uint64_t word = 0;
+  if (offset + sizeof(word) <= num_bytes) {
+    memcpy(&word, data + offset, sizeof(word));
+  } else {
+    memcpy(&word, data + offset, num_bytes - offset);
+  }
+  return (word >> (bit % 8)) & ((uint64_t(1) << num_bits) - 1);
+}
+
+inline void WriteBits(const uint64_t value, const size_t bit, uint8_t* data) {
+  uint64_t word;
+  memcpy(&word, data + bit / 8, sizeof(word));
+  word |= value << (bit % 8);
+  memcpy(data + bit / 8, &word, sizeof(word));
+}
+
+// Matches are typically sorted by the first index, so it is delta and zig-zag
+// coded. The second index is in random order and stored directly. Both are
+// bit packed with the smallest fixed width that fits all values of the blob,
+// which decodes much faster than variable length codes.
+std::string PackMatches(const FeatureMatchesBlob& blob) {
+  const size_t num_matches = blob.rows();
+  std::vector<uint64_t> deltas(num_matches);
+  uint64_t max_delta = 0;
+  uint64_t max_idx2 = 0;
+  int64_t prev_idx1 = 0;
+  for (size_t i = 0; i < num_matches; ++i) {
+    const int64_t idx1 = blob(i, 0);
+    deltas[i] = ZigZagEncode(idx1 - prev_idx1);
+    max_delta = std::max(max_delta, deltas[i]);
+    max_idx2 = std::max<uint64_t>(max_idx2, blob(i, 1));
+    prev_idx1 = idx1;
+  }
+
+  const int num_bits1 = NumBits(max_delta);
+  const int num_bits2 = NumBits(max_idx2);
+  const size_t num_bytes =
+      NumPackedMatchesBytes(num_matches, num_bits1 + num_bits2);
+  // Pad the data for the word-wise writes of the last bits.
+  std::string data(num_bytes + sizeof(uint64_t), '\0');
+  data[0] = static_cast<char>(num_bits1);
+  data[1] = static_cast<char>(num_bits2);
+  uint8_t* bits = reinterpret_cast<uint8_t*>(data.data()) +
+                  kPackedMatchesHeaderNumBytes;
+  size_t bit = 0;
+  for (size_t i = 0; i < num_matches; ++i) {
+    WriteBits(deltas[i], bit, bits);
+    bit += num_bits1;
+    WriteBits(blob(i, 1), bit, bits);
+    bit += num_bits2;
+  }
+  data.resize(num_bytes);
+  return data;
+}
+
+FeatureMatchesBlob UnpackMatches(const size_t num_matches,
+                                 const uint8_t* data,
+                                 const size_t num_bytes) {
+  THROW_CHECK_GE(num_bytes, kPackedMatchesHeaderNumBytes);
+  const int num_bits1 = data[0];
+  const int num_bits2 = data[1];
+  THROW_CHECK_LE(num_bits1, kMaxPackedMatchNumBits);
+  THROW_CHECK_LE(num_bits2, kMaxPackedMatchNumBits);
+  THROW_CHECK_EQ(num_bytes,
+                 NumPackedMatchesBytes(num_matches, num_bits1 + num_bits2));
+
+  const uint8_t* bits = data + kPackedMatchesHeaderNumBytes;
+  const size_t num_bits_bytes = num_bytes - kPackedMatchesHeaderNumBytes;
+  FeatureMatchesBlob blob(num_matches, 2);
+  point2D_t* idxs = blob.data();
+  int64_t idx1 = 0;
+  size_t bit = 0;
+  size_t i = 0;
+
+  // Fast path reading both indices of a match with a single word load, if
+  // they fit into the word after the sub-byte shift.
+  if (num_bits1 + num_bits2 <= 57) {
+    const uint64_t mask1 = (uint64_t(1) << num_bits1) - 1;
+    const uint64_t mask2 = (uint64_t(1) << num_bits2) - 1;
+    for (; i < num_matches && bit / 8 + sizeof(uint64_t) <= num_bits_bytes;
+         ++i) {
+      uint64_t word;
+      memcpy(&word, bits + bit / 8, sizeof(word));
+      word >>= bit % 8;
+      idx1 += ZigZagDecode(word & mask1);
+      *(idxs++) = static_cast<point2D_t>(idx1);
+      *(idxs++) = static_cast<point2D_t>((word >> num_bits1) & mask2);
+      bit += num_bits1 + num_bits2;
+    }
+  }
+
+  for (; i < num_matches; ++i) {
+    idx1 += ZigZagDecode(ReadBits(bits, num_bits_bytes, bit, num_bits1));
+    bit += num_bits1;
+    *(idxs++) = static_cast<point2D_t>(idx1);
+    *(idxs++) = static_cast<point2D_t>(
+        ReadBits(bits, num_bits_bytes, bit, num_bits2));
+    bit += num_bits2;
+  }
+  return blob;
+}
+
+// The LZ4 block is prefixed with the number of uncompressed bytes.
+std::string CompressLZ4(const std::string& data) {
+  const uint64_t num_bytes = data.size();
+  std::string compressed(sizeof(num_bytes), '\0');
+  memcpy(compressed.data(), &num_bytes, sizeof(num_bytes));
+  if (data.empty()) {
+    return compressed;
+  }
+  const int max_num_compressed_bytes =
+      LZ4_compressBound(static_cast<int>(data.size()));
+  compressed.resize(sizeof(num_bytes) + max_num_compressed_bytes);
+  const int num_compressed_bytes =
+      LZ4_compress_default(data.data(),
+                           compressed.data() + sizeof(num_bytes),
+                           static_cast<int>(data.size()),
+                           max_num_compressed_bytes);
+  THROW_CHECK_GT(num_compressed_bytes, 0) << "LZ4 compression failed";
+  compressed.resize(sizeof(num_bytes) + num_compressed_bytes);
+  return compressed;
+}
+
+void DecompressLZ4(const void* data,
+                   const size_t num_bytes,
+                   std::string* decompressed) {
+  uint64_t num_decompressed_bytes = 0;
+  THROW_CHECK_GE(num_bytes, sizeof(num_decompressed_bytes));
+  memcpy(&num_decompressed_bytes, data, sizeof(num_decompressed_bytes));
+  const size_t num_compressed_bytes = num_bytes - sizeof(num_decompressed_bytes);
+  // Validate the untrusted header before allocating the output, such that a
+  // corrupt blob cannot trigger a huge allocation and all sizes fit into int.
+  THROW_CHECK_LE(num_decompressed_bytes,
+                 static_cast<uint64_t>(LZ4_MAX_INPUT_SIZE));
+  if (num_decompressed_bytes == 0) {
+    THROW_CHECK_EQ(num_compressed_bytes, 0);
+    decompressed->clear();
+    return;
+  }
+  const int max_num_compressed_bytes =
+      LZ4_compressBound(static_cast<int>(num_decompressed_bytes));
+  THROW_CHECK_LE(num_compressed_bytes,
+                 static_cast<size_t>(max_num_compressed_bytes));
+  decompressed->resize(num_decompressed_bytes);
+  const int rc = LZ4_decompress_safe(
+      static_cast<const char*>(data) + sizeof(num_decompressed_bytes),
+      decompressed->data(),
+      static_cast<int>(num_compressed_bytes),
+      static_cast<int>(num_decompressed_bytes));
+  THROW_CHECK_EQ(rc, static_cast<int>(num_decompressed_bytes))
+      << "LZ4 decompression failed";
+}
+
+std::string EncodeKeypointsBlob(const FeatureKeypointsBlob& blob,
+                                const Database::BlobEncoding encoding) {
+  std::string data = PackKeypoints(FeatureKeypointsFromBlob(blob));
+  if (encoding == Database::BlobEncoding::PACKED_LZ4) {
+    data = CompressLZ4(data);
+  }
+  return data;
+}
+
+// Bit packed matches are practically incompressible, so LZ4 would only add
+// decoding time and matches are always written without it. Rows written with
+// LZ4 compressed matches can still be read.
+Database::BlobEncoding MatchesBlobEncoding(
+    const Database::BlobEncoding encoding) {
+  if (encoding == Database::BlobEncoding::PACKED_LZ4) {
+    return Database::BlobEncoding::PACKED;
+  }
+  return encoding;
+}
+
+Database::BlobEncoding ReadBlobEncoding(sqlite3_stmt* sql_stmt,
+                                        const int rc,
+                                        const int col) {
+  if (rc != SQLITE_ROW) {
+    return Database::BlobEncoding::RAW;
+  }
+  const int64_t encoding = sqlite3_column_int64(sql_stmt, col);
+  THROW_CHECK_GE(encoding, 0);
+  THROW_CHECK_LE(encoding,
+                 static_cast<int64_t>(Database::BlobEncoding::PACKED_LZ4))
+      << "Blob encoding not supported";
+  return static_cast<Database::BlobEncoding>(encoding);
+}
+
+// Read the data column of a row written with a packed encoding. The returned
+// payload points either into the SQLite row or into `buffer` for compressed
+// rows.
+const uint8_t* ReadPackedBlobPayload(sqlite3_stmt* sql_stmt,
+                                     const int col,
+                                     const Database::BlobEncoding encoding,
+                                     size_t* num_bytes,
+                                     std::string* buffer) {
+  const void* data = sqlite3_column_blob(sql_stmt, col + 2);
+  *num_bytes = static_cast<size_t>(sqlite3_column_bytes(sql_stmt, col + 2));
+  if (encoding == Database::BlobEncoding::PACKED_LZ4) {
+    DecompressLZ4(data, *num_bytes, buffer);
+    *num_bytes = buffer->size();
+    return reinterpret_cast<const uint8_t*>(buffer->data());
+  }
+  return static_cast<const uint8_t*>(data);
+}
+
 template <typename MatrixType>
 MatrixType ReadStaticMatrixBlob(sqlite3_stmt* sql_stmt,
                                 const int rc,
@@ -201,6 +490,60 @@ void WriteDynamicMatrixBlob(sqlite3_stmt* sql_stmt,
                                  SQLITE_STATIC));
 }
 
+FeatureKeypointsBlob ReadKeypointsBlobColumns(sqlite3_stmt* sql_stmt,
+                                              const int rc,
+                                              const int col,
+                                              const int encoding_col) {
+  const Database::BlobEncoding encoding =
+      ReadBlobEncoding(sql_stmt, rc, encoding_col);
+  if (encoding == Database::BlobEncoding::RAW) {
+    return ReadDynamicMatrixBlob<FeatureKeypointsBlob>(sql_stmt, rc, col);
+  }
+
+  const size_t rows =
+      static_cast<size_t>(sqlite3_column_int64(sql_stmt, col + 0));
+  size_t num_bytes = 0;
+  std::string buffer;
+  const uint8_t* data =
+      ReadPackedBlobPayload(sql_stmt, col, encoding, &num_bytes, &buffer);
+  return UnpackKeypoints(rows, data, num_bytes);
+}
+
+FeatureMatchesBlob ReadMatchesBlobColumns(sqlite3_stmt* sql_stmt,
+                                          const int rc,
+                                          const int col,
+                                          const int encoding_col) {
+  const Database::BlobEncoding encoding =
+      ReadBlobEncoding(sql_stmt, rc, encoding_col);
+  if (encoding == Database::BlobEncoding::RAW) {
+    return ReadDynamicMatrixBlob<FeatureMatchesBlob>(sql_stmt, rc, col);
+  }
+
+  const size_t rows =
+      static_cast<size_t>(sqlite3_column_int64(sql_stmt, col + 0));
+  size_t num_bytes = 0;
+  std::string buffer;
+  const uint8_t* data =
+      ReadPackedBlobPayload(sql_stmt, col, encoding, &num_bytes, &buffer);
+  return UnpackMatches(rows, data, num_bytes);
+}
+
+// Bind an encoded blob to the (rows, cols, data) columns starting at `col`.
+// The data must live until the statement is executed.
+void WriteEncodedBlob(sqlite3_stmt* sql_stmt,
+                      const int64_t rows,
+                      const int64_t cols,
+                      const std::string& data,
+                      const int col) {
+  SQLITE3_CALL(sqlite3_bind_int64(sql_stmt, col + 0, rows));
+  SQLITE3_CALL(sqlite3_bind_int64(sql_stmt, col + 1, cols));
+  SQLITE3_CALL(sqlite3_bind_blob(sql_stmt,
+                                 col + 2,
+                                 data.data(),
+                                 static_cast<int>(data.size()),
+                                 SQLITE_STATIC));
+}
+
 Camera ReadCameraRow(sqlite3_stmt* sql_stmt) {
   Camera camera;
 
@@ -280,6 +623,13 @@ void Database::Open(const std::string& path) {
   CreateTables();
   UpdateSchema();
   PrepareSQLStatements();
+
+  const int64_t blob_encoding = ReadMetadataValue(
+      "blob_encoding", static_cast<int64_t>(BlobEncoding::RAW));
+  THROW_CHECK_GE(blob_encoding, 0);
+  THROW_CHECK_LE(blob_encoding, static_cast<int64_t>(BlobEncoding::PACKED_LZ4))
+      << "Blob encoding not supported";
+  blob_encoding_ = static_cast<BlobEncoding>(blob_encoding);
 }
 
 void Database::Close() {
@@ -294,6 +644,15 @@ void Database::Close() {
   }
 }
 
+void Database::SetBlobEncoding(const BlobEncoding encoding) {
+  WriteMetadataValue("blob_encoding", static_cast<int64_t>(encoding));
+  blob_encoding_ = encoding;
+}
+
+Database::BlobEncoding Database::GetBlobEncoding() const {
+  return blob_encoding_;
+}
+
 bool Database::ExistsCamera(const camera_t camera_id) const {
   return ExistsRowId(sql_stmt_exists_camera_, camera_id);
 }
@@ -462,8 +821,8 @@ FeatureKeypointsBlob Database::ReadKeypointsBlob(const image_t image_id) const {
   SQLITE3_CALL(sqlite3_bind_int64(sql_stmt_read_keypoints_, 1, image_id));
 
   const int rc = SQLITE3_CALL(sqlite3_step(sql_stmt_read_keypoints_));
-  FeatureKeypointsBlob blob = ReadDynamicMatrixBlob<FeatureKeypointsBlob>(
-      sql_stmt_read_keypoints_, rc, 0);
+  FeatureKeypointsBlob blob =
+      ReadKeypointsBlobColumns(sql_stmt_read_keypoints_, rc, 0, 3);
 
   SQLITE3_CALL(sqlite3_reset(sql_stmt_read_keypoints_));
   return blob;
@@ -492,7 +851,7 @@ FeatureMatchesBlob Database::ReadMatchesBlob(image_t image_id1,
 
   const int rc = SQLITE3_CALL(sqlite3_step(sql_stmt_read_matches_));
   FeatureMatchesBlob blob =
-      ReadDynamicMatrixBlob<FeatureMatchesBlob>(sql_stmt_read_matches_, rc, 0);
+      ReadMatchesBlobColumns(sql_stmt_read_matches_, rc, 0, 3);
 
   SQLITE3_CALL(sqlite3_reset(sql_stmt_read_matches_));
 
@@ -516,8 +875,8 @@ std::vector<std::pair<image_pair_t, FeatureMatches>> Database::ReadAllMatches()
          SQLITE_ROW) {
     const image_pair_t pair_id = static_cast<image_pair_t>(
         sqlite3_column_int64(sql_stmt_read_matches_all_, 0));
-    const FeatureMatchesBlob blob = ReadDynamicMatrixBlob<FeatureMatchesBlob>(
-        sql_stmt_read_matches_all_, rc, 1);
+    const FeatureMatchesBlob blob =
+        ReadMatchesBlobColumns(sql_stmt_read_matches_all_, rc, 1, 4);
     all_matches.emplace_back(pair_id, FeatureMatchesFromBlob(blob));
   }
 
@@ -536,8 +895,8 @@ TwoViewGeometry Database::ReadTwoViewGeometry(const image_t image_id1,
 
   TwoViewGeometry two_view_geometry;
 
-  FeatureMatchesBlob blob = ReadDynamicMatrixBlob<FeatureMatchesBlob>(
-      sql_stmt_read_two_view_geometry_, rc, 0);
+  FeatureMatchesBlob blob =
+      ReadMatchesBlobColumns(sql_stmt_read_two_view_geometry_, rc, 0, 9);
 
   two_view_geometry.config = static_cast<int>(
       sqlite3_column_int64(sql_stmt_read_two_view_geometry_, 3));
@@ -582,8 +941,8 @@ void Database::ReadTwoViewGeometries(
 
     TwoViewGeometry two_view_geometry;
 
-    const FeatureMatchesBlob blob = ReadDynamicMatrixBlob<FeatureMatchesBlob>(
-        sql_stmt_read_two_view_geometries_, rc, 1);
+    const FeatureMatchesBlob blob =
+        ReadMatchesBlobColumns(sql_stmt_read_two_view_geometries_, rc, 1, 10);
     two_view_geometry.inlier_matches = FeatureMatchesFromBlob(blob);
 
     two_view_geometry.config = static_cast<int>(
@@ -709,7 +1068,18 @@ void Database::WriteKeypoints(const image_t image_id,
 void Database::WriteKeypoints(const image_t image_id,
                               const FeatureKeypointsBlob& blob) const {
   SQLITE3_CALL(sqlite3_bind_int64(sql_stmt_write_keypoints_, 1, image_id));
-  WriteDynamicMatrixBlob(sql_stmt_write_keypoints_, blob, 2);
+
+  // Important: the encoded data must live until the query is executed.
+  std::string encoded_data;
+  if (blob_encoding_ == BlobEncoding::RAW) {
+    WriteDynamicMatrixBlob(sql_stmt_write_keypoints_, blob, 2);
+  } else {
+    encoded_data = EncodeKeypointsBlob(blob, blob_encoding_);
+    WriteEncodedBlob(
+        sql_stmt_write_keypoints_, blob.rows(), 6, encoded_data, 2);
+  }
+  SQLITE3_CALL(sqlite3_bind_int64(
+      sql_stmt_write_keypoints_, 5, static_cast<int64_t>(blob_encoding_)));
 
   SQLITE3_CALL(sqlite3_step(sql_stmt_write_keypoints_));
   SQLITE3_CALL(sqlite3_reset(sql_stmt_write_keypoints_));
@@ -738,13 +1108,24 @@ void Database::WriteMatches(const image_t image_id1,
 
   // Important: the swapped data must live until the query is executed.
   FeatureMatchesBlob swapped_blob;
+  const FeatureMatchesBlob* blob_ptr = &blob;
   if (SwapImagePair(image_id1, image_id2)) {
     swapped_blob = blob;
     SwapFeatureMatchesBlob(&swapped_blob);
-    WriteDynamicMatrixBlob(sql_stmt_write_matches_, swapped_blob, 2);
+    blob_ptr = &swapped_blob;
+  }
+
+  const BlobEncoding encoding = MatchesBlobEncoding(blob_encoding_);
+  std::string encoded_data;
+  if (encoding == BlobEncoding::RAW) {
+    WriteDynamicMatrixBlob(sql_stmt_write_matches_, *blob_ptr, 2);
   } else {
-    WriteDynamicMatrixBlob(sql_stmt_write_matches_, blob, 2);
+    encoded_data = PackMatches(*blob_ptr);
+    WriteEncodedBlob(
+        sql_stmt_write_matches_, blob_ptr->rows(), 2, encoded_data, 2);
   }
+  SQLITE3_CALL(sqlite3_bind_int64(
+      sql_stmt_write_matches_, 5, static_cast<int64_t>(encoding)));
 
   SQLITE3_CALL(sqlite3_step(sql_stmt_write_matches_));
   SQLITE3_CALL(sqlite3_reset(sql_stmt_write_matches_));
@@ -771,7 +1152,21 @@ void Database::WriteTwoViewGeometry(
 
   const FeatureMatchesBlob inlier_matches =
       FeatureMatchesToBlob(two_view_geometry_ptr->inlier_matches);
-  WriteDynamicMatrixBlob(sql_stmt_write_two_view_geometry_, inlier_matches, 2);
+  const BlobEncoding encoding = MatchesBlobEncoding(blob_encoding_);
+  std::string encoded_inlier_matches;
+  if (encoding == BlobEncoding::RAW) {
+    WriteDynamicMatrixBlob(
+        sql_stmt_write_two_view_geometry_, inlier_matches, 2);
+  } else {
+    encoded_inlier_matches = PackMatches(inlier_matches);
+    WriteEncodedBlob(sql_stmt_write_two_view_geometry_,
+                     inlier_matches.rows(),
+                     2,
+                     encoded_inlier_matches,
+                     2);
+  }
+  SQLITE3_CALL(sqlite3_bind_int64(
+      sql_stmt_write_two_view_geometry_, 11, static_cast<int64_t>(encoding)));
 
   SQLITE3_CALL(sqlite3_bind_int64(
       sql_stmt_write_two_view_geometry_, 5, two_view_geometry_ptr->config));
@@ -1036,6 +1431,63 @@ void Database::Merge(const Database& database1,
   }
 }
 
+void Database::MergeShard(const std::string& shard_path) const {
+  // Bring the schema of the shard up to date.
+  { Database shard_database(shard_path); }
+
+  {
+    sqlite3_stmt* sql_stmt;
+    SQLITE3_CALL(sqlite3_prepare_v2(
+        database_, "ATTACH DATABASE ? AS shard;", -1, &sql_stmt, 0));
+    SQLITE3_CALL(sqlite3_bind_text(sql_stmt,
+                                   1,
+                                   shard_path.c_str(),
+                                   static_cast<int>(shard_path.size()),
+                                   SQLITE_STATIC));
+    SQLITE3_CALL(sqlite3_step(sql_stmt));
+    SQLITE3_CALL(sqlite3_finalize(sql_stmt));
+  }
+
+  // Pair identifiers are only meaningful if all images of the shard have the
+  // same identifier in this database.
+  const size_t num_inconsistent_images = [this]() {
+    const std::string sql =
+        "SELECT COUNT(*) FROM shard.images AS s LEFT JOIN main.images AS m "
+        "ON s.image_id = m.image_id WHERE m.name IS NULL OR m.name != s.name;";
+    sqlite3_stmt* sql_stmt;
+    SQLITE3_CALL(sqlite3_prepare_v2(database_, sql.c_str(), -1, &sql_stmt, 0));
+    size_t count = 0;
+    if (SQLITE3_CALL(sqlite3_step(sql_stmt)) == SQLITE_ROW) {
+      count = static_cast<size_t>(sqlite3_column_int64(sql_stmt, 0));
+    }
+    SQLITE3_CALL(sqlite3_finalize(sql_stmt));
+    return count;
+  }();
+
+  if (num_inconsistent_images == 0) {
+    BeginTransaction();
+    SQLITE3_EXEC(database_,
+                 "INSERT OR REPLACE INTO main.matches"
+                 "(pair_id, rows, cols, data, format) "
+                 "SELECT pair_id, rows, cols, data, format FROM shard.matches;",
+                 nullptr);
+    SQLITE3_EXEC(database_,
+                 "INSERT OR REPLACE INTO main.two_view_geometries"
+                 "(pair_id, rows, cols, data, config, F, E, H, qvec, tvec, "
+                 "format) "
+                 "SELECT pair_id, rows, cols, data, config, F, E, H, qvec, "
+                 "tvec, format FROM shard.two_view_geometries;",
+                 nullptr);
+    EndTransaction();
+  }
+
+  SQLITE3_EXEC(database_, "DETACH DATABASE shard;", nullptr);
+
+  THROW_CHECK_EQ(num_inconsistent_images, 0)
+      << "Images of shard " << shard_path
+      << " are inconsistent with the database";
+}
+
 void Database::BeginTransaction() const {
   SQLITE3_EXEC(database_, "BEGIN TRANSACTION", nullptr);
 }
@@ -1168,7 +1620,7 @@ void Database::PrepareSQLStatements() {
       database_, sql.c_str(), -1, &sql_stmt_read_pose_prior_, 0));
   sql_stmts_.push_back(sql_stmt_read_pose_prior_);
 
-  sql = "SELECT rows, cols, data FROM keypoints WHERE image_id = ?;";
+  sql = "SELECT rows, cols, data, format FROM keypoints WHERE image_id = ?;";
   SQLITE3_CALL(sqlite3_prepare_v2(
       database_, sql.c_str(), -1, &sql_stmt_read_keypoints_, 0));
   sql_stmts_.push_back(sql_stmt_read_keypoints_);
@@ -1178,24 +1630,27 @@ void Database::PrepareSQLStatements() {
       database_, sql.c_str(), -1, &sql_stmt_read_descriptors_, 0));
   sql_stmts_.push_back(sql_stmt_read_descriptors_);
 
-  sql = "SELECT rows, cols, data FROM matches WHERE pair_id = ?;";
+  sql = "SELECT rows, cols, data, format FROM matches WHERE pair_id = ?;";
   SQLITE3_CALL(sqlite3_prepare_v2(
       database_, sql.c_str(), -1, &sql_stmt_read_matches_, 0));
   sql_stmts_.push_back(sql_stmt_read_matches_);
 
-  sql = "SELECT * FROM matches WHERE rows > 0;";
+  sql =
+      "SELECT pair_id, rows, cols, data, format FROM matches WHERE rows > 0;";
   SQLITE3_CALL(sqlite3_prepare_v2(
       database_, sql.c_str(), -1, &sql_stmt_read_matches_all_, 0));
   sql_stmts_.push_back(sql_stmt_read_matches_all_);
 
   sql =
-      "SELECT rows, cols, data, config, F, E, H, qvec, tvec FROM "
+      "SELECT rows, cols, data, config, F, E, H, qvec, tvec, format FROM "
       "two_view_geometries WHERE pair_id = ?;";
   SQLITE3_CALL(sqlite3_prepare_v2(
       database_, sql.c_str(), -1, &sql_stmt_read_two_view_geometry_, 0));
   sql_stmts_.push_back(sql_stmt_read_two_view_geometry_);
 
-  sql = "SELECT * FROM two_view_geometries WHERE rows > 0;";
+  sql =
+      "SELECT pair_id, rows, cols, data, config, F, E, H, qvec, tvec, format "
+      "FROM two_view_geometries WHERE rows > 0;";
   SQLITE3_CALL(sqlite3_prepare_v2(
       database_, sql.c_str(), -1, &sql_stmt_read_two_view_geometries_, 0));
   sql_stmts_.push_back(sql_stmt_read_two_view_geometries_);
@@ -1208,6 +1663,11 @@ void Database::PrepareSQLStatements() {
                                   0));
   sql_stmts_.push_back(sql_stmt_read_two_view_geometry_num_inliers_);
 
+  sql = "SELECT value FROM metadata WHERE name = ?;";
+  SQLITE3_CALL(sqlite3_prepare_v2(
+      database_, sql.c_str(), -1, &sql_stmt_read_metadata_, 0));
+  sql_stmts_.push_back(sql_stmt_read_metadata_);
+
   //////////////////////////////////////////////////////////////////////////////
   // write_*
   //////////////////////////////////////////////////////////////////////////////
@@ -1218,7 +1678,9 @@ void Database::PrepareSQLStatements() {
       database_, sql.c_str(), -1, &sql_stmt_write_pose_prior_, 0));
   sql_stmts_.push_back(sql_stmt_write_pose_prior_);
 
-  sql = "INSERT INTO keypoints(image_id, rows, cols, data) VALUES(?, ?, ?, ?);";
+  sql =
+      "INSERT INTO keypoints(image_id, rows, cols, data, format) "
+      "VALUES(?, ?, ?, ?, ?);";
   SQLITE3_CALL(sqlite3_prepare_v2(
       database_, sql.c_str(), -1, &sql_stmt_write_keypoints_, 0));
   sql_stmts_.push_back(sql_stmt_write_keypoints_);
@@ -1229,18 +1691,25 @@ void Database::PrepareSQLStatements() {
       database_, sql.c_str(), -1, &sql_stmt_write_descriptors_, 0));
   sql_stmts_.push_back(sql_stmt_write_descriptors_);
 
-  sql = "INSERT INTO matches(pair_id, rows, cols, data) VALUES(?, ?, ?, ?);";
+  sql =
+      "INSERT INTO matches(pair_id, rows, cols, data, format) "
+      "VALUES(?, ?, ?, ?, ?);";
   SQLITE3_CALL(sqlite3_prepare_v2(
       database_, sql.c_str(), -1, &sql_stmt_write_matches_, 0));
   sql_stmts_.push_back(sql_stmt_write_matches_);
 
   sql =
       "INSERT INTO two_view_geometries(pair_id, rows, cols, data, config, F, "
-      "E, H, qvec, tvec) VALUES(?, ?, ?, ?, ?, ?, ?, ?, ?, ?);";
+      "E, H, qvec, tvec, format) VALUES(?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?);";
   SQLITE3_CALL(sqlite3_prepare_v2(
       database_, sql.c_str(), -1, &sql_stmt_write_two_view_geometry_, 0));
   sql_stmts_.push_back(sql_stmt_write_two_view_geometry_);
 
+  sql = "INSERT OR REPLACE INTO metadata(name, value) VALUES(?, ?);";
+  SQLITE3_CALL(sqlite3_prepare_v2(
+      database_, sql.c_str(), -1, &sql_stmt_write_metadata_, 0));
+  sql_stmts_.push_back(sql_stmt_write_metadata_);
+
   //////////////////////////////////////////////////////////////////////////////
   // delete_*
   //////////////////////////////////////////////////////////////////////////////
@@ -1307,6 +1776,7 @@ void Database::CreateTables() const {
   CreateDescriptorsTable();
   CreateMatchesTable();
   CreateTwoViewGeometriesTable();
+  CreateMetadataTable();
 }
 
 void Database::CreateCameraTable() const {
@@ -1354,6 +1824,7 @@ void Database::CreateKeypointsTable() const {
       "    rows      INTEGER               NOT NULL,"
       "    cols      INTEGER               NOT NULL,"
       "    data      BLOB,"
+      "    format    INTEGER               NOT NULL DEFAULT 0,"
       "FOREIGN KEY(image_id) REFERENCES images(image_id) ON DELETE CASCADE);";
 
   SQLITE3_EXEC(database_, sql.c_str(), nullptr);
@@ -1377,7 +1848,8 @@ void Database::CreateMatchesTable() const {
       "   (pair_id  INTEGER  PRIMARY KEY  NOT NULL,"
       "    rows     INTEGER               NOT NULL,"
       "    cols     INTEGER               NOT NULL,"
-      "    data     BLOB);";
+      "    data     BLOB,"
+      "    format   INTEGER               NOT NULL DEFAULT 0);";
 
   SQLITE3_EXEC(database_, sql.c_str(), nullptr);
 }
@@ -1399,11 +1871,21 @@ void Database::CreateTwoViewGeometriesTable() const {
         "    E        BLOB,"
         "    H        BLOB,"
         "    qvec     BLOB,"
-        "    tvec     BLOB);";
+        "    tvec     BLOB,"
+        "    format   INTEGER               NOT NULL DEFAULT 0);";
     SQLITE3_EXEC(database_, sql.c_str(), nullptr);
   }
 }
 
+void Database::CreateMetadataTable() const {
+  const std::string sql =
+      "CREATE TABLE IF NOT EXISTS metadata"
+      "   (name   TEXT     PRIMARY KEY  NOT NULL,"
+      "    value  INTEGER               NOT NULL);";
+
+  SQLITE3_EXEC(database_, sql.c_str(), nullptr);
+}
+
 void Database::UpdateSchema() const {
   if (!ExistsColumn("two_view_geometries", "F")) {
     SQLITE3_EXEC(database_,
@@ -1435,6 +1917,17 @@ void Database::UpdateSchema() const {
                  nullptr);
   }
 
+  // The format column stores the blob encoding of each row.
+  for (const std::string table_name :
+       {"keypoints", "matches", "two_view_geometries"}) {
+    if (!ExistsColumn(table_name, "format")) {
+      const std::string sql = StringPrintf(
+          "ALTER TABLE %s ADD COLUMN format INTEGER NOT NULL DEFAULT 0;",
+          table_name.c_str());
+      SQLITE3_EXEC(database_, sql.c_str(), nullptr);
+    }
+  }
+
   // Update user version number.
   std::unique_lock<std::mutex> lock(update_schema_mutex_);
   const std::string update_user_version_sql =
@@ -1512,6 +2005,38 @@ bool Database::ExistsRowString(sqlite3_stmt* sql_stmt,
   return exists;
 }
 
+int64_t Database::ReadMetadataValue(const std::string& name,
+                                    const int64_t default_value) const {
+  SQLITE3_CALL(sqlite3_bind_text(sql_stmt_read_metadata_,
+                                 1,
+                                 name.c_str(),
+                                 static_cast<int>(name.size()),
+                                 SQLITE_STATIC));
+
+  int64_t value = default_value;
+  const int rc = SQLITE3_CALL(sqlite3_step(sql_stmt_read_metadata_));
+  if (rc == SQLITE_ROW) {
+    value = sqlite3_column_int64(sql_stmt_read_metadata_, 0);
+  }
+
+  SQLITE3_CALL(sqlite3_reset(sql_stmt_read_metadata_));
+
+  return value;
+}
+
+void Database::WriteMetadataValue(const std::string& name,
+                                  const int64_t value) const {
+  SQLITE3_CALL(sqlite3_bind_text(sql_stmt_write_metadata_,
+                                 1,
+                                 name.c_str(),
+                                 static_cast<int>(name.size()),
+                                 SQLITE_STATIC));
+  SQLITE3_CALL(sqlite3_bind_int64(sql_stmt_write_metadata_, 2, value));
+
+  SQLITE3_CALL(sqlite3_step(sql_stmt_write_metadata_));
+  SQLITE3_CALL(sqlite3_reset(sql_stmt_write_metadata_));
+}
+
 size_t Database::CountRows(const std::string& table) const {
   const std::string sql =
       StringPrintf("SELECT COUNT(*) FROM %s;", table.c_str());
@@ -71,6 +71,20 @@ class Database {
   // Can be used to construct temporary in-memory database.
   const static std::string kInMemoryDatabasePath;
 
+  // Encoding of the keypoint and match blobs. The encoding is stored per row
+  // in the `format` column, such that rows with different encodings can be
+  // mixed in the same database and are transparently decoded when reading.
+  enum class BlobEncoding {
+    // Row-major float32 keypoints and uint32 match indices.
+    RAW = 0,
+    // Keypoint locations as float32 and affine shapes quantized to float16.
+    // Match indices are delta coded and bit packed with a fixed width.
+    PACKED = 1,
+    // Same as PACKED with LZ4 block compression of the keypoints. Matches are
+    // written as PACKED, since the bit packed indices do not compress.
+    PACKED_LZ4 = 2,
+  };
+
   Database();
   explicit Database(const std::string& path);
   ~Database();
@@ -80,6 +94,12 @@ class Database {
   void Open(const std::string& path);
   void Close();
 
+  // Set the encoding for writing keypoints, matches, and inlier matches. The
+  // setting is persisted in the database, so that all later writers use the
+  // same encoding. Existing rows are not converted.
+  void SetBlobEncoding(BlobEncoding encoding);
+  BlobEncoding GetBlobEncoding() const;
+
   // Check if entry already exists in database. For image pairs, the order of
   // `image_id1` and `image_id2` does not matter.
   bool ExistsCamera(camera_t camera_id) const;
@@ -250,6 +270,13 @@ class Database {
                     const Database& database2,
                     Database* merged_database);
 
+  // Import all matches and two-view geometries of a shard database into this
+  // database. The shard must have been created as a copy of this database,
+  // e.g., to match a subset of the image pairs on a different node, such that
+  // image identifiers are consistent. Existing entries for the same image
+  // pairs are replaced. Rows are copied between the tables without decoding.
+  void MergeShard(const std::string& shard_path) const;
+
  private:
   friend class DatabaseTransaction;
 
@@ -275,6 +302,7 @@ class Database {
   void CreateDescriptorsTable() const;
   void CreateMatchesTable() const;
   void CreateTwoViewGeometriesTable() const;
+  void CreateMetadataTable() const;
 
   void UpdateSchema() const;
 
@@ -286,6 +314,11 @@ class Database {
   bool ExistsRowString(sqlite3_stmt* sql_stmt,
                        const std::string& row_entry) const;
 
+  // Read and write persistent settings in the `metadata` table.
+  int64_t ReadMetadataValue(const std::string& name,
+                            int64_t default_value) const;
+  void WriteMetadataValue(const std::string& name, int64_t value) const;
+
   size_t CountRows(const std::string& table) const;
   size_t CountRowsForEntry(sqlite3_stmt* sql_stmt, sqlite3_int64 row_id) const;
   size_t SumColumn(const std::string& column, const std::string& table) const;
@@ -293,6 +326,9 @@ class Database {
 
   sqlite3* database_ = nullptr;
 
+  // Encoding used for writing keypoint and match blobs.
+  BlobEncoding blob_encoding_ = BlobEncoding::RAW;
+
   // Check if elements got removed from the database to only apply
   // the VACUUM command in such case
   mutable bool database_cleared_ = false;
@@ -346,6 +382,7 @@ class Database {
   sqlite3_stmt* sql_stmt_read_two_view_geometry_ = nullptr;
   sqlite3_stmt* sql_stmt_read_two_view_geometries_ = nullptr;
   sqlite3_stmt* sql_stmt_read_two_view_geometry_num_inliers_ = nullptr;
+  sqlite3_stmt* sql_stmt_read_metadata_ = nullptr;
 
   // write_*
   sqlite3_stmt* sql_stmt_write_pose_prior_ = nullptr;
@@ -353,6 +390,7 @@ class Database {
   sqlite3_stmt* sql_stmt_write_descriptors_ = nullptr;
   sqlite3_stmt* sql_stmt_write_matches_ = nullptr;
   sqlite3_stmt* sql_stmt_write_two_view_geometry_ = nullptr;
+  sqlite3_stmt* sql_stmt_write_metadata_ = nullptr;
 
   // delete_*
   sqlite3_stmt* sql_stmt_delete_matches_ = nullptr;
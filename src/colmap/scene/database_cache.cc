@@ -52,7 +52,9 @@ std::shared_ptr<DatabaseCache> DatabaseCache::Create(
     const Database& database,
     const size_t min_num_matches,
     const bool ignore_watermarks,
-    const std::unordered_set<std::string>& image_names) {
+    const std::unordered_set<std::string>& image_names,
+    const bool compact_correspondence_graph,
+    const std::string& correspondence_graph_path) {
   auto cache = std::make_shared<DatabaseCache>();
 
   //////////////////////////////////////////////////////////////////////////////
@@ -82,15 +84,41 @@ std::shared_ptr<DatabaseCache> DatabaseCache::Create(
   timer.Restart();
   LOG(INFO) << "Loading matches...";
 
+  const bool out_of_core = !correspondence_graph_path.empty();
+
   std::vector<image_pair_t> image_pair_ids;
   std::vector<TwoViewGeometry> two_view_geometries;
-  database.ReadTwoViewGeometries(&image_pair_ids, &two_view_geometries);
+  size_t num_ignored_image_pairs = 0;
+  if (out_of_core) {
+    // Only keep the identifiers of the used image pairs in memory and stream
+    // their inlier matches into the correspondence graph further below.
+    std::vector<std::pair<image_t, image_t>> image_pairs;
+    std::vector<int> num_inliers;
+    database.ReadTwoViewGeometryNumInliers(&image_pairs, &num_inliers);
+    for (size_t i = 0; i < image_pairs.size(); ++i) {
+      const auto& [image_id1, image_id2] = image_pairs[i];
+      if (static_cast<size_t>(num_inliers[i]) < min_num_matches ||
+          (ignore_watermarks &&
+           database.ReadTwoViewGeometry(image_id1, image_id2).config ==
+               TwoViewGeometry::WATERMARK)) {
+        num_ignored_image_pairs += 1;
+      } else {
+        image_pair_ids.push_back(
+            Database::ImagePairToPairId(image_id1, image_id2));
+      }
+    }
+  } else {
+    database.ReadTwoViewGeometries(&image_pair_ids, &two_view_geometries);
+  }
 
   LOG(INFO) << StringPrintf(
       " %d in %.3fs", image_pair_ids.size(), timer.ElapsedSeconds());
 
-  auto UseInlierMatchesCheck = [min_num_matches, ignore_watermarks](
-                                   const TwoViewGeometry& two_view_geometry) {
+  auto UseInlierMatchesCheck = [&](const size_t i) {
+    if (out_of_core) {
+      return true;
+    }
+    const TwoViewGeometry& two_view_geometry = two_view_geometries[i];
     return static_cast<size_t>(two_view_geometry.inlier_matches.size()) >=
                min_num_matches &&
            (!ignore_watermarks ||
@@ -127,7 +155,7 @@ std::shared_ptr<DatabaseCache> DatabaseCache::Create(
     std::unordered_set<image_t> connected_image_ids;
     connected_image_ids.reserve(image_ids.size());
     for (size_t i = 0; i < image_pair_ids.size(); ++i) {
-      if (UseInlierMatchesCheck(two_view_geometries[i])) {
+      if (UseInlierMatchesCheck(i)) {
         image_t image_id1;
         image_t image_id2;
         std::tie(image_id1, image_id2) =
@@ -166,22 +194,32 @@ std::shared_ptr<DatabaseCache> DatabaseCache::Create(
   LOG(INFO) << "Building correspondence graph...";
 
   cache->correspondence_graph_ = std::make_shared<class CorrespondenceGraph>();
+  if (out_of_core) {
+    cache->correspondence_graph_->SetOutOfCore(correspondence_graph_path);
+  }
 
   for (const auto& image : cache->images_) {
     cache->correspondence_graph_->AddImage(image.first,
                                            image.second.NumPoints2D());
   }
 
-  size_t num_ignored_image_pairs = 0;
   for (size_t i = 0; i < image_pair_ids.size(); ++i) {
-    if (UseInlierMatchesCheck(two_view_geometries[i])) {
+    if (UseInlierMatchesCheck(i)) {
       image_t image_id1;
       image_t image_id2;
       std::tie(image_id1, image_id2) =
           Database::PairIdToImagePair(image_pair_ids[i]);
       if (image_ids.count(image_id1) > 0 && image_ids.count(image_id2) > 0) {
-        cache->correspondence_graph_->AddCorrespondences(
-            image_id1, image_id2, two_view_geometries[i].inlier_matches);
+        if (out_of_core) {
+          cache->correspondence_graph_->AddCorrespondences(
+              image_id1,
+              image_id2,
+              database.ReadTwoViewGeometry(image_id1, image_id2)
+                  .inlier_matches);
+        } else {
+          cache->correspondence_graph_->AddCorrespondences(
+              image_id1, image_id2, two_view_geometries[i].inlier_matches);
+        }
       } else {
         num_ignored_image_pairs += 1;
       }
@@ -190,7 +228,7 @@ std::shared_ptr<DatabaseCache> DatabaseCache::Create(
     }
   }
 
-  cache->correspondence_graph_->Finalize();
+  cache->correspondence_graph_->Finalize(compact_correspondence_graph);
 
   LOG(INFO) << StringPrintf(" in %.3fs (ignored %d)",
                             timer.ElapsedSeconds(),
@@ -59,11 +59,19 @@ class DatabaseCache {
   // @param ignore_watermarks     Whether to ignore watermark image pairs.
   // @param image_names           Whether to use only load the data for a subset
   //                              of the images. All images are used if empty.
+  // @param compact_correspondence_graph  Whether to use the compact layout of
+  //                              the correspondence graph.
+  // @param correspondence_graph_path  If not empty, the correspondence graph
+  //                              is stored out of core in files at this path
+  //                              and the matches are streamed from the
+  //                              database instead of loaded at once.
   static std::shared_ptr<DatabaseCache> Create(
       const Database& database,
       size_t min_num_matches,
       bool ignore_watermarks,
-      const std::unordered_set<std::string>& image_names);
+      const std::unordered_set<std::string>& image_names,
+      bool compact_correspondence_graph = false,
+      const std::string& correspondence_graph_path = "");
 
   // Get number of objects.
   inline size_t NumCameras() const;
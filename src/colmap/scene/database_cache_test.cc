@@ -29,6 +29,8 @@
 
 #include "colmap/scene/database_cache.h"
 
+#include "colmap/util/testing.h"
+
 #include <gtest/gtest.h>
 
 namespace colmap {
@@ -90,5 +92,73 @@ TEST(DatabaseCache, Nominal) {
             1);
 }
 
+TEST(DatabaseCache, OutOfCore) {
+  Database database(Database::kInMemoryDatabasePath);
+  const Camera camera = Camera::CreateFromModelId(
+      kInvalidCameraId, SimplePinholeCameraModel::model_id, 1, 1, 1);
+  const camera_t camera_id = database.WriteCamera(camera);
+  std::vector<image_t> image_ids;
+  for (int i = 0; i < 4; ++i) {
+    Image image;
+    image.SetName("image" + std::to_string(i));
+    image.SetCameraId(camera_id);
+    image_ids.push_back(database.WriteImage(image));
+    database.WriteKeypoints(image_ids.back(), FeatureKeypoints(10));
+  }
+  TwoViewGeometry two_view_geometry;
+  two_view_geometry.config = TwoViewGeometry::ConfigurationType::CALIBRATED;
+  two_view_geometry.inlier_matches = {{0, 1}, {2, 3}};
+  database.WriteTwoViewGeometry(image_ids[0], image_ids[1], two_view_geometry);
+  two_view_geometry.inlier_matches = {{1, 1}};
+  database.WriteTwoViewGeometry(image_ids[1], image_ids[2], two_view_geometry);
+  two_view_geometry.config = TwoViewGeometry::ConfigurationType::WATERMARK;
+  two_view_geometry.inlier_matches = {{4, 4}, {5, 5}};
+  database.WriteTwoViewGeometry(image_ids[2], image_ids[3], two_view_geometry);
+
+  const std::string path = CreateTestDir() + "/correspondence_graph.bin";
+  for (const size_t min_num_matches : {0, 2}) {
+    for (const bool ignore_watermarks : {false, true}) {
+      const auto cache = DatabaseCache::Create(database,
+                                               min_num_matches,
+                                               ignore_watermarks,
+                                               /*image_names=*/{});
+      const auto out_of_core_cache =
+          DatabaseCache::Create(database,
+                                min_num_matches,
+                                ignore_watermarks,
+                                /*image_names=*/{},
+                                /*compact_correspondence_graph=*/false,
+                                path);
+      const auto graph = cache->CorrespondenceGraph();
+      const auto out_of_core_graph = out_of_core_cache->CorrespondenceGraph();
+      EXPECT_FALSE(graph->IsOutOfCore());
+      EXPECT_TRUE(out_of_core_graph->IsOutOfCore());
+      EXPECT_EQ(cache->NumImages(), out_of_core_cache->NumImages());
+      EXPECT_EQ(graph->NumImages(), out_of_core_graph->NumImages());
+      EXPECT_EQ(graph->NumCorrespondencesBetweenImages(),
+                out_of_core_graph->NumCorrespondencesBetweenImages());
+      for (const image_t image_id : image_ids) {
+        ASSERT_EQ(graph->ExistsImage(image_id),
+                  out_of_core_graph->ExistsImage(image_id));
+        if (!graph->ExistsImage(image_id)) {
+          continue;
+        }
+        for (point2D_t point2D_idx = 0; point2D_idx < 10; ++point2D_idx) {
+          std::vector<CorrespondenceGraph::Correspondence> corrs;
+          std::vector<CorrespondenceGraph::Correspondence> out_of_core_corrs;
+          graph->ExtractCorrespondences(image_id, point2D_idx, &corrs);
+          out_of_core_graph->ExtractCorrespondences(
+              image_id, point2D_idx, &out_of_core_corrs);
+          ASSERT_EQ(corrs.size(), out_of_core_corrs.size());
+          for (size_t i = 0; i < corrs.size(); ++i) {
+            EXPECT_EQ(corrs[i].image_id, out_of_core_corrs[i].image_id);
+            EXPECT_EQ(corrs[i].point2D_idx, out_of_core_corrs[i].point2D_idx);
+          }
+        }
+      }
+    }
+  }
+}
+
 }  // namespace
 }  // namespace colmap
@@ -31,7 +31,9 @@
 
 #include "colmap/geometry/pose.h"
 #include "colmap/util/eigen_alignment.h"
+#include "colmap/util/testing.h"
 
+#include <limits>
 #include <thread>
 
 #include <Eigen/Geometry>
@@ -417,6 +419,131 @@ TEST(Database, TwoViewGeometry) {
   EXPECT_EQ(database.NumInlierMatches(), 0);
 }
 
+class ParameterizedDatabaseBlobEncodingTests
+    : public ::testing::TestWithParam<Database::BlobEncoding> {};
+
+TEST_P(ParameterizedDatabaseBlobEncodingTests, Nominal) {
+  const Database::BlobEncoding encoding = GetParam();
+  const std::string database_path = CreateTestDir() + "/database.db";
+  {
+    Database database(database_path);
+    EXPECT_EQ(database.GetBlobEncoding(), Database::BlobEncoding::RAW);
+    database.SetBlobEncoding(encoding);
+  }
+
+  Database database(database_path);
+  EXPECT_EQ(database.GetBlobEncoding(), encoding);
+  Camera camera;
+  camera.camera_id = database.WriteCamera(camera);
+  Image image;
+  image.SetName("test");
+  image.SetCameraId(camera.camera_id);
+  image.SetImageId(database.WriteImage(image));
+
+  FeatureKeypoints keypoints;
+  for (int i = 0; i < 100; ++i) {
+    keypoints.push_back(FeatureKeypoint(1000.f * std::rand() / RAND_MAX,
+                                        1000.f * std::rand() / RAND_MAX,
+                                        10.f * std::rand() / RAND_MAX,
+                                        6.f * std::rand() / RAND_MAX));
+  }
+  database.WriteKeypoints(image.ImageId(), keypoints);
+  EXPECT_EQ(database.NumKeypoints(), keypoints.size());
+  const FeatureKeypoints keypoints_read =
+      database.ReadKeypoints(image.ImageId());
+  ASSERT_EQ(keypoints.size(), keypoints_read.size());
+  for (size_t i = 0; i < keypoints.size(); ++i) {
+    EXPECT_EQ(keypoints[i].x, keypoints_read[i].x);
+    EXPECT_EQ(keypoints[i].y, keypoints_read[i].y);
+    EXPECT_NEAR(keypoints[i].a11, keypoints_read[i].a11, 1e-2);
+    EXPECT_NEAR(keypoints[i].a12, keypoints_read[i].a12, 1e-2);
+    EXPECT_NEAR(keypoints[i].a21, keypoints_read[i].a21, 1e-2);
+    EXPECT_NEAR(keypoints[i].a22, keypoints_read[i].a22, 1e-2);
+  }
+
+  const image_t image_id1 = 1;
+  const image_t image_id2 = 2;
+  FeatureMatches matches(1000);
+  for (size_t i = 0; i < matches.size(); ++i) {
+    matches[i].point2D_idx1 = 3 * i + std::rand() % 3;
+    matches[i].point2D_idx2 = std::rand() % 100000;
+  }
+  std::swap(matches[0], matches[10]);
+  matches[20].point2D_idx2 = std::numeric_limits<point2D_t>::max();
+  database.WriteMatches(image_id1, image_id2, matches);
+  EXPECT_EQ(database.NumMatches(), matches.size());
+  const FeatureMatches matches_read12 =
+      database.ReadMatches(image_id1, image_id2);
+  const FeatureMatches matches_read21 =
+      database.ReadMatches(image_id2, image_id1);
+  ASSERT_EQ(matches.size(), matches_read12.size());
+  ASSERT_EQ(matches.size(), matches_read21.size());
+  for (size_t i = 0; i < matches.size(); ++i) {
+    EXPECT_EQ(matches[i].point2D_idx1, matches_read12[i].point2D_idx1);
+    EXPECT_EQ(matches[i].point2D_idx2, matches_read12[i].point2D_idx2);
+    EXPECT_EQ(matches[i].point2D_idx1, matches_read21[i].point2D_idx2);
+    EXPECT_EQ(matches[i].point2D_idx2, matches_read21[i].point2D_idx1);
+  }
+  const auto all_matches = database.ReadAllMatches();
+  ASSERT_EQ(all_matches.size(), 1);
+  EXPECT_EQ(all_matches[0].second.size(), matches.size());
+
+  TwoViewGeometry two_view_geometry;
+  two_view_geometry.inlier_matches = matches;
+  two_view_geometry.config = TwoViewGeometry::ConfigurationType::CALIBRATED;
+  database.WriteTwoViewGeometry(image_id2, image_id1, two_view_geometry);
+  EXPECT_EQ(database.NumInlierMatches(), matches.size());
+  const TwoViewGeometry two_view_geometry_read =
+      database.ReadTwoViewGeometry(image_id2, image_id1);
+  ASSERT_EQ(two_view_geometry_read.inlier_matches.size(), matches.size());
+  for (size_t i = 0; i < matches.size(); ++i) {
+    EXPECT_EQ(matches[i].point2D_idx1,
+              two_view_geometry_read.inlier_matches[i].point2D_idx1);
+    EXPECT_EQ(matches[i].point2D_idx2,
+              two_view_geometry_read.inlier_matches[i].point2D_idx2);
+  }
+  EXPECT_EQ(two_view_geometry_read.config, two_view_geometry.config);
+  std::vector<image_pair_t> image_pair_ids;
+  std::vector<TwoViewGeometry> two_view_geometries;
+  database.ReadTwoViewGeometries(&image_pair_ids, &two_view_geometries);
+  ASSERT_EQ(two_view_geometries.size(), 1);
+  EXPECT_EQ(two_view_geometries[0].inlier_matches.size(), matches.size());
+
+  database.WriteMatches(image_id1, 3, FeatureMatches());
+  EXPECT_EQ(database.ReadMatches(image_id1, 3).size(), 0);
+
+  // Rows with different encodings can be mixed in the same database.
+  database.SetBlobEncoding(Database::BlobEncoding::RAW);
+  database.WriteMatches(image_id1, 4, matches);
+  EXPECT_EQ(database.ReadMatches(image_id1, 4).size(), matches.size());
+  EXPECT_EQ(database.ReadMatches(image_id1, image_id2).size(), matches.size());
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    DatabaseBlobEncodingTests,
+    ParameterizedDatabaseBlobEncodingTests,
+    ::testing::Values(Database::BlobEncoding::RAW,
+                      Database::BlobEncoding::PACKED,
+                      Database::BlobEncoding::PACKED_LZ4));
+
+TEST(Database, InvalidBlobEncoding) {
+  const std::string database_path = CreateTestDir() + "/database.db";
+  { Database database(database_path); }
+
+  sqlite3* database = nullptr;
+  ASSERT_EQ(sqlite3_open(database_path.c_str(), &database), SQLITE_OK);
+  ASSERT_EQ(sqlite3_exec(database,
+                         "INSERT OR REPLACE INTO metadata(name, value) "
+                         "VALUES('blob_encoding', 3);",
+                         nullptr,
+                         nullptr,
+                         nullptr),
+            SQLITE_OK);
+  sqlite3_close(database);
+
+  EXPECT_ANY_THROW(Database{database_path});
+}
+
 TEST(Database, Merge) {
   Database database1(Database::kInMemoryDatabasePath);
   Database database2(Database::kInMemoryDatabasePath);
@@ -512,5 +639,48 @@ TEST(Database, Merge) {
   EXPECT_EQ(merged_database.NumMatches(), 0);
 }
 
+TEST(Database, MergeShard) {
+  const std::string test_dir = CreateTestDir();
+  const std::string database_path = test_dir + "/database.db";
+  const std::string shard_path = test_dir + "/shard.db";
+
+  Database database(database_path);
+  Database shard(shard_path);
+  Camera camera = Camera::CreateFromModelName(
+      kInvalidCameraId, "SIMPLE_PINHOLE", 1.0, 1, 1);
+  camera.camera_id = database.WriteCamera(camera);
+  shard.WriteCamera(camera, /*use_camera_id=*/true);
+  Image image;
+  image.SetCameraId(camera.camera_id);
+  for (int i = 0; i < 3; ++i) {
+    image.SetName("test" + std::to_string(i));
+    image.SetImageId(database.WriteImage(image));
+    shard.WriteImage(image, /*use_image_id=*/true);
+  }
+
+  database.WriteMatches(1, 2, FeatureMatches(10));
+  shard.WriteMatches(1, 2, FeatureMatches(20));
+  shard.WriteMatches(2, 3, FeatureMatches(30));
+  TwoViewGeometry two_view_geometry;
+  two_view_geometry.inlier_matches = FeatureMatches(5);
+  two_view_geometry.config = TwoViewGeometry::ConfigurationType::CALIBRATED;
+  shard.WriteTwoViewGeometry(3, 2, two_view_geometry);
+
+  database.MergeShard(shard_path);
+  EXPECT_EQ(database.NumMatchedImagePairs(), 2);
+  EXPECT_EQ(database.ReadMatches(1, 2).size(), 20);
+  EXPECT_EQ(database.ReadMatches(3, 2).size(), 30);
+  EXPECT_EQ(database.NumVerifiedImagePairs(), 1);
+  const TwoViewGeometry two_view_geometry_read =
+      database.ReadTwoViewGeometry(3, 2);
+  EXPECT_EQ(two_view_geometry_read.config, two_view_geometry.config);
+  EXPECT_EQ(two_view_geometry_read.inlier_matches.size(), 5);
+
+  image.SetName("test3");
+  image.SetImageId(shard.WriteImage(image));
+  EXPECT_ANY_THROW(database.MergeShard(shard_path));
+  EXPECT_EQ(database.NumMatchedImagePairs(), 2);
+}
+
 }  // namespace
 }  // namespace colmap
@@ -32,28 +32,103 @@
 #include "colmap/geometry/pose.h"
 #include "colmap/scene/projection.h"
 
+#include <utility>
+
 namespace colmap {
+namespace {
+
+// Empty image points that moved-from images share, such that moving does not
+// allocate and the moved-from image remains valid. The points are never
+// modified, since the non-const accessors copy shared points before writing.
+const std::shared_ptr<std::vector<struct Point2D>>& EmptyPoints2D() {
+  static const auto* kEmptyPoints2D =
+      new std::shared_ptr<std::vector<struct Point2D>>(
+          std::make_shared<std::vector<struct Point2D>>());
+  return *kEmptyPoints2D;
+}
+
+}  // namespace
 
 Image::Image()
     : image_id_(kInvalidImageId),
       name_(""),
       camera_id_(kInvalidCameraId),
       registered_(false),
-      num_points3D_(0) {}
+      num_points3D_(0),
+      points2D_(std::make_shared<std::vector<struct Point2D>>()) {}
+
+Image::Image(const Image& other)
+    : image_id_(other.image_id_),
+      name_(other.name_),
+      camera_id_(other.camera_id_),
+      registered_(other.registered_),
+      num_points3D_(other.num_points3D_),
+      cam_from_world_(other.cam_from_world_),
+      points2D_(other.points2D_) {
+  if (registered_) {
+    MutablePoints2D();
+  }
+}
+
+Image::Image(Image&& other) noexcept
+    : image_id_(other.image_id_),
+      name_(std::move(other.name_)),
+      camera_id_(other.camera_id_),
+      registered_(other.registered_),
+      num_points3D_(std::exchange(other.num_points3D_, 0)),
+      cam_from_world_(other.cam_from_world_),
+      points2D_(std::exchange(other.points2D_, EmptyPoints2D())) {}
+
+Image& Image::operator=(const Image& other) {
+  if (this != &other) {
+    image_id_ = other.image_id_;
+    name_ = other.name_;
+    camera_id_ = other.camera_id_;
+    registered_ = other.registered_;
+    num_points3D_ = other.num_points3D_;
+    cam_from_world_ = other.cam_from_world_;
+    points2D_ = other.points2D_;
+    if (registered_) {
+      MutablePoints2D();
+    }
+  }
+  return *this;
+}
+
+Image& Image::operator=(Image&& other) noexcept {
+  if (this != &other) {
+    image_id_ = other.image_id_;
+    name_ = std::move(other.name_);
+    camera_id_ = other.camera_id_;
+    registered_ = other.registered_;
+    num_points3D_ = std::exchange(other.num_points3D_, 0);
+    cam_from_world_ = other.cam_from_world_;
+    points2D_ = std::exchange(other.points2D_, EmptyPoints2D());
+  }
+  return *this;
+}
+
+void Image::SetRegistered(const bool registered) {
+  registered_ = registered;
+  if (registered_) {
+    MutablePoints2D();
+  }
+}
 
 void Image::SetPoints2D(const std::vector<Eigen::Vector2d>& points) {
-  THROW_CHECK(points2D_.empty());
-  points2D_.resize(points.size());
+  THROW_CHECK(points2D_->empty());
+  std::vector<struct Point2D>& points2D = MutablePoints2D();
+  points2D.resize(points.size());
   for (point2D_t point2D_idx = 0; point2D_idx < points.size(); ++point2D_idx) {
-    points2D_[point2D_idx].xy = points[point2D_idx];
+    points2D[point2D_idx].xy = points[point2D_idx];
   }
 }
 
 void Image::SetPoints2D(const std::vector<struct Point2D>& points) {
-  THROW_CHECK(points2D_.empty());
-  points2D_ = points;
+  THROW_CHECK(points2D_->empty());
+  MutablePoints2D() = points;
   num_points3D_ = 0;
-  for (const auto& point2D : points2D_) {
+  for (const auto& point2D : *points2D_) {
     if (point2D.HasPoint3D()) {
       num_points3D_ += 1;
     }
@@ -63,7 +138,7 @@ void Image::SetPoints2D(const std::vector<struct Point2D>& points) {
 void Image::SetPoint3DForPoint2D(const point2D_t point2D_idx,
                                  const point3D_t point3D_id) {
   THROW_CHECK_NE(point3D_id, kInvalidPoint3DId);
-  struct Point2D& point2D = points2D_.at(point2D_idx);
+  struct Point2D& point2D = MutablePoints2D().at(point2D_idx);
   if (!point2D.HasPoint3D()) {
     num_points3D_ += 1;
   }
@@ -71,7 +146,7 @@ void Image::SetPoint3DForPoint2D(const point2D_t point2D_idx,
 }
 
 void Image::ResetPoint3DForPoint2D(const point2D_t point2D_idx) {
-  struct Point2D& point2D = points2D_.at(point2D_idx);
+  struct Point2D& point2D = MutablePoints2D().at(point2D_idx);
   if (point2D.HasPoint3D()) {
     point2D.point3D_id = kInvalidPoint3DId;
     num_points3D_ -= 1;
@@ -79,11 +154,11 @@ void Image::ResetPoint3DForPoint2D(const point2D_t point2D_idx) {
 }
 
 bool Image::HasPoint3D(const point3D_t point3D_id) const {
-  return std::find_if(points2D_.begin(),
-                      points2D_.end(),
+  return std::find_if(points2D_->begin(),
+                      points2D_->end(),
                       [point3D_id](const struct Point2D& point2D) {
                         return point2D.point3D_id == point3D_id;
-                      }) != points2D_.end();
+                      }) != points2D_->end();
 }
 
 Eigen::Vector3d Image::ProjectionCenter() const {
@@ -94,4 +169,11 @@ Eigen::Vector3d Image::ViewingDirection() const {
   return cam_from_world_.rotation.toRotationMatrix().row(2);
 }
 
+std::vector<struct Point2D>& Image::MutablePoints2D() {
+  if (points2D_.use_count() > 1) {
+    points2D_ = std::make_shared<std::vector<struct Point2D>>(*points2D_);
+  }
+  return *points2D_;
+}
+
 }  // namespace colmap
@@ -38,6 +38,7 @@
 #include "colmap/util/logging.h"
 #include "colmap/util/types.h"
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -48,9 +49,22 @@ namespace colmap {
 // Class that holds information about an image. An image is the product of one
 // camera shot at a certain location (parameterized as the pose). An image may
 // share a camera with multiple other images, if its intrinsics are the same.
+//
+// The image points of unregistered images are shared between copies of the
+// image, e.g., between the database cache and the reconstructions loaded from
+// it, until one of the copies modifies them. Registered images and copies of
+// registered images own their image points, such that references to the points
+// of an image in a reconstruction stay valid when the reconstruction
+// triangulates them. Note that the non-const accessors of the image points copy
+// shared points and must therefore not be called concurrently for the same
+// unregistered image. Moved-from images have no image points.
 class Image {
  public:
   Image();
+  Image(const Image& other);
+  Image(Image&& other) noexcept;
+  Image& operator=(const Image& other);
+  Image& operator=(Image&& other) noexcept;
 
   // Access the unique identifier of the image.
   inline image_t ImageId() const;
@@ -70,7 +84,7 @@ class Image {
 
   // Check if image is registered.
   inline bool IsRegistered() const;
-  inline void SetRegistered(bool registered);
+  void SetRegistered(bool registered);
 
   // Get the number of image points.
   inline point2D_t NumPoints2D() const;
@@ -91,6 +105,9 @@ class Image {
   void SetPoints2D(const std::vector<Eigen::Vector2d>& points);
   void SetPoints2D(const std::vector<struct Point2D>& points);
 
+  // Check whether the image points are shared with other copies of the image.
+  inline bool HasSharedPoints2D() const;
+
   // Set the point as triangulated, i.e. it is part of a 3D point track.
   void SetPoint3DForPoint2D(point2D_t point2D_idx, point3D_t point3D_id);
 
@@ -107,6 +124,9 @@ class Image {
   Eigen::Vector3d ViewingDirection() const;
 
  private:
+  // Get mutable image points and copy them, if they are shared.
+  std::vector<struct Point2D>& MutablePoints2D();
+
   // Identifier of the image, if not specified `kInvalidImageId`.
   image_t image_id_;
 
@@ -128,7 +148,7 @@ class Image {
   Rigid3d cam_from_world_;
 
   // All image points, including points that are not part of a 3D point track.
-  std::vector<struct Point2D> points2D_;
+  std::shared_ptr<std::vector<struct Point2D>> points2D_;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -156,10 +176,8 @@ inline bool Image::HasCamera() const { return camera_id_ != kInvalidCameraId; }
 
 bool Image::IsRegistered() const { return registered_; }
 
-void Image::SetRegistered(const bool registered) { registered_ = registered; }
-
 point2D_t Image::NumPoints2D() const {
-  return static_cast<point2D_t>(points2D_.size());
+  return static_cast<point2D_t>(points2D_->size());
 }
 
 point2D_t Image::NumPoints3D() const { return num_points3D_; }
@@ -169,15 +187,19 @@ const Rigid3d& Image::CamFromWorld() const { return cam_from_world_; }
 Rigid3d& Image::CamFromWorld() { return cam_from_world_; }
 
 const struct Point2D& Image::Point2D(const point2D_t point2D_idx) const {
-  return points2D_.at(point2D_idx);
+  return points2D_->at(point2D_idx);
 }
 
 struct Point2D& Image::Point2D(const point2D_t point2D_idx) {
-  return points2D_.at(point2D_idx);
+  return MutablePoints2D().at(point2D_idx);
+}
+
+const std::vector<struct Point2D>& Image::Points2D() const {
+  return *points2D_;
 }
 
-const std::vector<struct Point2D>& Image::Points2D() const { return points2D_; }
+std::vector<struct Point2D>& Image::Points2D() { return MutablePoints2D(); }
 
-std::vector<struct Point2D>& Image::Points2D() { return points2D_; }
+bool Image::HasSharedPoints2D() const { return points2D_.use_count() > 1; }
 
 }  // namespace colmap
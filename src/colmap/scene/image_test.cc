@@ -29,6 +29,8 @@
 
 #include "colmap/scene/image.h"
 
+#include <utility>
+
 #include <gtest/gtest.h>
 
 namespace colmap {
@@ -111,6 +113,64 @@ TEST(Image, Points2D) {
   EXPECT_EQ(image.NumPoints3D(), 0);
 }
 
+TEST(Image, SharedPoints2D) {
+  Image image;
+  image.SetPoints2D(std::vector<Eigen::Vector2d>(10, Eigen::Vector2d::Ones()));
+  EXPECT_FALSE(image.HasSharedPoints2D());
+
+  // Copies of unregistered images share their points until modified.
+  Image copied_image = image;
+  EXPECT_TRUE(image.HasSharedPoints2D());
+  EXPECT_TRUE(copied_image.HasSharedPoints2D());
+  EXPECT_EQ(&std::as_const(copied_image).Points2D(),
+            &std::as_const(image).Points2D());
+  copied_image.SetPoint3DForPoint2D(0, 1);
+  EXPECT_FALSE(image.HasSharedPoints2D());
+  EXPECT_FALSE(copied_image.HasSharedPoints2D());
+  EXPECT_TRUE(copied_image.Point2D(0).HasPoint3D());
+  EXPECT_FALSE(image.Point2D(0).HasPoint3D());
+  EXPECT_EQ(copied_image.Point2D(1).xy, image.Point2D(1).xy);
+
+  // Registered images own their points.
+  Image assigned_image;
+  assigned_image = image;
+  EXPECT_TRUE(image.HasSharedPoints2D());
+  assigned_image.SetRegistered(true);
+  EXPECT_FALSE(image.HasSharedPoints2D());
+  EXPECT_FALSE(assigned_image.HasSharedPoints2D());
+  const Image copied_registered_image = assigned_image;
+  EXPECT_FALSE(assigned_image.HasSharedPoints2D());
+  EXPECT_FALSE(copied_registered_image.HasSharedPoints2D());
+  EXPECT_EQ(copied_registered_image.NumPoints2D(), 10);
+}
+
+TEST(Image, MovePoints2D) {
+  Image image;
+  image.SetPoints2D(std::vector<Eigen::Vector2d>(10, Eigen::Vector2d::Ones()));
+  image.SetPoint3DForPoint2D(0, 1);
+  const std::vector<struct Point2D>* points2D = &image.Points2D();
+
+  // Moving transfers the points and leaves a valid image without points.
+  Image moved_image = std::move(image);
+  EXPECT_EQ(&moved_image.Points2D(), points2D);
+  EXPECT_EQ(moved_image.NumPoints2D(), 10);
+  EXPECT_EQ(moved_image.NumPoints3D(), 1);
+  EXPECT_EQ(image.NumPoints2D(), 0);
+  EXPECT_EQ(image.NumPoints3D(), 0);
+  EXPECT_TRUE(image.Points2D().empty());
+
+  Image move_assigned_image;
+  move_assigned_image = std::move(moved_image);
+  EXPECT_EQ(&move_assigned_image.Points2D(), points2D);
+  EXPECT_EQ(moved_image.NumPoints2D(), 0);
+  EXPECT_TRUE(moved_image.Points2D().empty());
+
+  // Moved-from images can be reused without modifying other images.
+  image.SetPoints2D(std::vector<Eigen::Vector2d>(5, Eigen::Vector2d::Zero()));
+  EXPECT_EQ(image.NumPoints2D(), 5);
+  EXPECT_EQ(moved_image.NumPoints2D(), 0);
+}
+
 TEST(Image, Points2DWith3D) {
   Image image;
   EXPECT_EQ(image.Points2D().size(), 0);
@@ -0,0 +1,251 @@
+// Copyright (c) 2023, ETH Zurich and UNC Chapel Hill.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of ETH Zurich and UNC Chapel Hill nor the names of
+//       its contributors may be used to endorse or promote products derived
+//       from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "colmap/scene/point3d_spatial_index.h"
+
+#include "colmap/util/logging.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace colmap {
+namespace {
+
+// Voxel coordinates are clamped to this range to avoid overflow for points
+// that are far away from the origin. Clamped points share boundary voxels,
+// which only adds candidates that are rejected by the exact distance checks.
+constexpr double kMaxVoxelCoord = 1e15;
+
+int64_t VoxelCoord(const double coord, const double voxel_size) {
+  return static_cast<int64_t>(std::clamp(
+      std::floor(coord / voxel_size), -kMaxVoxelCoord, kMaxVoxelCoord));
+}
+
+}  // namespace
+
+Point3DSpatialIndex::Point3DSpatialIndex(const double voxel_size)
+    : voxel_size_(voxel_size) {
+  THROW_CHECK_GT(voxel_size, 0);
+}
+
+size_t Point3DSpatialIndex::VoxelHash::operator()(const Voxel& voxel) const {
+  // Hash function from "Optimized Spatial Hashing for Collision Detection of
+  // Deformable Objects", Teschner et al., 2003.
+  return static_cast<size_t>((static_cast<uint64_t>(voxel.x) * 73856093) ^
+                             (static_cast<uint64_t>(voxel.y) * 19349663) ^
+                             (static_cast<uint64_t>(voxel.z) * 83492791));
+}
+
+Point3DSpatialIndex::Voxel Point3DSpatialIndex::VoxelForPoint(
+    const Eigen::Vector3d& xyz) const {
+  return Voxel{VoxelCoord(xyz.x(), voxel_size_),
+               VoxelCoord(xyz.y(), voxel_size_),
+               VoxelCoord(xyz.z(), voxel_size_)};
+}
+
+void Point3DSpatialIndex::SetPoint3D(const point3D_t point3D_id,
+                                     const Eigen::Vector3d& xyz) {
+  THROW_CHECK(xyz.allFinite());
+  const Voxel voxel = VoxelForPoint(xyz);
+  const auto [it, inserted] = positions_.emplace(point3D_id, xyz);
+  if (!inserted) {
+    const Voxel prev_voxel = VoxelForPoint(it->second);
+    it->second = xyz;
+    if (prev_voxel == voxel) {
+      return;
+    }
+    auto& prev_point3D_ids = voxels_.at(prev_voxel);
+    prev_point3D_ids.erase(std::find(
+        prev_point3D_ids.begin(), prev_point3D_ids.end(), point3D_id));
+    if (prev_point3D_ids.empty()) {
+      voxels_.erase(prev_voxel);
+    }
+  }
+  voxels_[voxel].push_back(point3D_id);
+}
+
+void Point3DSpatialIndex::DeletePoint3D(const point3D_t point3D_id) {
+  const auto it = positions_.find(point3D_id);
+  if (it == positions_.end()) {
+    return;
+  }
+  const Voxel voxel = VoxelForPoint(it->second);
+  positions_.erase(it);
+  auto& point3D_ids = voxels_.at(voxel);
+  point3D_ids.erase(
+      std::find(point3D_ids.begin(), point3D_ids.end(), point3D_id));
+  if (point3D_ids.empty()) {
+    voxels_.erase(voxel);
+  }
+}
+
+void Point3DSpatialIndex::Clear() {
+  positions_.clear();
+  voxels_.clear();
+}
+
+void Point3DSpatialIndex::CollectCandidates(
+    const Voxel& min_voxel,
+    const Voxel& max_voxel,
+    std::vector<point3D_t>* candidates) const {
+  const double num_voxels =
+      static_cast<double>(max_voxel.x - min_voxel.x + 1) *
+      static_cast<double>(max_voxel.y - min_voxel.y + 1) *
+      static_cast<double>(max_voxel.z - min_voxel.z + 1);
+  if (num_voxels > voxels_.size()) {
+    for (const auto& [voxel, point3D_ids] : voxels_) {
+      if (voxel.x >= min_voxel.x && voxel.x <= max_voxel.x &&
+          voxel.y >= min_voxel.y && voxel.y <= max_voxel.y &&
+          voxel.z >= min_voxel.z && voxel.z <= max_voxel.z) {
+        candidates->insert(
+            candidates->end(), point3D_ids.begin(), point3D_ids.end());
+      }
+    }
+    return;
+  }
+
+  for (int64_t x = min_voxel.x; x <= max_voxel.x; ++x) {
+    for (int64_t y = min_voxel.y; y <= max_voxel.y; ++y) {
+      for (int64_t z = min_voxel.z; z <= max_voxel.z; ++z) {
+        const auto it = voxels_.find(Voxel{x, y, z});
+        if (it != voxels_.end()) {
+          candidates->insert(
+              candidates->end(), it->second.begin(), it->second.end());
+        }
+      }
+    }
+  }
+}
+
+std::vector<point3D_t> Point3DSpatialIndex::FindInRadius(
+    const Eigen::Vector3d& center, const double radius) const {
+  std::vector<point3D_t> point3D_ids;
+  if (radius < 0) {
+    return point3D_ids;
+  }
+  const Eigen::Vector3d offset = Eigen::Vector3d::Constant(radius);
+  CollectCandidates(
+      VoxelForPoint(center - offset), VoxelForPoint(center + offset),
+      &point3D_ids);
+  const double radius_squared = radius * radius;
+  point3D_ids.erase(
+      std::remove_if(point3D_ids.begin(),
+                     point3D_ids.end(),
+                     [&](const point3D_t point3D_id) {
+                       return (positions_.at(point3D_id) - center)
+                                  .squaredNorm() > radius_squared;
+                     }),
+      point3D_ids.end());
+  std::sort(point3D_ids.begin(), point3D_ids.end());
+  return point3D_ids;
+}
+
+std::vector<point3D_t> Point3DSpatialIndex::FindInBox(
+    const Eigen::Vector3d& min_xyz, const Eigen::Vector3d& max_xyz) const {
+  std::vector<point3D_t> point3D_ids;
+  if ((min_xyz.array() > max_xyz.array()).any()) {
+    return point3D_ids;
+  }
+  CollectCandidates(
+      VoxelForPoint(min_xyz), VoxelForPoint(max_xyz), &point3D_ids);
+  point3D_ids.erase(
+      std::remove_if(point3D_ids.begin(),
+                     point3D_ids.end(),
+                     [&](const point3D_t point3D_id) {
+                       const Eigen::Vector3d& xyz = positions_.at(point3D_id);
+                       return (xyz.array() < min_xyz.array()).any() ||
+                              (xyz.array() > max_xyz.array()).any();
+                     }),
+      point3D_ids.end());
+  std::sort(point3D_ids.begin(), point3D_ids.end());
+  return point3D_ids;
+}
+
+std::vector<point3D_t> Point3DSpatialIndex::FindNearest(
+    const Eigen::Vector3d& xyz, const size_t k) const {
+  std::vector<std::pair<double, point3D_t>> candidates;
+  auto AddCandidates = [&](const std::vector<point3D_t>& point3D_ids) {
+    for (const point3D_t point3D_id : point3D_ids) {
+      candidates.emplace_back((positions_.at(point3D_id) - xyz).squaredNorm(),
+                              point3D_id);
+    }
+  };
+
+  // Visit the shells of voxels around the query voxel with increasing
+  // Chebyshev distance r, until the k-th nearest candidate is strictly closer
+  // than any point in the unvisited voxels, which are at least r voxels away.
+  // Falls back to visiting all voxels, if the shells contain more voxels.
+  const Voxel center = VoxelForPoint(xyz);
+  const size_t num_nearest = std::min(k, positions_.size());
+  for (int64_t r = 0; num_nearest > 0; ++r) {
+    const double num_visited_voxels = std::pow(2.0 * r + 1.0, 3.0);
+    if (num_visited_voxels > voxels_.size()) {
+      candidates.clear();
+      for (const auto& voxel : voxels_) {
+        AddCandidates(voxel.second);
+      }
+      break;
+    }
+
+    for (int64_t dx = -r; dx <= r; ++dx) {
+      for (int64_t dy = -r; dy <= r; ++dy) {
+        const bool on_shell = std::abs(dx) == r || std::abs(dy) == r;
+        for (int64_t dz = -r; dz <= r; dz += on_shell ? 1 : 2 * r) {
+          const auto it =
+              voxels_.find(Voxel{center.x + dx, center.y + dy, center.z + dz});
+          if (it != voxels_.end()) {
+            AddCandidates(it->second);
+          }
+        }
+      }
+    }
+
+    if (candidates.size() >= num_nearest) {
+      std::nth_element(candidates.begin(),
+                       candidates.begin() + num_nearest - 1,
+                       candidates.end());
+      const double min_unvisited_dist = r * voxel_size_;
+      if (candidates[num_nearest - 1].first <
+          min_unvisited_dist * min_unvisited_dist) {
+        break;
+      }
+    }
+  }
+
+  std::partial_sort(candidates.begin(),
+                    candidates.begin() + num_nearest,
+                    candidates.end());
+  std::vector<point3D_t> point3D_ids(num_nearest);
+  for (size_t i = 0; i < num_nearest; ++i) {
+    point3D_ids[i] = candidates[i].second;
+  }
+  return point3D_ids;
+}
+
+}  // namespace colmap
@@ -0,0 +1,118 @@
+// Copyright (c) 2023, ETH Zurich and UNC Chapel Hill.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of ETH Zurich and UNC Chapel Hill nor the names of
+//       its contributors may be used to endorse or promote products derived
+//       from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include "colmap/util/types.h"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <Eigen/Core>
+
+namespace colmap {
+
+// Spatial index over 3D points based on a hash of the voxels of a regular
+// grid. Points can be inserted, moved, and deleted incrementally, and the
+// radius, box, and nearest neighbor queries only visit the voxels around the
+// queried region instead of all points. The voxel size should be in the order
+// of the typical query radius or point spacing.
+class Point3DSpatialIndex {
+ public:
+  explicit Point3DSpatialIndex(double voxel_size = 1.0);
+
+  inline double VoxelSize() const;
+  inline size_t NumPoints3D() const;
+  inline bool ExistsPoint3D(point3D_t point3D_id) const;
+
+  // Insert the point or move it to the new position, if it already exists.
+  void SetPoint3D(point3D_t point3D_id, const Eigen::Vector3d& xyz);
+
+  // Delete the point, if it exists.
+  void DeletePoint3D(point3D_t point3D_id);
+
+  void Clear();
+
+  // Find the points within the given distance of the center. The points are
+  // ordered by their identifiers.
+  std::vector<point3D_t> FindInRadius(const Eigen::Vector3d& center,
+                                      double radius) const;
+
+  // Find the points inside the axis-aligned box, including its boundary. The
+  // points are ordered by their identifiers.
+  std::vector<point3D_t> FindInBox(const Eigen::Vector3d& min_xyz,
+                                   const Eigen::Vector3d& max_xyz) const;
+
+  // Find the k nearest points ordered by increasing distance, where ties are
+  // ordered by the identifiers of the points.
+  std::vector<point3D_t> FindNearest(const Eigen::Vector3d& xyz,
+                                     size_t k) const;
+
+ private:
+  struct Voxel {
+    int64_t x;
+    int64_t y;
+    int64_t z;
+    bool operator==(const Voxel& other) const {
+      return x == other.x && y == other.y && z == other.z;
+    }
+  };
+
+  struct VoxelHash {
+    size_t operator()(const Voxel& voxel) const;
+  };
+
+  Voxel VoxelForPoint(const Eigen::Vector3d& xyz) const;
+
+  // Append the points of all voxels in the given range of voxels to the
+  // candidates, or of all voxels if the range contains more voxels than there
+  // are populated voxels.
+  void CollectCandidates(const Voxel& min_voxel,
+                         const Voxel& max_voxel,
+                         std::vector<point3D_t>* candidates) const;
+
+  double voxel_size_;
+  std::unordered_map<point3D_t, Eigen::Vector3d> positions_;
+  std::unordered_map<Voxel, std::vector<point3D_t>, VoxelHash> voxels_;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Implementation
+////////////////////////////////////////////////////////////////////////////////
+
+double Point3DSpatialIndex::VoxelSize() const { return voxel_size_; }
+
+size_t Point3DSpatialIndex::NumPoints3D() const { return positions_.size(); }
+
+bool Point3DSpatialIndex::ExistsPoint3D(const point3D_t point3D_id) const {
+  return positions_.find(point3D_id) != positions_.end();
+}
+
+}  // namespace colmap
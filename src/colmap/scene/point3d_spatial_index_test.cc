@@ -0,0 +1,170 @@
+// Copyright (c) 2023, ETH Zurich and UNC Chapel Hill.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of ETH Zurich and UNC Chapel Hill nor the names of
+//       its contributors may be used to endorse or promote products derived
+//       from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "colmap/scene/point3d_spatial_index.h"
+
+#include <algorithm>
+#include <random>
+
+#include <gtest/gtest.h>
+
+namespace colmap {
+namespace {
+
+std::vector<point3D_t> BruteForceInRadius(
+    const std::unordered_map<point3D_t, Eigen::Vector3d>& points,
+    const Eigen::Vector3d& center,
+    const double radius) {
+  std::vector<point3D_t> point3D_ids;
+  for (const auto& point : points) {
+    if ((point.second - center).squaredNorm() <= radius * radius) {
+      point3D_ids.push_back(point.first);
+    }
+  }
+  std::sort(point3D_ids.begin(), point3D_ids.end());
+  return point3D_ids;
+}
+
+std::vector<point3D_t> BruteForceInBox(
+    const std::unordered_map<point3D_t, Eigen::Vector3d>& points,
+    const Eigen::Vector3d& min_xyz,
+    const Eigen::Vector3d& max_xyz) {
+  std::vector<point3D_t> point3D_ids;
+  for (const auto& point : points) {
+    if ((point.second.array() >= min_xyz.array()).all() &&
+        (point.second.array() <= max_xyz.array()).all()) {
+      point3D_ids.push_back(point.first);
+    }
+  }
+  std::sort(point3D_ids.begin(), point3D_ids.end());
+  return point3D_ids;
+}
+
+std::vector<point3D_t> BruteForceNearest(
+    const std::unordered_map<point3D_t, Eigen::Vector3d>& points,
+    const Eigen::Vector3d& xyz,
+    const size_t k) {
+  std::vector<std::pair<double, point3D_t>> dists;
+  for (const auto& point : points) {
+    dists.emplace_back((point.second - xyz).squaredNorm(), point.first);
+  }
+  std::sort(dists.begin(), dists.end());
+  std::vector<point3D_t> point3D_ids;
+  for (size_t i = 0; i < std::min(k, dists.size()); ++i) {
+    point3D_ids.push_back(dists[i].second);
+  }
+  return point3D_ids;
+}
+
+TEST(Point3DSpatialIndex, Empty) {
+  Point3DSpatialIndex index(0.5);
+  EXPECT_EQ(index.VoxelSize(), 0.5);
+  EXPECT_EQ(index.NumPoints3D(), 0);
+  EXPECT_FALSE(index.ExistsPoint3D(1));
+  EXPECT_TRUE(index.FindInRadius(Eigen::Vector3d::Zero(), 10).empty());
+  EXPECT_TRUE(index.FindInBox(Eigen::Vector3d::Constant(-1),
+                              Eigen::Vector3d::Constant(1))
+                  .empty());
+  EXPECT_TRUE(index.FindNearest(Eigen::Vector3d::Zero(), 3).empty());
+}
+
+TEST(Point3DSpatialIndex, SetAndDelete) {
+  Point3DSpatialIndex index;
+  index.SetPoint3D(1, Eigen::Vector3d(0, 0, 0));
+  index.SetPoint3D(2, Eigen::Vector3d(5, 0, 0));
+  EXPECT_EQ(index.NumPoints3D(), 2);
+  EXPECT_TRUE(index.ExistsPoint3D(1));
+  EXPECT_TRUE(index.ExistsPoint3D(2));
+  EXPECT_EQ(index.FindInRadius(Eigen::Vector3d::Zero(), 1),
+            std::vector<point3D_t>({1}));
+  index.SetPoint3D(2, Eigen::Vector3d(0.5, 0, 0));
+  EXPECT_EQ(index.NumPoints3D(), 2);
+  EXPECT_EQ(index.FindInRadius(Eigen::Vector3d::Zero(), 1),
+            std::vector<point3D_t>({1, 2}));
+  index.SetPoint3D(1, Eigen::Vector3d(-5, -5, -5));
+  EXPECT_EQ(index.FindInRadius(Eigen::Vector3d::Zero(), 1),
+            std::vector<point3D_t>({2}));
+  EXPECT_EQ(index.FindNearest(Eigen::Vector3d::Zero(), 2),
+            std::vector<point3D_t>({2, 1}));
+  index.DeletePoint3D(2);
+  index.DeletePoint3D(3);
+  EXPECT_EQ(index.NumPoints3D(), 1);
+  EXPECT_FALSE(index.ExistsPoint3D(2));
+  EXPECT_TRUE(index.FindInRadius(Eigen::Vector3d::Zero(), 1).empty());
+  index.Clear();
+  EXPECT_EQ(index.NumPoints3D(), 0);
+  EXPECT_TRUE(index.FindNearest(Eigen::Vector3d::Zero(), 1).empty());
+}
+
+TEST(Point3DSpatialIndex, Queries) {
+  std::mt19937 prng(42);
+  std::uniform_real_distribution<double> uniform(-10, 10);
+  const auto random_point = [&]() {
+    return Eigen::Vector3d(uniform(prng), uniform(prng), uniform(prng));
+  };
+
+  for (const double voxel_size : {0.1, 1.0, 100.0}) {
+    Point3DSpatialIndex index(voxel_size);
+    std::unordered_map<point3D_t, Eigen::Vector3d> points;
+    for (point3D_t point3D_id = 1; point3D_id <= 500; ++point3D_id) {
+      points[point3D_id] = random_point();
+      index.SetPoint3D(point3D_id, points[point3D_id]);
+    }
+    // Move and delete some of the points.
+    for (point3D_t point3D_id = 1; point3D_id <= 100; ++point3D_id) {
+      points[point3D_id] = random_point();
+      index.SetPoint3D(point3D_id, points[point3D_id]);
+    }
+    for (point3D_t point3D_id = 101; point3D_id <= 150; ++point3D_id) {
+      points.erase(point3D_id);
+      index.DeletePoint3D(point3D_id);
+    }
+    EXPECT_EQ(index.NumPoints3D(), points.size());
+
+    for (int i = 0; i < 20; ++i) {
+      const Eigen::Vector3d center = random_point();
+      for (const double radius : {0.0, 0.5, 3.0, 50.0}) {
+        EXPECT_EQ(index.FindInRadius(center, radius),
+                  BruteForceInRadius(points, center, radius));
+      }
+      const Eigen::Vector3d other = random_point();
+      const Eigen::Vector3d min_xyz = center.cwiseMin(other);
+      const Eigen::Vector3d max_xyz = center.cwiseMax(other);
+      EXPECT_EQ(index.FindInBox(min_xyz, max_xyz),
+                BruteForceInBox(points, min_xyz, max_xyz));
+      for (const size_t k : {1, 5, 1000}) {
+        EXPECT_EQ(index.FindNearest(center, k),
+                  BruteForceNearest(points, center, k));
+      }
+    }
+  }
+}
+
+}  // namespace
+}  // namespace colmap
@@ -31,7 +31,8 @@ project "colmap_scene"
         "colmap_sensor",
         "colmap_feature",
         "colmap_geometry",
-        "colmap_util"
+        "colmap_util",
+        "lz4"
     }
 
 	defines
@@ -54,6 +54,11 @@ std::unordered_set<point3D_t> Reconstruction::Point3DIds() const {
   return point3D_ids;
 }
 
+void Reconstruction::SetMaxPoint3DId(const point3D_t max_point3D_id) {
+  THROW_CHECK_GE(max_point3D_id, max_point3D_id_);
+  max_point3D_id_ = max_point3D_id;
+}
+
 void Reconstruction::Load(const DatabaseCache& database_cache) {
   // Add cameras.
   cameras_.reserve(database_cache.NumCameras());
@@ -110,6 +115,15 @@ void Reconstruction::TearDown() {
   }
 }
 
+void Reconstruction::Reserve(const size_t num_cameras,
+                             const size_t num_images,
+                             const size_t num_points3D) {
+  cameras_.reserve(num_cameras);
+  images_.reserve(num_images);
+  reg_image_ids_.reserve(num_images);
+  points3D_.reserve(num_points3D);
+}
+
 void Reconstruction::AddCamera(struct Camera camera) {
   const camera_t camera_id = camera.camera_id;
   THROW_CHECK(camera.VerifyParams());
@@ -129,7 +143,11 @@ void Reconstruction::AddImage(class Image image) {
 void Reconstruction::AddPoint3D(const point3D_t point3D_id,
                                 struct Point3D point3D) {
   max_point3D_id_ = std::max(max_point3D_id_, point3D_id);
+  const Eigen::Vector3d xyz = point3D.xyz;
   THROW_CHECK(points3D_.emplace(point3D_id, std::move(point3D)).second);
+  if (points3D_index_) {
+    points3D_index_->SetPoint3D(point3D_id, xyz);
+  }
 }
 
 point3D_t Reconstruction::AddPoint3D(const Eigen::Vector3d& xyz,
@@ -150,9 +168,21 @@ point3D_t Reconstruction::AddPoint3D(const Eigen::Vector3d& xyz,
   point3D.track = std::move(track);
   point3D.color = color;
 
+  if (points3D_index_) {
+    points3D_index_->SetPoint3D(point3D_id, xyz);
+  }
+
   return point3D_id;
 }
 
+void Reconstruction::SetPoint3DXYZ(const point3D_t point3D_id,
+                                   const Eigen::Vector3d& xyz) {
+  points3D_.at(point3D_id).xyz = xyz;
+  if (points3D_index_) {
+    points3D_index_->SetPoint3D(point3D_id, xyz);
+  }
+}
+
 void Reconstruction::AddObservation(const point3D_t point3D_id,
                                     const TrackElement& track_el) {
   class Image& image = Image(track_el.image_id);
@@ -203,6 +233,10 @@ void Reconstruction::DeletePoint3D(const point3D_t point3D_id) {
   }
 
   points3D_.erase(point3D_id);
+
+  if (points3D_index_) {
+    points3D_index_->DeletePoint3D(point3D_id);
+  }
 }
 
 void Reconstruction::DeleteObservation(const image_t image_id,
@@ -224,7 +258,7 @@ void Reconstruction::DeleteObservation(const image_t image_id,
 }
 
 void Reconstruction::DeleteAllPoints2DAndPoints3D() {
-  points3D_.clear();
+  ClearPoints3D();
   for (auto& image : images_) {
     class Image new_image;
     new_image.SetImageId(image.second.ImageId());
@@ -300,6 +334,13 @@ std::pair<Eigen::Vector3d, Eigen::Vector3d> Reconstruction::ComputeBoundingBox(
   return std::make_pair(std::get<0>(bound), std::get<1>(bound));
 }
 
+void Reconstruction::ClearPoints3D() {
+  points3D_.clear();
+  if (points3D_index_) {
+    points3D_index_->Clear();
+  }
+}
+
 std::tuple<Eigen::Vector3d, Eigen::Vector3d, Eigen::Vector3d>
 Reconstruction::ComputeBoundsAndCentroid(const double p0,
                                          const double p1,
@@ -376,6 +417,7 @@ void Reconstruction::Transform(const Sim3d& new_from_old_world) {
   for (auto& point3D : points3D_) {
     point3D.second.xyz = new_from_old_world * point3D.second.xyz;
   }
+  UpdatePoints3DSpatialIndex();
 }
 
 Reconstruction Reconstruction::Crop(
@@ -394,22 +436,108 @@ Reconstruction Reconstruction::Crop(
     cropped_reconstruction.AddImage(std::move(new_image));
   }
   std::unordered_set<image_t> registered_image_ids;
-  for (const auto& point3D : points3D_) {
-    if ((point3D.second.xyz.array() >= bbox.first.array()).all() &&
-        (point3D.second.xyz.array() <= bbox.second.array()).all()) {
-      for (const auto& track_el : point3D.second.track.Elements()) {
-        if (registered_image_ids.count(track_el.image_id) == 0) {
-          cropped_reconstruction.RegisterImage(track_el.image_id);
-          registered_image_ids.insert(track_el.image_id);
-        }
+  auto AddCroppedPoint3D = [&](const struct Point3D& point3D) {
+    for (const auto& track_el : point3D.track.Elements()) {
+      if (registered_image_ids.count(track_el.image_id) == 0) {
+        cropped_reconstruction.RegisterImage(track_el.image_id);
+        registered_image_ids.insert(track_el.image_id);
+      }
+    }
+    cropped_reconstruction.AddPoint3D(
+        point3D.xyz, point3D.track, point3D.color);
+  };
+  if (points3D_index_) {
+    for (const point3D_t point3D_id :
+         FindPoints3DInBox(bbox.first, bbox.second)) {
+      AddCroppedPoint3D(Point3D(point3D_id));
+    }
+  } else {
+    for (const auto& point3D : points3D_) {
+      if ((point3D.second.xyz.array() >= bbox.first.array()).all() &&
+          (point3D.second.xyz.array() <= bbox.second.array()).all()) {
+        AddCroppedPoint3D(point3D.second);
       }
-      cropped_reconstruction.AddPoint3D(
-          point3D.second.xyz, point3D.second.track, point3D.second.color);
     }
   }
   return cropped_reconstruction;
 }
 
+void Reconstruction::EnablePoints3DSpatialIndex(const double voxel_size) {
+  points3D_index_.emplace(voxel_size);
+  for (const auto& point3D : points3D_) {
+    points3D_index_->SetPoint3D(point3D.first, point3D.second.xyz);
+  }
+}
+
+void Reconstruction::DisablePoints3DSpatialIndex() { points3D_index_.reset(); }
+
+void Reconstruction::UpdatePoint3DSpatialIndex(const point3D_t point3D_id) {
+  if (points3D_index_) {
+    points3D_index_->SetPoint3D(point3D_id, points3D_.at(point3D_id).xyz);
+  }
+}
+
+void Reconstruction::UpdatePoints3DSpatialIndex() {
+  if (points3D_index_) {
+    for (const auto& point3D : points3D_) {
+      points3D_index_->SetPoint3D(point3D.first, point3D.second.xyz);
+    }
+  }
+}
+
+std::vector<point3D_t> Reconstruction::FindPoints3DInRadius(
+    const Eigen::Vector3d& center, const double radius) const {
+  if (points3D_index_) {
+    return points3D_index_->FindInRadius(center, radius);
+  }
+  std::vector<point3D_t> point3D_ids;
+  for (const auto& point3D : points3D_) {
+    if (radius >= 0 &&
+        (point3D.second.xyz - center).squaredNorm() <= radius * radius) {
+      point3D_ids.push_back(point3D.first);
+    }
+  }
+  std::sort(point3D_ids.begin(), point3D_ids.end());
+  return point3D_ids;
+}
+
+std::vector<point3D_t> Reconstruction::FindPoints3DInBox(
+    const Eigen::Vector3d& min_xyz, const Eigen::Vector3d& max_xyz) const {
+  if (points3D_index_) {
+    return points3D_index_->FindInBox(min_xyz, max_xyz);
+  }
+  std::vector<point3D_t> point3D_ids;
+  for (const auto& point3D : points3D_) {
+    if ((point3D.second.xyz.array() >= min_xyz.array()).all() &&
+        (point3D.second.xyz.array() <= max_xyz.array()).all()) {
+      point3D_ids.push_back(point3D.first);
+    }
+  }
+  std::sort(point3D_ids.begin(), point3D_ids.end());
+  return point3D_ids;
+}
+
+std::vector<point3D_t> Reconstruction::FindNearestPoints3D(
+    const Eigen::Vector3d& xyz, const size_t k) const {
+  if (points3D_index_) {
+    return points3D_index_->FindNearest(xyz, k);
+  }
+  std::vector<std::pair<double, point3D_t>> dists;
+  dists.reserve(points3D_.size());
+  for (const auto& point3D : points3D_) {
+    dists.emplace_back((point3D.second.xyz - xyz).squaredNorm(),
+                       point3D.first);
+  }
+  const size_t num_nearest = std::min(k, dists.size());
+  std::partial_sort(
+      dists.begin(), dists.begin() + num_nearest, dists.end());
+  std::vector<point3D_t> point3D_ids(num_nearest);
+  for (size_t i = 0; i < num_nearest; ++i) {
+    point3D_ids[i] = dists[i].second;
+  }
+  return point3D_ids;
+}
+
 const class Image* Reconstruction::FindImageWithName(
     const std::string& name) const {
   for (const auto& image : images_) {
@@ -535,6 +663,8 @@ void Reconstruction::Read(const std::string& path) {
              ExistsFile(JoinPaths(path, "images.txt")) &&
              ExistsFile(JoinPaths(path, "points3D.txt"))) {
     ReadText(path);
+  } else if (ExistsFile(JoinPaths(path, "reconstruction.chunked"))) {
+    ReadChunked(path);
   } else {
     LOG(FATAL_THROW) << "cameras, images, points3D files do not exist at "
                      << path;
@@ -546,7 +676,7 @@ void Reconstruction::Write(const std::string& path) const { WriteBinary(path); }
 void Reconstruction::ReadText(const std::string& path) {
   cameras_.clear();
   images_.clear();
-  points3D_.clear();
+  ClearPoints3D();
   ReadCamerasText(*this, JoinPaths(path, "cameras.txt"));
   ReadImagesText(*this, JoinPaths(path, "images.txt"));
   ReadPoints3DText(*this, JoinPaths(path, "points3D.txt"));
@@ -555,12 +685,20 @@ void Reconstruction::ReadText(const std::string& path) {
 void Reconstruction::ReadBinary(const std::string& path) {
   cameras_.clear();
   images_.clear();
-  points3D_.clear();
+  ClearPoints3D();
   ReadCamerasBinary(*this, JoinPaths(path, "cameras.bin"));
   ReadImagesBinary(*this, JoinPaths(path, "images.bin"));
   ReadPoints3DBinary(*this, JoinPaths(path, "points3D.bin"));
 }
 
+void Reconstruction::ReadChunked(const std::string& path) {
+  cameras_.clear();
+  images_.clear();
+  ClearPoints3D();
+  ChunkedReconstructionReader(JoinPaths(path, "reconstruction.chunked"))
+      .Read(*this);
+}
+
 void Reconstruction::WriteText(const std::string& path) const {
   THROW_CHECK_DIR_EXISTS(path);
   WriteCamerasText(*this, JoinPaths(path, "cameras.txt"));
@@ -575,6 +713,11 @@ void Reconstruction::WriteBinary(const std::string& path) const {
   WritePoints3DBinary(*this, JoinPaths(path, "points3D.bin"));
 }
 
+void Reconstruction::WriteChunked(const std::string& path) const {
+  THROW_CHECK_DIR_EXISTS(path);
+  WriteChunkedReconstruction(*this, JoinPaths(path, "reconstruction.chunked"));
+}
+
 std::vector<PlyPoint> Reconstruction::ConvertToPLY() const {
   std::vector<PlyPoint> ply_points;
   ply_points.reserve(points3D_.size());
@@ -594,7 +737,7 @@ std::vector<PlyPoint> Reconstruction::ConvertToPLY() const {
 }
 
 void Reconstruction::ImportPLY(const std::string& path) {
-  points3D_.clear();
+  ClearPoints3D();
 
   const auto ply_points = ReadPly(path);
 
@@ -608,7 +751,7 @@ void Reconstruction::ImportPLY(const std::string& path) {
 }
 
 void Reconstruction::ImportPLY(const std::vector<PlyPoint>& ply_points) {
-  points3D_.clear();
+  ClearPoints3D();
   points3D_.reserve(ply_points.size());
   for (const auto& ply_point : ply_points) {
     AddPoint3D(Eigen::Vector3d(ply_point.x, ply_point.y, ply_point.z),
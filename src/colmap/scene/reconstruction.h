@@ -35,11 +35,13 @@
 #include "colmap/scene/image.h"
 #include "colmap/scene/point2d.h"
 #include "colmap/scene/point3d.h"
+#include "colmap/scene/point3d_spatial_index.h"
 #include "colmap/scene/track.h"
 #include "colmap/util/eigen_alignment.h"
 #include "colmap/util/types.h"
 
 #include <memory>
+#include <optional>
 #include <tuple>
 #include <unordered_map>
 #include <unordered_set>
@@ -84,6 +86,16 @@ class Reconstruction {
   // Identifiers of all 3D points.
   std::unordered_set<point3D_t> Point3DIds() const;
 
+  // Get the largest identifier assigned to a 3D point. New 3D points are
+  // assigned the following identifiers. Reading a reconstruction from disk
+  // only restores the largest identifier of the existing 3D points.
+  inline point3D_t MaxPoint3DId() const;
+
+  // Continue the identifiers of new 3D points after the given identifier,
+  // e.g., to restore the state of a reconstruction read from disk. The
+  // identifier can only be increased.
+  void SetMaxPoint3DId(point3D_t max_point3D_id);
+
   // Check whether specific object exists.
   inline bool ExistsCamera(camera_t camera_id) const;
   inline bool ExistsImage(image_t image_id) const;
@@ -98,6 +110,10 @@ class Reconstruction {
   // save memory.
   void TearDown();
 
+  // Reserve capacity for the given number of cameras, images, and 3D points
+  // to avoid rehashing when bulk loading large reconstructions.
+  void Reserve(size_t num_cameras, size_t num_images, size_t num_points3D);
+
   // Add new camera. There is only one camera per image, while multiple images
   // might be taken by the same camera.
   void AddCamera(struct Camera camera);
@@ -114,6 +130,9 @@ class Reconstruction {
       Track track,
       const Eigen::Vector3ub& color = Eigen::Vector3ub::Zero());
 
+  // Set the position of an existing 3D point and update the spatial index.
+  void SetPoint3DXYZ(point3D_t point3D_id, const Eigen::Vector3d& xyz);
+
   // Add observation to existing 3D point.
   void AddObservation(point3D_t point3D_id, const TrackElement& track_el);
 
@@ -174,6 +193,31 @@ class Reconstruction {
   Reconstruction Crop(
       const std::pair<Eigen::Vector3d, Eigen::Vector3d>& bbox) const;
 
+  // Enable a spatial index over the 3D points with the given voxel size, which
+  // accelerates the spatial queries below. The index is maintained
+  // incrementally as points are added, moved with SetPoint3DXYZ, transformed,
+  // merged, and deleted. Positions modified in place through the mutable
+  // Point3D accessor, e.g. by bundle adjustment or through the points map in
+  // Python, must be followed by UpdatePoint3DSpatialIndex for the modified
+  // points or UpdatePoints3DSpatialIndex for all points. The const queries
+  // may be called concurrently from multiple threads.
+  void EnablePoints3DSpatialIndex(double voxel_size);
+  void DisablePoints3DSpatialIndex();
+  void UpdatePoint3DSpatialIndex(point3D_t point3D_id);
+  void UpdatePoints3DSpatialIndex();
+  inline bool HasPoints3DSpatialIndex() const;
+
+  // Find the 3D points within the given distance of the center or inside the
+  // axis-aligned box, ordered by their identifiers, or the k nearest 3D points
+  // ordered by increasing distance. All points are scanned linearly, if the
+  // spatial index is not enabled.
+  std::vector<point3D_t> FindPoints3DInRadius(const Eigen::Vector3d& center,
+                                              double radius) const;
+  std::vector<point3D_t> FindPoints3DInBox(
+      const Eigen::Vector3d& min_xyz, const Eigen::Vector3d& max_xyz) const;
+  std::vector<point3D_t> FindNearestPoints3D(const Eigen::Vector3d& xyz,
+                                             size_t k) const;
+
   // Find specific image by name. Note that this uses linear search.
   const class Image* FindImageWithName(const std::string& name) const;
 
@@ -195,17 +239,20 @@ class Reconstruction {
   // Updates mean reprojection errors for all 3D points.
   void UpdatePoint3DErrors();
 
-  // Read data from text or binary file. Prefer binary data if it exists.
+  // Read data from text, binary, or chunked file. Prefer binary data if it
+  // exists.
   void Read(const std::string& path);
   void Write(const std::string& path) const;
 
-  // Read data from binary/text file.
+  // Read data from binary/text/chunked file.
   void ReadText(const std::string& path);
   void ReadBinary(const std::string& path);
+  void ReadChunked(const std::string& path);
 
-  // Write data from binary/text file.
+  // Write data from binary/text/chunked file.
   void WriteText(const std::string& path) const;
   void WriteBinary(const std::string& path) const;
+  void WriteChunked(const std::string& path) const;
 
   // Convert 3D points in reconstruction to PLY point cloud.
   std::vector<PlyPoint> ConvertToPLY() const;
@@ -240,6 +287,9 @@ class Reconstruction {
   std::tuple<Eigen::Vector3d, Eigen::Vector3d, Eigen::Vector3d>
   ComputeBoundsAndCentroid(double p0, double p1, bool use_images) const;
 
+  // Delete all 3D points without updating the images.
+  void ClearPoints3D();
+
   std::unordered_map<camera_t, struct Camera> cameras_;
   std::unordered_map<image_t, class Image> images_;
   std::unordered_map<point3D_t, struct Point3D> points3D_;
@@ -249,6 +299,9 @@ class Reconstruction {
 
   // Total number of added 3D points, used to generate unique identifiers.
   point3D_t max_point3D_id_;
+
+  // Optional spatial index over the positions of the 3D points.
+  std::optional<Point3DSpatialIndex> points3D_index_;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -263,6 +316,8 @@ size_t Reconstruction::NumRegImages() const { return reg_image_ids_.size(); }
 
 size_t Reconstruction::NumPoints3D() const { return points3D_.size(); }
 
+point3D_t Reconstruction::MaxPoint3DId() const { return max_point3D_id_; }
+
 const struct Camera& Reconstruction::Camera(const camera_t camera_id) const {
   return cameras_.at(camera_id);
 }
@@ -316,6 +371,10 @@ bool Reconstruction::ExistsPoint3D(const point3D_t point3D_id) const {
   return points3D_.find(point3D_id) != points3D_.end();
 }
 
+bool Reconstruction::HasPoints3DSpatialIndex() const {
+  return points3D_index_.has_value();
+}
+
 bool Reconstruction::IsImageRegistered(const image_t image_id) const {
   return Image(image_id).IsRegistered();
 }
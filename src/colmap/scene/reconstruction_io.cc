@@ -36,164 +36,503 @@
 #include "colmap/scene/point3d.h"
 #include "colmap/scene/reconstruction.h"
 #include "colmap/scene/track.h"
+#include "colmap/util/endian.h"
+#include "colmap/util/mapped_file.h"
 #include "colmap/util/misc.h"
 #include "colmap/util/ply.h"
+#include "colmap/util/threading.h"
 #include "colmap/util/types.h"
 
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
+#include <future>
+#include <string_view>
+#include <unordered_set>
+
+#include <Eigen/Geometry>
 
 namespace colmap {
+namespace {
 
-void ReadCamerasText(Reconstruction& reconstruction, const std::string& path) {
-  std::ifstream file(path);
-  THROW_CHECK_FILE_OPEN(file, path);
+// Bounds-checked little-endian reader over a memory range.
+class BinaryCursor {
+ public:
+  BinaryCursor(const char* data, size_t size, size_t offset = 0)
+      : data_(data), size_(size), offset_(offset) {}
 
-  std::string line;
-  std::string item;
+  size_t Offset() const { return offset_; }
 
-  while (std::getline(file, line)) {
-    StringTrim(&line);
+  size_t NumRemainingBytes() const { return size_ - offset_; }
 
-    if (line.empty() || line[0] == '#') {
-      continue;
-    }
+  template <typename T>
+  T Read() {
+    THROW_CHECK_LE(offset_ + sizeof(T), size_) << "Unexpected end of file";
+    T data;
+    std::memcpy(&data, data_ + offset_, sizeof(T));
+    offset_ += sizeof(T);
+    return LittleEndianToNative(data);
+  }
 
-    std::stringstream line_stream(line);
+  void Skip(size_t num_bytes) {
+    THROW_CHECK_LE(num_bytes, size_ - offset_) << "Unexpected end of file";
+    offset_ += num_bytes;
+  }
 
-    struct Camera camera;
+  std::string ReadString() {
+    const void* end = std::memchr(data_ + offset_, '\0', size_ - offset_);
+    THROW_CHECK_NOTNULL(end);
+    const size_t length = static_cast<const char*>(end) - (data_ + offset_);
+    std::string str(data_ + offset_, length);
+    offset_ += length + 1;
+    return str;
+  }
 
-    // ID
-    std::getline(line_stream, item, ' ');
-    camera.camera_id = std::stoul(item);
+  void SkipString() {
+    const void* end = std::memchr(data_ + offset_, '\0', size_ - offset_);
+    THROW_CHECK_NOTNULL(end);
+    offset_ = static_cast<const char*>(end) - data_ + 1;
+  }
 
-    // MODEL
-    std::getline(line_stream, item, ' ');
-    camera.model_id = CameraModelNameToId(item);
+ private:
+  const char* data_;
+  size_t size_;
+  size_t offset_;
+};
+
+// Writes little-endian binary data through a large in-memory buffer, so that
+// the underlying stream sees few large writes instead of many small ones.
+class BufferedBinaryWriter {
+ public:
+  explicit BufferedBinaryWriter(const std::string& path)
+      : path_(path), file_(path, std::ios::trunc | std::ios::binary) {
+    THROW_CHECK_FILE_OPEN(file_, path);
+    buffer_.reserve(kBufferSize);
+  }
 
-    // WIDTH
-    std::getline(line_stream, item, ' ');
-    camera.width = std::stoll(item);
+  uint64_t NumBytesWritten() const { return num_bytes_written_; }
 
-    // HEIGHT
-    std::getline(line_stream, item, ' ');
-    camera.height = std::stoll(item);
+  template <typename T>
+  void Write(const T& data) {
+    const T data_little_endian = NativeToLittleEndian(data);
+    Write(reinterpret_cast<const char*>(&data_little_endian), sizeof(T));
+  }
 
-    // PARAMS
-    camera.params.reserve(CameraModelNumParams(camera.model_id));
-    while (!line_stream.eof()) {
-      std::getline(line_stream, item, ' ');
-      camera.params.push_back(std::stold(item));
+  void Write(const char* data, size_t num_bytes) {
+    num_bytes_written_ += num_bytes;
+    if (buffer_.size() + num_bytes > kBufferSize) {
+      Flush();
+    }
+    if (num_bytes > kBufferSize) {
+      file_.write(data, num_bytes);
+    } else {
+      buffer_.insert(buffer_.end(), data, data + num_bytes);
     }
+  }
 
-    THROW_CHECK(camera.VerifyParams());
-    reconstruction.AddCamera(std::move(camera));
+  void Flush() {
+    file_.write(buffer_.data(), buffer_.size());
+    THROW_CHECK(file_.good()) << "Could not write to file: " << path_;
+    buffer_.clear();
   }
-}
 
-void ReadImagesText(Reconstruction& reconstruction, const std::string& path) {
-  std::ifstream file(path);
-  THROW_CHECK_FILE_OPEN(file, path);
+ private:
+  static constexpr size_t kBufferSize = 16 * 1024 * 1024;
+
+  const std::string path_;
+  std::ofstream file_;
+  std::vector<char> buffer_;
+  uint64_t num_bytes_written_ = 0;
+};
+
+// Parses the records in [0, num_records) in parallel, where each record is
+// parsed by parse_func(record_idx). Small inputs are parsed sequentially.
+template <typename ParseFunc>
+void ParseRecordsInParallel(const size_t num_records, ParseFunc parse_func) {
+  const size_t kMinNumRecordsPerThread = 1024;
+  const size_t num_threads =
+      std::min<size_t>(GetEffectiveNumThreads(-1),
+                       num_records / kMinNumRecordsPerThread);
+  if (num_threads <= 1) {
+    for (size_t i = 0; i < num_records; ++i) {
+      parse_func(i);
+    }
+    return;
+  }
 
-  std::string line;
-  std::string item;
+  ThreadPool thread_pool(num_threads);
+  std::vector<std::future<void>> futures;
+  futures.reserve(num_threads);
+  const size_t num_records_per_thread =
+      (num_records + num_threads - 1) / num_threads;
+  for (size_t start = 0; start < num_records;
+       start += num_records_per_thread) {
+    const size_t end = std::min(num_records, start + num_records_per_thread);
+    futures.push_back(thread_pool.AddTask([&parse_func, start, end]() {
+      for (size_t i = start; i < end; ++i) {
+        parse_func(i);
+      }
+    }));
+  }
+  for (auto& future : futures) {
+    future.get();
+  }
+}
 
-  while (std::getline(file, line)) {
-    StringTrim(&line);
+// Formats the records in [0, num_records) in parallel, where each record is
+// appended to a string by format_func(record_idx, &text), and writes the
+// formatted chunks to the stream in record order.
+template <typename FormatFunc>
+void FormatRecordsInParallel(const size_t num_records,
+                             FormatFunc format_func,
+                             std::ostream* stream) {
+  const size_t kNumRecordsPerChunk = 1024;
+  const size_t num_chunks =
+      (num_records + kNumRecordsPerChunk - 1) / kNumRecordsPerChunk;
+
+  auto format_chunk = [&format_func, num_records](const size_t chunk_idx) {
+    std::string text;
+    const size_t begin = chunk_idx * kNumRecordsPerChunk;
+    const size_t end = std::min(num_records, begin + kNumRecordsPerChunk);
+    for (size_t i = begin; i < end; ++i) {
+      format_func(i, &text);
+    }
+    return text;
+  };
+
+  const size_t num_threads =
+      std::min<size_t>(GetEffectiveNumThreads(-1), num_chunks);
+  if (num_threads <= 1) {
+    for (size_t chunk_idx = 0; chunk_idx < num_chunks; ++chunk_idx) {
+      const std::string text = format_chunk(chunk_idx);
+      stream->write(text.data(), text.size());
+    }
+    return;
+  }
 
-    if (line.empty() || line[0] == '#') {
-      continue;
+  // Bound the memory by only formatting a few chunks per thread ahead.
+  ThreadPool thread_pool(num_threads);
+  const size_t num_chunks_per_batch = 4 * num_threads;
+  for (size_t batch_begin = 0; batch_begin < num_chunks;
+       batch_begin += num_chunks_per_batch) {
+    const size_t batch_end =
+        std::min(num_chunks, batch_begin + num_chunks_per_batch);
+    std::vector<std::future<std::string>> futures;
+    futures.reserve(batch_end - batch_begin);
+    for (size_t chunk_idx = batch_begin; chunk_idx < batch_end; ++chunk_idx) {
+      futures.push_back(thread_pool.AddTask(format_chunk, chunk_idx));
     }
+    for (auto& future : futures) {
+      const std::string text = future.get();
+      stream->write(text.data(), text.size());
+    }
+  }
+}
 
-    std::stringstream line_stream1(line);
+// Appends the value formatted as by an std::ostream with precision 17.
+void AppendDouble(const double value, std::string* text) {
+  char buffer[32];
+#ifdef __cpp_lib_to_chars
+  const auto result = std::to_chars(
+      buffer, buffer + sizeof(buffer), value, std::chars_format::general, 17);
+  text->append(buffer, result.ptr);
+#else
+  const int num_chars = std::snprintf(buffer, sizeof(buffer), "%.17g", value);
+  text->append(buffer, num_chars);
+#endif
+}
 
-    // ID
-    std::getline(line_stream1, item, ' ');
-    const image_t image_id = std::stoul(item);
+template <typename T>
+void AppendInteger(const T value, std::string* text) {
+  char buffer[24];
+  const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+  text->append(buffer, result.ptr);
+}
 
-    class Image image;
-    image.SetImageId(image_id);
+bool IsTextSpace(const char c) {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' ||
+         c == '\f';
+}
 
-    image.SetRegistered(true);
+// Returns whether the line is neither empty nor a comment.
+bool IsTextDataLine(const char* begin, const char* end) {
+  while (begin != end && IsTextSpace(*begin)) {
+    ++begin;
+  }
+  return begin != end && *begin != '#';
+}
 
-    Rigid3d& cam_from_world = image.CamFromWorld();
+// Returns the end of the line starting at begin, excluding the newline.
+const char* FindLineEnd(const char* begin, const char* end) {
+  const void* newline = std::memchr(begin, '\n', end - begin);
+  return newline == nullptr ? end : static_cast<const char*>(newline);
+}
 
-    std::getline(line_stream1, item, ' ');
-    cam_from_world.rotation.w() = std::stold(item);
+// Parser for whitespace-separated tokens in a line of text.
+class TextTokenizer {
+ public:
+  TextTokenizer(const char* begin, const char* end) : pos_(begin), end_(end) {}
 
-    std::getline(line_stream1, item, ' ');
-    cam_from_world.rotation.x() = std::stold(item);
+  bool AtEnd() {
+    SkipWhitespace();
+    return pos_ == end_;
+  }
 
-    std::getline(line_stream1, item, ' ');
-    cam_from_world.rotation.y() = std::stold(item);
+  std::string_view NextToken() {
+    SkipWhitespace();
+    const char* begin = pos_;
+    while (pos_ != end_ && !IsTextSpace(*pos_)) {
+      ++pos_;
+    }
+    THROW_CHECK(pos_ != begin) << "Unexpected end of line";
+    return std::string_view(begin, pos_ - begin);
+  }
 
-    std::getline(line_stream1, item, ' ');
-    cam_from_world.rotation.z() = std::stold(item);
+  template <typename T>
+  T Read() {
+    const std::string_view token = NextToken();
+    T value;
+    THROW_CHECK(Parse(token, &value)) << "Invalid value: " << token;
+    return value;
+  }
 
-    cam_from_world.rotation.normalize();
+ private:
+  void SkipWhitespace() {
+    while (pos_ != end_ && IsTextSpace(*pos_)) {
+      ++pos_;
+    }
+  }
 
-    std::getline(line_stream1, item, ' ');
-    cam_from_world.translation.x() = std::stold(item);
+  template <typename T>
+  static bool Parse(const std::string_view token, T* value) {
+    const auto result =
+        std::from_chars(token.data(), token.data() + token.size(), *value);
+    return result.ec == std::errc() &&
+           result.ptr == token.data() + token.size();
+  }
 
-    std::getline(line_stream1, item, ' ');
-    cam_from_world.translation.y() = std::stold(item);
+  static bool Parse(std::string_view token, double* value) {
+    if (!token.empty() && token[0] == '+') {
+      token.remove_prefix(1);
+    }
+#ifdef __cpp_lib_to_chars
+    const auto result =
+        std::from_chars(token.data(), token.data() + token.size(), *value);
+    return result.ec == std::errc() &&
+           result.ptr == token.data() + token.size();
+#else
+    const std::string token_str(token);
+    char* token_end = nullptr;
+    *value = std::strtod(token_str.c_str(), &token_end);
+    return !token_str.empty() && token_end == token_str.c_str() + token.size();
+#endif
+  }
 
-    std::getline(line_stream1, item, ' ');
-    cam_from_world.translation.z() = std::stold(item);
+  const char* pos_;
+  const char* end_;
+};
+
+// Record layouts shared by the binary and the chunked formats.
+
+struct Camera ReadCameraRecord(BinaryCursor* cursor) {
+  struct Camera camera;
+  camera.camera_id = cursor->Read<camera_t>();
+  camera.model_id = static_cast<CameraModelId>(cursor->Read<int>());
+  camera.width = cursor->Read<uint64_t>();
+  camera.height = cursor->Read<uint64_t>();
+  camera.params.resize(CameraModelNumParams(camera.model_id), 0.);
+  for (double& param : camera.params) {
+    param = cursor->Read<double>();
+  }
+  THROW_CHECK(camera.VerifyParams());
+  return camera;
+}
 
-    // CAMERA_ID
-    std::getline(line_stream1, item, ' ');
-    image.SetCameraId(std::stoul(item));
+void WriteCameraRecord(BufferedBinaryWriter* writer,
+                       const struct Camera& camera) {
+  writer->Write<camera_t>(camera.camera_id);
+  writer->Write<int>(static_cast<int>(camera.model_id));
+  writer->Write<uint64_t>(camera.width);
+  writer->Write<uint64_t>(camera.height);
+  for (const double param : camera.params) {
+    writer->Write<double>(param);
+  }
+}
 
-    // NAME
-    std::getline(line_stream1, item, ' ');
-    image.SetName(item);
+void ReadImagePoseRecord(BinaryCursor* cursor, class Image* image) {
+  image->SetImageId(cursor->Read<image_t>());
 
-    // POINTS2D
-    if (!std::getline(file, line)) {
-      break;
-    }
+  Rigid3d& cam_from_world = image->CamFromWorld();
+  cam_from_world.rotation.w() = cursor->Read<double>();
+  cam_from_world.rotation.x() = cursor->Read<double>();
+  cam_from_world.rotation.y() = cursor->Read<double>();
+  cam_from_world.rotation.z() = cursor->Read<double>();
+  cam_from_world.rotation.normalize();
+  cam_from_world.translation.x() = cursor->Read<double>();
+  cam_from_world.translation.y() = cursor->Read<double>();
+  cam_from_world.translation.z() = cursor->Read<double>();
 
-    StringTrim(&line);
-    std::stringstream line_stream2(line);
+  image->SetCameraId(cursor->Read<camera_t>());
 
-    std::vector<Eigen::Vector2d> points2D;
-    std::vector<point3D_t> point3D_ids;
+  image->Name() = cursor->ReadString();
+}
 
-    if (!line.empty()) {
-      while (!line_stream2.eof()) {
-        Eigen::Vector2d point;
+void WriteImagePoseRecord(BufferedBinaryWriter* writer,
+                          const class Image& image) {
+  writer->Write<image_t>(image.ImageId());
 
-        std::getline(line_stream2, item, ' ');
-        point.x() = std::stold(item);
+  const Rigid3d& cam_from_world = image.CamFromWorld();
+  writer->Write<double>(cam_from_world.rotation.w());
+  writer->Write<double>(cam_from_world.rotation.x());
+  writer->Write<double>(cam_from_world.rotation.y());
+  writer->Write<double>(cam_from_world.rotation.z());
+  writer->Write<double>(cam_from_world.translation.x());
+  writer->Write<double>(cam_from_world.translation.y());
+  writer->Write<double>(cam_from_world.translation.z());
 
-        std::getline(line_stream2, item, ' ');
-        point.y() = std::stold(item);
+  writer->Write<camera_t>(image.CameraId());
 
-        points2D.push_back(point);
+  const std::string& name = image.Name();
+  writer->Write(name.c_str(), name.size() + 1);
+}
 
-        std::getline(line_stream2, item, ' ');
-        if (item == "-1") {
-          point3D_ids.push_back(kInvalidPoint3DId);
-        } else {
-          point3D_ids.push_back(std::stoll(item));
-        }
-      }
-    }
+const size_t kPoint2DRecordNumBytes = 2 * sizeof(double) + sizeof(point3D_t);
+
+// Size of an image record with an empty name and no 2D points.
+const size_t kMinImageRecordNumBytes = sizeof(image_t) + 7 * sizeof(double) +
+                                       sizeof(camera_t) + 1 + sizeof(uint64_t);
+
+void ReadPoints2DRecord(BinaryCursor* cursor, class Image* image) {
+  const size_t num_points2D = cursor->Read<uint64_t>();
+  THROW_CHECK_LE(num_points2D,
+                 cursor->NumRemainingBytes() / kPoint2DRecordNumBytes);
+  std::vector<struct Point2D> points2D(num_points2D);
+  for (struct Point2D& point2D : points2D) {
+    point2D.xy(0) = cursor->Read<double>();
+    point2D.xy(1) = cursor->Read<double>();
+    point2D.point3D_id = cursor->Read<point3D_t>();
+  }
+  image->SetPoints2D(points2D);
+}
 
-    image.SetPoints2D(points2D);
+void SkipPoints2DRecord(BinaryCursor* cursor, size_t file_size) {
+  const size_t num_points2D = cursor->Read<uint64_t>();
+  THROW_CHECK_LE(num_points2D, file_size / kPoint2DRecordNumBytes);
+  cursor->Skip(num_points2D * kPoint2DRecordNumBytes);
+}
 
-    for (point2D_t point2D_idx = 0; point2D_idx < image.NumPoints2D();
-         ++point2D_idx) {
-      if (point3D_ids[point2D_idx] != kInvalidPoint3DId) {
-        image.SetPoint3DForPoint2D(point2D_idx, point3D_ids[point2D_idx]);
-      }
+void WritePoints2DRecord(BufferedBinaryWriter* writer,
+                         const class Image& image) {
+  writer->Write<uint64_t>(image.NumPoints2D());
+  for (const Point2D& point2D : image.Points2D()) {
+    writer->Write<double>(point2D.xy(0));
+    writer->Write<double>(point2D.xy(1));
+    writer->Write<point3D_t>(point2D.point3D_id);
+  }
+}
+
+const size_t kTrackElementRecordNumBytes = sizeof(image_t) + sizeof(point2D_t);
+
+// Size of a 3D point record with an empty track.
+const size_t kMinPoint3DRecordNumBytes = sizeof(point3D_t) +
+                                         3 * sizeof(double) +
+                                         3 * sizeof(uint8_t) + sizeof(double) +
+                                         sizeof(uint64_t);
+
+void ReadPoint3DRecord(BinaryCursor* cursor,
+                       point3D_t* point3D_id,
+                       struct Point3D* point3D) {
+  *point3D_id = cursor->Read<point3D_t>();
+
+  point3D->xyz(0) = cursor->Read<double>();
+  point3D->xyz(1) = cursor->Read<double>();
+  point3D->xyz(2) = cursor->Read<double>();
+  point3D->color(0) = cursor->Read<uint8_t>();
+  point3D->color(1) = cursor->Read<uint8_t>();
+  point3D->color(2) = cursor->Read<uint8_t>();
+  point3D->error = cursor->Read<double>();
+
+  const size_t track_length = cursor->Read<uint64_t>();
+  THROW_CHECK_LE(track_length,
+                 cursor->NumRemainingBytes() / kTrackElementRecordNumBytes);
+  point3D->track.Reserve(track_length);
+  for (size_t j = 0; j < track_length; ++j) {
+    const image_t image_id = cursor->Read<image_t>();
+    const point2D_t point2D_idx = cursor->Read<point2D_t>();
+    point3D->track.AddElement(image_id, point2D_idx);
+  }
+  point3D->track.Compress();
+}
+
+void SkipPoint3DRecord(BinaryCursor* cursor, size_t file_size) {
+  cursor->Skip(sizeof(point3D_t) + 3 * sizeof(double) + 3 * sizeof(uint8_t) +
+               sizeof(double));
+  const size_t track_length = cursor->Read<uint64_t>();
+  THROW_CHECK_LE(track_length, file_size / kTrackElementRecordNumBytes);
+  cursor->Skip(track_length * kTrackElementRecordNumBytes);
+}
+
+void WritePoint3DRecord(BufferedBinaryWriter* writer,
+                        const point3D_t point3D_id,
+                        const struct Point3D& point3D) {
+  writer->Write<point3D_t>(point3D_id);
+  writer->Write<double>(point3D.xyz(0));
+  writer->Write<double>(point3D.xyz(1));
+  writer->Write<double>(point3D.xyz(2));
+  writer->Write<uint8_t>(point3D.color(0));
+  writer->Write<uint8_t>(point3D.color(1));
+  writer->Write<uint8_t>(point3D.color(2));
+  writer->Write<double>(point3D.error);
+
+  writer->Write<uint64_t>(point3D.track.Length());
+  for (const auto& track_el : point3D.track.Elements()) {
+    writer->Write<image_t>(track_el.image_id);
+    writer->Write<point2D_t>(track_el.point2D_idx);
+  }
+}
+
+// Recursively splits the points in [begin, end) at the median of the longest
+// axis of their bounding box, until each bucket has at most max_num_points.
+void SplitPointBuckets(
+    std::vector<std::pair<point3D_t, Eigen::Vector3d>>* points,
+    const size_t begin,
+    const size_t end,
+    const size_t max_num_points,
+    std::vector<std::pair<size_t, size_t>>* buckets) {
+  if (end - begin <= max_num_points) {
+    if (end > begin) {
+      buckets->emplace_back(begin, end);
     }
+    return;
+  }
 
-    reconstruction.AddImage(std::move(image));
+  Eigen::AlignedBox3d bbox;
+  for (size_t i = begin; i < end; ++i) {
+    bbox.extend((*points)[i].second);
   }
+  int axis;
+  bbox.sizes().maxCoeff(&axis);
+
+  const size_t middle = begin + (end - begin) / 2;
+  std::nth_element(points->begin() + begin,
+                   points->begin() + middle,
+                   points->begin() + end,
+                   [axis](const auto& point1, const auto& point2) {
+                     return point1.second(axis) < point2.second(axis);
+                   });
+
+  SplitPointBuckets(points, begin, middle, max_num_points, buckets);
+  SplitPointBuckets(points, middle, end, max_num_points, buckets);
 }
 
-void ReadPoints3DText(Reconstruction& reconstruction, const std::string& path) {
+const char kChunkedMagic[8] = {'C', 'O', 'L', 'M', 'A', 'P', 'C', 'R'};
+const uint32_t kChunkedVersion = 1;
+
+}  // namespace
+
+void ReadCamerasText(Reconstruction& reconstruction, const std::string& path) {
   std::ifstream file(path);
   THROW_CHECK_FILE_OPEN(file, path);
 
@@ -209,164 +548,284 @@ void ReadPoints3DText(Reconstruction& reconstruction, const std::string& path) {
 
     std::stringstream line_stream(line);
 
+    struct Camera camera;
+
     // ID
     std::getline(line_stream, item, ' ');
-    const point3D_t point3D_id = std::stoll(item);
-
-    struct Point3D point3D;
+    camera.camera_id = std::stoul(item);
 
-    // XYZ
+    // MODEL
     std::getline(line_stream, item, ' ');
-    point3D.xyz(0) = std::stold(item);
+    camera.model_id = CameraModelNameToId(item);
 
+    // WIDTH
     std::getline(line_stream, item, ' ');
-    point3D.xyz(1) = std::stold(item);
+    camera.width = std::stoll(item);
 
+    // HEIGHT
     std::getline(line_stream, item, ' ');
-    point3D.xyz(2) = std::stold(item);
+    camera.height = std::stoll(item);
 
-    // Color
-    std::getline(line_stream, item, ' ');
-    point3D.color(0) = static_cast<uint8_t>(std::stoi(item));
+    // PARAMS
+    camera.params.reserve(CameraModelNumParams(camera.model_id));
+    while (!line_stream.eof()) {
+      std::getline(line_stream, item, ' ');
+      camera.params.push_back(std::stold(item));
+    }
 
-    std::getline(line_stream, item, ' ');
-    point3D.color(1) = static_cast<uint8_t>(std::stoi(item));
+    THROW_CHECK(camera.VerifyParams());
+    reconstruction.AddCamera(std::move(camera));
+  }
+}
 
-    std::getline(line_stream, item, ' ');
-    point3D.color(2) = static_cast<uint8_t>(std::stoi(item));
+void ReadImagesText(Reconstruction& reconstruction, const std::string& path) {
+  const MappedFile file(path);
+  const char* file_end = file.Data() + file.Size();
+
+  // First pass: Find the two lines of each record without parsing them. The
+  // first line of a record is the next non-empty, non-comment line, while the
+  // second line with the 2D points may be empty.
+  struct Record {
+    const char* line1_begin;
+    const char* line1_end;
+    const char* line2_begin;
+    const char* line2_end;
+  };
+  std::vector<Record> records;
+  const char* line_begin = file.Data();
+  while (line_begin < file_end) {
+    const char* line_end = FindLineEnd(line_begin, file_end);
+    if (IsTextDataLine(line_begin, line_end)) {
+      Record record;
+      record.line1_begin = line_begin;
+      record.line1_end = line_end;
+      if (line_end == file_end) {
+        break;
+      }
+      record.line2_begin = line_end + 1;
+      record.line2_end = FindLineEnd(record.line2_begin, file_end);
+      records.push_back(record);
+      line_end = record.line2_end;
+    }
+    line_begin = line_end + 1;
+  }
 
-    // ERROR
-    std::getline(line_stream, item, ' ');
-    point3D.error = std::stold(item);
+  // Second pass: Parse the records in parallel.
+  std::vector<class Image> images(records.size());
+  ParseRecordsInParallel(records.size(), [&](const size_t i) {
+    class Image& image = images[i];
 
-    // TRACK
-    while (!line_stream.eof()) {
-      TrackElement track_el;
+    TextTokenizer tokenizer1(records[i].line1_begin, records[i].line1_end);
 
-      std::getline(line_stream, item, ' ');
-      StringTrim(&item);
-      if (item.empty()) {
-        break;
+    // ID
+    image.SetImageId(tokenizer1.Read<image_t>());
+
+    image.SetRegistered(true);
+
+    Rigid3d& cam_from_world = image.CamFromWorld();
+    cam_from_world.rotation.w() = tokenizer1.Read<double>();
+    cam_from_world.rotation.x() = tokenizer1.Read<double>();
+    cam_from_world.rotation.y() = tokenizer1.Read<double>();
+    cam_from_world.rotation.z() = tokenizer1.Read<double>();
+    cam_from_world.rotation.normalize();
+    cam_from_world.translation.x() = tokenizer1.Read<double>();
+    cam_from_world.translation.y() = tokenizer1.Read<double>();
+    cam_from_world.translation.z() = tokenizer1.Read<double>();
+
+    // CAMERA_ID
+    image.SetCameraId(tokenizer1.Read<camera_t>());
+
+    // NAME
+    image.SetName(std::string(tokenizer1.NextToken()));
+
+    // POINTS2D
+    TextTokenizer tokenizer2(records[i].line2_begin, records[i].line2_end);
+    std::vector<struct Point2D> points2D;
+    while (!tokenizer2.AtEnd()) {
+      struct Point2D& point2D = points2D.emplace_back();
+      point2D.xy(0) = tokenizer2.Read<double>();
+      point2D.xy(1) = tokenizer2.Read<double>();
+      const std::string_view point3D_id = tokenizer2.NextToken();
+      if (point3D_id != "-1") {
+        TextTokenizer tokenizer3(point3D_id.data(),
+                                 point3D_id.data() + point3D_id.size());
+        point2D.point3D_id = tokenizer3.Read<point3D_t>();
       }
-      track_el.image_id = std::stoul(item);
+    }
+    image.SetPoints2D(points2D);
+  });
 
-      std::getline(line_stream, item, ' ');
-      track_el.point2D_idx = std::stoul(item);
+  reconstruction.Reserve(reconstruction.NumCameras(),
+                         reconstruction.NumImages() + images.size(),
+                         reconstruction.NumPoints3D());
+  for (class Image& image : images) {
+    reconstruction.AddImage(std::move(image));
+  }
+}
 
-      point3D.track.AddElement(track_el);
+void ReadPoints3DText(Reconstruction& reconstruction, const std::string& path) {
+  const MappedFile file(path);
+  const char* file_end = file.Data() + file.Size();
+
+  // Split the file into chunks at line boundaries and parse the chunks in
+  // parallel, since each non-empty, non-comment line is one record.
+  const size_t kMinNumBytesPerChunk = 1 << 20;
+  const size_t num_chunks = std::max<size_t>(
+      1,
+      std::min<size_t>(4 * GetEffectiveNumThreads(-1),
+                       file.Size() / kMinNumBytesPerChunk));
+  std::vector<const char*> chunk_begins(num_chunks + 1, file_end);
+  chunk_begins[0] = file.Data();
+  for (size_t i = 1; i < num_chunks; ++i) {
+    const char* chunk_begin = std::max(
+        chunk_begins[i - 1], file.Data() + i * file.Size() / num_chunks);
+    if (chunk_begin != file.Data() && chunk_begin[-1] != '\n') {
+      chunk_begin = std::min(FindLineEnd(chunk_begin, file_end) + 1, file_end);
     }
+    chunk_begins[i] = chunk_begin;
+  }
+
+  std::vector<std::vector<std::pair<point3D_t, struct Point3D>>> chunk_points3D(
+      num_chunks);
+  auto parse_chunk = [&](const size_t chunk_idx) {
+    const char* chunk_end = chunk_begins[chunk_idx + 1];
+    const char* line_begin = chunk_begins[chunk_idx];
+    while (line_begin < chunk_end) {
+      const char* line_end = FindLineEnd(line_begin, chunk_end);
+      if (IsTextDataLine(line_begin, line_end)) {
+        TextTokenizer tokenizer(line_begin, line_end);
+
+        auto& [point3D_id, point3D] = chunk_points3D[chunk_idx].emplace_back();
+
+        // ID
+        point3D_id = tokenizer.Read<point3D_t>();
+
+        // XYZ
+        point3D.xyz(0) = tokenizer.Read<double>();
+        point3D.xyz(1) = tokenizer.Read<double>();
+        point3D.xyz(2) = tokenizer.Read<double>();
+
+        // Color
+        point3D.color(0) = static_cast<uint8_t>(tokenizer.Read<int>());
+        point3D.color(1) = static_cast<uint8_t>(tokenizer.Read<int>());
+        point3D.color(2) = static_cast<uint8_t>(tokenizer.Read<int>());
+
+        // ERROR
+        point3D.error = tokenizer.Read<double>();
+
+        // TRACK
+        while (!tokenizer.AtEnd()) {
+          const image_t image_id = tokenizer.Read<image_t>();
+          const point2D_t point2D_idx = tokenizer.Read<point2D_t>();
+          point3D.track.AddElement(image_id, point2D_idx);
+        }
 
-    point3D.track.Compress();
+        point3D.track.Compress();
+      }
+      line_begin = line_end + 1;
+    }
+  };
+
+  if (num_chunks == 1) {
+    parse_chunk(0);
+  } else {
+    ThreadPool thread_pool(std::min<size_t>(GetEffectiveNumThreads(-1),
+                                            num_chunks));
+    std::vector<std::future<void>> futures;
+    futures.reserve(num_chunks);
+    for (size_t chunk_idx = 0; chunk_idx < num_chunks; ++chunk_idx) {
+      futures.push_back(thread_pool.AddTask(parse_chunk, chunk_idx));
+    }
+    for (auto& future : futures) {
+      future.get();
+    }
+  }
 
-    reconstruction.AddPoint3D(point3D_id, std::move(point3D));
+  size_t num_points3D = 0;
+  for (const auto& points3D : chunk_points3D) {
+    num_points3D += points3D.size();
+  }
+  reconstruction.Reserve(reconstruction.NumCameras(),
+                         reconstruction.NumImages(),
+                         reconstruction.NumPoints3D() + num_points3D);
+  for (auto& points3D : chunk_points3D) {
+    for (auto& point3D : points3D) {
+      reconstruction.AddPoint3D(point3D.first, std::move(point3D.second));
+    }
+    points3D.clear();
+    points3D.shrink_to_fit();
   }
 }
 
 void ReadCamerasBinary(Reconstruction& reconstruction,
                        const std::string& path) {
-  std::ifstream file(path, std::ios::binary);
-  THROW_CHECK_FILE_OPEN(file, path);
+  const MappedFile file(path);
+  BinaryCursor cursor(file.Data(), file.Size());
 
-  const size_t num_cameras = ReadBinaryLittleEndian<uint64_t>(&file);
+  const size_t num_cameras = cursor.Read<uint64_t>();
   for (size_t i = 0; i < num_cameras; ++i) {
-    struct Camera camera;
-    camera.camera_id = ReadBinaryLittleEndian<camera_t>(&file);
-    camera.model_id =
-        static_cast<CameraModelId>(ReadBinaryLittleEndian<int>(&file));
-    camera.width = ReadBinaryLittleEndian<uint64_t>(&file);
-    camera.height = ReadBinaryLittleEndian<uint64_t>(&file);
-    camera.params.resize(CameraModelNumParams(camera.model_id), 0.);
-    ReadBinaryLittleEndian<double>(&file, &camera.params);
-    THROW_CHECK(camera.VerifyParams());
-    reconstruction.AddCamera(std::move(camera));
+    reconstruction.AddCamera(ReadCameraRecord(&cursor));
   }
 }
 
 void ReadImagesBinary(Reconstruction& reconstruction, const std::string& path) {
-  std::ifstream file(path, std::ios::binary);
-  THROW_CHECK_FILE_OPEN(file, path);
+  const MappedFile file(path);
+  BinaryCursor cursor(file.Data(), file.Size());
 
-  const size_t num_reg_images = ReadBinaryLittleEndian<uint64_t>(&file);
+  // First pass: Find the byte offset of each record without parsing it.
+  const size_t num_reg_images = cursor.Read<uint64_t>();
+  THROW_CHECK_LE(num_reg_images, file.Size() / kMinImageRecordNumBytes);
+  std::vector<size_t> record_offsets(num_reg_images);
   for (size_t i = 0; i < num_reg_images; ++i) {
-    class Image image;
-
-    image.SetImageId(ReadBinaryLittleEndian<image_t>(&file));
-
-    Rigid3d& cam_from_world = image.CamFromWorld();
-    cam_from_world.rotation.w() = ReadBinaryLittleEndian<double>(&file);
-    cam_from_world.rotation.x() = ReadBinaryLittleEndian<double>(&file);
-    cam_from_world.rotation.y() = ReadBinaryLittleEndian<double>(&file);
-    cam_from_world.rotation.z() = ReadBinaryLittleEndian<double>(&file);
-    cam_from_world.rotation.normalize();
-    cam_from_world.translation.x() = ReadBinaryLittleEndian<double>(&file);
-    cam_from_world.translation.y() = ReadBinaryLittleEndian<double>(&file);
-    cam_from_world.translation.z() = ReadBinaryLittleEndian<double>(&file);
-
-    image.SetCameraId(ReadBinaryLittleEndian<camera_t>(&file));
-
-    char name_char;
-    do {
-      file.read(&name_char, 1);
-      if (name_char != '\0') {
-        image.Name() += name_char;
-      }
-    } while (name_char != '\0');
-
-    const size_t num_points2D = ReadBinaryLittleEndian<uint64_t>(&file);
-
-    std::vector<Eigen::Vector2d> points2D;
-    points2D.reserve(num_points2D);
-    std::vector<point3D_t> point3D_ids;
-    point3D_ids.reserve(num_points2D);
-    for (size_t j = 0; j < num_points2D; ++j) {
-      const double x = ReadBinaryLittleEndian<double>(&file);
-      const double y = ReadBinaryLittleEndian<double>(&file);
-      points2D.emplace_back(x, y);
-      point3D_ids.push_back(ReadBinaryLittleEndian<point3D_t>(&file));
-    }
-
-    image.SetPoints2D(points2D);
-
-    for (point2D_t point2D_idx = 0; point2D_idx < image.NumPoints2D();
-         ++point2D_idx) {
-      if (point3D_ids[point2D_idx] != kInvalidPoint3DId) {
-        image.SetPoint3DForPoint2D(point2D_idx, point3D_ids[point2D_idx]);
-      }
-    }
+    record_offsets[i] = cursor.Offset();
+    cursor.Skip(sizeof(image_t) + 7 * sizeof(double) + sizeof(camera_t));
+    cursor.SkipString();
+    SkipPoints2DRecord(&cursor, file.Size());
+  }
 
-    image.SetRegistered(true);
+  // Second pass: Parse the records in parallel.
+  std::vector<class Image> images(num_reg_images);
+  ParseRecordsInParallel(num_reg_images, [&](const size_t i) {
+    BinaryCursor cursor(file.Data(), file.Size(), record_offsets[i]);
+    ReadImagePoseRecord(&cursor, &images[i]);
+    ReadPoints2DRecord(&cursor, &images[i]);
+    images[i].SetRegistered(true);
+  });
+
+  reconstruction.Reserve(reconstruction.NumCameras(),
+                         reconstruction.NumImages() + num_reg_images,
+                         reconstruction.NumPoints3D());
+  for (class Image& image : images) {
     reconstruction.AddImage(std::move(image));
   }
 }
 
 void ReadPoints3DBinary(Reconstruction& reconstruction,
                         const std::string& path) {
-  std::ifstream file(path, std::ios::binary);
-  THROW_CHECK_FILE_OPEN(file, path);
+  const MappedFile file(path);
+  BinaryCursor cursor(file.Data(), file.Size());
 
-  const size_t num_points3D = ReadBinaryLittleEndian<uint64_t>(&file);
+  // First pass: Find the byte offset of each record without parsing it.
+  const size_t num_points3D = cursor.Read<uint64_t>();
+  THROW_CHECK_LE(num_points3D, file.Size() / kMinPoint3DRecordNumBytes);
+  std::vector<size_t> record_offsets(num_points3D);
   for (size_t i = 0; i < num_points3D; ++i) {
-    struct Point3D point3D;
-
-    const point3D_t point3D_id = ReadBinaryLittleEndian<point3D_t>(&file);
-
-    point3D.xyz(0) = ReadBinaryLittleEndian<double>(&file);
-    point3D.xyz(1) = ReadBinaryLittleEndian<double>(&file);
-    point3D.xyz(2) = ReadBinaryLittleEndian<double>(&file);
-    point3D.color(0) = ReadBinaryLittleEndian<uint8_t>(&file);
-    point3D.color(1) = ReadBinaryLittleEndian<uint8_t>(&file);
-    point3D.color(2) = ReadBinaryLittleEndian<uint8_t>(&file);
-    point3D.error = ReadBinaryLittleEndian<double>(&file);
-
-    const size_t track_length = ReadBinaryLittleEndian<uint64_t>(&file);
-    for (size_t j = 0; j < track_length; ++j) {
-      const image_t image_id = ReadBinaryLittleEndian<image_t>(&file);
-      const point2D_t point2D_idx = ReadBinaryLittleEndian<point2D_t>(&file);
-      point3D.track.AddElement(image_id, point2D_idx);
-    }
-    point3D.track.Compress();
+    record_offsets[i] = cursor.Offset();
+    SkipPoint3DRecord(&cursor, file.Size());
+  }
 
-    reconstruction.AddPoint3D(point3D_id, std::move(point3D));
+  // Second pass: Parse the records in parallel.
+  std::vector<std::pair<point3D_t, struct Point3D>> points3D(num_points3D);
+  ParseRecordsInParallel(num_points3D, [&](const size_t i) {
+    BinaryCursor cursor(file.Data(), file.Size(), record_offsets[i]);
+    ReadPoint3DRecord(&cursor, &points3D[i].first, &points3D[i].second);
+  });
+
+  reconstruction.Reserve(reconstruction.NumCameras(),
+                         reconstruction.NumImages(),
+                         reconstruction.NumPoints3D() + num_points3D);
+  for (auto& point3D : points3D) {
+    reconstruction.AddPoint3D(point3D.first, std::move(point3D.second));
   }
 }
 
@@ -419,49 +878,58 @@ void WriteImagesText(const Reconstruction& reconstruction,
        << ", mean observations per image: "
        << reconstruction.ComputeMeanObservationsPerRegImage() << std::endl;
 
+  std::vector<const class Image*> images;
+  images.reserve(reconstruction.NumRegImages());
   for (const auto& image : reconstruction.Images()) {
-    if (!image.second.IsRegistered()) {
-      continue;
+    if (image.second.IsRegistered()) {
+      images.push_back(&image.second);
     }
+  }
 
-    std::ostringstream line;
-    line.precision(17);
-
-    std::string line_string;
-
-    line << image.first << " ";
-
-    const Rigid3d& cam_from_world = image.second.CamFromWorld();
-    line << cam_from_world.rotation.w() << " ";
-    line << cam_from_world.rotation.x() << " ";
-    line << cam_from_world.rotation.y() << " ";
-    line << cam_from_world.rotation.z() << " ";
-    line << cam_from_world.translation.x() << " ";
-    line << cam_from_world.translation.y() << " ";
-    line << cam_from_world.translation.z() << " ";
-
-    line << image.second.CameraId() << " ";
-
-    line << image.second.Name();
-
-    file << line.str() << std::endl;
-
-    line.str("");
-    line.clear();
+  FormatRecordsInParallel(
+      images.size(),
+      [&images](const size_t i, std::string* text) {
+        const class Image& image = *images[i];
+
+        AppendInteger(image.ImageId(), text);
+        text->push_back(' ');
+
+        const Rigid3d& cam_from_world = image.CamFromWorld();
+        for (const double value : {cam_from_world.rotation.w(),
+                                   cam_from_world.rotation.x(),
+                                   cam_from_world.rotation.y(),
+                                   cam_from_world.rotation.z(),
+                                   cam_from_world.translation.x(),
+                                   cam_from_world.translation.y(),
+                                   cam_from_world.translation.z()}) {
+          AppendDouble(value, text);
+          text->push_back(' ');
+        }
 
-    for (const Point2D& point2D : image.second.Points2D()) {
-      line << point2D.xy(0) << " ";
-      line << point2D.xy(1) << " ";
-      if (point2D.HasPoint3D()) {
-        line << point2D.point3D_id << " ";
-      } else {
-        line << -1 << " ";
-      }
-    }
-    line_string = line.str();
-    line_string = line_string.substr(0, line_string.size() - 1);
-    file << line_string << std::endl;
-  }
+        AppendInteger(image.CameraId(), text);
+        text->push_back(' ');
+
+        text->append(image.Name());
+        text->push_back('\n');
+
+        for (const Point2D& point2D : image.Points2D()) {
+          AppendDouble(point2D.xy(0), text);
+          text->push_back(' ');
+          AppendDouble(point2D.xy(1), text);
+          text->push_back(' ');
+          if (point2D.HasPoint3D()) {
+            AppendInteger(point2D.point3D_id, text);
+          } else {
+            text->append("-1");
+          }
+          text->push_back(' ');
+        }
+        if (image.NumPoints2D() > 0) {
+          text->pop_back();
+        }
+        text->push_back('\n');
+      },
+      &file);
 }
 
 void WritePoints3DText(const Reconstruction& reconstruction,
@@ -480,110 +948,367 @@ void WritePoints3DText(const Reconstruction& reconstruction,
        << ", mean track length: " << reconstruction.ComputeMeanTrackLength()
        << std::endl;
 
+  std::vector<std::pair<point3D_t, const struct Point3D*>> points3D;
+  points3D.reserve(reconstruction.NumPoints3D());
   for (const auto& point3D : reconstruction.Points3D()) {
-    file << point3D.first << " ";
-    file << point3D.second.xyz(0) << " ";
-    file << point3D.second.xyz(1) << " ";
-    file << point3D.second.xyz(2) << " ";
-    file << static_cast<int>(point3D.second.color(0)) << " ";
-    file << static_cast<int>(point3D.second.color(1)) << " ";
-    file << static_cast<int>(point3D.second.color(2)) << " ";
-    file << point3D.second.error << " ";
-
-    std::ostringstream line;
-    line.precision(17);
-
-    for (const auto& track_el : point3D.second.track.Elements()) {
-      line << track_el.image_id << " ";
-      line << track_el.point2D_idx << " ";
-    }
+    points3D.emplace_back(point3D.first, &point3D.second);
+  }
 
-    std::string line_string = line.str();
-    line_string = line_string.substr(0, line_string.size() - 1);
+  FormatRecordsInParallel(
+      points3D.size(),
+      [&points3D](const size_t i, std::string* text) {
+        const struct Point3D& point3D = *points3D[i].second;
 
-    file << line_string << std::endl;
-  }
+        AppendInteger(points3D[i].first, text);
+        text->push_back(' ');
+        for (int d = 0; d < 3; ++d) {
+          AppendDouble(point3D.xyz(d), text);
+          text->push_back(' ');
+        }
+        for (int c = 0; c < 3; ++c) {
+          AppendInteger(static_cast<int>(point3D.color(c)), text);
+          text->push_back(' ');
+        }
+        AppendDouble(point3D.error, text);
+        text->push_back(' ');
+
+        for (const auto& track_el : point3D.track.Elements()) {
+          AppendInteger(track_el.image_id, text);
+          text->push_back(' ');
+          AppendInteger(track_el.point2D_idx, text);
+          text->push_back(' ');
+        }
+        if (point3D.track.Length() > 0) {
+          text->pop_back();
+        }
+        text->push_back('\n');
+      },
+      &file);
 }
 
 void WriteCamerasBinary(const Reconstruction& reconstruction,
                         const std::string& path) {
-  std::ofstream file(path, std::ios::trunc | std::ios::binary);
-  THROW_CHECK_FILE_OPEN(file, path);
+  BufferedBinaryWriter writer(path);
 
-  WriteBinaryLittleEndian<uint64_t>(&file, reconstruction.NumCameras());
+  writer.Write<uint64_t>(reconstruction.NumCameras());
 
   for (const auto& camera : reconstruction.Cameras()) {
-    WriteBinaryLittleEndian<camera_t>(&file, camera.first);
-    WriteBinaryLittleEndian<int>(&file,
-                                 static_cast<int>(camera.second.model_id));
-    WriteBinaryLittleEndian<uint64_t>(&file, camera.second.width);
-    WriteBinaryLittleEndian<uint64_t>(&file, camera.second.height);
-    for (const double param : camera.second.params) {
-      WriteBinaryLittleEndian<double>(&file, param);
-    }
+    WriteCameraRecord(&writer, camera.second);
   }
+
+  writer.Flush();
 }
 
 void WriteImagesBinary(const Reconstruction& reconstruction,
                        const std::string& path) {
-  std::ofstream file(path, std::ios::trunc | std::ios::binary);
-  THROW_CHECK_FILE_OPEN(file, path);
+  BufferedBinaryWriter writer(path);
 
-  WriteBinaryLittleEndian<uint64_t>(&file, reconstruction.NumRegImages());
+  writer.Write<uint64_t>(reconstruction.NumRegImages());
 
   for (const auto& image : reconstruction.Images()) {
     if (!image.second.IsRegistered()) {
       continue;
     }
+    WriteImagePoseRecord(&writer, image.second);
+    WritePoints2DRecord(&writer, image.second);
+  }
+
+  writer.Flush();
+}
+
+void WritePoints3DBinary(const Reconstruction& reconstruction,
+                         const std::string& path) {
+  BufferedBinaryWriter writer(path);
+
+  writer.Write<uint64_t>(reconstruction.NumPoints3D());
+
+  for (const auto& point3D : reconstruction.Points3D()) {
+    WritePoint3DRecord(&writer, point3D.first, point3D.second);
+  }
+
+  writer.Flush();
+}
+
+void WriteChunkedReconstruction(const Reconstruction& reconstruction,
+                                const std::string& path,
+                                const size_t max_num_points_per_bucket) {
+  THROW_CHECK_GT(max_num_points_per_bucket, 0);
+
+  BufferedBinaryWriter writer(path);
+  writer.Write(kChunkedMagic, sizeof(kChunkedMagic));
+  writer.Write<uint32_t>(kChunkedVersion);
 
-    WriteBinaryLittleEndian<image_t>(&file, image.first);
+  const uint64_t cameras_offset = writer.NumBytesWritten();
+  writer.Write<uint64_t>(reconstruction.NumCameras());
+  for (const auto& camera : reconstruction.Cameras()) {
+    WriteCameraRecord(&writer, camera.second);
+  }
 
-    const Rigid3d& cam_from_world = image.second.CamFromWorld();
-    WriteBinaryLittleEndian<double>(&file, cam_from_world.rotation.w());
-    WriteBinaryLittleEndian<double>(&file, cam_from_world.rotation.x());
-    WriteBinaryLittleEndian<double>(&file, cam_from_world.rotation.y());
-    WriteBinaryLittleEndian<double>(&file, cam_from_world.rotation.z());
-    WriteBinaryLittleEndian<double>(&file, cam_from_world.translation.x());
-    WriteBinaryLittleEndian<double>(&file, cam_from_world.translation.y());
-    WriteBinaryLittleEndian<double>(&file, cam_from_world.translation.z());
+  std::vector<image_t> reg_image_ids = reconstruction.RegImageIds();
+  std::sort(reg_image_ids.begin(), reg_image_ids.end());
 
-    WriteBinaryLittleEndian<camera_t>(&file, image.second.CameraId());
+  const uint64_t poses_offset = writer.NumBytesWritten();
+  writer.Write<uint64_t>(reg_image_ids.size());
+  for (const image_t image_id : reg_image_ids) {
+    WriteImagePoseRecord(&writer, reconstruction.Image(image_id));
+  }
+
+  std::vector<uint64_t> observations_offsets;
+  observations_offsets.reserve(reg_image_ids.size());
+  for (const image_t image_id : reg_image_ids) {
+    observations_offsets.push_back(writer.NumBytesWritten());
+    WritePoints2DRecord(&writer, reconstruction.Image(image_id));
+  }
 
-    const std::string name = image.second.Name() + '\0';
-    file.write(name.c_str(), name.size());
+  std::vector<std::pair<point3D_t, Eigen::Vector3d>> points;
+  points.reserve(reconstruction.NumPoints3D());
+  for (const auto& point3D : reconstruction.Points3D()) {
+    points.emplace_back(point3D.first, point3D.second.xyz);
+  }
+  std::sort(points.begin(),
+            points.end(),
+            [](const auto& point1, const auto& point2) {
+              return point1.first < point2.first;
+            });
+
+  std::vector<std::pair<size_t, size_t>> buckets;
+  SplitPointBuckets(
+      &points, 0, points.size(), max_num_points_per_bucket, &buckets);
+
+  std::vector<Eigen::AlignedBox3d> bucket_bboxes;
+  std::vector<uint64_t> bucket_offsets;
+  bucket_bboxes.reserve(buckets.size());
+  bucket_offsets.reserve(buckets.size());
+  for (const auto& [begin, end] : buckets) {
+    Eigen::AlignedBox3d& bbox = bucket_bboxes.emplace_back();
+    bucket_offsets.push_back(writer.NumBytesWritten());
+    writer.Write<uint64_t>(end - begin);
+    for (size_t i = begin; i < end; ++i) {
+      const point3D_t point3D_id = points[i].first;
+      bbox.extend(points[i].second);
+      WritePoint3DRecord(
+          &writer, point3D_id, reconstruction.Point3D(point3D_id));
+    }
+  }
 
-    WriteBinaryLittleEndian<uint64_t>(&file, image.second.NumPoints2D());
-    for (const Point2D& point2D : image.second.Points2D()) {
-      WriteBinaryLittleEndian<double>(&file, point2D.xy(0));
-      WriteBinaryLittleEndian<double>(&file, point2D.xy(1));
-      WriteBinaryLittleEndian<point3D_t>(&file, point2D.point3D_id);
+  const uint64_t index_offset = writer.NumBytesWritten();
+  writer.Write<uint64_t>(cameras_offset);
+  writer.Write<uint64_t>(poses_offset);
+  writer.Write<uint64_t>(reg_image_ids.size());
+  for (size_t i = 0; i < reg_image_ids.size(); ++i) {
+    writer.Write<image_t>(reg_image_ids[i]);
+    writer.Write<uint64_t>(observations_offsets[i]);
+  }
+  writer.Write<uint64_t>(buckets.size());
+  for (size_t i = 0; i < buckets.size(); ++i) {
+    for (int d = 0; d < 3; ++d) {
+      writer.Write<double>(bucket_bboxes[i].min()(d));
     }
+    for (int d = 0; d < 3; ++d) {
+      writer.Write<double>(bucket_bboxes[i].max()(d));
+    }
+    writer.Write<uint64_t>(bucket_offsets[i]);
+    writer.Write<uint64_t>(buckets[i].second - buckets[i].first);
   }
+  writer.Write<uint64_t>(index_offset);
+  writer.Write(kChunkedMagic, sizeof(kChunkedMagic));
+
+  writer.Flush();
 }
 
-void WritePoints3DBinary(const Reconstruction& reconstruction,
-                         const std::string& path) {
-  std::ofstream file(path, std::ios::trunc | std::ios::binary);
-  THROW_CHECK_FILE_OPEN(file, path);
+struct ChunkedReconstructionReader::Impl {
+  explicit Impl(const std::string& path) : file(path, /*sequential=*/false) {}
+
+  struct PointBucket {
+    Eigen::AlignedBox3d bbox;
+    uint64_t offset = 0;
+    uint64_t num_points = 0;
+  };
+
+  void ReadPointBuckets(Reconstruction& reconstruction,
+                        const Eigen::AlignedBox3d& bbox) const {
+    // Find the byte offset of each point record in the overlapping buckets.
+    std::vector<size_t> record_offsets;
+    for (const PointBucket& bucket : point_buckets) {
+      if (!bucket.bbox.intersects(bbox)) {
+        continue;
+      }
+      BinaryCursor cursor(file.Data(), file.Size(), bucket.offset);
+      const size_t num_points = cursor.Read<uint64_t>();
+      THROW_CHECK_EQ(num_points, bucket.num_points);
+      for (size_t i = 0; i < num_points; ++i) {
+        record_offsets.push_back(cursor.Offset());
+        SkipPoint3DRecord(&cursor, file.Size());
+      }
+    }
+
+    std::vector<std::pair<point3D_t, struct Point3D>> points3D(
+        record_offsets.size());
+    ParseRecordsInParallel(record_offsets.size(), [&](const size_t i) {
+      BinaryCursor cursor(file.Data(), file.Size(), record_offsets[i]);
+      ReadPoint3DRecord(&cursor, &points3D[i].first, &points3D[i].second);
+    });
+
+    reconstruction.Reserve(reconstruction.NumCameras(),
+                           reconstruction.NumImages(),
+                           reconstruction.NumPoints3D() + points3D.size());
+    for (auto& point3D : points3D) {
+      if (bbox.contains(point3D.second.xyz)) {
+        reconstruction.AddPoint3D(point3D.first, std::move(point3D.second));
+      }
+    }
+  }
 
-  WriteBinaryLittleEndian<uint64_t>(&file, reconstruction.NumPoints3D());
+  MappedFile file;
+  uint64_t cameras_offset = 0;
+  uint64_t poses_offset = 0;
+  std::vector<image_t> image_ids;
+  std::unordered_map<image_t, uint64_t> observations_offsets;
+  std::vector<PointBucket> point_buckets;
+};
+
+ChunkedReconstructionReader::ChunkedReconstructionReader(
+    const std::string& path)
+    : impl_(std::make_unique<Impl>(path)) {
+  const MappedFile& file = impl_->file;
+
+  const size_t kHeaderNumBytes = sizeof(kChunkedMagic) + sizeof(uint32_t);
+  const size_t kTrailerNumBytes = sizeof(uint64_t) + sizeof(kChunkedMagic);
+  THROW_CHECK_GE(file.Size(), kHeaderNumBytes + kTrailerNumBytes)
+      << "Invalid chunked reconstruction file: " << path;
+  THROW_CHECK_EQ(
+      std::memcmp(file.Data(), kChunkedMagic, sizeof(kChunkedMagic)), 0)
+      << "Invalid chunked reconstruction file: " << path;
+  THROW_CHECK_EQ(
+      std::memcmp(file.Data() + file.Size() - sizeof(kChunkedMagic),
+                  kChunkedMagic,
+                  sizeof(kChunkedMagic)),
+      0)
+      << "Truncated chunked reconstruction file: " << path;
+
+  BinaryCursor header_cursor(file.Data(), file.Size(), sizeof(kChunkedMagic));
+  const uint32_t version = header_cursor.Read<uint32_t>();
+  THROW_CHECK_EQ(version, kChunkedVersion)
+      << "Unsupported chunked reconstruction version: " << path;
+
+  BinaryCursor trailer_cursor(
+      file.Data(), file.Size(), file.Size() - kTrailerNumBytes);
+  const uint64_t index_offset = trailer_cursor.Read<uint64_t>();
+  THROW_CHECK_LE(index_offset, file.Size() - kTrailerNumBytes);
+
+  BinaryCursor cursor(
+      file.Data(), file.Size() - kTrailerNumBytes, index_offset);
+  impl_->cameras_offset = cursor.Read<uint64_t>();
+  impl_->poses_offset = cursor.Read<uint64_t>();
+
+  const size_t num_images = cursor.Read<uint64_t>();
+  THROW_CHECK_LE(num_images,
+                 cursor.NumRemainingBytes() /
+                     (sizeof(image_t) + sizeof(uint64_t)));
+  impl_->image_ids.reserve(num_images);
+  impl_->observations_offsets.reserve(num_images);
+  for (size_t i = 0; i < num_images; ++i) {
+    const image_t image_id = cursor.Read<image_t>();
+    impl_->image_ids.push_back(image_id);
+    impl_->observations_offsets.emplace(image_id, cursor.Read<uint64_t>());
+  }
 
-  for (const auto& point3D : reconstruction.Points3D()) {
-    WriteBinaryLittleEndian<point3D_t>(&file, point3D.first);
-    WriteBinaryLittleEndian<double>(&file, point3D.second.xyz(0));
-    WriteBinaryLittleEndian<double>(&file, point3D.second.xyz(1));
-    WriteBinaryLittleEndian<double>(&file, point3D.second.xyz(2));
-    WriteBinaryLittleEndian<uint8_t>(&file, point3D.second.color(0));
-    WriteBinaryLittleEndian<uint8_t>(&file, point3D.second.color(1));
-    WriteBinaryLittleEndian<uint8_t>(&file, point3D.second.color(2));
-    WriteBinaryLittleEndian<double>(&file, point3D.second.error);
-
-    WriteBinaryLittleEndian<uint64_t>(&file, point3D.second.track.Length());
-    for (const auto& track_el : point3D.second.track.Elements()) {
-      WriteBinaryLittleEndian<image_t>(&file, track_el.image_id);
-      WriteBinaryLittleEndian<point2D_t>(&file, track_el.point2D_idx);
+  const size_t num_point_buckets = cursor.Read<uint64_t>();
+  THROW_CHECK_LE(num_point_buckets,
+                 cursor.NumRemainingBytes() /
+                     (6 * sizeof(double) + 2 * sizeof(uint64_t)));
+  impl_->point_buckets.resize(num_point_buckets);
+  for (Impl::PointBucket& bucket : impl_->point_buckets) {
+    for (int d = 0; d < 3; ++d) {
+      bucket.bbox.min()(d) = cursor.Read<double>();
     }
+    for (int d = 0; d < 3; ++d) {
+      bucket.bbox.max()(d) = cursor.Read<double>();
+    }
+    bucket.offset = cursor.Read<uint64_t>();
+    bucket.num_points = cursor.Read<uint64_t>();
+  }
+}
+
+ChunkedReconstructionReader::~ChunkedReconstructionReader() = default;
+
+size_t ChunkedReconstructionReader::NumRegImages() const {
+  return impl_->image_ids.size();
+}
+
+size_t ChunkedReconstructionReader::NumPoints3D() const {
+  size_t num_points3D = 0;
+  for (const Impl::PointBucket& bucket : impl_->point_buckets) {
+    num_points3D += bucket.num_points;
   }
+  return num_points3D;
+}
+
+const std::vector<image_t>& ChunkedReconstructionReader::RegImageIds() const {
+  return impl_->image_ids;
+}
+
+void ChunkedReconstructionReader::Read(Reconstruction& reconstruction) const {
+  ReadPoses(reconstruction);
+  ReadObservations(reconstruction, impl_->image_ids);
+  Eigen::AlignedBox3d bbox;
+  for (const Impl::PointBucket& bucket : impl_->point_buckets) {
+    bbox.extend(bucket.bbox);
+  }
+  impl_->ReadPointBuckets(reconstruction, bbox);
+}
+
+void ChunkedReconstructionReader::ReadPoses(
+    Reconstruction& reconstruction) const {
+  const MappedFile& file = impl_->file;
+
+  BinaryCursor cameras_cursor(file.Data(), file.Size(), impl_->cameras_offset);
+  const size_t num_cameras = cameras_cursor.Read<uint64_t>();
+  for (size_t i = 0; i < num_cameras; ++i) {
+    reconstruction.AddCamera(ReadCameraRecord(&cameras_cursor));
+  }
+
+  BinaryCursor poses_cursor(file.Data(), file.Size(), impl_->poses_offset);
+  const size_t num_reg_images = poses_cursor.Read<uint64_t>();
+  THROW_CHECK_EQ(num_reg_images, impl_->image_ids.size());
+  reconstruction.Reserve(reconstruction.NumCameras(),
+                         reconstruction.NumImages() + num_reg_images,
+                         reconstruction.NumPoints3D());
+  for (size_t i = 0; i < num_reg_images; ++i) {
+    class Image image;
+    ReadImagePoseRecord(&poses_cursor, &image);
+    image.SetRegistered(true);
+    reconstruction.AddImage(std::move(image));
+  }
+}
+
+void ChunkedReconstructionReader::ReadObservations(
+    Reconstruction& reconstruction,
+    const std::vector<image_t>& image_ids) const {
+  const MappedFile& file = impl_->file;
+
+  const std::unordered_set<image_t> unique_image_ids(image_ids.begin(),
+                                                     image_ids.end());
+  std::vector<std::pair<class Image*, uint64_t>> images;
+  images.reserve(unique_image_ids.size());
+  for (const image_t image_id : unique_image_ids) {
+    const auto offset = impl_->observations_offsets.find(image_id);
+    THROW_CHECK(offset != impl_->observations_offsets.end())
+        << "Image " << image_id << " does not exist in the file";
+    images.emplace_back(&reconstruction.Image(image_id), offset->second);
+  }
+
+  ParseRecordsInParallel(images.size(), [&](const size_t i) {
+    BinaryCursor cursor(file.Data(), file.Size(), images[i].second);
+    ReadPoints2DRecord(&cursor, images[i].first);
+  });
+}
+
+void ChunkedReconstructionReader::ReadPoints3D(
+    Reconstruction& reconstruction,
+    const std::pair<Eigen::Vector3d, Eigen::Vector3d>& bbox) const {
+  impl_->ReadPointBuckets(reconstruction,
+                          Eigen::AlignedBox3d(bbox.first, bbox.second));
 }
 
 bool ExportNVM(const Reconstruction& reconstruction,
@@ -31,6 +31,11 @@
 
 #include "colmap/scene/reconstruction.h"
 
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
 #include <Eigen/Core>
 
 namespace colmap {
@@ -66,6 +71,52 @@ void WriteImagesBinary(const Reconstruction& reconstruction,
 void WritePoints3DBinary(const Reconstruction& reconstruction,
                          const std::string& path);
 
+// Writes all cameras, registered images, and 3D points into a single file in
+// the chunked format, which supports loading parts of a model without reading
+// the entire file. The file consists of a header, one chunk with the cameras,
+// one chunk with the poses of all registered images, one chunk with the 2D
+// points of each image, one chunk per spatial bucket of 3D points, and an
+// index footer with the offsets of all chunks and the bounding boxes of the
+// buckets. Buckets are formed by recursive median splits of the 3D points
+// along the longest axis, until each has at most max_num_points_per_bucket.
+void WriteChunkedReconstruction(const Reconstruction& reconstruction,
+                                const std::string& path,
+                                size_t max_num_points_per_bucket = 65536);
+
+// Reader for files written by WriteChunkedReconstruction. The file is
+// memory-mapped and only the chunks of the requested data are accessed.
+class ChunkedReconstructionReader {
+ public:
+  explicit ChunkedReconstructionReader(const std::string& path);
+  ~ChunkedReconstructionReader();
+
+  size_t NumRegImages() const;
+  size_t NumPoints3D() const;
+  const std::vector<image_t>& RegImageIds() const;
+
+  // Read all cameras, images, and 3D points.
+  void Read(Reconstruction& reconstruction) const;
+
+  // Read all cameras and registered images without their 2D points.
+  void ReadPoses(Reconstruction& reconstruction) const;
+
+  // Read the 2D points of the given images, which must have been read before
+  // through ReadPoses.
+  void ReadObservations(Reconstruction& reconstruction,
+                        const std::vector<image_t>& image_ids) const;
+
+  // Read all 3D points inside the given bounding box (min, max). Only the
+  // buckets overlapping the box are accessed. Note that the tracks of the
+  // points are not checked against the images in the reconstruction.
+  void ReadPoints3D(
+      Reconstruction& reconstruction,
+      const std::pair<Eigen::Vector3d, Eigen::Vector3d>& bbox) const;
+
+ private:
+  struct Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
 // Exports in NVM format http://ccwu.me/vsfm/doc.html#nvm. Only supports
 // SIMPLE_RADIAL camera model when exporting distortion parameters. When
 // skip_distortion == true it supports all camera models with the caveat that
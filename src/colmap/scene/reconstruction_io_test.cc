@@ -0,0 +1,390 @@
+// Copyright (c) 2023, ETH Zurich and UNC Chapel Hill.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of ETH Zurich and UNC Chapel Hill nor the names of
+//       its contributors may be used to endorse or promote products derived
+//       from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "colmap/scene/reconstruction_io.h"
+
+#include "colmap/scene/synthetic.h"
+#include "colmap/util/endian.h"
+#include "colmap/util/testing.h"
+
+#include <fstream>
+#include <limits>
+#include <sstream>
+
+#include <gtest/gtest.h>
+
+namespace colmap {
+namespace {
+
+void ExpectEqualReconstructions(const Reconstruction& reconstruction1,
+                                const Reconstruction& reconstruction2) {
+  EXPECT_EQ(reconstruction1.NumCameras(), reconstruction2.NumCameras());
+  EXPECT_EQ(reconstruction1.NumImages(), reconstruction2.NumImages());
+  EXPECT_EQ(reconstruction1.NumRegImages(), reconstruction2.NumRegImages());
+  EXPECT_EQ(reconstruction1.NumPoints3D(), reconstruction2.NumPoints3D());
+
+  for (const auto& image : reconstruction1.Images()) {
+    const Image& other_image = reconstruction2.Image(image.first);
+    EXPECT_EQ(image.second.Name(), other_image.Name());
+    EXPECT_EQ(image.second.CameraId(), other_image.CameraId());
+    EXPECT_EQ(image.second.IsRegistered(), other_image.IsRegistered());
+    EXPECT_EQ(image.second.NumPoints3D(), other_image.NumPoints3D());
+    EXPECT_TRUE(image.second.CamFromWorld().rotation.isApprox(
+        other_image.CamFromWorld().rotation));
+    EXPECT_EQ(image.second.CamFromWorld().translation,
+              other_image.CamFromWorld().translation);
+    ASSERT_EQ(image.second.NumPoints2D(), other_image.NumPoints2D());
+    for (point2D_t point2D_idx = 0; point2D_idx < image.second.NumPoints2D();
+         ++point2D_idx) {
+      const Point2D& point2D = image.second.Point2D(point2D_idx);
+      const Point2D& other_point2D = other_image.Point2D(point2D_idx);
+      EXPECT_EQ(point2D.xy, other_point2D.xy);
+      EXPECT_EQ(point2D.point3D_id, other_point2D.point3D_id);
+    }
+  }
+
+  for (const auto& point3D : reconstruction1.Points3D()) {
+    const Point3D& other_point3D = reconstruction2.Point3D(point3D.first);
+    EXPECT_EQ(point3D.second.xyz, other_point3D.xyz);
+    EXPECT_EQ(point3D.second.color, other_point3D.color);
+    EXPECT_EQ(point3D.second.error, other_point3D.error);
+    ASSERT_EQ(point3D.second.track.Length(), other_point3D.track.Length());
+    for (size_t i = 0; i < point3D.second.track.Length(); ++i) {
+      EXPECT_EQ(point3D.second.track.Element(i).image_id,
+                other_point3D.track.Element(i).image_id);
+      EXPECT_EQ(point3D.second.track.Element(i).point2D_idx,
+                other_point3D.track.Element(i).point2D_idx);
+    }
+  }
+}
+
+class ParameterizedReconstructionBinaryTests
+    : public ::testing::TestWithParam<std::pair<int, int>> {};
+
+TEST_P(ParameterizedReconstructionBinaryTests, WriteRead) {
+  const auto [num_images, num_points3D] = GetParam();
+  SyntheticDatasetOptions synthetic_dataset_options;
+  synthetic_dataset_options.num_images = num_images;
+  synthetic_dataset_options.num_points3D = num_points3D;
+  Reconstruction reconstruction;
+  SynthesizeDataset(synthetic_dataset_options, &reconstruction);
+
+  const std::string test_dir = CreateTestDir();
+  reconstruction.WriteBinary(test_dir);
+
+  Reconstruction read_reconstruction;
+  read_reconstruction.ReadBinary(test_dir);
+  ExpectEqualReconstructions(reconstruction, read_reconstruction);
+}
+
+INSTANTIATE_TEST_SUITE_P(ReconstructionBinary,
+                         ParameterizedReconstructionBinaryTests,
+                         ::testing::Values(std::make_pair(10, 100),
+                                           std::make_pair(3000, 5),
+                                           std::make_pair(5, 5000)));
+
+class ParameterizedReconstructionTextTests
+    : public ::testing::TestWithParam<std::pair<int, int>> {};
+
+TEST_P(ParameterizedReconstructionTextTests, WriteRead) {
+  const auto [num_images, num_points3D] = GetParam();
+  SyntheticDatasetOptions synthetic_dataset_options;
+  synthetic_dataset_options.num_images = num_images;
+  synthetic_dataset_options.num_points3D = num_points3D;
+  Reconstruction reconstruction;
+  SynthesizeDataset(synthetic_dataset_options, &reconstruction);
+
+  const std::string test_dir = CreateTestDir();
+  reconstruction.WriteText(test_dir);
+
+  Reconstruction read_reconstruction;
+  read_reconstruction.ReadText(test_dir);
+  ExpectEqualReconstructions(reconstruction, read_reconstruction);
+}
+
+INSTANTIATE_TEST_SUITE_P(ReconstructionText,
+                         ParameterizedReconstructionTextTests,
+                         ::testing::Values(std::make_pair(10, 100),
+                                           std::make_pair(3000, 5),
+                                           std::make_pair(5, 5000)));
+
+std::vector<std::string> ReadLines(const std::string& path) {
+  std::ifstream file(path);
+  std::vector<std::string> lines;
+  std::string line;
+  while (std::getline(file, line)) {
+    lines.push_back(line);
+  }
+  return lines;
+}
+
+TEST(ReconstructionText, Format) {
+  Reconstruction reconstruction;
+  Camera camera =
+      Camera::CreateFromModelId(1, CameraModelId::kSimplePinhole, 1, 1, 1);
+  reconstruction.AddCamera(camera);
+  Image image;
+  image.SetImageId(2);
+  image.SetCameraId(camera.camera_id);
+  image.SetName("image.png");
+  image.CamFromWorld().translation = Eigen::Vector3d(-0.0, 0.1, 1e300);
+  image.SetPoints2D(std::vector<Eigen::Vector2d>{
+      Eigen::Vector2d(1.0 / 3.0, 1e-20), Eigen::Vector2d(1234.5, -7)});
+  reconstruction.AddImage(image);
+  reconstruction.RegisterImage(image.ImageId());
+  Image empty_image;
+  empty_image.SetImageId(3);
+  empty_image.SetCameraId(camera.camera_id);
+  empty_image.SetName("empty_image.png");
+  reconstruction.AddImage(empty_image);
+  reconstruction.RegisterImage(empty_image.ImageId());
+  Track track;
+  track.AddElement(image.ImageId(), 1);
+  const point3D_t point3D_id =
+      reconstruction.AddPoint3D(Eigen::Vector3d(std::sqrt(2.0), -1e-5, 5),
+                                track,
+                                Eigen::Vector3ub(1, 2, 255));
+  reconstruction.Point3D(point3D_id).error = 0.1;
+  const point3D_t empty_point3D_id =
+      reconstruction.AddPoint3D(Eigen::Vector3d::Zero(), Track());
+
+  const std::string test_dir = CreateTestDir();
+  reconstruction.WriteText(test_dir);
+
+  // The reference formatting is that of a std::ostream with precision 17.
+  std::ostringstream expected;
+  expected.precision(17);
+  expected << image.ImageId() << " 1 0 0 0 " << -0.0 << " " << 0.1 << " "
+           << 1e300 << " " << camera.camera_id << " image.png\n"
+           << 1.0 / 3.0 << " " << 1e-20 << " -1 " << 1234.5 << " " << -7.0
+           << " " << point3D_id << "\n";
+  std::ostringstream expected_empty;
+  expected_empty << empty_image.ImageId() << " 1 0 0 0 0 0 0 "
+                 << camera.camera_id << " empty_image.png\n\n";
+  std::string images_text;
+  for (const std::string& line : ReadLines(test_dir + "/images.txt")) {
+    if (!line.empty() && line[0] == '#') {
+      continue;
+    }
+    images_text += line + "\n";
+  }
+  EXPECT_TRUE(images_text == expected.str() + expected_empty.str() ||
+              images_text == expected_empty.str() + expected.str())
+      << images_text;
+
+  expected.str("");
+  expected << point3D_id << " " << std::sqrt(2.0) << " " << -1e-5
+           << " 5 1 2 255 " << 0.1 << " " << image.ImageId() << " 1";
+  expected_empty.str("");
+  expected_empty << empty_point3D_id << " 0 0 0 0 0 0 -1 ";
+  const std::vector<std::string> points3D_lines =
+      ReadLines(test_dir + "/points3D.txt");
+  ASSERT_EQ(points3D_lines.size(), 5);
+  EXPECT_EQ(std::min(points3D_lines[3], points3D_lines[4]),
+            std::min(expected.str(), expected_empty.str()));
+  EXPECT_EQ(std::max(points3D_lines[3], points3D_lines[4]),
+            std::max(expected.str(), expected_empty.str()));
+}
+
+TEST(ReconstructionBinary, Empty) {
+  const std::string test_dir = CreateTestDir();
+  Reconstruction reconstruction;
+  reconstruction.WriteBinary(test_dir);
+
+  Reconstruction read_reconstruction;
+  read_reconstruction.ReadBinary(test_dir);
+  ExpectEqualReconstructions(reconstruction, read_reconstruction);
+}
+
+TEST(ReconstructionBinary, Truncated) {
+  SyntheticDatasetOptions synthetic_dataset_options;
+  Reconstruction reconstruction;
+  SynthesizeDataset(synthetic_dataset_options, &reconstruction);
+
+  const std::string test_dir = CreateTestDir();
+  const std::string images_path = test_dir + "/images.bin";
+  const std::string points3D_path = test_dir + "/points3D.bin";
+  WriteImagesBinary(reconstruction, images_path);
+  WritePoints3DBinary(reconstruction, points3D_path);
+
+  for (const std::string& path : {images_path, points3D_path}) {
+    std::string data;
+    {
+      std::ifstream file(path, std::ios::binary);
+      data.assign(std::istreambuf_iterator<char>(file),
+                  std::istreambuf_iterator<char>());
+    }
+    {
+      std::ofstream file(path, std::ios::trunc | std::ios::binary);
+      file.write(data.data(), data.size() - 1);
+    }
+  }
+
+  Reconstruction read_reconstruction;
+  EXPECT_ANY_THROW(ReadImagesBinary(read_reconstruction, images_path));
+  EXPECT_ANY_THROW(ReadPoints3DBinary(read_reconstruction, points3D_path));
+}
+
+TEST(ReconstructionBinary, InvalidNumRecords) {
+  const std::string test_dir = CreateTestDir();
+  const std::string images_path = test_dir + "/images.bin";
+  const std::string points3D_path = test_dir + "/points3D.bin";
+
+  // The number of records exceeds the number of records that fit into the
+  // file, which must fail before allocating memory for the records.
+  for (const std::string& path : {images_path, points3D_path}) {
+    std::ofstream file(path, std::ios::trunc | std::ios::binary);
+    WriteBinaryLittleEndian<uint64_t>(&file,
+                                      std::numeric_limits<uint64_t>::max());
+  }
+
+  Reconstruction read_reconstruction;
+  EXPECT_ANY_THROW(ReadImagesBinary(read_reconstruction, images_path));
+  EXPECT_ANY_THROW(ReadPoints3DBinary(read_reconstruction, points3D_path));
+}
+
+TEST(ReconstructionBinary, NonExistent) {
+  Reconstruction reconstruction;
+  EXPECT_ANY_THROW(ReadImagesBinary(reconstruction, "/non/existent.bin"));
+  EXPECT_ANY_THROW(ReadPoints3DBinary(reconstruction, "/non/existent.bin"));
+}
+
+TEST(ChunkedReconstruction, WriteRead) {
+  SyntheticDatasetOptions synthetic_dataset_options;
+  synthetic_dataset_options.num_points3D = 1000;
+  Reconstruction reconstruction;
+  SynthesizeDataset(synthetic_dataset_options, &reconstruction);
+
+  const std::string test_dir = CreateTestDir();
+  reconstruction.WriteChunked(test_dir);
+
+  Reconstruction read_reconstruction;
+  read_reconstruction.Read(test_dir);
+  ExpectEqualReconstructions(reconstruction, read_reconstruction);
+}
+
+TEST(ChunkedReconstruction, Empty) {
+  const std::string test_dir = CreateTestDir();
+  Reconstruction reconstruction;
+  reconstruction.WriteChunked(test_dir);
+
+  Reconstruction read_reconstruction;
+  read_reconstruction.ReadChunked(test_dir);
+  ExpectEqualReconstructions(reconstruction, read_reconstruction);
+}
+
+TEST(ChunkedReconstruction, PartialRead) {
+  SyntheticDatasetOptions synthetic_dataset_options;
+  synthetic_dataset_options.num_points3D = 1000;
+  Reconstruction reconstruction;
+  SynthesizeDataset(synthetic_dataset_options, &reconstruction);
+
+  const std::string path = CreateTestDir() + "/reconstruction.chunked";
+  WriteChunkedReconstruction(
+      reconstruction, path, /*max_num_points_per_bucket=*/50);
+
+  ChunkedReconstructionReader reader(path);
+  EXPECT_EQ(reader.NumRegImages(), reconstruction.NumRegImages());
+  EXPECT_EQ(reader.NumPoints3D(), reconstruction.NumPoints3D());
+
+  Reconstruction poses_reconstruction;
+  reader.ReadPoses(poses_reconstruction);
+  EXPECT_EQ(poses_reconstruction.NumCameras(), reconstruction.NumCameras());
+  EXPECT_EQ(poses_reconstruction.NumRegImages(),
+            reconstruction.NumRegImages());
+  EXPECT_EQ(poses_reconstruction.NumPoints3D(), 0);
+  for (const auto& image : poses_reconstruction.Images()) {
+    EXPECT_EQ(image.second.NumPoints2D(), 0);
+    EXPECT_EQ(image.second.Name(), reconstruction.Image(image.first).Name());
+    EXPECT_TRUE(image.second.CamFromWorld().rotation.isApprox(
+        reconstruction.Image(image.first).CamFromWorld().rotation));
+  }
+
+  const std::vector<image_t> image_ids = {reader.RegImageIds()[0],
+                                          reader.RegImageIds()[2]};
+  reader.ReadObservations(poses_reconstruction, image_ids);
+  for (const auto& image : poses_reconstruction.Images()) {
+    if (image.first == image_ids[0] || image.first == image_ids[1]) {
+      EXPECT_EQ(image.second.NumPoints2D(),
+                reconstruction.Image(image.first).NumPoints2D());
+      EXPECT_EQ(image.second.NumPoints3D(),
+                reconstruction.Image(image.first).NumPoints3D());
+    } else {
+      EXPECT_EQ(image.second.NumPoints2D(), 0);
+    }
+  }
+  EXPECT_ANY_THROW(reader.ReadObservations(poses_reconstruction,
+                                           {kInvalidImageId}));
+
+  const std::pair<Eigen::Vector3d, Eigen::Vector3d> bbox(
+      Eigen::Vector3d(0, 0, 0), Eigen::Vector3d(1, 1, 1));
+  Reconstruction points_reconstruction;
+  reader.ReadPoints3D(points_reconstruction, bbox);
+  size_t num_points3D_in_bbox = 0;
+  for (const auto& point3D : reconstruction.Points3D()) {
+    if ((point3D.second.xyz.array() >= bbox.first.array()).all() &&
+        (point3D.second.xyz.array() <= bbox.second.array()).all()) {
+      ++num_points3D_in_bbox;
+      ASSERT_TRUE(points_reconstruction.ExistsPoint3D(point3D.first));
+      EXPECT_EQ(points_reconstruction.Point3D(point3D.first).xyz,
+                point3D.second.xyz);
+    }
+  }
+  EXPECT_GT(num_points3D_in_bbox, 0);
+  EXPECT_LT(num_points3D_in_bbox, reconstruction.NumPoints3D());
+  EXPECT_EQ(points_reconstruction.NumPoints3D(), num_points3D_in_bbox);
+}
+
+TEST(ChunkedReconstruction, Invalid) {
+  SyntheticDatasetOptions synthetic_dataset_options;
+  Reconstruction reconstruction;
+  SynthesizeDataset(synthetic_dataset_options, &reconstruction);
+
+  const std::string test_dir = CreateTestDir();
+  const std::string path = test_dir + "/reconstruction.chunked";
+  WriteChunkedReconstruction(reconstruction, path);
+
+  std::string data;
+  {
+    std::ifstream file(path, std::ios::binary);
+    data.assign(std::istreambuf_iterator<char>(file),
+                std::istreambuf_iterator<char>());
+  }
+  {
+    std::ofstream file(path, std::ios::trunc | std::ios::binary);
+    file.write(data.data(), data.size() - 1);
+  }
+  EXPECT_ANY_THROW(ChunkedReconstructionReader{path});
+
+  WriteImagesBinary(reconstruction, path);
+  EXPECT_ANY_THROW(ChunkedReconstructionReader{path});
+}
+
+}  // namespace
+}  // namespace colmap
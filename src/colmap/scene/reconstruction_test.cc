@@ -112,6 +112,24 @@ TEST(Reconstruction, AddPoint3D) {
   EXPECT_EQ(reconstruction.Point3DIds().count(point3D_id), 1);
 }
 
+TEST(Reconstruction, MaxPoint3DId) {
+  Reconstruction reconstruction;
+  EXPECT_EQ(reconstruction.MaxPoint3DId(), 0);
+  const point3D_t point3D_id1 =
+      reconstruction.AddPoint3D(Eigen::Vector3d::Random(), Track());
+  const point3D_t point3D_id2 =
+      reconstruction.AddPoint3D(Eigen::Vector3d::Random(), Track());
+  EXPECT_EQ(reconstruction.MaxPoint3DId(), point3D_id2);
+  reconstruction.DeletePoint3D(point3D_id2);
+  EXPECT_EQ(reconstruction.MaxPoint3DId(), point3D_id2);
+  EXPECT_GT(reconstruction.AddPoint3D(Eigen::Vector3d::Random(), Track()),
+            point3D_id2);
+  EXPECT_ANY_THROW(reconstruction.SetMaxPoint3DId(point3D_id1));
+  reconstruction.SetMaxPoint3DId(10);
+  EXPECT_EQ(reconstruction.MaxPoint3DId(), 10);
+  EXPECT_EQ(reconstruction.AddPoint3D(Eigen::Vector3d::Random(), Track()), 11);
+}
+
 TEST(Reconstruction, AddObservation) {
   Reconstruction reconstruction;
   GenerateReconstruction(3, &reconstruction);
@@ -349,6 +367,88 @@ TEST(Reconstruction, Crop) {
   EXPECT_FALSE(recon2.IsImageRegistered(3));
 }
 
+TEST(Reconstruction, FindPoints3D) {
+  Reconstruction reconstruction;
+  GenerateReconstruction(1, &reconstruction);
+  const point3D_t point3D_id1 =
+      reconstruction.AddPoint3D(Eigen::Vector3d(0, 0, 0), Track());
+  const point3D_t point3D_id2 =
+      reconstruction.AddPoint3D(Eigen::Vector3d(1, 0, 0), Track());
+  const point3D_t point3D_id3 =
+      reconstruction.AddPoint3D(Eigen::Vector3d(3, 3, 3), Track());
+  for (const bool use_index : {false, true}) {
+    if (use_index) {
+      reconstruction.EnablePoints3DSpatialIndex(0.5);
+      EXPECT_TRUE(reconstruction.HasPoints3DSpatialIndex());
+    } else {
+      EXPECT_FALSE(reconstruction.HasPoints3DSpatialIndex());
+    }
+    EXPECT_EQ(reconstruction.FindPoints3DInRadius(Eigen::Vector3d::Zero(), 1),
+              std::vector<point3D_t>({point3D_id1, point3D_id2}));
+    EXPECT_EQ(reconstruction.FindPoints3DInBox(Eigen::Vector3d(0.5, -1, -1),
+                                               Eigen::Vector3d(4, 4, 4)),
+              std::vector<point3D_t>({point3D_id2, point3D_id3}));
+    EXPECT_EQ(reconstruction.FindNearestPoints3D(Eigen::Vector3d(2, 2, 2), 2),
+              std::vector<point3D_t>({point3D_id3, point3D_id2}));
+  }
+  reconstruction.DisablePoints3DSpatialIndex();
+  EXPECT_FALSE(reconstruction.HasPoints3DSpatialIndex());
+}
+
+TEST(Reconstruction, Points3DSpatialIndex) {
+  Reconstruction reconstruction;
+  GenerateReconstruction(1, &reconstruction);
+  reconstruction.EnablePoints3DSpatialIndex(1);
+  const point3D_t point3D_id1 =
+      reconstruction.AddPoint3D(Eigen::Vector3d(0, 0, 0), Track());
+  const point3D_t point3D_id2 =
+      reconstruction.AddPoint3D(Eigen::Vector3d(5, 5, 5), Track());
+  EXPECT_EQ(reconstruction.FindPoints3DInRadius(Eigen::Vector3d::Zero(), 1),
+            std::vector<point3D_t>({point3D_id1}));
+
+  // Positions set explicitly are re-indexed immediately.
+  reconstruction.SetPoint3DXYZ(point3D_id2, Eigen::Vector3d(0, 0, 0.5));
+  EXPECT_EQ(reconstruction.Point3D(point3D_id2).xyz,
+            Eigen::Vector3d(0, 0, 0.5));
+  EXPECT_EQ(reconstruction.FindPoints3DInRadius(Eigen::Vector3d::Zero(), 1),
+            std::vector<point3D_t>({point3D_id1, point3D_id2}));
+
+  reconstruction.DeletePoint3D(point3D_id1);
+  EXPECT_EQ(reconstruction.FindPoints3DInRadius(Eigen::Vector3d::Zero(), 1),
+            std::vector<point3D_t>({point3D_id2}));
+
+  reconstruction.Transform(
+      Sim3d(2, Eigen::Quaterniond::Identity(), Eigen::Vector3d(0, 0, 1)));
+  EXPECT_TRUE(
+      reconstruction.FindPoints3DInRadius(Eigen::Vector3d::Zero(), 1).empty());
+  EXPECT_EQ(
+      reconstruction.FindPoints3DInRadius(Eigen::Vector3d(0, 0, 2), 0.1),
+      std::vector<point3D_t>({point3D_id2}));
+
+  // Positions modified in place are re-indexed after updating the index.
+  reconstruction.Point3D(point3D_id2).xyz = Eigen::Vector3d(0, 0, 3);
+  EXPECT_TRUE(
+      reconstruction.FindPoints3DInRadius(Eigen::Vector3d(0, 0, 3), 0.1)
+          .empty());
+  reconstruction.UpdatePoint3DSpatialIndex(point3D_id2);
+  EXPECT_EQ(
+      reconstruction.FindPoints3DInRadius(Eigen::Vector3d(0, 0, 3), 0.1),
+      std::vector<point3D_t>({point3D_id2}));
+  reconstruction.Point3D(point3D_id2).xyz = Eigen::Vector3d(0, 0, 4);
+  reconstruction.UpdatePoints3DSpatialIndex();
+  EXPECT_EQ(
+      reconstruction.FindPoints3DInRadius(Eigen::Vector3d(0, 0, 4), 0.1),
+      std::vector<point3D_t>({point3D_id2}));
+
+  // Copies keep their own index.
+  Reconstruction copy = reconstruction;
+  copy.DeleteAllPoints2DAndPoints3D();
+  EXPECT_TRUE(copy.HasPoints3DSpatialIndex());
+  EXPECT_TRUE(copy.FindNearestPoints3D(Eigen::Vector3d::Zero(), 1).empty());
+  EXPECT_EQ(reconstruction.FindNearestPoints3D(Eigen::Vector3d::Zero(), 1),
+            std::vector<point3D_t>({point3D_id2}));
+}
+
 TEST(Reconstruction, Transform) {
   Reconstruction reconstruction;
   GenerateReconstruction(3, &reconstruction);
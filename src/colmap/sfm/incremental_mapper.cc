@@ -34,29 +34,61 @@
 #include "colmap/geometry/triangulation.h"
 #include "colmap/scene/projection.h"
 #include "colmap/sensor/bitmap.h"
+#include "colmap/util/endian.h"
 #include "colmap/util/misc.h"
 
+#include <algorithm>
 #include <array>
 #include <fstream>
+#include <limits>
 
 namespace colmap {
 namespace {
 
-void SortAndAppendNextImages(std::vector<std::pair<image_t, float>> image_ranks,
-                             std::vector<image_t>* sorted_images_ids) {
-  std::sort(image_ranks.begin(),
-            image_ranks.end(),
-            [](const std::pair<image_t, float>& image1,
-               const std::pair<image_t, float>& image2) {
-              return image1.second > image2.second;
-            });
+template <typename T>
+void WriteIds(std::ostream* stream, const std::unordered_set<T>& ids) {
+  // Sort the identifiers, so that equal states are written identically.
+  std::vector<T> sorted_ids(ids.begin(), ids.end());
+  std::sort(sorted_ids.begin(), sorted_ids.end());
+  WriteBinaryLittleEndian<uint64_t>(stream, sorted_ids.size());
+  for (const T id : sorted_ids) {
+    WriteBinaryLittleEndian<T>(stream, id);
+  }
+}
 
-  sorted_images_ids->reserve(sorted_images_ids->size() + image_ranks.size());
-  for (const auto& image : image_ranks) {
-    sorted_images_ids->push_back(image.first);
+template <typename T>
+void ReadIds(std::istream* stream, std::unordered_set<T>* ids) {
+  const uint64_t num_ids = ReadBinaryLittleEndian<uint64_t>(stream);
+  ids->clear();
+  ids->reserve(num_ids);
+  for (uint64_t i = 0; i < num_ids; ++i) {
+    ids->insert(ReadBinaryLittleEndian<T>(stream));
   }
+}
 
-  image_ranks.clear();
+template <typename T>
+void WriteIdCounts(std::ostream* stream,
+                   const std::unordered_map<T, size_t>& counts) {
+  std::vector<std::pair<T, size_t>> sorted_counts(counts.begin(),
+                                                  counts.end());
+  std::sort(sorted_counts.begin(), sorted_counts.end());
+  WriteBinaryLittleEndian<uint64_t>(stream, sorted_counts.size());
+  for (const auto& [id, count] : sorted_counts) {
+    WriteBinaryLittleEndian<T>(stream, id);
+    WriteBinaryLittleEndian<uint64_t>(stream, count);
+  }
+}
+
+template <typename T>
+void ReadIdCounts(std::istream* stream,
+                  std::unordered_map<T, size_t>* counts) {
+  const uint64_t num_counts = ReadBinaryLittleEndian<uint64_t>(stream);
+  counts->clear();
+  counts->reserve(num_counts);
+  for (uint64_t i = 0; i < num_counts; ++i) {
+    const T id = ReadBinaryLittleEndian<T>(stream);
+    (*counts)[id] = ReadBinaryLittleEndian<uint64_t>(stream);
+  }
 }
 
 float RankNextImageMaxVisiblePointsNum(
@@ -75,6 +107,13 @@ float RankNextImageMinUncertainty(const image_t image_id,
   return static_cast<float>(obs_manager.Point3DVisibilityScore(image_id));
 }
 
+float RankNextImageMinPoseUncertainty(
+    const image_t image_id, const class ObservationManager& obs_manager) {
+  return static_cast<float>(
+      std::max(obs_manager.PoseInformationLogDet(image_id),
+               static_cast<double>(std::numeric_limits<float>::lowest())));
+}
+
 }  // namespace
 
 bool IncrementalMapper::Options::Check() const {
@@ -90,6 +129,8 @@ bool IncrementalMapper::Options::Check() const {
   CHECK_OPTION_LE(abs_pose_min_inlier_ratio, 1.0);
   CHECK_OPTION_GE(local_ba_num_images, 2);
   CHECK_OPTION_GE(local_ba_min_tri_angle, 0.0);
+  CHECK_OPTION_GE(global_ba_partition_min_num_images, 0);
+  CHECK_OPTION(global_ba_partition.Check());
   CHECK_OPTION_GE(min_focal_length_ratio, 0.0);
   CHECK_OPTION_GE(max_focal_length_ratio, min_focal_length_ratio);
   CHECK_OPTION_GE(max_extra_param, 0.0);
@@ -118,6 +159,7 @@ void IncrementalMapper::BeginReconstruction(
       *reconstruction_, database_cache_->CorrespondenceGraph());
   triangulator_ = std::make_shared<IncrementalTriangulator>(
       database_cache_->CorrespondenceGraph(), *reconstruction_, obs_manager_);
+  local_bundle_adjuster_.reset();
 
   num_shared_reg_images_ = 0;
   num_reg_images_per_camera_.clear();
@@ -131,6 +173,7 @@ void IncrementalMapper::BeginReconstruction(
 
   filtered_images_.clear();
   num_reg_trials_.clear();
+  next_image_ranking_ = NextImageRanking();
 }
 
 void IncrementalMapper::EndReconstruction(const bool discard) {
@@ -146,6 +189,7 @@ void IncrementalMapper::EndReconstruction(const bool discard) {
   reconstruction_ = nullptr;
   obs_manager_.reset();
   triangulator_.reset();
+  local_bundle_adjuster_.reset();
 }
 
 bool IncrementalMapper::FindInitialImagePair(const Options& options,
@@ -207,6 +251,17 @@ bool IncrementalMapper::FindInitialImagePair(const Options& options,
 }
 
 std::vector<image_t> IncrementalMapper::FindNextImages(const Options& options) {
+  const std::set<NextImageCandidate>& candidates = RankNextImages(options);
+  std::vector<image_t> ranked_images_ids;
+  ranked_images_ids.reserve(candidates.size());
+  for (const auto& candidate : candidates) {
+    ranked_images_ids.push_back(candidate.image_id);
+  }
+  return ranked_images_ids;
+}
+
+const std::set<IncrementalMapper::NextImageCandidate>&
+IncrementalMapper::RankNextImages(const Options& options) {
   THROW_CHECK_NOTNULL(reconstruction_);
   THROW_CHECK(options.Check());
 
@@ -222,45 +277,77 @@ std::vector<image_t> IncrementalMapper::FindNextImages(const Options& options) {
     case Options::ImageSelectionMethod::MIN_UNCERTAINTY:
       rank_image_func = RankNextImageMinUncertainty;
       break;
+    case Options::ImageSelectionMethod::MIN_POSE_UNCERTAINTY:
+      rank_image_func = RankNextImageMinPoseUncertainty;
+      break;
   }
 
-  std::vector<std::pair<image_t, float>> image_ranks;
-  std::vector<std::pair<image_t, float>> other_image_ranks;
+  // Only pay for the pose information if it is used for the ranking.
+  obs_manager_->SetAccumulatePoseInformation(
+      options.image_selection_method ==
+      Options::ImageSelectionMethod::MIN_POSE_UNCERTAINTY);
+
+  // Re-rank all images if the ranking is not initialized yet or the options
+  // changed, and otherwise only the images that changed since the last call.
+  NextImageRanking& ranking = next_image_ranking_;
+  if (!ranking.is_valid ||
+      ranking.image_selection_method != options.image_selection_method ||
+      ranking.abs_pose_min_num_inliers != options.abs_pose_min_num_inliers ||
+      ranking.max_reg_trials != options.max_reg_trials) {
+    ranking = NextImageRanking();
+    ranking.is_valid = true;
+    ranking.image_selection_method = options.image_selection_method;
+    ranking.abs_pose_min_num_inliers = options.abs_pose_min_num_inliers;
+    ranking.max_reg_trials = options.max_reg_trials;
+    for (const auto& image : reconstruction_->Images()) {
+      ranking.changed_image_ids.insert(image.first);
+    }
+  }
+
+  ranking.changed_image_ids.insert(obs_manager_->ChangedImageIds().begin(),
+                                   obs_manager_->ChangedImageIds().end());
+  obs_manager_->ClearChangedImageIds();
+
+  for (const image_t image_id : ranking.changed_image_ids) {
+    const auto candidate_it = ranking.candidate_by_image_id.find(image_id);
+    if (candidate_it != ranking.candidate_by_image_id.end()) {
+      ranking.candidates.erase(candidate_it->second);
+      ranking.candidate_by_image_id.erase(candidate_it);
+    }
 
-  // Append images that have not failed to register before.
-  for (const auto& image : reconstruction_->Images()) {
     // Skip images that are already registered.
-    if (image.second.IsRegistered()) {
+    if (reconstruction_->IsImageRegistered(image_id)) {
       continue;
     }
 
     // Only consider images with a sufficient number of visible points.
-    if (obs_manager_->NumVisiblePoints3D(image.first) <
+    if (obs_manager_->NumVisiblePoints3D(image_id) <
         static_cast<size_t>(options.abs_pose_min_num_inliers)) {
       continue;
     }
 
     // Only try registration for a certain maximum number of times.
-    const size_t num_reg_trials = num_reg_trials_[image.first];
+    const auto num_reg_trials_it = num_reg_trials_.find(image_id);
+    const size_t num_reg_trials = num_reg_trials_it == num_reg_trials_.end()
+                                      ? 0
+                                      : num_reg_trials_it->second;
     if (num_reg_trials >= static_cast<size_t>(options.max_reg_trials)) {
       continue;
     }
 
     // If image has been filtered or failed to register, place it in the
     // second bucket and prefer images that have not been tried before.
-    const float rank = rank_image_func(image.first, *obs_manager_);
-    if (filtered_images_.count(image.first) == 0 && num_reg_trials == 0) {
-      image_ranks.emplace_back(image.first, rank);
-    } else {
-      other_image_ranks.emplace_back(image.first, rank);
-    }
+    NextImageCandidate candidate;
+    candidate.is_retrial =
+        filtered_images_.count(image_id) > 0 || num_reg_trials > 0;
+    candidate.rank = rank_image_func(image_id, *obs_manager_);
+    candidate.image_id = image_id;
+    ranking.candidates.insert(candidate);
+    ranking.candidate_by_image_id.emplace(image_id, candidate);
   }
+  ranking.changed_image_ids.clear();
 
-  std::vector<image_t> ranked_images_ids;
-  SortAndAppendNextImages(image_ranks, &ranked_images_ids);
-  SortAndAppendNextImages(other_image_ranks, &ranked_images_ids);
-
-  return ranked_images_ids;
+  return ranking.candidates;
 }
 
 void IncrementalMapper::RegisterInitialImagePair(
@@ -357,6 +444,7 @@ bool IncrementalMapper::RegisterNextImage(const Options& options,
       << "Image cannot be registered multiple times";
 
   num_reg_trials_[image_id] += 1;
+  next_image_ranking_.changed_image_ids.insert(image_id);
 
   // Check if enough 2D-3D correspondences.
   if (obs_manager_->NumVisiblePoints3D(image_id) <
@@ -383,7 +471,7 @@ bool IncrementalMapper::RegisterNextImage(const Options& options,
     corr_point3D_ids.clear();
     const auto corr_range =
         correspondence_graph->FindCorrespondences(image_id, point2D_idx);
-    for (const auto* corr = corr_range.beg; corr < corr_range.end; ++corr) {
+    for (auto corr = corr_range.beg; corr < corr_range.end; ++corr) {
       const Image& corr_image = reconstruction_->Image(corr->image_id);
       if (!corr_image.IsRegistered()) {
         continue;
@@ -656,12 +744,18 @@ IncrementalMapper::AdjustLocalBundle(
       }
     }
 
-    // Adjust the local bundle.
-    BundleAdjuster bundle_adjuster(ba_options, ba_config);
-    bundle_adjuster.Solve(reconstruction_.get());
+    // Adjust the local bundle. The problem is kept between calls, such that
+    // only the residuals of changed images and points must be set up again.
+    if (local_bundle_adjuster_ == nullptr) {
+      local_bundle_adjuster_ =
+          std::make_unique<IncrementalBundleAdjuster>(ba_options);
+    } else {
+      local_bundle_adjuster_->SetOptions(ba_options);
+    }
+    local_bundle_adjuster_->Solve(ba_config, reconstruction_.get());
 
     report.num_adjusted_observations =
-        bundle_adjuster.Summary().num_residuals / 2;
+        local_bundle_adjuster_->Summary().num_residuals / 2;
 
     // Merge refined tracks with other existing points.
     report.num_merged_observations =
@@ -686,11 +780,13 @@ IncrementalMapper::AdjustLocalBundle(
   report.num_filtered_observations =
       obs_manager_->FilterPoints3DInImages(options.filter_max_reproj_error,
                                            options.filter_min_tri_angle,
-                                           filter_image_ids);
+                                           filter_image_ids,
+                                           options.num_threads);
   report.num_filtered_observations +=
       obs_manager_->FilterPoints3D(options.filter_max_reproj_error,
                                    options.filter_min_tri_angle,
-                                   point3D_ids);
+                                   point3D_ids,
+                                   options.num_threads);
 
   return report;
 }
@@ -718,7 +814,7 @@ bool IncrementalMapper::AdjustGlobalBundle(
   }
 
   // Avoid degeneracies in bundle adjustment.
-  obs_manager_->FilterObservationsWithNegativeDepth();
+  obs_manager_->FilterObservationsWithNegativeDepth(options.num_threads);
 
   // Configure bundle adjustment.
   BundleAdjustmentConfig ba_config;
@@ -743,6 +839,14 @@ bool IncrementalMapper::AdjustGlobalBundle(
   }
 
   // Run bundle adjustment.
+  if (options.global_ba_partition_min_num_images > 0 &&
+      reg_image_ids.size() >=
+          static_cast<size_t>(options.global_ba_partition_min_num_images)) {
+    PartitionedBundleAdjuster bundle_adjuster(
+        options.global_ba_partition, ba_options_tmp, ba_config);
+    return bundle_adjuster.Solve(reconstruction_.get());
+  }
+
   BundleAdjuster bundle_adjuster(ba_options_tmp, ba_config);
   return bundle_adjuster.Solve(reconstruction_.get());
 }
@@ -826,7 +930,8 @@ size_t IncrementalMapper::FilterImages(const Options& options) {
   const std::vector<image_t> image_ids =
       obs_manager_->FilterImages(options.min_focal_length_ratio,
                                  options.max_focal_length_ratio,
-                                 options.max_extra_param);
+                                 options.max_extra_param,
+                                 options.num_threads);
 
   for (const image_t image_id : image_ids) {
     DeRegisterImageEvent(image_id);
@@ -841,8 +946,10 @@ size_t IncrementalMapper::FilterImages(const Options& options) {
 size_t IncrementalMapper::FilterPoints(const Options& options) {
   THROW_CHECK_NOTNULL(obs_manager_);
   THROW_CHECK(options.Check());
-  const size_t num_filtered_observations = obs_manager_->FilterAllPoints3D(
-      options.filter_max_reproj_error, options.filter_min_tri_angle);
+  const size_t num_filtered_observations =
+      obs_manager_->FilterAllPoints3D(options.filter_max_reproj_error,
+                                      options.filter_min_tri_angle,
+                                      options.num_threads);
   VLOG(1) << "=> Filtered observations: " << num_filtered_observations;
   return num_filtered_observations;
 }
@@ -891,6 +998,48 @@ void IncrementalMapper::ClearModifiedPoints3D() {
   triangulator_->ClearModifiedPoints3D();
 }
 
+void IncrementalMapper::WriteState(const std::string& path) const {
+  THROW_CHECK_NOTNULL(reconstruction_);
+  std::ofstream file(path, std::ios::trunc | std::ios::binary);
+  THROW_CHECK_FILE_OPEN(file, path);
+
+  WriteBinaryLittleEndian<uint64_t>(&file, num_total_reg_images_);
+  WriteBinaryLittleEndian<uint64_t>(&file, num_shared_reg_images_);
+  WriteIdCounts(&file, init_num_reg_trials_);
+  WriteIds(&file, init_image_pairs_);
+  WriteIdCounts(&file, num_reg_images_per_camera_);
+  WriteIdCounts(&file, num_registrations_);
+  WriteIds(&file, filtered_images_);
+  WriteIdCounts(&file, num_reg_trials_);
+  WriteIds(&file, existing_image_ids_);
+  WriteBinaryLittleEndian<uint64_t>(&file, reconstruction_->MaxPoint3DId());
+}
+
+void IncrementalMapper::ReadState(const std::string& path) {
+  THROW_CHECK_NOTNULL(reconstruction_);
+  std::ifstream file(path, std::ios::binary);
+  THROW_CHECK_FILE_OPEN(file, path);
+
+  num_total_reg_images_ = ReadBinaryLittleEndian<uint64_t>(&file);
+  num_shared_reg_images_ = ReadBinaryLittleEndian<uint64_t>(&file);
+  ReadIdCounts(&file, &init_num_reg_trials_);
+  ReadIds(&file, &init_image_pairs_);
+  ReadIdCounts(&file, &num_reg_images_per_camera_);
+  ReadIdCounts(&file, &num_registrations_);
+  ReadIds(&file, &filtered_images_);
+  ReadIdCounts(&file, &num_reg_trials_);
+  ReadIds(&file, &existing_image_ids_);
+  const point3D_t max_point3D_id = ReadBinaryLittleEndian<uint64_t>(&file);
+  THROW_CHECK(file.good()) << "Truncated mapper state: " << path;
+
+  // Continue the identifiers of the 3D points without reusing those of
+  // deleted points, which are not restored when reading the reconstruction.
+  reconstruction_->SetMaxPoint3DId(
+      std::max(reconstruction_->MaxPoint3DId(), max_point3D_id));
+
+  next_image_ranking_ = NextImageRanking();
+}
+
 std::vector<image_t> IncrementalMapper::FindFirstInitialImage(
     const Options& options) const {
   // Struct to hold meta-data for ranking images.
@@ -975,7 +1124,7 @@ std::vector<image_t> IncrementalMapper::FindSecondInitialImage(
        ++point2D_idx) {
     const auto corr_range =
         correspondence_graph->FindCorrespondences(image_id1, point2D_idx);
-    for (const auto* corr = corr_range.beg; corr < corr_range.end; ++corr) {
+    for (auto corr = corr_range.beg; corr < corr_range.end; ++corr) {
       if (num_registrations_.count(corr->image_id) == 0 ||
           num_registrations_.at(corr->image_id) == 0) {
         num_correspondences[corr->image_id] += 1;
@@ -1211,6 +1360,8 @@ void IncrementalMapper::RegisterImageEvent(const image_t image_id) {
       num_reg_images_per_camera_[image.CameraId()];
   num_reg_images_for_camera += 1;
 
+  next_image_ranking_.changed_image_ids.insert(image_id);
+
   size_t& num_regs_for_image = num_registrations_[image_id];
   num_regs_for_image += 1;
   if (num_regs_for_image == 1) {
@@ -1227,6 +1378,8 @@ void IncrementalMapper::DeRegisterImageEvent(const image_t image_id) {
   THROW_CHECK_GT(num_reg_images_for_camera, 0);
   num_reg_images_for_camera -= 1;
 
+  next_image_ranking_.changed_image_ids.insert(image_id);
+
   size_t& num_regs_for_image = num_registrations_[image_id];
   num_regs_for_image -= 1;
   if (num_regs_for_image == 0) {
@@ -30,12 +30,15 @@
 #pragma once
 
 #include "colmap/estimators/bundle_adjustment.h"
+#include "colmap/estimators/partitioned_bundle_adjustment.h"
 #include "colmap/scene/database.h"
 #include "colmap/scene/database_cache.h"
 #include "colmap/scene/reconstruction.h"
 #include "colmap/sfm/incremental_triangulator.h"
 #include "colmap/sfm/observation_manager.h"
 
+#include <set>
+
 namespace colmap {
 
 // Class that provides all functionality for the incremental reconstruction
@@ -48,8 +51,8 @@ namespace colmap {
 //      mapper.FindInitialImagePair(options, tvg, image_id1, image_id2));
 //  mapper.RegisterInitialImagePair(options, tvg, image_id1, image_id2);
 //  while (...) {
-//    const auto next_image_ids = mapper.FindNextImages(options);
-//    for (const auto image_id : next_image_ids) {
+//    for (const auto& candidate : mapper.RankNextImages(options)) {
+//      const image_t image_id = candidate.image_id;
 //      THROW_CHECK(mapper.RegisterNextImage(options, image_id));
 //      if (...) {
 //        mapper.AdjustLocalBundle(...);
@@ -100,6 +103,14 @@ class IncrementalMapper {
     // Minimum triangulation for images to be chosen in local bundle adjustment.
     double local_ba_min_tri_angle = 6;
 
+    // Minimum number of registered images to partition global bundle
+    // adjustment into overlapping submaps, which are solved in parallel and
+    // reconciled through consensus. Partitioning is disabled if zero.
+    int global_ba_partition_min_num_images = 0;
+
+    // Options for the partitioned global bundle adjustment.
+    PartitionedBundleAdjuster::Options global_ba_partition;
+
     // Thresholds for bogus camera parameters. Images with bogus camera
     // parameters are filtered and ignored in triangulation.
     double min_focal_length_ratio = 0.1;  // Opening angle of ~130deg
@@ -122,10 +133,14 @@ class IncrementalMapper {
     int num_threads = -1;
 
     // Method to find and select next best image to register.
+    // `MIN_UNCERTAINTY` prefers images with a uniform distribution of visible
+    // points, while `MIN_POSE_UNCERTAINTY` prefers images with the smallest
+    // estimated pose covariance given their visible points.
     enum class ImageSelectionMethod {
       MAX_VISIBLE_POINTS_NUM,
       MAX_VISIBLE_POINTS_RATIO,
       MIN_UNCERTAINTY,
+      MIN_POSE_UNCERTAINTY,
     };
     ImageSelectionMethod image_selection_method =
         ImageSelectionMethod::MIN_UNCERTAINTY;
@@ -169,6 +184,32 @@ class IncrementalMapper {
   // ignores images that failed to registered for `max_reg_trials`.
   std::vector<image_t> FindNextImages(const Options& options);
 
+  // Candidate for the next image in the ranking of `RankNextImages`.
+  struct NextImageCandidate {
+    // Whether the image has been filtered or failed to register before.
+    bool is_retrial = false;
+    float rank = 0;
+    image_t image_id = kInvalidImageId;
+
+    // Order the candidates by preference, i.e., images that have not been
+    // tried before first and then by decreasing rank.
+    inline bool operator<(const NextImageCandidate& other) const {
+      if (is_retrial != other.is_retrial) {
+        return !is_retrial;
+      } else if (rank != other.rank) {
+        return rank > other.rank;
+      } else {
+        return image_id < other.image_id;
+      }
+    }
+  };
+
+  // Same as `FindNextImages` but without copying the ranked images. The
+  // returned ranking is not updated when registering images and remains valid
+  // until the next call to `FindNextImages`, `RankNextImages`,
+  // `BeginReconstruction`, or `ReadState`.
+  const std::set<NextImageCandidate>& RankNextImages(const Options& options);
+
   // Attempt to seed the reconstruction from an image pair.
   void RegisterInitialImagePair(const Options& options,
                                 const TwoViewGeometry& two_view_geometry,
@@ -264,6 +305,16 @@ class IncrementalMapper {
   // Clear the collection of changed 3D points.
   void ClearModifiedPoints3D();
 
+  // Write and read the state of the mapper that is not contained in the
+  // reconstructions, i.e. the registration statistics across reconstructions
+  // and the registration trials, filtered images, and largest 3D point
+  // identifier of the current reconstruction. This allows to checkpoint and
+  // resume the reconstruction.
+  // The state must be read after `BeginReconstruction` with the reconstruction
+  // that was current when the state was written.
+  void WriteState(const std::string& path) const;
+  void ReadState(const std::string& path);
+
   // Estimate two view geometry and checks if it is suitable for initialization.
   bool EstimateInitialTwoViewGeometry(const Options& options,
                                       TwoViewGeometry& two_view_geometry,
@@ -306,6 +357,9 @@ class IncrementalMapper {
   // Class that is responsible for incremental triangulation.
   std::shared_ptr<IncrementalTriangulator> triangulator_;
 
+  // Bundle adjustment problem that is reused across local bundle adjustments.
+  std::unique_ptr<IncrementalBundleAdjuster> local_bundle_adjuster_;
+
   // Number of images that are registered in at least on reconstruction.
   size_t num_total_reg_images_;
 
@@ -334,6 +388,24 @@ class IncrementalMapper {
   // an upper bound to the number of trials to register an image.
   std::unordered_map<image_t, size_t> num_reg_trials_;
 
+  // Ranking of the candidates for the next image. Instead of ranking all
+  // images in every call to `FindNextImages`, only the images whose
+  // statistics, number of registration trials, or registration changed since
+  // the previous call are re-ranked.
+  struct NextImageRanking {
+    // Whether the ranking was initialized with the following options.
+    bool is_valid = false;
+    Options::ImageSelectionMethod image_selection_method =
+        Options::ImageSelectionMethod::MIN_UNCERTAINTY;
+    int abs_pose_min_num_inliers = 0;
+    int max_reg_trials = 0;
+
+    std::set<NextImageCandidate> candidates;
+    std::unordered_map<image_t, NextImageCandidate> candidate_by_image_id;
+    std::unordered_set<image_t> changed_image_ids;
+  };
+  NextImageRanking next_image_ranking_;
+
   // Images that were registered before beginning the reconstruction.
   // This image list will be non-empty, if the reconstruction is continued from
   // an existing reconstruction.
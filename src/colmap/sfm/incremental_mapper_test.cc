@@ -0,0 +1,267 @@
+// Copyright (c) 2023, ETH Zurich and UNC Chapel Hill.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of ETH Zurich and UNC Chapel Hill nor the names of
+//       its contributors may be used to endorse or promote products derived
+//       from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "colmap/sfm/incremental_mapper.h"
+
+#include "colmap/scene/synthetic.h"
+#include "colmap/util/testing.h"
+
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <memory>
+
+#include <gtest/gtest.h>
+
+namespace colmap {
+namespace {
+
+// Ranks the next images with a new mapper that is initialized from the state
+// of the given mapper and thus ranks all images from scratch.
+std::vector<image_t> FindNextImagesFromScratch(
+    const IncrementalMapper::Options& options,
+    const std::shared_ptr<const DatabaseCache>& database_cache,
+    const IncrementalMapper& mapper) {
+  const std::string state_path = CreateTestDir() + "/mapper_state.bin";
+  mapper.WriteState(state_path);
+  IncrementalMapper new_mapper(database_cache);
+  new_mapper.BeginReconstruction(
+      std::make_shared<Reconstruction>(*mapper.Reconstruction()));
+  new_mapper.ReadState(state_path);
+  return new_mapper.FindNextImages(options);
+}
+
+std::string ReadFileContents(const std::string& path) {
+  std::ifstream file(path, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(file),
+                     std::istreambuf_iterator<char>());
+}
+
+TEST(IncrementalMapper, FindNextImagesMatchesRankingFromScratch) {
+  Database database(Database::kInMemoryDatabasePath);
+  Reconstruction gt_reconstruction;
+  SyntheticDatasetOptions synthetic_dataset_options;
+  synthetic_dataset_options.num_cameras = 24;
+  synthetic_dataset_options.num_images = 24;
+  synthetic_dataset_options.num_points3D = 200;
+  synthetic_dataset_options.point2D_stddev = 0;
+  SynthesizeDataset(synthetic_dataset_options, &gt_reconstruction, &database);
+
+  const std::shared_ptr<const DatabaseCache> database_cache =
+      DatabaseCache::Create(
+          database, /*min_num_matches=*/0, /*ignore_watermarks=*/false, {});
+
+  IncrementalMapper::Options options;
+  options.num_threads = 1;
+  // Fails the registration, since no image has enough visible points.
+  IncrementalMapper::Options failing_options = options;
+  failing_options.abs_pose_min_num_inliers = std::numeric_limits<int>::max();
+  IncrementalMapper::Options other_options = options;
+  other_options.image_selection_method =
+      IncrementalMapper::Options::ImageSelectionMethod::MAX_VISIBLE_POINTS_NUM;
+  const IncrementalTriangulator::Options tri_options;
+
+  IncrementalMapper mapper(database_cache);
+  mapper.BeginReconstruction(std::make_shared<Reconstruction>());
+  std::shared_ptr<Reconstruction> reconstruction = mapper.Reconstruction();
+
+  TwoViewGeometry two_view_geometry;
+  image_t image_id1;
+  image_t image_id2;
+  ASSERT_TRUE(mapper.FindInitialImagePair(
+      options, two_view_geometry, image_id1, image_id2));
+  mapper.RegisterInitialImagePair(
+      options, two_view_geometry, image_id1, image_id2);
+
+  auto FindNextImages = [&](const IncrementalMapper::Options& options) {
+    const std::vector<image_t> next_image_ids = mapper.FindNextImages(options);
+    EXPECT_EQ(next_image_ids,
+              FindNextImagesFromScratch(options, database_cache, mapper));
+    return next_image_ids;
+  };
+
+  bool filtered_image = false;
+  for (size_t step = 0; step < 2 * gt_reconstruction.NumImages(); ++step) {
+    std::vector<image_t> next_image_ids = FindNextImages(options);
+    if (next_image_ids.empty()) {
+      break;
+    }
+
+    // Failed registration trials move the image to the retrials, but the
+    // ranking is only updated in the next call.
+    if (step % 3 == 0) {
+      const std::set<IncrementalMapper::NextImageCandidate>& candidates =
+          mapper.RankNextImages(options);
+      EXPECT_FALSE(
+          mapper.RegisterNextImage(failing_options, next_image_ids.back()));
+      std::vector<image_t> candidate_image_ids;
+      for (const auto& candidate : candidates) {
+        candidate_image_ids.push_back(candidate.image_id);
+      }
+      EXPECT_EQ(candidate_image_ids, next_image_ids);
+      next_image_ids = FindNextImages(options);
+    }
+
+    // Changed options re-rank all images, and the ranking is maintained
+    // incrementally again after switching back.
+    if (step % 4 == 0) {
+      FindNextImages(other_options);
+    }
+
+    const image_t image_id = next_image_ids.front();
+    if (mapper.RegisterNextImage(options, image_id)) {
+      mapper.TriangulateImage(tri_options, image_id);
+    }
+    mapper.FilterPoints(options);
+
+    // Filter an image with bogus camera parameters, once enough images are
+    // registered, and restore its camera for later retrials.
+    if (!filtered_image && reconstruction->NumRegImages() >= 20) {
+      const image_t filter_image_id = reconstruction->RegImageIds().back();
+      Camera& camera = reconstruction->Camera(
+          reconstruction->Image(filter_image_id).CameraId());
+      const double focal_length = camera.FocalLength();
+      camera.SetFocalLength(100 * focal_length);
+      EXPECT_EQ(mapper.FilterImages(options), 1);
+      EXPECT_EQ(mapper.FilteredImages().count(filter_image_id), 1);
+      camera.SetFocalLength(focal_length);
+      filtered_image = true;
+    }
+  }
+
+  EXPECT_TRUE(filtered_image);
+  EXPECT_GE(reconstruction->NumRegImages(), 20);
+}
+
+TEST(IncrementalMapper, WriteReadState) {
+  Database database(Database::kInMemoryDatabasePath);
+  Reconstruction gt_reconstruction;
+  SyntheticDatasetOptions synthetic_dataset_options;
+  synthetic_dataset_options.num_cameras = 24;
+  synthetic_dataset_options.num_images = 24;
+  synthetic_dataset_options.num_points3D = 200;
+  synthetic_dataset_options.point2D_stddev = 0;
+  SynthesizeDataset(synthetic_dataset_options, &gt_reconstruction, &database);
+
+  const std::shared_ptr<const DatabaseCache> database_cache =
+      DatabaseCache::Create(
+          database, /*min_num_matches=*/0, /*ignore_watermarks=*/false, {});
+
+  IncrementalMapper::Options options;
+  options.num_threads = 1;
+  IncrementalMapper::Options failing_options = options;
+  failing_options.abs_pose_min_num_inliers = std::numeric_limits<int>::max();
+  const IncrementalTriangulator::Options tri_options;
+
+  IncrementalMapper mapper(database_cache);
+  mapper.BeginReconstruction(std::make_shared<Reconstruction>());
+  std::shared_ptr<Reconstruction> reconstruction = mapper.Reconstruction();
+
+  TwoViewGeometry two_view_geometry;
+  image_t image_id1;
+  image_t image_id2;
+  ASSERT_TRUE(mapper.FindInitialImagePair(
+      options, two_view_geometry, image_id1, image_id2));
+  mapper.RegisterInitialImagePair(
+      options, two_view_geometry, image_id1, image_id2);
+
+  // Register all images with failed trials for every other image.
+  for (size_t step = 0; step < 2 * gt_reconstruction.NumImages(); ++step) {
+    const std::vector<image_t> next_image_ids = mapper.FindNextImages(options);
+    if (next_image_ids.empty()) {
+      break;
+    }
+    if (step % 2 == 0) {
+      EXPECT_FALSE(
+          mapper.RegisterNextImage(failing_options, next_image_ids.back()));
+    }
+    if (mapper.RegisterNextImage(options, next_image_ids.front())) {
+      mapper.TriangulateImage(tri_options, next_image_ids.front());
+    }
+  }
+  ASSERT_GE(reconstruction->NumRegImages(), 20);
+
+  // Filter an image with bogus camera parameters.
+  const image_t filter_image_id = reconstruction->RegImageIds().back();
+  Camera& camera =
+      reconstruction->Camera(reconstruction->Image(filter_image_id).CameraId());
+  const double focal_length = camera.FocalLength();
+  camera.SetFocalLength(100 * focal_length);
+  EXPECT_EQ(mapper.FilterImages(options), 1);
+  camera.SetFocalLength(focal_length);
+
+  // Delete the 3D point with the largest identifier, which is not restored
+  // when reading the reconstruction from disk.
+  point3D_t max_point3D_id = 0;
+  for (const auto& point3D : reconstruction->Points3D()) {
+    max_point3D_id = std::max(max_point3D_id, point3D.first);
+  }
+  mapper.ObservationManager().DeletePoint3D(max_point3D_id);
+
+  const std::string test_dir = CreateTestDir();
+  const std::string state_path = test_dir + "/mapper_state.bin";
+  mapper.WriteState(state_path);
+  reconstruction->Write(test_dir);
+
+  auto new_reconstruction = std::make_shared<Reconstruction>();
+  new_reconstruction->Read(test_dir);
+  EXPECT_LT(new_reconstruction->MaxPoint3DId(), max_point3D_id);
+  IncrementalMapper new_mapper(database_cache);
+  new_mapper.BeginReconstruction(new_reconstruction);
+  new_mapper.ReadState(state_path);
+  EXPECT_EQ(new_reconstruction->MaxPoint3DId(), reconstruction->MaxPoint3DId());
+
+  // The state is written in sorted order, such that the initial image pairs,
+  // the registration trials, and the filtered images must round-trip exactly.
+  const std::string new_state_path = test_dir + "/new_mapper_state.bin";
+  new_mapper.WriteState(new_state_path);
+  EXPECT_EQ(ReadFileContents(new_state_path), ReadFileContents(state_path));
+
+  EXPECT_EQ(new_mapper.FilteredImages(), mapper.FilteredImages());
+  EXPECT_EQ(new_mapper.FilteredImages().count(filter_image_id), 1);
+  EXPECT_EQ(new_mapper.NumTotalRegImages(), mapper.NumTotalRegImages());
+  EXPECT_EQ(new_mapper.FindNextImages(options), mapper.FindNextImages(options));
+
+  // The already tried initial pair is not proposed again.
+  TwoViewGeometry new_two_view_geometry;
+  image_t new_image_id1;
+  image_t new_image_id2;
+  const bool found_init_pair = new_mapper.FindInitialImagePair(
+      options, new_two_view_geometry, new_image_id1, new_image_id2);
+  const bool expected_found_init_pair = mapper.FindInitialImagePair(
+      options, two_view_geometry, image_id1, image_id2);
+  EXPECT_EQ(found_init_pair, expected_found_init_pair);
+  if (found_init_pair) {
+    EXPECT_EQ(new_image_id1, image_id1);
+    EXPECT_EQ(new_image_id2, image_id2);
+  }
+}
+
+}  // namespace
+}  // namespace colmap
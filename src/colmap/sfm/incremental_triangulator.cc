@@ -32,10 +32,56 @@
 #include "colmap/estimators/triangulation.h"
 #include "colmap/scene/projection.h"
 #include "colmap/util/misc.h"
+#include "colmap/util/threading.h"
+
+#include <algorithm>
 
 namespace colmap {
 namespace {
 
+// Check if all observations of both tracks are inliers for the track length
+// weighted average of the two point locations.
+bool IsMergeable(const Reconstruction& reconstruction,
+                 const Point3D& point3D1,
+                 const Point3D& point3D2,
+                 const double max_squared_reproj_error) {
+  const Eigen::Vector3d merged_xyz =
+      (point3D1.track.Length() * point3D1.xyz +
+       point3D2.track.Length() * point3D2.xyz) /
+      (point3D1.track.Length() + point3D2.track.Length());
+
+  for (const Track* track : {&point3D1.track, &point3D2.track}) {
+    for (const auto test_track_el : track->Elements()) {
+      const Image& test_image = reconstruction.Image(test_track_el.image_id);
+      const Camera& test_camera = reconstruction.Camera(test_image.CameraId());
+      const Point2D& test_point2D =
+          test_image.Point2D(test_track_el.point2D_idx);
+      if (CalculateSquaredReprojectionError(test_point2D.xy,
+                                            merged_xyz,
+                                            test_image.CamFromWorld(),
+                                            test_camera) >
+          max_squared_reproj_error) {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+// New 3D point of an observation, which is estimated before the preceding
+// observations of the image are triangulated.
+struct NewPoint3DEstimate {
+  // All correspondences including the reference observation.
+  std::vector<IncrementalTriangulator::CorrData> corrs_data;
+  // Whether none of the correspondences was triangulated during estimation.
+  bool is_valid = false;
+  bool success = false;
+  std::vector<IncrementalTriangulator::CorrData> create_corrs_data;
+  std::vector<char> inlier_mask;
+  Eigen::Vector3d xyz;
+};
+
 bool TriangulateTrack(
     const EstimateTriangulationOptions& options,
     const std::vector<IncrementalTriangulator::CorrData>& corrs_data,
@@ -124,14 +170,80 @@ size_t IncrementalTriangulator::TriangulateImage(const Options& options,
   // Container for correspondences from reference observation to other images.
   std::vector<CorrData> corrs_data;
 
+  // Estimate the new points of observations without triangulated
+  // correspondences in parallel. Adding a point modifies the observations
+  // that later new points are estimated from, so that estimates are only used
+  // if all their correspondences are still untriangulated. Otherwise, the
+  // observation is triangulated serially as usual.
+  std::vector<NewPoint3DEstimate> estimates;
+  ThreadPool* thread_pool = GetThreadPool(options);
+  if (thread_pool != nullptr) {
+    CacheCameraBogusParams(options);
+    estimates.resize(image.NumPoints2D());
+    const size_t kNumPoints2DPerTask = 64;
+    ParallelForChunks(
+        thread_pool,
+        image.NumPoints2D(),
+        kNumPoints2DPerTask,
+        [&](const size_t begin_idx, const size_t end_idx) {
+          std::vector<CorrespondenceGraph::Correspondence> found_corrs;
+          CorrData task_ref_corr_data = ref_corr_data;
+          for (size_t point2D_idx = begin_idx; point2D_idx < end_idx;
+               ++point2D_idx) {
+            NewPoint3DEstimate& estimate = estimates[point2D_idx];
+            const size_t num_triangulated =
+                Find(options,
+                     image_id,
+                     point2D_idx,
+                     static_cast<size_t>(options.max_transitivity),
+                     &found_corrs,
+                     &estimate.corrs_data);
+            if (estimate.corrs_data.empty() || num_triangulated > 0) {
+              continue;
+            }
+            estimate.is_valid = true;
+            task_ref_corr_data.point2D_idx = point2D_idx;
+            task_ref_corr_data.point2D = &image.Point2D(point2D_idx);
+            estimate.corrs_data.push_back(task_ref_corr_data);
+            estimate.success = EstimateNewPoint3D(options,
+                                                  estimate.corrs_data,
+                                                  &estimate.create_corrs_data,
+                                                  &estimate.inlier_mask,
+                                                  &estimate.xyz);
+          }
+        });
+  }
+
   // Try to triangulate all image observations.
   for (point2D_t point2D_idx = 0; point2D_idx < image.NumPoints2D();
        ++point2D_idx) {
+    if (!estimates.empty()) {
+      const NewPoint3DEstimate& estimate = estimates[point2D_idx];
+      if (estimate.corrs_data.empty()) {
+        continue;
+      }
+      if (estimate.is_valid &&
+          std::none_of(estimate.corrs_data.begin(),
+                       estimate.corrs_data.end(),
+                       [](const CorrData& corr_data) {
+                         return corr_data.point2D->HasPoint3D();
+                       })) {
+        if (estimate.success) {
+          num_tris += AddNewPoint3D(options,
+                                    estimate.create_corrs_data,
+                                    estimate.inlier_mask,
+                                    estimate.xyz);
+        }
+        continue;
+      }
+    }
+
     const size_t num_triangulated =
         Find(options,
              image_id,
              point2D_idx,
              static_cast<size_t>(options.max_transitivity),
+             &found_corrs_,
              &corrs_data);
     if (corrs_data.empty()) {
       continue;
@@ -214,6 +326,7 @@ size_t IncrementalTriangulator::CompleteImage(const Options& options,
              image_id,
              point2D_idx,
              static_cast<size_t>(options.max_transitivity),
+             &found_corrs_,
              &corrs_data);
     if (num_triangulated || corrs_data.empty()) {
       continue;
@@ -256,9 +369,8 @@ size_t IncrementalTriangulator::CompleteTracks(
 
   ClearCaches();
 
-  for (const point3D_t point3D_id : point3D_ids) {
-    num_completed += Complete(options, point3D_id);
-  }
+  num_completed += ParallelCompleteTracks(
+      options, std::vector<point3D_t>(point3D_ids.begin(), point3D_ids.end()));
 
   return num_completed;
 }
@@ -270,9 +382,10 @@ size_t IncrementalTriangulator::CompleteAllTracks(const Options& options) {
 
   ClearCaches();
 
-  for (const point3D_t point3D_id : reconstruction_.Point3DIds()) {
-    num_completed += Complete(options, point3D_id);
-  }
+  const std::unordered_set<point3D_t> point3D_ids =
+      reconstruction_.Point3DIds();
+  num_completed += ParallelCompleteTracks(
+      options, std::vector<point3D_t>(point3D_ids.begin(), point3D_ids.end()));
 
   return num_completed;
 }
@@ -285,9 +398,8 @@ size_t IncrementalTriangulator::MergeTracks(
 
   ClearCaches();
 
-  for (const point3D_t point3D_id : point3D_ids) {
-    num_merged += Merge(options, point3D_id);
-  }
+  num_merged += ParallelMergeTracks(
+      options, std::vector<point3D_t>(point3D_ids.begin(), point3D_ids.end()));
 
   return num_merged;
 }
@@ -299,9 +411,10 @@ size_t IncrementalTriangulator::MergeAllTracks(const Options& options) {
 
   ClearCaches();
 
-  for (const point3D_t point3D_id : reconstruction_.Point3DIds()) {
-    num_merged += Merge(options, point3D_id);
-  }
+  const std::unordered_set<point3D_t> point3D_ids =
+      reconstruction_.Point3DIds();
+  num_merged += ParallelMergeTracks(
+      options, std::vector<point3D_t>(point3D_ids.begin(), point3D_ids.end()));
 
   return num_merged;
 }
@@ -316,94 +429,180 @@ size_t IncrementalTriangulator::Retriangulate(const Options& options) {
   Options re_options = options;
   re_options.continue_max_angle_error = options.re_max_angle_error;
 
+  // Only perform retriangulation for under-reconstructed image pairs. The
+  // ratio only increases during retriangulation, so that all candidate pairs
+  // can be collected upfront and are checked again before retriangulation.
+  const auto IsUnderReconstructed =
+      [&options](const ObservationManager::ImagePairStat& image_pair_stat) {
+        const double tri_ratio =
+            static_cast<double>(image_pair_stat.num_tri_corrs) /
+            static_cast<double>(image_pair_stat.num_total_corrs);
+        return tri_ratio < options.re_min_ratio;
+      };
+
+  std::vector<image_pair_t> pair_ids;
   for (const auto& image_pair : obs_manager_->ImagePairs()) {
-    // Only perform retriangulation for under-reconstructed image pairs.
-    const double tri_ratio =
-        static_cast<double>(image_pair.second.num_tri_corrs) /
-        static_cast<double>(image_pair.second.num_total_corrs);
-    if (tri_ratio >= options.re_min_ratio) {
-      continue;
+    if (IsUnderReconstructed(image_pair.second)) {
+      pair_ids.push_back(image_pair.first);
     }
+  }
 
-    // Check if images are registered yet.
-
-    image_t image_id1;
-    image_t image_id2;
-    std::tie(image_id1, image_id2) =
-        Database::PairIdToImagePair(image_pair.first);
-
+  // Check if images are registered and have valid cameras.
+  const auto IsValidImagePair = [this, &options](const image_t image_id1,
+                                                 const image_t image_id2) {
     const Image& image1 = reconstruction_.Image(image_id1);
-    if (!image1.IsRegistered()) {
-      continue;
-    }
-
     const Image& image2 = reconstruction_.Image(image_id2);
-    if (!image2.IsRegistered()) {
-      continue;
+    return image1.IsRegistered() && image2.IsRegistered() &&
+           !HasCameraBogusParams(options,
+                                 reconstruction_.Camera(image1.CameraId())) &&
+           !HasCameraBogusParams(options,
+                                 reconstruction_.Camera(image2.CameraId()));
+  };
+
+  const auto MakeCorrData = [this](const image_t image_id,
+                                   const point2D_t point2D_idx) {
+    CorrData corr_data;
+    corr_data.image_id = image_id;
+    corr_data.point2D_idx = point2D_idx;
+    corr_data.image = &reconstruction_.Image(image_id);
+    corr_data.camera = &reconstruction_.Camera(corr_data.image->CameraId());
+    corr_data.point2D = &corr_data.image->Point2D(point2D_idx);
+    return corr_data;
+  };
+
+  // The new points of correspondences without triangulated observations are
+  // estimated in parallel for a batch of image pairs. The image pairs are then
+  // retriangulated serially, and the estimates are only used if both
+  // observations are still untriangulated.
+  ThreadPool* thread_pool = GetThreadPool(options);
+  if (thread_pool != nullptr) {
+    CacheCameraBogusParams(options);
+  }
+  const size_t kNumImagePairsPerBatch =
+      4 * (thread_pool == nullptr ? 1 : thread_pool->NumThreads());
+  std::vector<std::vector<NewPoint3DEstimate>> estimates;
+
+  for (size_t batch_begin = 0; batch_begin < pair_ids.size();
+       batch_begin += kNumImagePairsPerBatch) {
+    const size_t batch_size =
+        std::min(kNumImagePairsPerBatch, pair_ids.size() - batch_begin);
+
+    estimates.clear();
+    if (thread_pool != nullptr) {
+      estimates.resize(batch_size);
+      ParallelForChunks(
+          thread_pool,
+          batch_size,
+          /*chunk_size=*/1,
+          [&](const size_t begin, const size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+              const auto [image_id1, image_id2] =
+                  Database::PairIdToImagePair(pair_ids[batch_begin + i]);
+              if (re_num_trials_.count(pair_ids[batch_begin + i]) > 0 &&
+                  re_num_trials_.at(pair_ids[batch_begin + i]) >=
+                      options.re_max_trials) {
+                continue;
+              }
+              if (!IsValidImagePair(image_id1, image_id2)) {
+                continue;
+              }
+              const FeatureMatches& corrs =
+                  correspondence_graph_->FindCorrespondencesBetweenImages(
+                      image_id1, image_id2);
+              estimates[i].resize(corrs.size());
+              for (size_t j = 0; j < corrs.size(); ++j) {
+                NewPoint3DEstimate& estimate = estimates[i][j];
+                estimate.corrs_data = {
+                    MakeCorrData(image_id1, corrs[j].point2D_idx1),
+                    MakeCorrData(image_id2, corrs[j].point2D_idx2)};
+                if (estimate.corrs_data[0].point2D->HasPoint3D() ||
+                    estimate.corrs_data[1].point2D->HasPoint3D()) {
+                  continue;
+                }
+                estimate.is_valid = true;
+                estimate.success =
+                    EstimateNewPoint3D(options,
+                                       estimate.corrs_data,
+                                       &estimate.create_corrs_data,
+                                       &estimate.inlier_mask,
+                                       &estimate.xyz);
+              }
+            }
+          });
     }
 
-    // Only perform retriangulation for a maximum number of trials.
+    for (size_t i = 0; i < batch_size; ++i) {
+      const image_pair_t pair_id = pair_ids[batch_begin + i];
+      if (!IsUnderReconstructed(obs_manager_->ImagePairs().at(pair_id))) {
+        continue;
+      }
 
-    int& num_re_trials = re_num_trials_[image_pair.first];
-    if (num_re_trials >= options.re_max_trials) {
-      continue;
-    }
-    num_re_trials += 1;
+      const auto [image_id1, image_id2] = Database::PairIdToImagePair(pair_id);
 
-    const Camera& camera1 = reconstruction_.Camera(image1.CameraId());
-    const Camera& camera2 = reconstruction_.Camera(image2.CameraId());
-    if (HasCameraBogusParams(options, camera1) ||
-        HasCameraBogusParams(options, camera2)) {
-      continue;
-    }
+      // Check if images are registered yet.
 
-    // Find correspondences and perform retriangulation.
+      if (!reconstruction_.Image(image_id1).IsRegistered() ||
+          !reconstruction_.Image(image_id2).IsRegistered()) {
+        continue;
+      }
 
-    const FeatureMatches& corrs =
-        correspondence_graph_->FindCorrespondencesBetweenImages(image_id1,
-                                                                image_id2);
+      // Only perform retriangulation for a maximum number of trials.
 
-    for (const auto& corr : corrs) {
-      const Point2D& point2D1 = image1.Point2D(corr.point2D_idx1);
-      const Point2D& point2D2 = image2.Point2D(corr.point2D_idx2);
+      int& num_re_trials = re_num_trials_[pair_id];
+      if (num_re_trials >= options.re_max_trials) {
+        continue;
+      }
+      num_re_trials += 1;
 
-      // Two cases are possible here: both points belong to the same 3D point
-      // or to different 3D points. In the former case, there is nothing
-      // to do. In the latter case, we do not attempt retriangulation,
-      // as retriangulated correspondences are very likely bogus and
-      // would therefore destroy both 3D points if merged.
-      if (point2D1.HasPoint3D() && point2D2.HasPoint3D()) {
+      if (!IsValidImagePair(image_id1, image_id2)) {
         continue;
       }
 
-      CorrData corr_data1;
-      corr_data1.image_id = image_id1;
-      corr_data1.point2D_idx = corr.point2D_idx1;
-      corr_data1.image = &image1;
-      corr_data1.camera = &camera1;
-      corr_data1.point2D = &point2D1;
-
-      CorrData corr_data2;
-      corr_data2.image_id = image_id2;
-      corr_data2.point2D_idx = corr.point2D_idx2;
-      corr_data2.image = &image2;
-      corr_data2.camera = &camera2;
-      corr_data2.point2D = &point2D2;
-
-      if (point2D1.HasPoint3D() && !point2D2.HasPoint3D()) {
-        const std::vector<CorrData> corrs_data1 = {corr_data1};
-        num_tris += Continue(re_options, corr_data2, corrs_data1);
-      } else if (!point2D1.HasPoint3D() && point2D2.HasPoint3D()) {
-        const std::vector<CorrData> corrs_data2 = {corr_data2};
-        num_tris += Continue(re_options, corr_data1, corrs_data2);
-      } else if (!point2D1.HasPoint3D() && !point2D2.HasPoint3D()) {
-        const std::vector<CorrData> corrs_data = {corr_data1, corr_data2};
-        // Do not use larger triangulation threshold as this causes
-        // significant drift when creating points (options vs. re_options).
-        num_tris += Create(options, corrs_data);
+      // Find correspondences and perform retriangulation.
+
+      const FeatureMatches& corrs =
+          correspondence_graph_->FindCorrespondencesBetweenImages(image_id1,
+                                                                  image_id2);
+
+      for (size_t j = 0; j < corrs.size(); ++j) {
+        const CorrData corr_data1 =
+            MakeCorrData(image_id1, corrs[j].point2D_idx1);
+        const CorrData corr_data2 =
+            MakeCorrData(image_id2, corrs[j].point2D_idx2);
+        const bool has_point3D1 = corr_data1.point2D->HasPoint3D();
+        const bool has_point3D2 = corr_data2.point2D->HasPoint3D();
+
+        // Two cases are possible here: both points belong to the same 3D
+        // point or to different 3D points. In the former case, there is
+        // nothing to do. In the latter case, we do not attempt
+        // retriangulation, as retriangulated correspondences are very likely
+        // bogus and would therefore destroy both 3D points if merged.
+        if (has_point3D1 && has_point3D2) {
+          continue;
+        }
+
+        if (has_point3D1 && !has_point3D2) {
+          const std::vector<CorrData> corrs_data1 = {corr_data1};
+          num_tris += Continue(re_options, corr_data2, corrs_data1);
+        } else if (!has_point3D1 && has_point3D2) {
+          const std::vector<CorrData> corrs_data2 = {corr_data2};
+          num_tris += Continue(re_options, corr_data1, corrs_data2);
+        } else if (!estimates.empty() && !estimates[i].empty() &&
+                   estimates[i][j].is_valid) {
+          const NewPoint3DEstimate& estimate = estimates[i][j];
+          if (estimate.success) {
+            num_tris += AddNewPoint3D(options,
+                                      estimate.create_corrs_data,
+                                      estimate.inlier_mask,
+                                      estimate.xyz);
+          }
+        } else {
+          const std::vector<CorrData> corrs_data = {corr_data1, corr_data2};
+          // Do not use larger triangulation threshold as this causes
+          // significant drift when creating points (options vs. re_options).
+          num_tris += Create(options, corrs_data);
+        }
       }
-      // Else both points have a 3D point, but we do not want to
-      // merge points in retriangulation.
     }
   }
 
@@ -438,20 +637,22 @@ void IncrementalTriangulator::ClearCaches() {
   found_corrs_.clear();
 }
 
-size_t IncrementalTriangulator::Find(const Options& options,
-                                     const image_t image_id,
-                                     const point2D_t point2D_idx,
-                                     const size_t transitivity,
-                                     std::vector<CorrData>* corrs_data) {
+size_t IncrementalTriangulator::Find(
+    const Options& options,
+    const image_t image_id,
+    const point2D_t point2D_idx,
+    const size_t transitivity,
+    std::vector<CorrespondenceGraph::Correspondence>* found_corrs,
+    std::vector<CorrData>* corrs_data) {
   correspondence_graph_->ExtractTransitiveCorrespondences(
-      image_id, point2D_idx, transitivity, &found_corrs_);
+      image_id, point2D_idx, transitivity, found_corrs);
 
   corrs_data->clear();
-  corrs_data->reserve(found_corrs_.size());
+  corrs_data->reserve(found_corrs->size());
 
   size_t num_triangulated = 0;
 
-  for (const auto& corr : found_corrs_) {
+  for (const auto& corr : *found_corrs) {
     const Image& corr_image = reconstruction_.Image(corr.image_id);
     if (!corr_image.IsRegistered()) {
       continue;
@@ -481,23 +682,40 @@ size_t IncrementalTriangulator::Find(const Options& options,
 
 size_t IncrementalTriangulator::Create(
     const Options& options, const std::vector<CorrData>& corrs_data) {
-  // Extract correspondences without an existing triangulated observation.
   std::vector<CorrData> create_corrs_data;
-  create_corrs_data.reserve(corrs_data.size());
+  std::vector<char> inlier_mask;
+  Eigen::Vector3d xyz;
+  if (!EstimateNewPoint3D(
+          options, corrs_data, &create_corrs_data, &inlier_mask, &xyz)) {
+    return 0;
+  }
+  return AddNewPoint3D(options, create_corrs_data, inlier_mask, xyz);
+}
+
+bool IncrementalTriangulator::EstimateNewPoint3D(
+    const Options& options,
+    const std::vector<CorrData>& corrs_data,
+    std::vector<CorrData>* create_corrs_data,
+    std::vector<char>* inlier_mask,
+    Eigen::Vector3d* xyz) const {
+  // Extract correspondences without an existing triangulated observation.
+  create_corrs_data->clear();
+  create_corrs_data->reserve(corrs_data.size());
   for (const CorrData& corr_data : corrs_data) {
     if (!corr_data.point2D->HasPoint3D()) {
-      create_corrs_data.push_back(corr_data);
+      create_corrs_data->push_back(corr_data);
     }
   }
 
-  if (create_corrs_data.size() < 2) {
+  if (create_corrs_data->size() < 2) {
     // Need at least two observations for triangulation.
-    return 0;
-  } else if (options.ignore_two_view_tracks && create_corrs_data.size() == 2) {
-    const CorrData& corr_data1 = create_corrs_data[0];
+    return false;
+  } else if (options.ignore_two_view_tracks &&
+             create_corrs_data->size() == 2) {
+    const CorrData& corr_data1 = (*create_corrs_data)[0];
     if (correspondence_graph_->IsTwoViewObservation(corr_data1.image_id,
                                                     corr_data1.point2D_idx)) {
-      return 0;
+      return false;
     }
   }
 
@@ -513,12 +731,14 @@ size_t IncrementalTriangulator::Create(
   tri_options.ransac_options.max_num_trials = 10000;
 
   // Estimate triangulation.
-  Eigen::Vector3d xyz;
-  std::vector<char> inlier_mask;
-  if (!TriangulateTrack(tri_options, create_corrs_data, inlier_mask, xyz)) {
-    return 0;
-  }
+  return TriangulateTrack(tri_options, *create_corrs_data, *inlier_mask, *xyz);
+}
 
+size_t IncrementalTriangulator::AddNewPoint3D(
+    const Options& options,
+    const std::vector<CorrData>& create_corrs_data,
+    const std::vector<char>& inlier_mask,
+    const Eigen::Vector3d& xyz) {
   // Add inliers to estimated track.
   Track track;
   track.Reserve(create_corrs_data.size());
@@ -602,7 +822,7 @@ size_t IncrementalTriangulator::Merge(const Options& options,
   for (const auto& track_el : point3D.track.Elements()) {
     const auto corr_range = correspondence_graph_->FindCorrespondences(
         track_el.image_id, track_el.point2D_idx);
-    for (const auto* corr = corr_range.beg; corr < corr_range.end; ++corr) {
+    for (auto corr = corr_range.beg; corr < corr_range.end; ++corr) {
       const auto& image = reconstruction_.Image(corr->image_id);
       if (!image.IsRegistered()) {
         continue;
@@ -622,38 +842,11 @@ size_t IncrementalTriangulator::Merge(const Options& options,
       merge_trials_[point3D_id].insert(corr_point2D.point3D_id);
       merge_trials_[corr_point2D.point3D_id].insert(point3D_id);
 
-      // Weighted average of point locations, depending on track length.
-      const Eigen::Vector3d merged_xyz =
-          (point3D.track.Length() * point3D.xyz +
-           corr_point3D.track.Length() * corr_point3D.xyz) /
-          (point3D.track.Length() + corr_point3D.track.Length());
-
-      // Count number of inlier track elements of the merged track.
-      bool merge_success = true;
-      for (const Track* track : {&point3D.track, &corr_point3D.track}) {
-        for (const auto test_track_el : track->Elements()) {
-          const Image& test_image =
-              reconstruction_.Image(test_track_el.image_id);
-          const Camera& test_camera =
-              reconstruction_.Camera(test_image.CameraId());
-          const Point2D& test_point2D =
-              test_image.Point2D(test_track_el.point2D_idx);
-          if (CalculateSquaredReprojectionError(test_point2D.xy,
-                                                merged_xyz,
-                                                test_image.CamFromWorld(),
-                                                test_camera) >
-              max_squared_reproj_error) {
-            merge_success = false;
-            break;
-          }
-        }
-        if (!merge_success) {
-          break;
-        }
-      }
-
       // Only accept merge if all track elements are inliers.
-      if (merge_success) {
+      if (IsMergeable(reconstruction_,
+                      point3D,
+                      corr_point3D,
+                      max_squared_reproj_error)) {
         const size_t num_merged =
             point3D.track.Length() + corr_point3D.track.Length();
 
@@ -679,12 +872,103 @@ size_t IncrementalTriangulator::Merge(const Options& options,
   return 0;
 }
 
+bool IncrementalTriangulator::HasMergeCandidate(const Options& options,
+                                                const point3D_t point3D_id) {
+  if (!reconstruction_.ExistsPoint3D(point3D_id)) {
+    return false;
+  }
+
+  const double max_squared_reproj_error =
+      options.merge_max_reproj_error * options.merge_max_reproj_error;
+
+  const auto& point3D = reconstruction_.Point3D(point3D_id);
+
+  for (const auto& track_el : point3D.track.Elements()) {
+    const auto corr_range = correspondence_graph_->FindCorrespondences(
+        track_el.image_id, track_el.point2D_idx);
+    for (auto corr = corr_range.beg; corr < corr_range.end; ++corr) {
+      const auto& image = reconstruction_.Image(corr->image_id);
+      if (!image.IsRegistered()) {
+        continue;
+      }
+
+      const Point2D& corr_point2D = image.Point2D(corr->point2D_idx);
+      if (!corr_point2D.HasPoint3D() || corr_point2D.point3D_id == point3D_id) {
+        continue;
+      }
+
+      if (IsMergeable(reconstruction_,
+                      point3D,
+                      reconstruction_.Point3D(corr_point2D.point3D_id),
+                      max_squared_reproj_error)) {
+        return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+size_t IncrementalTriangulator::ParallelMergeTracks(
+    const Options& options, const std::vector<point3D_t>& point3D_ids) {
+  size_t num_merged = 0;
+
+  ThreadPool* thread_pool = GetThreadPool(options);
+  if (thread_pool == nullptr) {
+    for (const point3D_t point3D_id : point3D_ids) {
+      num_merged += Merge(options, point3D_id);
+    }
+    return num_merged;
+  }
+
+  // The merge candidates are found in parallel and the points are merged
+  // serially in the original order. Points without candidates are skipped.
+  // This does not change the result, since merged points are recursively
+  // tested against all their corresponding points, including the skipped
+  // ones, and each pair of points is only tested once.
+  const size_t kNumPoints3DPerBatch = 100000;
+  const size_t kNumPoints3DPerTask = 256;
+  std::vector<char> has_merge_candidate;
+  for (size_t batch_begin = 0; batch_begin < point3D_ids.size();
+       batch_begin += kNumPoints3DPerBatch) {
+    const size_t batch_size =
+        std::min(kNumPoints3DPerBatch, point3D_ids.size() - batch_begin);
+    has_merge_candidate.resize(batch_size);
+    ParallelForChunks(thread_pool,
+                      batch_size,
+                      kNumPoints3DPerTask,
+                      [&](const size_t begin, const size_t end) {
+                        for (size_t i = begin; i < end; ++i) {
+                          has_merge_candidate[i] = HasMergeCandidate(
+                              options, point3D_ids[batch_begin + i]);
+                        }
+                      });
+
+    for (size_t i = 0; i < batch_size; ++i) {
+      if (has_merge_candidate[i]) {
+        num_merged += Merge(options, point3D_ids[batch_begin + i]);
+      }
+    }
+  }
+
+  return num_merged;
+}
+
 size_t IncrementalTriangulator::Complete(const Options& options,
                                          const point3D_t point3D_id) {
-  size_t num_completed = 0;
+  std::vector<TrackElement> track_els;
+  FindCompletions(options, point3D_id, &track_els);
+  return AddCompletions(point3D_id, track_els);
+}
+
+void IncrementalTriangulator::FindCompletions(
+    const Options& options,
+    const point3D_t point3D_id,
+    std::vector<TrackElement>* track_els) {
+  track_els->clear();
 
   if (!reconstruction_.ExistsPoint3D(point3D_id)) {
-    return num_completed;
+    return;
   }
 
   const double max_squared_reproj_error =
@@ -692,6 +976,13 @@ size_t IncrementalTriangulator::Complete(const Options& options,
 
   const Point3D& point3D = reconstruction_.Point3D(point3D_id);
 
+  // Observations that are already found through another correspondence.
+  std::unordered_set<uint64_t> found_point2D_keys;
+  const auto Point2DKey = [](const image_t image_id,
+                             const point2D_t point2D_idx) {
+    return (static_cast<uint64_t>(image_id) << 32) | point2D_idx;
+  };
+
   std::vector<TrackElement> queue = point3D.track.Elements();
 
   const int max_transitivity = options.complete_max_transitivity;
@@ -706,14 +997,16 @@ size_t IncrementalTriangulator::Complete(const Options& options,
     for (const TrackElement& queue_elem : prev_queue) {
       const auto corr_range = correspondence_graph_->FindCorrespondences(
           queue_elem.image_id, queue_elem.point2D_idx);
-      for (const auto* corr = corr_range.beg; corr < corr_range.end; ++corr) {
+      for (auto corr = corr_range.beg; corr < corr_range.end; ++corr) {
         const Image& image = reconstruction_.Image(corr->image_id);
         if (!image.IsRegistered()) {
           continue;
         }
 
         const Point2D& point2D = image.Point2D(corr->point2D_idx);
-        if (point2D.HasPoint3D()) {
+        if (point2D.HasPoint3D() ||
+            found_point2D_keys.count(
+                Point2DKey(corr->image_id, corr->point2D_idx)) > 0) {
           continue;
         }
 
@@ -729,16 +1022,79 @@ size_t IncrementalTriangulator::Complete(const Options& options,
         }
 
         // Success, add observation to point track.
-        const TrackElement track_el(corr->image_id, corr->point2D_idx);
-        obs_manager_->AddObservation(point3D_id, track_el);
-        modified_point3D_ids_.insert(point3D_id);
+        track_els->emplace_back(corr->image_id, corr->point2D_idx);
+        found_point2D_keys.insert(
+            Point2DKey(corr->image_id, corr->point2D_idx));
 
         // Recursively complete track for this new correspondence.
         if (transitivity < max_transitivity - 1) {
           queue.emplace_back(corr->image_id, corr->point2D_idx);
         }
+      }
+    }
+  }
+}
+
+size_t IncrementalTriangulator::AddCompletions(
+    const point3D_t point3D_id, const std::vector<TrackElement>& track_els) {
+  for (const TrackElement& track_el : track_els) {
+    obs_manager_->AddObservation(point3D_id, track_el);
+  }
+  if (!track_els.empty()) {
+    modified_point3D_ids_.insert(point3D_id);
+  }
+  return track_els.size();
+}
 
-        num_completed += 1;
+size_t IncrementalTriangulator::ParallelCompleteTracks(
+    const Options& options, const std::vector<point3D_t>& point3D_ids) {
+  size_t num_completed = 0;
+
+  ThreadPool* thread_pool = GetThreadPool(options);
+  if (thread_pool == nullptr) {
+    for (const point3D_t point3D_id : point3D_ids) {
+      num_completed += Complete(options, point3D_id);
+    }
+    return num_completed;
+  }
+
+  // The completions are found in parallel and added serially in the original
+  // order. If any of the found observations was triangulated by a preceding
+  // point in the meantime, the track is completed again serially.
+  CacheCameraBogusParams(options);
+  const size_t kNumPoints3DPerBatch = 100000;
+  const size_t kNumPoints3DPerTask = 256;
+  std::vector<std::vector<TrackElement>> track_els;
+  for (size_t batch_begin = 0; batch_begin < point3D_ids.size();
+       batch_begin += kNumPoints3DPerBatch) {
+    const size_t batch_size =
+        std::min(kNumPoints3DPerBatch, point3D_ids.size() - batch_begin);
+    track_els.resize(batch_size);
+    ParallelForChunks(thread_pool,
+                      batch_size,
+                      kNumPoints3DPerTask,
+                      [&](const size_t begin, const size_t end) {
+                        for (size_t i = begin; i < end; ++i) {
+                          FindCompletions(options,
+                                          point3D_ids[batch_begin + i],
+                                          &track_els[i]);
+                        }
+                      });
+
+    for (size_t i = 0; i < batch_size; ++i) {
+      const point3D_t point3D_id = point3D_ids[batch_begin + i];
+      const bool has_conflict = std::any_of(
+          track_els[i].begin(),
+          track_els[i].end(),
+          [this](const TrackElement& track_el) {
+            return reconstruction_.Image(track_el.image_id)
+                .Point2D(track_el.point2D_idx)
+                .HasPoint3D();
+          });
+      if (has_conflict) {
+        num_completed += Complete(options, point3D_id);
+      } else {
+        num_completed += AddCompletions(point3D_id, track_els[i]);
       }
     }
   }
@@ -761,4 +1117,22 @@ bool IncrementalTriangulator::HasCameraBogusParams(const Options& options,
   }
 }
 
+void IncrementalTriangulator::CacheCameraBogusParams(const Options& options) {
+  for (const auto& camera : reconstruction_.Cameras()) {
+    HasCameraBogusParams(options, camera.second);
+  }
+}
+
+ThreadPool* IncrementalTriangulator::GetThreadPool(const Options& options) {
+  const int num_threads = GetEffectiveNumThreads(options.num_threads);
+  if (num_threads == 1) {
+    return nullptr;
+  }
+  if (thread_pool_ == nullptr ||
+      thread_pool_->NumThreads() != static_cast<size_t>(num_threads)) {
+    thread_pool_ = std::make_unique<ThreadPool>(num_threads);
+  }
+  return thread_pool_.get();
+}
+
 }  // namespace colmap
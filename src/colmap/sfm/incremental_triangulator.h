@@ -32,6 +32,7 @@
 #include "colmap/scene/database_cache.h"
 #include "colmap/scene/reconstruction.h"
 #include "colmap/sfm/observation_manager.h"
+#include "colmap/util/threading.h"
 
 #include <memory>
 
@@ -83,6 +84,14 @@ class IncrementalTriangulator {
     double max_focal_length_ratio = 10.0;
     double max_extra_param = 1.0;
 
+    // Number of threads used for triangulation, track completion, track
+    // merging, and retriangulation. The changes are estimated in parallel
+    // without modifying the reconstruction and then applied in the original
+    // order. Note that the results depend on the number of threads, since the
+    // RANSAC estimation of new points draws from the random number generator
+    // of the thread that happens to process the observation.
+    int num_threads = -1;
+
     bool Check() const;
   };
 
@@ -160,17 +169,34 @@ class IncrementalTriangulator {
   // Clear cache of bogus camera parameters and merge trials.
   void ClearCaches();
 
-  // Find (transitive) correspondences to other images.
+  // Find (transitive) correspondences to other images. The found
+  // correspondences are extracted into the given buffer.
   size_t Find(const Options& options,
               image_t image_id,
               point2D_t point2D_idx,
               size_t transitivity,
+              std::vector<CorrespondenceGraph::Correspondence>* found_corrs,
               std::vector<CorrData>* corrs_data);
 
   // Try to create a new 3D point from the given correspondences.
   size_t Create(const Options& options,
                 const std::vector<CorrData>& corrs_data);
 
+  // Estimate a new 3D point from the correspondences without an existing
+  // triangulated observation. Does not modify the reconstruction.
+  bool EstimateNewPoint3D(const Options& options,
+                          const std::vector<CorrData>& corrs_data,
+                          std::vector<CorrData>* create_corrs_data,
+                          std::vector<char>* inlier_mask,
+                          Eigen::Vector3d* xyz) const;
+
+  // Add the new 3D point with the inlier correspondences and recursively try
+  // to create further points from the remaining outliers.
+  size_t AddNewPoint3D(const Options& options,
+                       const std::vector<CorrData>& create_corrs_data,
+                       const std::vector<char>& inlier_mask,
+                       const Eigen::Vector3d& xyz);
+
   // Try to continue the 3D point with the given correspondences.
   size_t Continue(const Options& options,
                   const CorrData& ref_corr_data,
@@ -179,12 +205,42 @@ class IncrementalTriangulator {
   // Try to merge 3D point with any of its corresponding 3D points.
   size_t Merge(const Options& options, point3D_t point3D_id);
 
+  // Check if the 3D point can be merged with any of its corresponding 3D
+  // points. Does not modify the reconstruction or the merge trials.
+  bool HasMergeCandidate(const Options& options, point3D_t point3D_id);
+
   // Try to transitively complete the track of a 3D point.
   size_t Complete(const Options& options, point3D_t point3D_id);
 
+  // Find the observations that transitively complete the track of a 3D point.
+  // Does not modify the reconstruction.
+  void FindCompletions(const Options& options,
+                       point3D_t point3D_id,
+                       std::vector<TrackElement>* track_els);
+
+  // Add the found observations to the track of a 3D point.
+  size_t AddCompletions(point3D_t point3D_id,
+                        const std::vector<TrackElement>& track_els);
+
+  // Complete or merge the tracks of the given 3D points in the given order,
+  // using multiple threads if enabled.
+  size_t ParallelCompleteTracks(const Options& options,
+                                const std::vector<point3D_t>& point3D_ids);
+  size_t ParallelMergeTracks(const Options& options,
+                             const std::vector<point3D_t>& point3D_ids);
+
   // Check if camera has bogus parameters and cache the result.
   bool HasCameraBogusParams(const Options& options, const Camera& camera);
 
+  // Cache the bogus parameters of all cameras, so that the cache is only read
+  // when the reconstruction is accessed concurrently.
+  void CacheCameraBogusParams(const Options& options);
+
+  // Get the thread pool for the configured number of threads, or null if
+  // multi-threading is disabled. The pool is reused across calls and only
+  // recreated if the number of threads changes.
+  ThreadPool* GetThreadPool(const Options& options);
+
   // Database cache for the reconstruction. Used to retrieve correspondence
   // information for triangulation.
   const std::shared_ptr<const CorrespondenceGraph> correspondence_graph_;
@@ -210,6 +266,9 @@ class IncrementalTriangulator {
   // Changed 3D points, i.e. if a 3D point is modified (created, continued,
   // deleted, merged, etc.). Cleared once `ModifiedPoints3D` is called.
   std::unordered_set<point3D_t> modified_point3D_ids_;
+
+  // Long-lived thread pool for the parallel estimation of changes.
+  std::unique_ptr<ThreadPool> thread_pool_;
 };
 
 }  // namespace colmap
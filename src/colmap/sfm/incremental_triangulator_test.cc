@@ -0,0 +1,149 @@
+// Copyright (c) 2023, ETH Zurich and UNC Chapel Hill.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of ETH Zurich and UNC Chapel Hill nor the names of
+//       its contributors may be used to endorse or promote products derived
+//       from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "colmap/sfm/incremental_triangulator.h"
+
+#include "colmap/scene/synthetic.h"
+
+#include <gtest/gtest.h>
+
+namespace colmap {
+namespace {
+
+size_t TriangulateAllImages(const IncrementalTriangulator::Options& options,
+                            const DatabaseCache& database_cache,
+                            Reconstruction& reconstruction) {
+  IncrementalTriangulator triangulator(
+      database_cache.CorrespondenceGraph(), reconstruction);
+  size_t num_tris = 0;
+  for (const image_t image_id : reconstruction.RegImageIds()) {
+    num_tris += triangulator.TriangulateImage(options, image_id);
+  }
+  return num_tris;
+}
+
+TEST(IncrementalTriangulator, TriangulateImageParallel) {
+  Database database(Database::kInMemoryDatabasePath);
+  Reconstruction gt_reconstruction;
+  SyntheticDatasetOptions synthetic_dataset_options;
+  synthetic_dataset_options.num_cameras = 2;
+  synthetic_dataset_options.num_images = 10;
+  synthetic_dataset_options.num_points3D = 200;
+  synthetic_dataset_options.point2D_stddev = 0;
+  SynthesizeDataset(synthetic_dataset_options, &gt_reconstruction, &database);
+
+  const auto database_cache = DatabaseCache::Create(
+      database, /*min_num_matches=*/0, /*ignore_watermarks=*/false, {});
+
+  // Keep the registered images and remove all triangulations.
+  Reconstruction reconstruction = gt_reconstruction;
+  for (const point3D_t point3D_id : reconstruction.Point3DIds()) {
+    reconstruction.DeletePoint3D(point3D_id);
+  }
+
+  IncrementalTriangulator::Options options;
+  options.num_threads = 1;
+  Reconstruction serial_reconstruction = reconstruction;
+  const size_t num_serial_tris =
+      TriangulateAllImages(options, *database_cache, serial_reconstruction);
+
+  options.num_threads = 4;
+  Reconstruction parallel_reconstruction = reconstruction;
+  const size_t num_parallel_tris =
+      TriangulateAllImages(options, *database_cache, parallel_reconstruction);
+
+  EXPECT_GT(num_serial_tris, 0);
+  EXPECT_EQ(num_parallel_tris, num_serial_tris);
+  EXPECT_EQ(parallel_reconstruction.NumPoints3D(),
+            serial_reconstruction.NumPoints3D());
+  EXPECT_EQ(parallel_reconstruction.ComputeNumObservations(),
+            serial_reconstruction.ComputeNumObservations());
+  for (const image_t image_id : reconstruction.RegImageIds()) {
+    EXPECT_EQ(parallel_reconstruction.Image(image_id).NumPoints3D(),
+              serial_reconstruction.Image(image_id).NumPoints3D());
+  }
+}
+
+size_t RetriangulateCompleteAndMerge(
+    const IncrementalTriangulator::Options& options,
+    const DatabaseCache& database_cache,
+    Reconstruction& reconstruction) {
+  IncrementalTriangulator triangulator(
+      database_cache.CorrespondenceGraph(), reconstruction);
+  size_t num_tris = triangulator.Retriangulate(options);
+  num_tris += triangulator.CompleteAllTracks(options);
+  num_tris += triangulator.MergeAllTracks(options);
+  return num_tris;
+}
+
+TEST(IncrementalTriangulator, RetriangulateCompleteAndMergeParallel) {
+  Database database(Database::kInMemoryDatabasePath);
+  Reconstruction gt_reconstruction;
+  SyntheticDatasetOptions synthetic_dataset_options;
+  synthetic_dataset_options.num_cameras = 2;
+  synthetic_dataset_options.num_images = 10;
+  synthetic_dataset_options.num_points3D = 200;
+  synthetic_dataset_options.point2D_stddev = 0.5;
+  SynthesizeDataset(synthetic_dataset_options, &gt_reconstruction, &database);
+
+  const auto database_cache = DatabaseCache::Create(
+      database, /*min_num_matches=*/0, /*ignore_watermarks=*/false, {});
+
+  // Keep the registered images and remove all triangulations, such that all
+  // image pairs are under-reconstructed.
+  Reconstruction reconstruction = gt_reconstruction;
+  for (const point3D_t point3D_id : reconstruction.Point3DIds()) {
+    reconstruction.DeletePoint3D(point3D_id);
+  }
+
+  IncrementalTriangulator::Options options;
+  options.num_threads = 1;
+  Reconstruction serial_reconstruction = reconstruction;
+  const size_t num_serial_tris = RetriangulateCompleteAndMerge(
+      options, *database_cache, serial_reconstruction);
+
+  options.num_threads = 4;
+  Reconstruction parallel_reconstruction = reconstruction;
+  const size_t num_parallel_tris = RetriangulateCompleteAndMerge(
+      options, *database_cache, parallel_reconstruction);
+
+  EXPECT_GT(num_serial_tris, 0);
+  EXPECT_EQ(num_parallel_tris, num_serial_tris);
+  EXPECT_EQ(parallel_reconstruction.NumPoints3D(),
+            serial_reconstruction.NumPoints3D());
+  EXPECT_EQ(parallel_reconstruction.ComputeNumObservations(),
+            serial_reconstruction.ComputeNumObservations());
+  for (const image_t image_id : reconstruction.RegImageIds()) {
+    EXPECT_EQ(parallel_reconstruction.Image(image_id).NumPoints3D(),
+              serial_reconstruction.Image(image_id).NumPoints3D());
+  }
+}
+
+}  // namespace
+}  // namespace colmap
@@ -35,6 +35,11 @@
 #include "colmap/scene/projection.h"
 #include "colmap/util/logging.h"
 #include "colmap/util/misc.h"
+#include "colmap/util/threading.h"
+#include "colmap/util/timer.h"
+
+#include <cmath>
+#include <limits>
 
 namespace colmap {
 
@@ -102,8 +107,122 @@ ObservationManager::ObservationManager(
   }
 }
 
+void ObservationManager::SetAccumulatePoseInformation(const bool accumulate) {
+  if (accumulate == accumulate_pose_information_) {
+    return;
+  }
+  accumulate_pose_information_ = accumulate;
+
+  for (auto& [image_id, stats] : image_stats_) {
+    stats.pose_information.setZero();
+    if (accumulate) {
+      stats.pose_jacobian_params.resize(
+          reconstruction_.Image(image_id).NumPoints2D(), {0, 0, 0, 0});
+    } else {
+      stats.pose_jacobian_params.clear();
+      stats.pose_jacobian_params.shrink_to_fit();
+    }
+    if (stats.num_visible_points3D > 0) {
+      SetImageChanged(image_id, stats);
+    }
+  }
+
+  if (!accumulate || correspondence_graph_ == nullptr) {
+    return;
+  }
+
+  // Add the contribution of every image point that sees a triangulated point
+  // once, as in IncrementCorrespondenceHasPoint3D. Contributions that were not
+  // added yet have a zero focal length.
+  for (const image_t image_id : reconstruction_.RegImageIds()) {
+    const Image& image = reconstruction_.Image(image_id);
+    for (point2D_t point2D_idx = 0; point2D_idx < image.NumPoints2D();
+         ++point2D_idx) {
+      const Point2D& point2D = image.Point2D(point2D_idx);
+      if (!point2D.HasPoint3D()) {
+        continue;
+      }
+      const double inv_depth = Point3DInvDepth(image, point2D);
+      const auto corr_range =
+          correspondence_graph_->FindCorrespondences(image_id, point2D_idx);
+      for (auto corr = corr_range.beg; corr < corr_range.end; ++corr) {
+        ImageStat& corr_stats = image_stats_.at(corr->image_id);
+        if (corr_stats.pose_jacobian_params[corr->point2D_idx][3] == 0) {
+          AddPoseInformation(reconstruction_.Image(corr->image_id),
+                             corr->point2D_idx,
+                             inv_depth,
+                             corr_stats);
+        }
+      }
+    }
+  }
+}
+
+double ObservationManager::PoseInformationLogDet(
+    const image_t image_id) const {
+  const Eigen::LDLT<Eigen::Matrix6d> ldlt(PoseInformation(image_id));
+  double log_det = 0;
+  for (int i = 0; i < 6; ++i) {
+    const double d = ldlt.vectorD()(i);
+    if (d <= 0) {
+      return std::numeric_limits<double>::lowest();
+    }
+    log_det += std::log(d);
+  }
+  return log_det;
+}
+
+void ObservationManager::UpdatePoseInformation(
+    const std::array<float, 4>& jacobian_params,
+    const double sign,
+    ImageStat& stats) {
+  const double x = jacobian_params[0];
+  const double y = jacobian_params[1];
+  const double inv_depth = jacobian_params[2];
+  const double focal_length = jacobian_params[3];
+
+  // Jacobian of the normalized image point w.r.t. a perturbation of the
+  // rotation and translation of the camera, scaled to pixels.
+  Eigen::Matrix<double, 2, 6> J;
+  J << x * y, -(1 + x * x), y, inv_depth, 0, -inv_depth * x,  //
+      1 + y * y, -x * y, -x, 0, inv_depth, -inv_depth * y;
+  J *= focal_length;
+
+  stats.pose_information.noalias() += sign * J.transpose() * J;
+}
+
+double ObservationManager::Point3DInvDepth(const Image& image,
+                                           const Point2D& point2D) const {
+  // The corresponding images typically observe the point from a similar
+  // distance, so its depth in this image approximates their unknown depths.
+  const double depth =
+      (image.CamFromWorld() * reconstruction_.Point3D(point2D.point3D_id).xyz)
+          .z();
+  return depth > 0 ? 1 / depth : 0;
+}
+
+void ObservationManager::AddPoseInformation(const Image& image,
+                                            const point2D_t point2D_idx,
+                                            const double point3D_inv_depth,
+                                            ImageStat& stats) {
+  // Keep the parameters of the contribution, so that it can be removed
+  // exactly even if the camera parameters are refined in the meantime.
+  const Camera& camera = reconstruction_.Camera(image.CameraId());
+  const Eigen::Vector2d cam_point =
+      camera.CamFromImg(image.Point2D(point2D_idx).xy);
+  std::array<float, 4>& jacobian_params =
+      stats.pose_jacobian_params[point2D_idx];
+  jacobian_params[0] = static_cast<float>(cam_point(0));
+  jacobian_params[1] = static_cast<float>(cam_point(1));
+  jacobian_params[2] = static_cast<float>(point3D_inv_depth);
+  jacobian_params[3] = static_cast<float>(camera.MeanFocalLength());
+  UpdatePoseInformation(jacobian_params, 1, stats);
+}
+
 void ObservationManager::IncrementCorrespondenceHasPoint3D(
-    const image_t image_id, const point2D_t point2D_idx) {
+    const image_t image_id,
+    const point2D_t point2D_idx,
+    const double point3D_inv_depth) {
   const Image& image = reconstruction_.Image(image_id);
   const struct Point2D& point2D = image.Point2D(point2D_idx);
   ImageStat& stats = image_stats_.at(image_id);
@@ -111,9 +230,13 @@ void ObservationManager::IncrementCorrespondenceHasPoint3D(
   stats.num_correspondences_have_point3D[point2D_idx] += 1;
   if (stats.num_correspondences_have_point3D[point2D_idx] == 1) {
     stats.num_visible_points3D += 1;
+    if (accumulate_pose_information_) {
+      AddPoseInformation(image, point2D_idx, point3D_inv_depth, stats);
+    }
   }
 
   stats.point3D_visibility_pyramid.SetPoint(point2D.xy(0), point2D.xy(1));
+  SetImageChanged(image_id, stats);
 
   assert(stats.num_visible_points3D <= stats.num_observations);
 }
@@ -127,13 +250,25 @@ void ObservationManager::DecrementCorrespondenceHasPoint3D(
   stats.num_correspondences_have_point3D[point2D_idx] -= 1;
   if (stats.num_correspondences_have_point3D[point2D_idx] == 0) {
     stats.num_visible_points3D -= 1;
+    if (accumulate_pose_information_) {
+      UpdatePoseInformation(
+          stats.pose_jacobian_params[point2D_idx], -1, stats);
+    }
   }
 
   stats.point3D_visibility_pyramid.ResetPoint(point2D.xy(0), point2D.xy(1));
+  SetImageChanged(image_id, stats);
 
   assert(stats.num_visible_points3D <= stats.num_observations);
 }
 
+void ObservationManager::ClearChangedImageIds() {
+  for (const image_t image_id : changed_image_ids_) {
+    image_stats_.at(image_id).changed = false;
+  }
+  changed_image_ids_.clear();
+}
+
 void ObservationManager::SetObservationAsTriangulated(
     const image_t image_id,
     const point2D_t point2D_idx,
@@ -147,12 +282,16 @@ void ObservationManager::SetObservationAsTriangulated(
   const Point2D& point2D = image.Point2D(point2D_idx);
   THROW_CHECK(point2D.HasPoint3D());
 
+  const double inv_depth =
+      accumulate_pose_information_ ? Point3DInvDepth(image, point2D) : 0;
+
   const auto corr_range =
       correspondence_graph_->FindCorrespondences(image_id, point2D_idx);
-  for (const auto* corr = corr_range.beg; corr < corr_range.end; ++corr) {
-    Image& corr_image = reconstruction_.Image(corr->image_id);
+  for (auto corr = corr_range.beg; corr < corr_range.end; ++corr) {
+    const Image& corr_image = reconstruction_.Image(corr->image_id);
     const Point2D& corr_point2D = corr_image.Point2D(corr->point2D_idx);
-    IncrementCorrespondenceHasPoint3D(corr->image_id, corr->point2D_idx);
+    IncrementCorrespondenceHasPoint3D(
+        corr->image_id, corr->point2D_idx, inv_depth);
     // Update number of shared 3D points between image pairs and make sure to
     // only count the correspondences once (not twice forward and backward).
     if (point2D.point3D_id == corr_point2D.point3D_id &&
@@ -181,8 +320,8 @@ void ObservationManager::ResetTriObservations(const image_t image_id,
 
   const auto corr_range =
       correspondence_graph_->FindCorrespondences(image_id, point2D_idx);
-  for (const auto* corr = corr_range.beg; corr < corr_range.end; ++corr) {
-    Image& corr_image = reconstruction_.Image(corr->image_id);
+  for (auto corr = corr_range.beg; corr < corr_range.end; ++corr) {
+    const Image& corr_image = reconstruction_.Image(corr->image_id);
     const Point2D& corr_point2D = corr_image.Point2D(corr->point2D_idx);
     DecrementCorrespondenceHasPoint3D(corr->image_id, corr->point2D_idx);
     // Update number of shared 3D points between image pairs and make sure to
@@ -280,19 +419,21 @@ point3D_t ObservationManager::MergePoints3D(const point3D_t point3D_id1,
 size_t ObservationManager::FilterPoints3D(
     const double max_reproj_error,
     const double min_tri_angle,
-    const std::unordered_set<point3D_t>& point3D_ids) {
+    const std::unordered_set<point3D_t>& point3D_ids,
+    const int num_threads) {
   size_t num_filtered = 0;
-  num_filtered +=
-      FilterPoints3DWithLargeReprojectionError(max_reproj_error, point3D_ids);
-  num_filtered +=
-      FilterPoints3DWithSmallTriangulationAngle(min_tri_angle, point3D_ids);
+  num_filtered += FilterPoints3DWithLargeReprojectionError(
+      max_reproj_error, point3D_ids, num_threads);
+  num_filtered += FilterPoints3DWithSmallTriangulationAngle(
+      min_tri_angle, point3D_ids, num_threads);
   return num_filtered;
 }
 
 size_t ObservationManager::FilterPoints3DInImages(
     const double max_reproj_error,
     const double min_tri_angle,
-    const std::unordered_set<image_t>& image_ids) {
+    const std::unordered_set<image_t>& image_ids,
+    const int num_threads) {
   std::unordered_set<point3D_t> point3D_ids;
   for (const image_t image_id : image_ids) {
     const Image& image = reconstruction_.Image(image_id);
@@ -302,157 +443,243 @@ size_t ObservationManager::FilterPoints3DInImages(
       }
     }
   }
-  return FilterPoints3D(max_reproj_error, min_tri_angle, point3D_ids);
+  return FilterPoints3D(
+      max_reproj_error, min_tri_angle, point3D_ids, num_threads);
 }
 
 size_t ObservationManager::FilterAllPoints3D(const double max_reproj_error,
-                                             const double min_tri_angle) {
+                                             const double min_tri_angle,
+                                             const int num_threads) {
   // Important: First filter observations and points with large reprojection
   // error, so that observations with large reprojection error do not make
   // a point stable through a large triangulation angle.
   const std::unordered_set<point3D_t>& point3D_ids =
       reconstruction_.Point3DIds();
   size_t num_filtered = 0;
-  num_filtered +=
-      FilterPoints3DWithLargeReprojectionError(max_reproj_error, point3D_ids);
-  num_filtered +=
-      FilterPoints3DWithSmallTriangulationAngle(min_tri_angle, point3D_ids);
+  num_filtered += FilterPoints3DWithLargeReprojectionError(
+      max_reproj_error, point3D_ids, num_threads);
+  num_filtered += FilterPoints3DWithSmallTriangulationAngle(
+      min_tri_angle, point3D_ids, num_threads);
   return num_filtered;
 }
 
-size_t ObservationManager::FilterObservationsWithNegativeDepth() {
-  size_t num_filtered = 0;
-  for (const auto image_id : reconstruction_.RegImageIds()) {
-    const Image& image = reconstruction_.Image(image_id);
-    const Eigen::Matrix3x4d cam_from_world = image.CamFromWorld().ToMatrix();
-    for (point2D_t point2D_idx = 0; point2D_idx < image.NumPoints2D();
-         ++point2D_idx) {
-      const Point2D& point2D = image.Point2D(point2D_idx);
-      if (point2D.HasPoint3D()) {
-        const struct Point3D& point3D =
-            reconstruction_.Point3D(point2D.point3D_id);
-        if (!HasPointPositiveDepth(cam_from_world, point3D.xyz)) {
-          DeleteObservation(image_id, point2D_idx);
-          num_filtered += 1;
+size_t ObservationManager::FilterObservationsWithNegativeDepth(
+    const int num_threads) {
+  Timer timer;
+  timer.Start();
+
+  // The reconstruction is only read while evaluating the filter criteria.
+  const Reconstruction& reconstruction = reconstruction_;
+  const std::vector<image_t>& reg_image_ids = reconstruction.RegImageIds();
+
+  // Determine the observations with negative depth in parallel.
+  std::vector<std::vector<point2D_t>> filtered_point2D_idxs(
+      reg_image_ids.size());
+  const size_t kNumImagesPerTask = 4;
+  ParallelForChunks(
+      num_threads,
+      reg_image_ids.size(),
+      kNumImagesPerTask,
+      [&](const size_t begin_idx, const size_t end_idx) {
+        for (size_t i = begin_idx; i < end_idx; ++i) {
+          const Image& image = reconstruction.Image(reg_image_ids[i]);
+          const Eigen::Matrix3x4d cam_from_world =
+              image.CamFromWorld().ToMatrix();
+          for (point2D_t point2D_idx = 0; point2D_idx < image.NumPoints2D();
+               ++point2D_idx) {
+            const Point2D& point2D = image.Point2D(point2D_idx);
+            if (point2D.HasPoint3D() &&
+                !HasPointPositiveDepth(
+                    cam_from_world,
+                    reconstruction.Point3D(point2D.point3D_id).xyz)) {
+              filtered_point2D_idxs[i].push_back(point2D_idx);
+            }
+          }
         }
+      });
+
+  // Deleting an observation can delete the entire 3D point and thereby the
+  // observations in other images, which must then not be deleted again.
+  size_t num_filtered = 0;
+  for (size_t i = 0; i < reg_image_ids.size(); ++i) {
+    const image_t image_id = reg_image_ids[i];
+    for (const point2D_t point2D_idx : filtered_point2D_idxs[i]) {
+      if (reconstruction_.Image(image_id).Point2D(point2D_idx).HasPoint3D()) {
+        DeleteObservation(image_id, point2D_idx);
+        num_filtered += 1;
       }
     }
   }
+
+  filter_times_.negative_depth += timer.ElapsedSeconds();
+
   return num_filtered;
 }
 
 size_t ObservationManager::FilterPoints3DWithSmallTriangulationAngle(
     const double min_tri_angle,
-    const std::unordered_set<point3D_t>& point3D_ids) {
-  // Number of filtered points.
-  size_t num_filtered = 0;
+    const std::unordered_set<point3D_t>& point3D_ids,
+    const int num_threads) {
+  Timer timer;
+  timer.Start();
+
+  // The reconstruction is only read while evaluating the filter criteria.
+  const Reconstruction& reconstruction = reconstruction_;
 
   // Minimum triangulation angle in radians.
   const double min_tri_angle_rad = DegToRad(min_tri_angle);
 
+  const std::vector<point3D_t> filter_point3D_ids(point3D_ids.begin(),
+                                                  point3D_ids.end());
+
   // Cache for image projection centers.
   std::unordered_map<image_t, Eigen::Vector3d> proj_centers;
+  proj_centers.reserve(reconstruction.NumImages());
+  for (const auto& image : reconstruction.Images()) {
+    proj_centers.emplace(image.first, image.second.ProjectionCenter());
+  }
 
-  for (const auto point3D_id : point3D_ids) {
-    if (!reconstruction_.ExistsPoint3D(point3D_id)) {
-      continue;
-    }
-
-    const struct Point3D& point3D = reconstruction_.Point3D(point3D_id);
-
-    // Calculate triangulation angle for all pairwise combinations of image
-    // poses in the track. Only delete point if none of the combinations
-    // has a sufficient triangulation angle.
-    bool keep_point = false;
-    for (size_t i1 = 0; i1 < point3D.track.Length(); ++i1) {
-      const image_t image_id1 = point3D.track.Element(i1).image_id;
-
-      Eigen::Vector3d proj_center1;
-      if (proj_centers.count(image_id1) == 0) {
-        const Image& image1 = reconstruction_.Image(image_id1);
-        proj_center1 = image1.ProjectionCenter();
-        proj_centers.emplace(image_id1, proj_center1);
-      } else {
-        proj_center1 = proj_centers.at(image_id1);
-      }
-
-      for (size_t i2 = 0; i2 < i1; ++i2) {
-        const image_t image_id2 = point3D.track.Element(i2).image_id;
-        const Eigen::Vector3d proj_center2 = proj_centers.at(image_id2);
-
-        const double tri_angle = CalculateTriangulationAngle(
-            proj_center1, proj_center2, point3D.xyz);
-
-        if (tri_angle >= min_tri_angle_rad) {
-          keep_point = true;
-          break;
+  // Determine the points to delete in parallel.
+  std::vector<char> delete_points(filter_point3D_ids.size(), false);
+  const size_t kNumPoints3DPerTask = 256;
+  ParallelForChunks(
+      num_threads,
+      filter_point3D_ids.size(),
+      kNumPoints3DPerTask,
+      [&](const size_t begin_idx, const size_t end_idx) {
+        for (size_t i = begin_idx; i < end_idx; ++i) {
+          const point3D_t point3D_id = filter_point3D_ids[i];
+          if (!reconstruction.ExistsPoint3D(point3D_id)) {
+            continue;
+          }
+
+          const struct Point3D& point3D = reconstruction.Point3D(point3D_id);
+
+          // Calculate triangulation angle for all pairwise combinations of
+          // image poses in the track. Only delete point if none of the
+          // combinations has a sufficient triangulation angle.
+          bool keep_point = false;
+          for (size_t i1 = 0; i1 < point3D.track.Length() && !keep_point;
+               ++i1) {
+            const Eigen::Vector3d& proj_center1 =
+                proj_centers.at(point3D.track.Element(i1).image_id);
+            for (size_t i2 = 0; i2 < i1; ++i2) {
+              const Eigen::Vector3d& proj_center2 =
+                  proj_centers.at(point3D.track.Element(i2).image_id);
+              const double tri_angle = CalculateTriangulationAngle(
+                  proj_center1, proj_center2, point3D.xyz);
+              if (tri_angle >= min_tri_angle_rad) {
+                keep_point = true;
+                break;
+              }
+            }
+          }
+
+          delete_points[i] = !keep_point;
         }
-      }
-
-      if (keep_point) {
-        break;
-      }
-    }
+      });
 
-    if (!keep_point) {
+  // Number of filtered points.
+  size_t num_filtered = 0;
+  for (size_t i = 0; i < filter_point3D_ids.size(); ++i) {
+    if (delete_points[i]) {
       num_filtered += 1;
-      DeletePoint3D(point3D_id);
+      DeletePoint3D(filter_point3D_ids[i]);
     }
   }
 
+  filter_times_.small_tri_angle += timer.ElapsedSeconds();
+
   return num_filtered;
 }
 
 size_t ObservationManager::FilterPoints3DWithLargeReprojectionError(
     const double max_reproj_error,
-    const std::unordered_set<point3D_t>& point3D_ids) {
+    const std::unordered_set<point3D_t>& point3D_ids,
+    const int num_threads) {
+  Timer timer;
+  timer.Start();
+
+  // The reconstruction is only read while evaluating the filter criteria.
+  const Reconstruction& reconstruction = reconstruction_;
+
   const double max_squared_reproj_error = max_reproj_error * max_reproj_error;
 
+  struct FilterResult {
+    bool exists = false;
+    double reproj_error_sum = 0.0;
+    std::vector<TrackElement> track_els_to_delete;
+  };
+
+  const std::vector<point3D_t> filter_point3D_ids(point3D_ids.begin(),
+                                                  point3D_ids.end());
+
+  // Determine the observations to delete in parallel.
+  std::vector<FilterResult> results(filter_point3D_ids.size());
+  const size_t kNumPoints3DPerTask = 256;
+  ParallelForChunks(
+      num_threads,
+      filter_point3D_ids.size(),
+      kNumPoints3DPerTask,
+      [&](const size_t begin_idx, const size_t end_idx) {
+        for (size_t i = begin_idx; i < end_idx; ++i) {
+          const point3D_t point3D_id = filter_point3D_ids[i];
+          if (!reconstruction.ExistsPoint3D(point3D_id)) {
+            continue;
+          }
+
+          FilterResult& result = results[i];
+          result.exists = true;
+
+          const struct Point3D& point3D = reconstruction.Point3D(point3D_id);
+          if (point3D.track.Length() < 2) {
+            continue;
+          }
+
+          for (const auto& track_el : point3D.track.Elements()) {
+            const Image& image = reconstruction.Image(track_el.image_id);
+            const struct Camera& camera =
+                reconstruction.Camera(image.CameraId());
+            const Point2D& point2D = image.Point2D(track_el.point2D_idx);
+            const double squared_reproj_error =
+                CalculateSquaredReprojectionError(
+                    point2D.xy, point3D.xyz, image.CamFromWorld(), camera);
+            if (squared_reproj_error > max_squared_reproj_error) {
+              result.track_els_to_delete.push_back(track_el);
+            } else {
+              result.reproj_error_sum += std::sqrt(squared_reproj_error);
+            }
+          }
+        }
+      });
+
   // Number of filtered points.
   size_t num_filtered = 0;
 
-  for (const auto point3D_id : point3D_ids) {
-    if (!reconstruction_.ExistsPoint3D(point3D_id)) {
+  for (size_t i = 0; i < filter_point3D_ids.size(); ++i) {
+    const FilterResult& result = results[i];
+    if (!result.exists) {
       continue;
     }
 
+    const point3D_t point3D_id = filter_point3D_ids[i];
     struct Point3D& point3D = reconstruction_.Point3D(point3D_id);
 
-    if (point3D.track.Length() < 2) {
-      num_filtered += point3D.track.Length();
-      DeletePoint3D(point3D_id);
-      continue;
-    }
-
-    double reproj_error_sum = 0.0;
-
-    std::vector<TrackElement> track_els_to_delete;
-
-    for (const auto& track_el : point3D.track.Elements()) {
-      const Image& image = reconstruction_.Image(track_el.image_id);
-      const struct Camera& camera = reconstruction_.Camera(image.CameraId());
-      const Point2D& point2D = image.Point2D(track_el.point2D_idx);
-      const double squared_reproj_error = CalculateSquaredReprojectionError(
-          point2D.xy, point3D.xyz, image.CamFromWorld(), camera);
-      if (squared_reproj_error > max_squared_reproj_error) {
-        track_els_to_delete.push_back(track_el);
-      } else {
-        reproj_error_sum += std::sqrt(squared_reproj_error);
-      }
-    }
-
-    if (track_els_to_delete.size() >= point3D.track.Length() - 1) {
+    if (point3D.track.Length() < 2 ||
+        result.track_els_to_delete.size() >= point3D.track.Length() - 1) {
       num_filtered += point3D.track.Length();
       DeletePoint3D(point3D_id);
     } else {
-      num_filtered += track_els_to_delete.size();
-      for (const auto& track_el : track_els_to_delete) {
+      num_filtered += result.track_els_to_delete.size();
+      for (const auto& track_el : result.track_els_to_delete) {
         DeleteObservation(track_el.image_id, track_el.point2D_idx);
       }
-      point3D.error = reproj_error_sum / point3D.track.Length();
+      point3D.error = result.reproj_error_sum / point3D.track.Length();
     }
   }
 
+  filter_times_.large_reproj_error += timer.ElapsedSeconds();
+
   return num_filtered;
 }
 
@@ -470,15 +697,37 @@ void ObservationManager::DeRegisterImage(const image_t image_id) {
 std::vector<image_t> ObservationManager::FilterImages(
     const double min_focal_length_ratio,
     const double max_focal_length_ratio,
-    const double max_extra_param) {
+    const double max_extra_param,
+    const int num_threads) {
+  Timer timer;
+  timer.Start();
+
+  // The reconstruction is only read while evaluating the filter criteria.
+  const Reconstruction& reconstruction = reconstruction_;
+  const std::vector<image_t>& reg_image_ids = reconstruction.RegImageIds();
+
+  std::vector<char> filter_images(reg_image_ids.size(), false);
+  const size_t kNumImagesPerTask = 64;
+  ParallelForChunks(
+      num_threads,
+      reg_image_ids.size(),
+      kNumImagesPerTask,
+      [&](const size_t begin_idx, const size_t end_idx) {
+        for (size_t i = begin_idx; i < end_idx; ++i) {
+          const Image& image = reconstruction.Image(reg_image_ids[i]);
+          filter_images[i] =
+              image.NumPoints3D() == 0 ||
+              reconstruction.Camera(image.CameraId())
+                  .HasBogusParams(min_focal_length_ratio,
+                                  max_focal_length_ratio,
+                                  max_extra_param);
+        }
+      });
+
   std::vector<image_t> filtered_image_ids;
-  for (const image_t image_id : reconstruction_.RegImageIds()) {
-    const Image& image = reconstruction_.Image(image_id);
-    if (image.NumPoints3D() == 0 || reconstruction_.Camera(image.CameraId())
-                                        .HasBogusParams(min_focal_length_ratio,
-                                                        max_focal_length_ratio,
-                                                        max_extra_param)) {
-      filtered_image_ids.push_back(image_id);
+  for (size_t i = 0; i < reg_image_ids.size(); ++i) {
+    if (filter_images[i]) {
+      filtered_image_ids.push_back(reg_image_ids[i]);
     }
   }
 
@@ -488,7 +737,11 @@ std::vector<image_t> ObservationManager::FilterImages(
     DeRegisterImage(image_id);
   }
 
+  filter_times_.images += timer.ElapsedSeconds();
+
   return filtered_image_ids;
 }
 
+void ObservationManager::ResetFilterTimes() { filter_times_ = {}; }
+
 }  // namespace colmap
@@ -35,6 +35,8 @@
 #include "colmap/scene/track.h"
 #include "colmap/util/types.h"
 
+#include <array>
+
 namespace colmap {
 
 bool MergeAndFilterReconstructions(double max_reproj_error,
@@ -50,6 +52,14 @@ class ObservationManager {
     size_t num_total_corrs = 0;
   };
 
+  // The accumulated time in seconds spent in the filters.
+  struct FilterTimes {
+    double large_reproj_error = 0.0;
+    double small_tri_angle = 0.0;
+    double negative_depth = 0.0;
+    double images = 0.0;
+  };
+
   explicit ObservationManager(Reconstruction& reconstruction,
                               std::shared_ptr<const CorrespondenceGraph>
                                   correspondence_graph = nullptr);
@@ -77,38 +87,57 @@ class ObservationManager {
   point3D_t MergePoints3D(point3D_t point3D_id1, point3D_t point3D_id2);
 
   // Filter 3D points with large reprojection error, negative depth, or
-  // insufficient triangulation angle.
+  // insufficient triangulation angle. The filter criteria are evaluated in
+  // parallel, while the filtered points and observations are deleted serially
+  // afterwards, so that the result is independent of the number of threads.
   //
   // @param max_reproj_error    The maximum reprojection error.
   // @param min_tri_angle       The minimum triangulation angle.
   // @param point3D_ids         The points to be filtered.
+  // @param num_threads         The number of threads, where -1 uses all
+  //                            available cores. Filters in the calling
+  //                            thread by default.
   //
   // @return                    The number of filtered observations.
   size_t FilterPoints3D(double max_reproj_error,
                         double min_tri_angle,
-                        const std::unordered_set<point3D_t>& point3D_ids);
+                        const std::unordered_set<point3D_t>& point3D_ids,
+                        int num_threads = 1);
   size_t FilterPoints3DInImages(double max_reproj_error,
                                 double min_tri_angle,
-                                const std::unordered_set<image_t>& image_ids);
-  size_t FilterAllPoints3D(double max_reproj_error, double min_tri_angle);
-
-  // Filter observations that have negative depth.
+                                const std::unordered_set<image_t>& image_ids,
+                                int num_threads = 1);
+  size_t FilterAllPoints3D(double max_reproj_error,
+                           double min_tri_angle,
+                           int num_threads = 1);
+
+  // Filter observations that have negative depth. The number of threads is
+  // used as in FilterPoints3D by this and the following filters.
   //
   // @return    The number of filtered observations.
-  size_t FilterObservationsWithNegativeDepth();
+  size_t FilterObservationsWithNegativeDepth(int num_threads = 1);
 
   size_t FilterPoints3DWithSmallTriangulationAngle(
-      double min_tri_angle, const std::unordered_set<point3D_t>& point3D_ids);
+      double min_tri_angle,
+      const std::unordered_set<point3D_t>& point3D_ids,
+      int num_threads = 1);
   size_t FilterPoints3DWithLargeReprojectionError(
       double max_reproj_error,
-      const std::unordered_set<point3D_t>& point3D_ids);
+      const std::unordered_set<point3D_t>& point3D_ids,
+      int num_threads = 1);
 
   // Filter images without observations or bogus camera parameters.
   //
   // @return    The identifiers of the filtered images.
   std::vector<image_t> FilterImages(double min_focal_length_ratio,
                                     double max_focal_length_ratio,
-                                    double max_extra_param);
+                                    double max_extra_param,
+                                    int num_threads = 1);
+
+  // Get the time spent in the filters since the construction or the last call
+  // to `ResetFilterTimes`.
+  inline const struct FilterTimes& FilterTimes() const;
+  void ResetFilterTimes();
 
   // De-register an existing image, and all its references.
   void DeRegisterImage(image_t image_id);
@@ -135,10 +164,32 @@ class ObservationManager {
   // The number of levels in the 3D point multi-resolution visibility pyramid.
   static const int kNumPoint3DVisibilityPyramidLevels;
 
+  // Enable or disable the accumulation of the pose information. It is
+  // disabled by default, since it adds a cost to every change of the visible
+  // points. Enabling it computes the information from the current state.
+  void SetAccumulatePoseInformation(bool accumulate);
+  inline bool AccumulatePoseInformation() const;
+
+  // Get the Fisher information of the pose of the image (in the order of
+  // rotation and translation) from its observations that see a triangulated
+  // point, assuming unit reprojection noise in pixels. The information is
+  // accumulated incrementally and thus cheap to query for unregistered images,
+  // e.g., to estimate the uncertainty of their pose before registration.
+  // Zero unless the accumulation is enabled.
+  inline const Eigen::Matrix6d& PoseInformation(image_t image_id) const;
+
+  // Get the log-determinant of the pose information, i.e. the negative
+  // log-determinant of the pose covariance. Larger values correspond to less
+  // uncertain poses. Returns the lowest double if the information is singular.
+  double PoseInformationLogDet(image_t image_id) const;
+
   // Indicate that another image has a point that is triangulated and has
-  // a correspondence to this image point.
+  // a correspondence to this image point. The inverse depth of the point in
+  // the other image approximates its unknown inverse depth in this image for
+  // the pose information and is only used by the first such correspondence.
   void IncrementCorrespondenceHasPoint3D(image_t image_id,
-                                         point2D_t point2D_idx);
+                                         point2D_t point2D_idx,
+                                         double point3D_inv_depth = 1.0);
 
   // Indicate that another image has a point that is not triangulated any more
   // and has a correspondence to this image point. This assumes that
@@ -147,6 +198,13 @@ class ObservationManager {
   void DecrementCorrespondenceHasPoint3D(image_t image_id,
                                          point2D_t point2D_idx);
 
+  // Get the images whose number of visible 3D points or 3D point visibility
+  // score changed since the last call to `ClearChangedImageIds`. This allows
+  // to incrementally maintain rankings of the images, e.g., for the selection
+  // of the next image in incremental reconstruction.
+  inline const std::vector<image_t>& ChangedImageIds() const;
+  void ClearChangedImageIds();
+
  private:
   void SetObservationAsTriangulated(image_t image_id,
                                     point2D_t point2D_idx,
@@ -174,12 +232,42 @@ class ObservationManager {
     // Data structure to compute the distribution of triangulated
     // correspondences in the image.
     VisibilityPyramid point3D_visibility_pyramid;
+
+    // The accumulated pose information and, per image point, the normalized
+    // image coordinates, inverse depth, and focal length its contribution was
+    // computed with. Empty if the accumulation is disabled.
+    Eigen::Matrix6d pose_information = Eigen::Matrix6d::Zero();
+    std::vector<std::array<float, 4>> pose_jacobian_params;
+
+    // Whether the image is contained in `changed_image_ids_`.
+    bool changed = false;
   };
 
+  // Record that the statistics of the image changed.
+  inline void SetImageChanged(image_t image_id, ImageStat& stats);
+
+  // Inverse depth of the triangulated point of the image point.
+  double Point3DInvDepth(const Image& image, const Point2D& point2D) const;
+
+  // Add the contribution of an image point to the pose information.
+  void AddPoseInformation(const Image& image,
+                          point2D_t point2D_idx,
+                          double point3D_inv_depth,
+                          ImageStat& stats);
+
+  // Add or remove the contribution of an image point to the pose information.
+  static void UpdatePoseInformation(
+      const std::array<float, 4>& jacobian_params,
+      double sign,
+      ImageStat& stats);
+
   Reconstruction& reconstruction_;
   const std::shared_ptr<const CorrespondenceGraph> correspondence_graph_;
   std::unordered_map<image_pair_t, ImagePairStat> image_pair_stats_;
   std::unordered_map<image_t, ImageStat> image_stats_;
+  std::vector<image_t> changed_image_ids_;
+  bool accumulate_pose_information_ = false;
+  struct FilterTimes filter_times_;
 };
 
 const std::unordered_map<image_pair_t, ObservationManager::ImagePairStat>&
@@ -204,4 +292,30 @@ size_t ObservationManager::Point3DVisibilityScore(
   return image_stats_.at(image_id).point3D_visibility_pyramid.Score();
 }
 
+bool ObservationManager::AccumulatePoseInformation() const {
+  return accumulate_pose_information_;
+}
+
+const Eigen::Matrix6d& ObservationManager::PoseInformation(
+    const image_t image_id) const {
+  return image_stats_.at(image_id).pose_information;
+}
+
+const struct ObservationManager::FilterTimes& ObservationManager::FilterTimes()
+    const {
+  return filter_times_;
+}
+
+const std::vector<image_t>& ObservationManager::ChangedImageIds() const {
+  return changed_image_ids_;
+}
+
+void ObservationManager::SetImageChanged(const image_t image_id,
+                                         ImageStat& stats) {
+  if (!stats.changed) {
+    stats.changed = true;
+    changed_image_ids_.push_back(image_id);
+  }
+}
+
 }  // namespace colmap
@@ -29,6 +29,8 @@
 
 #include "colmap/sfm/observation_manager.h"
 
+#include "colmap/scene/synthetic.h"
+
 #include <memory>
 
 #include <gtest/gtest.h>
@@ -205,6 +207,87 @@ TEST(ObservationManager, FilterImages) {
   EXPECT_EQ(reconstruction.NumRegImages(), 0);
 }
 
+TEST(ObservationManager, ParallelFilters) {
+  SyntheticDatasetOptions synthetic_dataset_options;
+  synthetic_dataset_options.num_images = 20;
+  synthetic_dataset_options.num_points3D = 2000;
+  synthetic_dataset_options.point2D_stddev = 1.0;
+  Reconstruction reconstruction;
+  SynthesizeDataset(synthetic_dataset_options, &reconstruction);
+  // Move some of the points behind the cameras.
+  for (const point3D_t point3D_id : reconstruction.Point3DIds()) {
+    if (point3D_id % 10 == 0) {
+      reconstruction.Point3D(point3D_id).xyz *= -1;
+    }
+  }
+
+  Reconstruction parallel_reconstruction = reconstruction;
+  ObservationManager obs_manager(reconstruction);
+  ObservationManager parallel_obs_manager(parallel_reconstruction);
+  const auto expect_equal_reconstructions = [&]() {
+    EXPECT_EQ(reconstruction.Point3DIds(),
+              parallel_reconstruction.Point3DIds());
+    EXPECT_EQ(reconstruction.RegImageIds(),
+              parallel_reconstruction.RegImageIds());
+    for (const auto& point3D : reconstruction.Points3D()) {
+      const Point3D& parallel_point3D =
+          parallel_reconstruction.Point3D(point3D.first);
+      ASSERT_EQ(point3D.second.track.Length(),
+                parallel_point3D.track.Length());
+      for (size_t i = 0; i < point3D.second.track.Length(); ++i) {
+        EXPECT_EQ(point3D.second.track.Element(i).image_id,
+                  parallel_point3D.track.Element(i).image_id);
+        EXPECT_EQ(point3D.second.track.Element(i).point2D_idx,
+                  parallel_point3D.track.Element(i).point2D_idx);
+      }
+      EXPECT_EQ(point3D.second.error, parallel_point3D.error);
+    }
+  };
+
+  EXPECT_EQ(obs_manager.FilterObservationsWithNegativeDepth(),
+            parallel_obs_manager.FilterObservationsWithNegativeDepth(
+                /*num_threads=*/4));
+  expect_equal_reconstructions();
+  EXPECT_EQ(obs_manager.FilterAllPoints3D(
+                /*max_reproj_error=*/1.5, /*min_tri_angle=*/1.5),
+            parallel_obs_manager.FilterAllPoints3D(
+                /*max_reproj_error=*/1.5,
+                /*min_tri_angle=*/1.5,
+                /*num_threads=*/4));
+  expect_equal_reconstructions();
+  EXPECT_EQ(obs_manager.FilterImages(0.1, 10.0, 1.0),
+            parallel_obs_manager.FilterImages(
+                0.1, 10.0, 1.0, /*num_threads=*/4));
+  expect_equal_reconstructions();
+  EXPECT_LT(reconstruction.NumPoints3D(),
+            synthetic_dataset_options.num_points3D);
+  EXPECT_GT(reconstruction.NumPoints3D(), 0);
+}
+
+TEST(ObservationManager, FilterTimes) {
+  SyntheticDatasetOptions synthetic_dataset_options;
+  synthetic_dataset_options.num_points3D = 1000;
+  Reconstruction reconstruction;
+  SynthesizeDataset(synthetic_dataset_options, &reconstruction);
+  ObservationManager obs_manager(reconstruction);
+  EXPECT_EQ(obs_manager.FilterTimes().large_reproj_error, 0);
+  EXPECT_EQ(obs_manager.FilterTimes().small_tri_angle, 0);
+  EXPECT_EQ(obs_manager.FilterTimes().negative_depth, 0);
+  EXPECT_EQ(obs_manager.FilterTimes().images, 0);
+  obs_manager.FilterObservationsWithNegativeDepth();
+  obs_manager.FilterAllPoints3D(1.0, 1.0);
+  obs_manager.FilterImages(0.1, 10.0, 1.0);
+  EXPECT_GT(obs_manager.FilterTimes().large_reproj_error, 0);
+  EXPECT_GT(obs_manager.FilterTimes().small_tri_angle, 0);
+  EXPECT_GT(obs_manager.FilterTimes().negative_depth, 0);
+  EXPECT_GE(obs_manager.FilterTimes().images, 0);
+  obs_manager.ResetFilterTimes();
+  EXPECT_EQ(obs_manager.FilterTimes().large_reproj_error, 0);
+  EXPECT_EQ(obs_manager.FilterTimes().small_tri_angle, 0);
+  EXPECT_EQ(obs_manager.FilterTimes().negative_depth, 0);
+  EXPECT_EQ(obs_manager.FilterTimes().images, 0);
+}
+
 TEST(ObservationManager, NumVisiblePoints3D) {
   Reconstruction reconstruction;
   const image_t kImageId1 = 1;
@@ -251,6 +334,48 @@ TEST(ObservationManager, NumVisiblePoints3D) {
   EXPECT_EQ(obs_manager.NumVisiblePoints3D(kImageId1), 0);
 }
 
+TEST(ObservationManager, ChangedImageIds) {
+  Reconstruction reconstruction;
+  const image_t kImageId1 = 1;
+  const image_t kImageId2 = 2;
+  const camera_t kCameraId = 1;
+  const Camera camera = Camera::CreateFromModelId(kCameraId,
+                                                  CameraModelId::kPinhole,
+                                                  /*focal_length=*/10,
+                                                  /*width=*/10,
+                                                  /*height=*/10);
+  reconstruction.AddCamera(camera);
+  Image image;
+  image.SetImageId(kImageId1);
+  image.SetCameraId(kCameraId);
+  image.SetPoints2D(std::vector<Eigen::Vector2d>(10));
+  reconstruction.AddImage(image);
+  image.SetImageId(kImageId2);
+  reconstruction.AddImage(image);
+  auto correspondence_graph = std::make_shared<CorrespondenceGraph>();
+  correspondence_graph->AddImage(kImageId1, 10);
+  correspondence_graph->AddImage(kImageId2, 10);
+  FeatureMatches matches;
+  for (size_t i = 0; i < 10; ++i) {
+    matches.emplace_back(i, i);
+  }
+  correspondence_graph->AddCorrespondences(kImageId1, kImageId2, matches);
+  correspondence_graph->Finalize();
+  ObservationManager obs_manager(reconstruction, correspondence_graph);
+
+  EXPECT_TRUE(obs_manager.ChangedImageIds().empty());
+  obs_manager.IncrementCorrespondenceHasPoint3D(kImageId1, 0);
+  obs_manager.IncrementCorrespondenceHasPoint3D(kImageId1, 1);
+  EXPECT_EQ(obs_manager.ChangedImageIds(), std::vector<image_t>{kImageId1});
+  obs_manager.IncrementCorrespondenceHasPoint3D(kImageId2, 0);
+  EXPECT_EQ(obs_manager.ChangedImageIds(),
+            std::vector<image_t>({kImageId1, kImageId2}));
+  obs_manager.ClearChangedImageIds();
+  EXPECT_TRUE(obs_manager.ChangedImageIds().empty());
+  obs_manager.DecrementCorrespondenceHasPoint3D(kImageId1, 0);
+  EXPECT_EQ(obs_manager.ChangedImageIds(), std::vector<image_t>{kImageId1});
+}
+
 TEST(ObservationManager, Point3DVisibilityScore) {
   Reconstruction reconstruction;
   const image_t kImageId1 = 1;
@@ -324,5 +449,161 @@ TEST(ObservationManager, Point3DVisibilityScore) {
             2 * scores.sum() + 2 * scores.bottomRows(scores.size() - 1).sum());
 }
 
+TEST(ObservationManager, PoseInformation) {
+  Reconstruction reconstruction;
+  const image_t kImageId1 = 1;
+  const image_t kImageId2 = 2;
+  const camera_t kCameraId = 1;
+  const Camera camera = Camera::CreateFromModelId(kCameraId,
+                                                  CameraModelId::kPinhole,
+                                                  /*focal_length=*/10,
+                                                  /*width=*/10,
+                                                  /*height=*/10);
+  reconstruction.AddCamera(camera);
+  Image image;
+  image.SetImageId(kImageId1);
+  image.SetCameraId(kCameraId);
+  std::vector<Eigen::Vector2d> points2D;
+  for (size_t i = 0; i < 3; ++i) {
+    for (size_t j = 0; j < 3; ++j) {
+      points2D.emplace_back(1 + 4 * i, 1 + 4 * j);
+    }
+  }
+  image.SetPoints2D(points2D);
+  reconstruction.AddImage(image);
+  image.SetImageId(kImageId2);
+  reconstruction.AddImage(image);
+  auto correspondence_graph = std::make_shared<CorrespondenceGraph>();
+  correspondence_graph->AddImage(kImageId1, points2D.size());
+  correspondence_graph->AddImage(kImageId2, points2D.size());
+  FeatureMatches matches;
+  for (size_t i = 0; i < points2D.size(); ++i) {
+    matches.emplace_back(i, i);
+  }
+  correspondence_graph->AddCorrespondences(kImageId1, kImageId2, matches);
+  correspondence_graph->Finalize();
+  ObservationManager obs_manager(reconstruction, correspondence_graph);
+  obs_manager.SetAccumulatePoseInformation(true);
+
+  EXPECT_EQ(obs_manager.PoseInformation(kImageId1), Eigen::Matrix6d::Zero());
+  EXPECT_EQ(obs_manager.PoseInformationLogDet(kImageId1),
+            std::numeric_limits<double>::lowest());
+
+  // Information of a single observation.
+  const double kInvDepth = 0.5;
+  obs_manager.IncrementCorrespondenceHasPoint3D(kImageId1, 0, kInvDepth);
+  const Eigen::Vector2d cam_point = camera.CamFromImg(points2D[0]);
+  const double x = cam_point(0);
+  const double y = cam_point(1);
+  Eigen::Matrix<double, 2, 6> J;
+  J << x * y, -(1 + x * x), y, kInvDepth, 0, -kInvDepth * x,  //
+      1 + y * y, -x * y, -x, 0, kInvDepth, -kInvDepth * y;
+  J *= camera.MeanFocalLength();
+  const Eigen::Matrix6d expected_information = J.transpose() * J;
+  EXPECT_TRUE(obs_manager.PoseInformation(kImageId1)
+                  .isApprox(expected_information, 1e-5));
+  EXPECT_EQ(obs_manager.PoseInformationLogDet(kImageId1),
+            std::numeric_limits<double>::lowest());
+
+  // Further correspondences of the same observation do not add information.
+  obs_manager.IncrementCorrespondenceHasPoint3D(kImageId1, 0, 2 * kInvDepth);
+  EXPECT_TRUE(obs_manager.PoseInformation(kImageId1)
+                  .isApprox(expected_information, 1e-5));
+
+  // Sufficiently many observations fully constrain the pose, and more
+  // observations reduce its uncertainty.
+  for (point2D_t point2D_idx = 1; point2D_idx < points2D.size() - 1;
+       ++point2D_idx) {
+    obs_manager.IncrementCorrespondenceHasPoint3D(
+        kImageId1, point2D_idx, kInvDepth * (1 + point2D_idx));
+  }
+  const double log_det = obs_manager.PoseInformationLogDet(kImageId1);
+  EXPECT_GT(log_det, std::numeric_limits<double>::lowest());
+  obs_manager.IncrementCorrespondenceHasPoint3D(
+      kImageId1, points2D.size() - 1, kInvDepth);
+  EXPECT_GT(obs_manager.PoseInformationLogDet(kImageId1), log_det);
+
+  // Removing all observations removes all information.
+  for (point2D_t point2D_idx = 0; point2D_idx < points2D.size();
+       ++point2D_idx) {
+    obs_manager.DecrementCorrespondenceHasPoint3D(kImageId1, point2D_idx);
+  }
+  obs_manager.DecrementCorrespondenceHasPoint3D(kImageId1, 0);
+  EXPECT_LT(obs_manager.PoseInformation(kImageId1).cwiseAbs().maxCoeff(),
+            1e-6);
+  EXPECT_EQ(obs_manager.PoseInformation(kImageId2), Eigen::Matrix6d::Zero());
+}
+
+TEST(ObservationManager, AccumulatePoseInformation) {
+  SyntheticDatasetOptions synthetic_dataset_options;
+  synthetic_dataset_options.num_images = 2;
+  Reconstruction reconstruction;
+  SynthesizeDataset(synthetic_dataset_options, &reconstruction);
+  const image_t kImageId1 = reconstruction.RegImageIds()[0];
+  const image_t kImageId2 = reconstruction.RegImageIds()[1];
+  auto correspondence_graph = std::make_shared<CorrespondenceGraph>();
+  correspondence_graph->AddImage(
+      kImageId1, reconstruction.Image(kImageId1).NumPoints2D());
+  correspondence_graph->AddImage(
+      kImageId2, reconstruction.Image(kImageId2).NumPoints2D());
+  FeatureMatches matches;
+  for (const auto& point3D : reconstruction.Points3D()) {
+    const Track& track = point3D.second.track;
+    ASSERT_EQ(track.Length(), 2);
+    if (track.Element(0).image_id == kImageId1) {
+      matches.emplace_back(track.Element(0).point2D_idx,
+                           track.Element(1).point2D_idx);
+    } else {
+      matches.emplace_back(track.Element(1).point2D_idx,
+                           track.Element(0).point2D_idx);
+    }
+  }
+  correspondence_graph->AddCorrespondences(kImageId1, kImageId2, matches);
+  correspondence_graph->Finalize();
+  ObservationManager obs_manager(reconstruction, correspondence_graph);
+
+  // The information is not accumulated by default.
+  EXPECT_FALSE(obs_manager.AccumulatePoseInformation());
+  for (const image_t image_id : reconstruction.RegImageIds()) {
+    EXPECT_EQ(obs_manager.PoseInformation(image_id), Eigen::Matrix6d::Zero());
+  }
+
+  // Enabling the accumulation computes the information from the current
+  // triangulated points.
+  obs_manager.SetAccumulatePoseInformation(true);
+  EXPECT_TRUE(obs_manager.AccumulatePoseInformation());
+  std::unordered_map<image_t, Eigen::Matrix6d> pose_informations;
+  for (const image_t image_id : reconstruction.RegImageIds()) {
+    EXPECT_GT(obs_manager.PoseInformationLogDet(image_id),
+              std::numeric_limits<double>::lowest());
+    pose_informations.emplace(image_id, obs_manager.PoseInformation(image_id));
+  }
+
+  // The incrementally accumulated information matches the computed one, since
+  // every image point has a single correspondence in the other image.
+  const std::unordered_map<point3D_t, Point3D> points3D =
+      reconstruction.Points3D();
+  for (const auto& point3D : points3D) {
+    obs_manager.DeletePoint3D(point3D.first);
+  }
+  for (const image_t image_id : reconstruction.RegImageIds()) {
+    EXPECT_LT(obs_manager.PoseInformation(image_id).cwiseAbs().maxCoeff(),
+              1e-3);
+  }
+  for (const auto& point3D : points3D) {
+    obs_manager.AddPoint3D(point3D.second.xyz, point3D.second.track);
+  }
+  for (const image_t image_id : reconstruction.RegImageIds()) {
+    EXPECT_TRUE(obs_manager.PoseInformation(image_id).isApprox(
+        pose_informations.at(image_id), 1e-6));
+  }
+
+  // Disabling the accumulation clears the information.
+  obs_manager.SetAccumulatePoseInformation(false);
+  for (const image_t image_id : reconstruction.RegImageIds()) {
+    EXPECT_EQ(obs_manager.PoseInformation(image_id), Eigen::Matrix6d::Zero());
+  }
+}
+
 }  // namespace
 }  // namespace colmap
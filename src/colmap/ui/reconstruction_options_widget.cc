@@ -47,6 +47,12 @@ MapperGeneralOptionsWidget::MapperGeneralOptionsWidget(QWidget* parent,
   AddOptionDirPath(&options->mapper->snapshot_path, "snapshot_path");
   AddOptionInt(
       &options->mapper->snapshot_images_freq, "snapshot_images_freq", 0);
+  AddOptionBool(&options->mapper->snapshot_async, "snapshot_async");
+  AddOptionDirPath(&options->mapper->checkpoint_path, "checkpoint_path");
+  AddOptionInt(
+      &options->mapper->checkpoint_images_freq, "checkpoint_images_freq", 0);
+  AddOptionBool(&options->mapper->resume_from_checkpoint,
+                "resume_from_checkpoint");
 }
 
 MapperTriangulationOptionsWidget::MapperTriangulationOptionsWidget(
@@ -113,6 +119,9 @@ MapperBundleAdjustmentOptionsWidget::MapperBundleAdjustmentOptionsWidget(
                 "refine_principal_point");
   AddOptionBool(&options->mapper->ba_refine_extra_params,
                 "refine_extra_params");
+  AddOptionBool(&options->mapper->ba_use_schur_solver, "use_schur_solver");
+  AddOptionBool(&options->mapper->ba_use_mixed_precision,
+                "use_mixed_precision");
 
   AddSpacer();
 
@@ -138,6 +147,12 @@ MapperBundleAdjustmentOptionsWidget::MapperBundleAdjustmentOptionsWidget(
   AddOptionInt(&options->mapper->ba_global_points_freq, "points_freq");
   AddOptionInt(&options->mapper->ba_global_max_num_iterations,
                "max_num_iterations");
+  AddOptionInt(&options->mapper->ba_global_partition_min_num_images,
+               "partition_min_num_images",
+               0);
+  AddOptionInt(&options->mapper->ba_global_partition_max_num_images,
+               "partition_max_num_images",
+               1);
   AddOptionInt(
       &options->mapper->ba_global_max_refinements, "max_refinements", 1);
   AddOptionDouble(&options->mapper->ba_global_max_refinement_change,
@@ -0,0 +1,82 @@
+// Copyright (c) 2023, ETH Zurich and UNC Chapel Hill.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of ETH Zurich and UNC Chapel Hill nor the names of
+//       its contributors may be used to endorse or promote products derived
+//       from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "colmap/util/mapped_file.h"
+
+#include "colmap/util/logging.h"
+#include "colmap/util/misc.h"
+
+#include <fstream>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace colmap {
+
+MappedFile::MappedFile(const std::string& path, const bool sequential) {
+#ifdef _WIN32
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  THROW_CHECK_FILE_OPEN(file, path);
+  buffer_.resize(static_cast<size_t>(file.tellg()));
+  file.seekg(0, std::ios::beg);
+  file.read(buffer_.data(), buffer_.size());
+  THROW_CHECK(file.good() || buffer_.empty()) << path;
+  data_ = buffer_.data();
+  size_ = buffer_.size();
+#else
+  fd_ = open(path.c_str(), O_RDONLY);
+  THROW_CHECK_NE(fd_, -1) << "Could not open file: " << path;
+  struct stat file_stat;
+  THROW_CHECK_EQ(fstat(fd_, &file_stat), 0) << path;
+  size_ = static_cast<size_t>(file_stat.st_size);
+  if (size_ > 0) {
+    void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+    THROW_CHECK(data != MAP_FAILED) << "Could not map file: " << path;
+    madvise(data, size_, sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+    data_ = static_cast<const char*>(data);
+  }
+#endif
+}
+
+MappedFile::~MappedFile() {
+#ifndef _WIN32
+  if (data_ != nullptr) {
+    munmap(const_cast<char*>(data_), size_);
+  }
+  if (fd_ != -1) {
+    close(fd_);
+  }
+#endif
+}
+
+}  // namespace colmap
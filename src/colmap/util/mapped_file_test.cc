@@ -0,0 +1,67 @@
+// Copyright (c) 2023, ETH Zurich and UNC Chapel Hill.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are met:
+//
+//     * Redistributions of source code must retain the above copyright
+//       notice, this list of conditions and the following disclaimer.
+//
+//     * Redistributions in binary form must reproduce the above copyright
+//       notice, this list of conditions and the following disclaimer in the
+//       documentation and/or other materials provided with the distribution.
+//
+//     * Neither the name of ETH Zurich and UNC Chapel Hill nor the names of
+//       its contributors may be used to endorse or promote products derived
+//       from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+// AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+// ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDERS OR CONTRIBUTORS BE
+// LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+// CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+// SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+// ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+// POSSIBILITY OF SUCH DAMAGE.
+
+#include "colmap/util/mapped_file.h"
+
+#include "colmap/util/testing.h"
+
+#include <fstream>
+
+#include <gtest/gtest.h>
+
+namespace colmap {
+namespace {
+
+TEST(MappedFile, Nominal) {
+  const std::string path = CreateTestDir() + "/file.bin";
+  const std::string data = "mapped\0file";
+  {
+    std::ofstream file(path, std::ios::binary);
+    file.write(data.data(), data.size());
+  }
+  for (const bool sequential : {true, false}) {
+    const MappedFile file(path, sequential);
+    ASSERT_EQ(file.Size(), data.size());
+    EXPECT_EQ(std::string(file.Data(), file.Size()), data);
+  }
+}
+
+TEST(MappedFile, Empty) {
+  const std::string path = CreateTestDir() + "/file.bin";
+  { std::ofstream file(path, std::ios::binary); }
+  const MappedFile file(path);
+  EXPECT_EQ(file.Size(), 0);
+}
+
+TEST(MappedFile, Missing) {
+  EXPECT_ANY_THROW(MappedFile(CreateTestDir() + "/missing.bin"));
+}
+
+}  // namespace
+}  // namespace colmap
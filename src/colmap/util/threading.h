@@ -31,6 +31,7 @@
 
 #include "colmap/util/timer.h"
 
+#include <algorithm>
 #include <atomic>
 #include <climits>
 #include <functional>
@@ -40,6 +41,7 @@
 #include <thread>
 #include <type_traits>
 #include <unordered_map>
+#include <vector>
 
 namespace colmap {
 
@@ -318,6 +320,25 @@ class JobQueue {
 // otherwise return the input value of num_threads.
 int GetEffectiveNumThreads(int num_threads);
 
+// Calls func(begin, end) for consecutive chunks of [0, num_items) in parallel,
+// where num_threads <= 0 uses all available cores. At most one thread per
+// chunk is started and a single chunk or thread processes the chunks in the
+// calling thread.
+template <typename Func>
+void ParallelForChunks(int num_threads,
+                       size_t num_items,
+                       size_t chunk_size,
+                       const Func& func);
+
+// Same as above but submits the chunks to an existing thread pool and waits
+// for them to finish, which avoids starting new threads in repeated calls.
+// The chunks are processed in the calling thread, if the thread pool is null.
+template <typename Func>
+void ParallelForChunks(ThreadPool* thread_pool,
+                       size_t num_items,
+                       size_t chunk_size,
+                       const Func& func);
+
 ////////////////////////////////////////////////////////////////////////////////
 // Implementation
 ////////////////////////////////////////////////////////////////////////////////
@@ -421,4 +442,45 @@ void JobQueue<T>::Clear() {
   std::swap(jobs_, empty_jobs);
 }
 
+template <typename Func>
+void ParallelForChunks(const int num_threads,
+                       const size_t num_items,
+                       const size_t chunk_size,
+                       const Func& func) {
+  const size_t num_chunks = (num_items + chunk_size - 1) / chunk_size;
+  const int num_eff_threads = static_cast<int>(
+      std::min<size_t>(GetEffectiveNumThreads(num_threads), num_chunks));
+  if (num_eff_threads <= 1) {
+    for (size_t begin = 0; begin < num_items; begin += chunk_size) {
+      func(begin, std::min(begin + chunk_size, num_items));
+    }
+    return;
+  }
+  ThreadPool thread_pool(num_eff_threads);
+  ParallelForChunks(&thread_pool, num_items, chunk_size, func);
+}
+
+template <typename Func>
+void ParallelForChunks(ThreadPool* thread_pool,
+                       const size_t num_items,
+                       const size_t chunk_size,
+                       const Func& func) {
+  if (thread_pool == nullptr || num_items <= chunk_size) {
+    for (size_t begin = 0; begin < num_items; begin += chunk_size) {
+      func(begin, std::min(begin + chunk_size, num_items));
+    }
+    return;
+  }
+  std::vector<std::future<void>> futures;
+  futures.reserve((num_items + chunk_size - 1) / chunk_size);
+  for (size_t begin = 0; begin < num_items; begin += chunk_size) {
+    const size_t end = std::min(begin + chunk_size, num_items);
+    futures.push_back(
+        thread_pool->AddTask([&func, begin, end]() { func(begin, end); }));
+  }
+  for (auto& future : futures) {
+    future.get();
+  }
+}
+
 }  // namespace colmap
@@ -896,5 +896,49 @@ TEST(GetEffectiveNumThreads, Nominal) {
   EXPECT_EQ(GetEffectiveNumThreads(3), 3);
 }
 
+TEST(ParallelForChunks, Nominal) {
+  for (const int num_threads : {-1, 1, 4}) {
+    for (const size_t num_items : {0, 1, 10, 99}) {
+      std::vector<std::atomic<int>> counts(num_items);
+      ParallelForChunks(num_threads,
+                        num_items,
+                        /*chunk_size=*/7,
+                        [&](const size_t begin, const size_t end) {
+                          EXPECT_LT(begin, end);
+                          EXPECT_LE(end - begin, 7);
+                          for (size_t i = begin; i < end; ++i) {
+                            ++counts[i];
+                          }
+                        });
+      for (const auto& count : counts) {
+        EXPECT_EQ(count, 1);
+      }
+    }
+  }
+}
+
+TEST(ParallelForChunks, ThreadPool) {
+  ThreadPool thread_pool(4);
+  for (ThreadPool* pool : {static_cast<ThreadPool*>(nullptr), &thread_pool}) {
+    // Repeated calls reuse the same thread pool.
+    for (const size_t num_items : {0, 1, 10, 99, 10, 1}) {
+      std::vector<std::atomic<int>> counts(num_items);
+      ParallelForChunks(pool,
+                        num_items,
+                        /*chunk_size=*/7,
+                        [&](const size_t begin, const size_t end) {
+                          EXPECT_LT(begin, end);
+                          EXPECT_LE(end - begin, 7);
+                          for (size_t i = begin; i < end; ++i) {
+                            ++counts[i];
+                          }
+                        });
+      for (const auto& count : counts) {
+        EXPECT_EQ(count, 1);
+      }
+    }
+  }
+}
+
 }  // namespace
 }  // namespace colmap
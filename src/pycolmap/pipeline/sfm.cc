@@ -111,6 +111,14 @@ void BindSfM(py::module& m) {
           "ignore_watermarks",
           &MapperOpts::ignore_watermarks,
           "Whether to ignore the inlier matches of watermark image pairs.")
+      .def_readwrite("compact_correspondence_graph",
+                     &MapperOpts::compact_correspondence_graph,
+                     "Whether to store the correspondence graph in a compact "
+                     "layout, which roughly halves its memory.")
+      .def_readwrite("correspondence_graph_path",
+                     &MapperOpts::correspondence_graph_path,
+                     "If not empty, the correspondence graph is stored out "
+                     "of core in files at this path.")
       .def_readwrite("multiple_models",
                      &MapperOpts::multiple_models,
                      "Whether to reconstruct multiple sub-models.")
@@ -175,6 +183,15 @@ void BindSfM(py::module& m) {
           &MapperOpts::ba_min_num_residuals_for_multi_threading,
           "The minimum number of residuals per bundle adjustment problem to "
           "enable multi-threading solving of the problems.")
+      .def_readwrite("ba_use_schur_solver",
+                     &MapperOpts::ba_use_schur_solver,
+                     "Whether to use the specialized Schur complement solver "
+                     "instead of Ceres-Solver for bundle adjustment.")
+      .def_readwrite("ba_use_mixed_precision",
+                     &MapperOpts::ba_use_mixed_precision,
+                     "Whether the Schur complement solver stores the "
+                     "Jacobians and the reduced camera system in single "
+                     "precision.")
       .def_readwrite(
           "ba_local_num_images",
           &MapperOpts::ba_local_num_images,
@@ -211,6 +228,15 @@ void BindSfM(py::module& m) {
           "ba_global_max_num_iterations",
           &MapperOpts::ba_global_max_num_iterations,
           "The maximum number of global bundle adjustment iterations.")
+      .def_readwrite("ba_global_partition_min_num_images",
+                     &MapperOpts::ba_global_partition_min_num_images,
+                     "The minimum number of registered images to partition "
+                     "global bundle adjustment into submaps that are solved "
+                     "in parallel. Partitioning is disabled if zero.")
+      .def_readwrite("ba_global_partition_max_num_images",
+                     &MapperOpts::ba_global_partition_max_num_images,
+                     "The maximum number of images per submap in partitioned "
+                     "global bundle adjustment.")
       .def_readwrite(
           "ba_local_max_refinements",
           &MapperOpts::ba_local_max_refinements,
@@ -235,6 +261,24 @@ void BindSfM(py::module& m) {
                      &MapperOpts::snapshot_images_freq,
                      "Frequency of registered images according to which "
                      "reconstruction snapshots will be saved.")
+      .def_readwrite("snapshot_async",
+                     &MapperOpts::snapshot_async,
+                     "Whether to write snapshots on a background thread from "
+                     "a copy of the reconstruction. The mapping still stalls "
+                     "for the deep copy of the 3D points, tracks, and image "
+                     "points of the registered images.")
+      .def_readwrite("checkpoint_path",
+                     &MapperOpts::checkpoint_path,
+                     "Path to a folder with the checkpoint of the incremental "
+                     "reconstruction, from which it can be resumed.")
+      .def_readwrite("checkpoint_images_freq",
+                     &MapperOpts::checkpoint_images_freq,
+                     "Frequency of registered images according to which the "
+                     "checkpoint will be updated.")
+      .def_readwrite("resume_from_checkpoint",
+                     &MapperOpts::resume_from_checkpoint,
+                     "Whether to resume the reconstruction from the "
+                     "checkpoint, if it exists.")
       .def_readwrite("image_names",
                      &MapperOpts::image_names,
                      "Which images to reconstruct. If no images are specified, "
@@ -298,6 +342,16 @@ void BindSfM(py::module& m) {
                          "single-threaded is typically better for small bundle "
                          "adjustment problems "
                          "due to the overhead of threading. ")
+          .def_readwrite("use_schur_solver",
+                         &BAOpts::use_schur_solver,
+                         "Whether to solve the problem with the specialized "
+                         "Schur complement solver instead of Ceres-Solver.")
+          .def_readwrite("use_mixed_precision",
+                         &BAOpts::use_mixed_precision,
+                         "Whether the Schur complement solver stores the "
+                         "Jacobians and the reduced camera system in single "
+                         "precision, while residuals, parameters, and the "
+                         "refinement of the solution use double precision.")
           .def_readwrite(
               "solver_options",
               &BAOpts::solver_options,
@@ -63,7 +63,15 @@ void BindCorrespondenceGraph(py::module& m) {
            py::overload_cast<>(
                &CorrespondenceGraph::NumCorrespondencesBetweenImages,
                py::const_))
-      .def("finalize", &CorrespondenceGraph::Finalize)
+      .def("finalize",
+           &CorrespondenceGraph::Finalize,
+           "compact_layout"_a = false)
+      .def("has_compact_layout", &CorrespondenceGraph::HasCompactLayout)
+      .def("set_out_of_core",
+           &CorrespondenceGraph::SetOutOfCore,
+           "path"_a,
+           "max_num_buffered_corrs"_a = 1 << 24)
+      .def("is_out_of_core", &CorrespondenceGraph::IsOutOfCore)
       .def("add_image",
            &CorrespondenceGraph::AddImage,
            "image_id"_a,
@@ -1,5 +1,6 @@
 #include "colmap/scene/database.h"
 
+#include "pycolmap/helpers.h"
 #include "pycolmap/pybind11_extension.h"
 
 #include <pybind11/eigen.h>
@@ -27,10 +28,24 @@ class DatabaseTransactionWrapper {
 
 void BindDatabase(py::module& m) {
   py::class_<Database, std::shared_ptr<Database>> PyDatabase(m, "Database");
+
+  auto PyBlobEncoding =
+      py::enum_<Database::BlobEncoding>(PyDatabase, "BlobEncoding")
+          .value("RAW", Database::BlobEncoding::RAW)
+          .value("PACKED", Database::BlobEncoding::PACKED)
+          .value("PACKED_LZ4", Database::BlobEncoding::PACKED_LZ4);
+  AddStringToEnumConstructor(PyBlobEncoding);
+
   PyDatabase.def(py::init<>())
       .def(py::init<const std::string&>(), "path"_a)
       .def("open", &Database::Open, "path"_a)
       .def("close", &Database::Close)
+      .def_property("blob_encoding",
+                    &Database::GetBlobEncoding,
+                    &Database::SetBlobEncoding,
+                    "Encoding for writing keypoints, matches, and inlier "
+                    "matches, which is persisted in the database. Existing "
+                    "rows are not converted.")
       .def_property_readonly("num_cameras", &Database::NumCameras)
       .def_property_readonly("num_images", &Database::NumImages)
       .def_property_readonly("num_keypoints", &Database::NumKeypoints)
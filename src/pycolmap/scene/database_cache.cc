@@ -18,7 +18,9 @@ void BindDatabaseCache(py::module& m) {
                   "database"_a,
                   "min_num_matches"_a,
                   "ignore_watermarks"_a,
-                  "image_names"_a)
+                  "image_names"_a,
+                  "compact_correspondence_graph"_a = false,
+                  "correspondence_graph_path"_a = "")
       .def("num_cameras", &DatabaseCache::NumCameras)
       .def("num_images", &DatabaseCache::NumImages)
       .def("exists_camera", &DatabaseCache::ExistsCamera, "camera_id"_a)
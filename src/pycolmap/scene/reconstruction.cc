@@ -100,6 +100,12 @@ void BindReconstruction(py::module& m) {
            "xyz"_a,
            "track"_a,
            "color"_a = Eigen::Vector3ub::Zero())
+      .def("set_point3D_xyz",
+           &Reconstruction::SetPoint3DXYZ,
+           "point3D_id"_a,
+           "xyz"_a,
+           "Set the position of an existing 3D point and update the spatial "
+           "index.")
       .def("add_observation",
            &Reconstruction::AddObservation,
            "Add observation to existing 3D point.")
@@ -154,6 +160,38 @@ void BindReconstruction(py::module& m) {
            "p0"_a = 0.0,
            "p1"_a = 1.0)
       .def("crop", &Reconstruction::Crop)
+      .def("enable_points3D_spatial_index",
+           &Reconstruction::EnablePoints3DSpatialIndex,
+           "voxel_size"_a,
+           "Enable a spatial index over the 3D points to accelerate the "
+           "spatial queries.")
+      .def("disable_points3D_spatial_index",
+           &Reconstruction::DisablePoints3DSpatialIndex)
+      .def("update_point3D_spatial_index",
+           &Reconstruction::UpdatePoint3DSpatialIndex,
+           "point3D_id"_a,
+           "Re-index a 3D point after modifying its position in place, e.g. "
+           "through the points3D map.")
+      .def("update_points3D_spatial_index",
+           &Reconstruction::UpdatePoints3DSpatialIndex,
+           "Re-index all 3D points after modifying their positions in place.")
+      .def("has_points3D_spatial_index",
+           &Reconstruction::HasPoints3DSpatialIndex)
+      .def("find_points3D_in_radius",
+           &Reconstruction::FindPoints3DInRadius,
+           "center"_a,
+           "radius"_a,
+           "Find the 3D points within the given distance of the center.")
+      .def("find_points3D_in_box",
+           &Reconstruction::FindPoints3DInBox,
+           "min_xyz"_a,
+           "max_xyz"_a,
+           "Find the 3D points inside the axis-aligned box.")
+      .def("find_nearest_points3D",
+           &Reconstruction::FindNearestPoints3D,
+           "xyz"_a,
+           "k"_a,
+           "Find the k nearest 3D points ordered by increasing distance.")
       .def("find_image_with_name",
            &Reconstruction::FindImageWithName,
            py::return_value_policy::reference_internal,
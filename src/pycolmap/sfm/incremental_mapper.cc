@@ -130,6 +130,11 @@ void BindIncrementalMapperOptions(py::module& m) {
                      &Opts::local_ba_min_tri_angle,
                      "Minimum triangulation for images to be chosen in local "
                      "bundle adjustment.")
+      .def_readwrite("global_ba_partition_min_num_images",
+                     &Opts::global_ba_partition_min_num_images,
+                     "Minimum number of registered images to partition global "
+                     "bundle adjustment into submaps that are solved in "
+                     "parallel. Partitioning is disabled if zero.")
       .def_readwrite("min_focal_length_ratio",
                      &Opts::min_focal_length_ratio,
                      "The threshold used to filter and ignore images with "
@@ -175,7 +180,8 @@ void BindIncrementalMapperImpl(py::module& m) {
                  ImageSelection::MAX_VISIBLE_POINTS_NUM)
           .value("MAX_VISIBLE_POINTS_RATIO",
                  ImageSelection::MAX_VISIBLE_POINTS_RATIO)
-          .value("MIN_UNCERTAINTY", ImageSelection::MIN_UNCERTAINTY);
+          .value("MIN_UNCERTAINTY", ImageSelection::MIN_UNCERTAINTY)
+          .value("MIN_POSE_UNCERTAINTY", ImageSelection::MIN_POSE_UNCERTAINTY);
   AddStringToEnumConstructor(PyImageSelectionMethod);
 
   // bind local bundle adjustment report
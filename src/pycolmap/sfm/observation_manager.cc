@@ -19,6 +19,14 @@ void BindObservationManager(py::module& m) {
       .def_readwrite("num_tri_corrs", &ImagePairStat::num_tri_corrs)
       .def_readwrite("num_total_corrs", &ImagePairStat::num_total_corrs);
 
+  using FilterTimes = struct ObservationManager::FilterTimes;
+  py::class_ext_<FilterTimes, std::shared_ptr<FilterTimes>>(m, "FilterTimes")
+      .def(py::init<>())
+      .def_readonly("large_reproj_error", &FilterTimes::large_reproj_error)
+      .def_readonly("small_tri_angle", &FilterTimes::small_tri_angle)
+      .def_readonly("negative_depth", &FilterTimes::negative_depth)
+      .def_readonly("images", &FilterTimes::images);
+
   py::class_<ObservationManager, std::shared_ptr<ObservationManager>>(
       m, "ObservationManager")
       .def(py::init<Reconstruction&,
@@ -62,6 +70,7 @@ void BindObservationManager(py::module& m) {
            "max_reproj_error"_a,
            "min_tri_angle"_a,
            "point3D_ids"_a,
+           "num_threads"_a = 1,
            "Filter 3D points with large reprojection error, negative depth, or"
            "insufficient triangulation angle.\n"
            "@param max_reproj_error    The maximum reprojection error.\n"
@@ -74,6 +83,7 @@ void BindObservationManager(py::module& m) {
           "max_reproj_error"_a,
           "min_tri_angle"_a,
           "image_ids"_a,
+          "num_threads"_a = 1,
           "Filter 3D points with large reprojection error, negative depth, or\n"
           "insufficient triangulation angle.\n\n"
           "@param max_reproj_error    The maximum reprojection error.\n"
@@ -86,6 +96,7 @@ void BindObservationManager(py::module& m) {
           &ObservationManager::FilterAllPoints3D,
           "max_reproj_error"_a,
           "min_tri_angle"_a,
+          "num_threads"_a = 1,
           "Filter 3D points with large reprojection error, negative depth, or\n"
           "insufficient triangulation angle.\n\n"
           "@param max_reproj_error    The maximum reprojection error.\n"
@@ -93,6 +104,7 @@ void BindObservationManager(py::module& m) {
           "@return                    The number of filtered observations.")
       .def("filter_observations_with_negative_depth",
            &ObservationManager::FilterObservationsWithNegativeDepth,
+           "num_threads"_a = 1,
            "Filter observations that have negative depth.\n\n"
            "@return    The number of filtered observations.")
       .def("filter_images",
@@ -100,8 +112,11 @@ void BindObservationManager(py::module& m) {
            "min_focal_length_ratio"_a,
            "max_focal_length_ratio"_a,
            "max_extra_param"_a,
+           "num_threads"_a = 1,
            "Filter images without observations or bogus camera parameters.\n\n"
            "@return    The identifiers of the filtered images.")
+      .def_property_readonly("filter_times", &ObservationManager::FilterTimes)
+      .def("reset_filter_times", &ObservationManager::ResetFilterTimes)
       .def("deregister_image",
            &ObservationManager::DeRegisterImage,
            "image_id"_a,
@@ -130,12 +145,36 @@ void BindObservationManager(py::module& m) {
            "select the next best image in incremental reconstruction, because a"
            "more uniform distribution of observations results in more robust "
            "registration.")
+      .def_property("accumulate_pose_information",
+                    &ObservationManager::AccumulatePoseInformation,
+                    &ObservationManager::SetAccumulatePoseInformation,
+                    "Whether to accumulate the pose information. Disabled by "
+                    "default. Enabling it computes the information from the "
+                    "current state.")
+      .def("pose_information",
+           &ObservationManager::PoseInformation,
+           "image_id"_a,
+           "Get the Fisher information of the pose of the image (in the order "
+           "of rotation and translation) from its observations that see a "
+           "triangulated point, assuming unit reprojection noise in pixels. "
+           "Zero unless the accumulation is enabled.")
+      .def("pose_information_log_det",
+           &ObservationManager::PoseInformationLogDet,
+           "image_id"_a,
+           "Get the log-determinant of the pose information, i.e. the "
+           "negative log-determinant of the pose covariance. Larger values "
+           "correspond to less uncertain poses. This is the rank of the "
+           "MIN_POSE_UNCERTAINTY image selection method.")
       .def("increment_correspondence_has_point3D",
            &ObservationManager::IncrementCorrespondenceHasPoint3D,
            "image_id"_a,
            "point2D_idx"_a,
+           "point3D_inv_depth"_a = 1.0,
            "Indicate that another image has a point that is triangulated and "
-           "has a correspondence to this image point.")
+           "has a correspondence to this image point. The inverse depth of "
+           "the point in the other image approximates its unknown inverse "
+           "depth in this image for the pose information and is only used by "
+           "the first such correspondence.")
       .def("decrement_correspondence_has_point3D",
            &ObservationManager::DecrementCorrespondenceHasPoint3D,
            "image_id"_a,